@@ -0,0 +1,202 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 265 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// number of times each configuration is timed
+const int DEFAULT_REPETITIONS   = 5;
+
+
+//---------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//---------------------------------------------------------------------------
+
+// parse a file several times and return the best time in milliseconds
+double timeParsing(const char* a_fileName, int a_repetitions, cOBJModel& a_model);
+
+// check that two parses of the same file produced the same arrays
+bool sameModel(const cOBJModel& a_model0, const cOBJModel& a_model1);
+
+
+//===========================================================================
+/*
+    DEMO:    26-obj-bench.cpp
+
+    This program measures the time taken by cOBJModel::LoadModel() to
+    parse an OBJ file, first sequentially and then split in chunks
+    parsed on thread pools of increasing size. Meshes are not built, so
+    only the parsing stage is measured.
+
+    Usage: 26-obj-bench <file.obj> [threads] [repetitions]
+
+    By default, pools of up to one thread per processor are used.
+*/
+//===========================================================================
+
+int main(int argc, char* argv[])
+{
+    //-----------------------------------------------------------------------
+    // INITIALIZATION
+    //-----------------------------------------------------------------------
+
+    printf ("\n");
+    printf ("-----------------------------------\n");
+    printf ("CHAI 3D\n");
+    printf ("Demo: 26-obj-bench\n");
+    printf ("Copyright 2003-2009\n");
+    printf ("-----------------------------------\n");
+    printf ("\n\n");
+
+    if (argc < 2)
+    {
+        printf ("Usage: %s <file.obj> [threads] [repetitions]\n\n", argv[0]);
+        return (1);
+    }
+
+    const char* fileName = argv[1];
+    int numThreads = (argc > 2) ? atoi(argv[2]) : (int)cThreadPool::getNumProcessors();
+    int repetitions = (argc > 3) ? atoi(argv[3]) : DEFAULT_REPETITIONS;
+    if (numThreads < 1) { numThreads = 1; }
+    if (repetitions < 1) { repetitions = 1; }
+
+    printf ("File: %s\n", fileName);
+    printf ("Processors: %u\n", cThreadPool::getNumProcessors());
+    printf ("Repetitions: %d (best time is reported)\n\n", repetitions);
+
+
+    //-----------------------------------------------------------------------
+    // SEQUENTIAL PARSING
+    //-----------------------------------------------------------------------
+
+    g_objLoaderUseParallelParsing = false;
+
+    cOBJModel reference;
+    double sequentialTime = timeParsing(fileName, repetitions, reference);
+    if (sequentialTime < 0.0)
+    {
+        printf ("Error - could not load %s\n\n", fileName);
+        return (1);
+    }
+
+    printf ("Vertices: %u   Faces: %u   Corners: %u\n\n",
+            (unsigned int)reference.m_vertices.size(),
+            (unsigned int)reference.m_faces.size(),
+            (unsigned int)reference.m_corners.size());
+    printf ("sequential            %10.2f ms\n", sequentialTime);
+
+
+    //-----------------------------------------------------------------------
+    // CHUNKED PARSING
+    //-----------------------------------------------------------------------
+
+    // the calling thread parses chunks as well, so a pool of n threads
+    // has n - 1 workers
+    g_objLoaderUseParallelParsing = true;
+    for (int threads=2; threads<=numThreads; threads++)
+    {
+        cThreadPool* pool = new cThreadPool(threads - 1);
+        g_objLoaderThreadPool = pool;
+
+        cOBJModel model;
+        double chunkedTime = timeParsing(fileName, repetitions, model);
+
+        printf ("chunked, %2d threads   %10.2f ms   speedup %5.2f %s\n",
+                threads, chunkedTime, sequentialTime / chunkedTime,
+                sameModel(reference, model) ? "" : "(MODEL DIFFERS)");
+
+        g_objLoaderThreadPool = NULL;
+        delete pool;
+    }
+
+    if (numThreads < 2)
+    {
+        printf ("\nChunked parsing needs at least 2 threads.\n");
+    }
+    printf ("\n");
+
+    return (0);
+}
+
+//---------------------------------------------------------------------------
+
+double timeParsing(const char* a_fileName, int a_repetitions, cOBJModel& a_model)
+{
+    cPrecisionClock clock;
+    double best = -1.0;
+
+    // the first load also brings the file in the system cache
+    if (!a_model.LoadModel(a_fileName)) { return (-1.0); }
+
+    for (int i=0; i<a_repetitions; i++)
+    {
+        cOBJModel model;
+        clock.start(true);
+        model.LoadModel(a_fileName);
+        double time = 1000.0 * clock.stop();
+
+        if ((best < 0.0) || (time < best)) { best = time; }
+    }
+
+    return (best);
+}
+
+//---------------------------------------------------------------------------
+
+bool sameModel(const cOBJModel& a_model0, const cOBJModel& a_model1)
+{
+    if ((a_model0.m_vertices.size() != a_model1.m_vertices.size()) ||
+        (a_model0.m_normals.size() != a_model1.m_normals.size()) ||
+        (a_model0.m_texCoords.size() != a_model1.m_texCoords.size()) ||
+        (a_model0.m_faces.size() != a_model1.m_faces.size()) ||
+        (a_model0.m_corners.size() != a_model1.m_corners.size()))
+    {
+        return (false);
+    }
+
+    for (unsigned int i=0; i<a_model0.m_vertices.size(); i++)
+    {
+        if (!a_model0.m_vertices[i].equals(a_model1.m_vertices[i], 0.0)) { return (false); }
+    }
+
+    for (unsigned int i=0; i<a_model0.m_corners.size(); i++)
+    {
+        const cOBJCorner& corner0 = a_model0.m_corners[i];
+        const cOBJCorner& corner1 = a_model1.m_corners[i];
+        if ((corner0.m_vertexIndex != corner1.m_vertexIndex) ||
+            (corner0.m_normalIndex != corner1.m_normalIndex) ||
+            (corner0.m_texCoordIndex != corner1.m_texCoordIndex))
+        {
+            return (false);
+        }
+    }
+
+    return (true);
+}
+
+//---------------------------------------------------------------------------
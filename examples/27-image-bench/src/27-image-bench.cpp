@@ -0,0 +1,271 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 265 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+#if defined(_LINUX) || defined(_MACOSX)
+#include <dirent.h>
+#endif
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// number of times each image is decoded
+const int DEFAULT_REPETITIONS   = 5;
+
+
+//---------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//---------------------------------------------------------------------------
+
+// list the TGA and BMP files of a directory, sorted by name
+void listImages(const std::string& a_directory, std::vector<std::string>& a_fileNames);
+
+// decode an image several times and return the best time in milliseconds
+double timeDecoding(const std::string& a_fileName, int a_repetitions,
+                    unsigned int& a_width, unsigned int& a_height,
+                    unsigned int& a_bitsPerPixel);
+
+// decode an image once, returns true if successful
+bool decodeImage(const std::string& a_fileName,
+                 unsigned int& a_width, unsigned int& a_height,
+                 unsigned int& a_bitsPerPixel);
+
+
+//===========================================================================
+/*
+    DEMO:    27-image-bench.cpp
+
+    This program measures the time taken by cFileLoaderTGA and
+    cFileLoaderBMP to decode every TGA and BMP file of a directory. Each
+    image is decoded several times and the best time is reported, along
+    with the image size and the decoding rate in megapixels per second.
+
+    Usage: 27-image-bench <directory> [repetitions]
+*/
+//===========================================================================
+
+int main(int argc, char* argv[])
+{
+    //-----------------------------------------------------------------------
+    // INITIALIZATION
+    //-----------------------------------------------------------------------
+
+    printf ("\n");
+    printf ("-----------------------------------\n");
+    printf ("CHAI 3D\n");
+    printf ("Demo: 27-image-bench\n");
+    printf ("Copyright 2003-2009\n");
+    printf ("-----------------------------------\n");
+    printf ("\n\n");
+
+    if (argc < 2)
+    {
+        printf ("Usage: %s <directory> [repetitions]\n\n", argv[0]);
+        return (1);
+    }
+
+    std::string directory = argv[1];
+    int repetitions = (argc > 2) ? atoi(argv[2]) : DEFAULT_REPETITIONS;
+    if (repetitions < 1) { repetitions = 1; }
+
+    std::vector<std::string> fileNames;
+    listImages(directory, fileNames);
+
+    printf ("Directory: %s\n", directory.c_str());
+    printf ("Images: %u\n", (unsigned int)fileNames.size());
+    printf ("Repetitions: %d (best time is reported)\n\n", repetitions);
+
+    if (fileNames.size() == 0)
+    {
+        printf ("Error - no TGA or BMP file found in %s\n\n", directory.c_str());
+        return (1);
+    }
+
+
+    //-----------------------------------------------------------------------
+    // DECODING
+    //-----------------------------------------------------------------------
+
+    double totalTime = 0.0;
+    double totalPixels = 0.0;
+    unsigned int numFailed = 0;
+
+    for (unsigned int i=0; i<fileNames.size(); i++)
+    {
+        unsigned int width, height, bitsPerPixel;
+        double time = timeDecoding(directory + "/" + fileNames[i], repetitions,
+                                   width, height, bitsPerPixel);
+        if (time < 0.0)
+        {
+            printf ("%-32s   could not be decoded\n", fileNames[i].c_str());
+            numFailed++;
+            continue;
+        }
+
+        double pixels = (double)width * (double)height;
+        printf ("%-32s %5u x %-5u %2u bpp %10.3f ms %8.1f Mpixels/s\n",
+                fileNames[i].c_str(), width, height, bitsPerPixel, time,
+                (time > 0.0) ? (pixels / (1000.0 * time)) : 0.0);
+
+        totalTime += time;
+        totalPixels += pixels;
+    }
+
+    printf ("\nTotal: %.3f ms", totalTime);
+    if (totalTime > 0.0)
+    {
+        printf (" (%.1f Mpixels/s)", totalPixels / (1000.0 * totalTime));
+    }
+    if (numFailed > 0)
+    {
+        printf (", %u image(s) could not be decoded", numFailed);
+    }
+    printf ("\n\n");
+
+    return ((numFailed > 0) ? 1 : 0);
+}
+
+//---------------------------------------------------------------------------
+
+void listImages(const std::string& a_directory, std::vector<std::string>& a_fileNames)
+{
+    a_fileNames.clear();
+
+#if defined(_WIN32)
+    WIN32_FIND_DATAA data;
+    std::string pattern = a_directory + "\\*";
+    HANDLE handle = FindFirstFileA(pattern.c_str(), &data);
+    if (handle == INVALID_HANDLE_VALUE) { return; }
+    do
+    {
+        if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+        {
+            a_fileNames.push_back(data.cFileName);
+        }
+    }
+    while (FindNextFileA(handle, &data));
+    FindClose(handle);
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    DIR* dir = opendir(a_directory.c_str());
+    if (dir == NULL) { return; }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        a_fileNames.push_back(entry->d_name);
+    }
+    closedir(dir);
+#endif
+
+    // keep the images only
+    std::vector<std::string> images;
+    for (unsigned int i=0; i<a_fileNames.size(); i++)
+    {
+        // skip "." and ".." and names too short to have an extension
+        if (a_fileNames[i].size() < 3) { continue; }
+
+        char* extension = find_extension(a_fileNames[i].c_str());
+        if (extension == NULL) { continue; }
+
+        std::string ext = extension;
+        for (unsigned int j=0; j<ext.size(); j++) { ext[j] = (char)tolower(ext[j]); }
+        if ((ext == "tga") || (ext == "bmp"))
+        {
+            images.push_back(a_fileNames[i]);
+        }
+    }
+
+    std::sort(images.begin(), images.end());
+    a_fileNames.swap(images);
+}
+
+//---------------------------------------------------------------------------
+
+double timeDecoding(const std::string& a_fileName, int a_repetitions,
+                    unsigned int& a_width, unsigned int& a_height,
+                    unsigned int& a_bitsPerPixel)
+{
+    cPrecisionClock clock;
+    double best = -1.0;
+
+    // the first decoding also brings the file in the system cache
+    if (!decodeImage(a_fileName, a_width, a_height, a_bitsPerPixel)) { return (-1.0); }
+
+    for (int i=0; i<a_repetitions; i++)
+    {
+        unsigned int width, height, bitsPerPixel;
+        clock.start(true);
+        decodeImage(a_fileName, width, height, bitsPerPixel);
+        double time = 1000.0 * clock.stop();
+
+        if ((best < 0.0) || (time < best)) { best = time; }
+    }
+
+    return (best);
+}
+
+//---------------------------------------------------------------------------
+
+bool decodeImage(const std::string& a_fileName,
+                 unsigned int& a_width, unsigned int& a_height,
+                 unsigned int& a_bitsPerPixel)
+{
+    char* extension = find_extension(a_fileName.c_str());
+    if (extension == NULL) { return (false); }
+
+    if ((extension[0] == 't') || (extension[0] == 'T'))
+    {
+        cFileLoaderTGA loader;
+        if (!loader.LoadFromFile(a_fileName)) { return (false); }
+        a_width = loader.GetImageWidth();
+        a_height = loader.GetImageHeight();
+        a_bitsPerPixel = loader.GetPixelDepth();
+    }
+    else
+    {
+        // loadBMP() takes a non const file name
+        std::vector<char> fileName(a_fileName.begin(), a_fileName.end());
+        fileName.push_back('\0');
+
+        cFileLoaderBMP loader;
+        if (!loader.loadBMP(&fileName[0])) { return (false); }
+        a_width = loader.getWidth();
+        a_height = loader.getHeight();
+        a_bitsPerPixel = loader.getBpp();
+    }
+
+    return (true);
+}
+
+//---------------------------------------------------------------------------
@@ -386,6 +386,10 @@ int main(int argc, char* argv[])
     // define the integration time constant of the dynamics model
     defWorld->m_integrationTime = 0.001;
 
+    // maintain a spatial hash of the nodes for haptic contact queries
+    defWorld->m_useSpatialHash = true;
+    defWorld->updateSpatialHash();
+
     // create anchors
     cGELSkeletonLink::default_kSpringElongation = 5.0; // [N/m]
     list<cGELSkeletonNode*>::iterator i;
@@ -564,6 +568,9 @@ void updateHaptics(void)
     // reset clock
     simClock.reset();
 
+    // nodes in contact with the device
+    vector<cGELSkeletonNode*> contacts;
+
     // main haptic simulation loop
     while(simulationRunning)
     {
@@ -591,11 +598,12 @@ void updateHaptics(void)
         // clear all external forces
         defWorld->clearExternalForces();
 
-        // compute reaction forces
-        list<cGELSkeletonNode*>::iterator i;
-        for(i = defObject->m_nodes.begin(); i != defObject->m_nodes.end(); ++i)
+        // compute reaction forces with nodes near the device
+        contacts.clear();
+        defWorld->m_spatialHash.queryNodes(pos, deviceRadius, contacts);
+        for(unsigned int i=0; i<contacts.size(); i++)
         {
-            cGELSkeletonNode* nextItem = *i;
+            cGELSkeletonNode* nextItem = contacts[i];
 
             cVector3d nodePos = nextItem->m_pos;
             cVector3d forcec = computeForce(pos, 0, nodePos, deviceRadius+nextItem->m_radius, 1.0);
@@ -706,32 +706,24 @@ bool createTetGenMesh(cGELMesh *a_object, char *a_filename,  char *a_filenameHig
         tetrahedralize(TETGEN_SWITCHES0, &input, &output);
 
         // create a vertex in the object for each point of the result
-        for (int p = 0, pi = 0; p < output.numberofpoints; ++p, pi += 3)
-        {
-            cVector3d point;
-            point.x = output.pointlist[pi+0];
-            point.y = output.pointlist[pi+1];
-            point.z = output.pointlist[pi+2];
-            a_object->newVertex(point);
-        }
+        a_object->reserve(output.numberofpoints, output.numberoftrifaces);
+        a_object->appendVertices(output.pointlist, output.numberofpoints);
 
         // create a triangle for each face on the surface
         set<int> outside;
+        vector<unsigned int> indices(3 * output.numberoftrifaces);
         for (int t = 0, ti = 0; t < output.numberoftrifaces; ++t, ti += 3)
         {
-            cVector3d p[3];
-            int vi[3];
             for (int i = 0; i < 3; ++i) {
-                int tc = output.trifacelist[ti+i];
-                outside.insert(tc);
-                vi[i] = tc;
-                int pi = tc*3;
-                p[i].x = output.pointlist[pi+0];
-                p[i].y = output.pointlist[pi+1];
-                p[i].z = output.pointlist[pi+2];
+                outside.insert(output.trifacelist[ti+i]);
             }
-            //unsigned int index = a_object->newTriangle(p[1], p[0], p[2]);
-            a_object->newTriangle(vi[1], vi[0], vi[2]);
+            indices[ti+0] = output.trifacelist[ti+1];
+            indices[ti+1] = output.trifacelist[ti+0];
+            indices[ti+2] = output.trifacelist[ti+2];
+        }
+        if (output.numberoftrifaces > 0)
+        {
+            a_object->appendTriangles(&indices[0], output.numberoftrifaces);
         }
 
         a_object->computeAllNormals();
@@ -756,33 +748,15 @@ bool createTetGenMesh(cGELMesh *a_object, char *a_filename,  char *a_filenameHig
 
         a_object->buildVertices();
 
-        // get all the edges of our tetrahedra
-        set< pair<int,int> > springs;
-        for (int t = 0, ti = 0; t < output.numberoftetrahedra; ++t, ti += 4)
-        {
-            // store each edge of the tetrahedron as a pair of indices
-            for (int i = 0; i < 4; ++i) {
-                int v0 = output.tetrahedronlist[ti+i];
-                for (int j = i+1; j < 4; ++j) {
-                    int v1 = output.tetrahedronlist[ti+j];
-                    springs.insert(pair<int,int>(min(v0,v1), max(v0,v1)));
-                }
-            }
-        }
-
-        // create a spring on each tetrahedral edge we found in the output
-        cGELLinearSpring::default_kSpringElongation = 40.0; // 0.55;
-        for (set< pair<int,int> >::iterator it = springs.begin(); it != springs.end(); ++it)
+        // use the tetrahedra of the output as co-rotational finite elements
+        for (int t = 0; t < 4 * output.numberoftetrahedra; ++t)
         {
-            cVertex* v0 = a_object->getVertex(it->first);
-            cVertex* v1 = a_object->getVertex(it->second);
-
-            cGELMassParticle* m0 = a_object->m_gelVertices[v0->m_tag].m_massParticle;
-            cGELMassParticle* m1 = a_object->m_gelVertices[v1->m_tag].m_massParticle;
-
-            cGELLinearSpring* spring = new cGELLinearSpring(m0, m1);
-            a_object->m_linearSprings.push_back(spring);
+            a_object->m_tetrahedra.push_back(output.tetrahedronlist[t]);
         }
+        a_object->m_tetrahedralModel.m_youngModulus = 500.0; // [N/m^2]
+        a_object->m_tetrahedralModel.m_poissonRatio = 0.3;
+        a_object->m_useTetrahedralModel = true;
+        a_object->buildTetrahedralModel();
 
         // extract texture
         int numModelV = model->getNumVertices(true);
@@ -837,30 +811,20 @@ bool createSkeletonMesh(cGELMesh *a_object, char *a_filename, char *a_filenameHi
         tetrahedralize(TETGEN_SWITCHES, &input, &output);
 
         // create a vertex in the object for each point of the result
-        for (int p = 0, pi = 0; p < output.numberofpoints; ++p, pi += 3)
-        {
-            cVector3d point;
-            point.x = output.pointlist[pi+0];
-            point.y = output.pointlist[pi+1];
-            point.z = output.pointlist[pi+2];
-            model->newVertex(point);
-        }
+        model->reserve(output.numberofpoints, output.numberoftrifaces);
+        model->appendVertices(output.pointlist, output.numberofpoints);
 
         // create a triangle for each face on the surface
+        vector<unsigned int> indices(3 * output.numberoftrifaces);
         for (int t = 0, ti = 0; t < output.numberoftrifaces; ++t, ti += 3)
         {
-            cVector3d p[3];
-            int vi[3];
-            for (int i = 0; i < 3; ++i) {
-                int tc = output.trifacelist[ti+i];
-                vi[i] = tc;
-                int pi = tc*3;
-                p[i].x = output.pointlist[pi+0];
-                p[i].y = output.pointlist[pi+1];
-                p[i].z = output.pointlist[pi+2];
-            }
-            //unsigned int index = a_object->newTriangle(p[1], p[0], p[2]);
-            model->newTriangle(vi[1], vi[0], vi[2]);
+            indices[ti+0] = output.trifacelist[ti+1];
+            indices[ti+1] = output.trifacelist[ti+0];
+            indices[ti+2] = output.trifacelist[ti+2];
+        }
+        if (output.numberoftrifaces > 0)
+        {
+            model->appendTriangles(&indices[0], output.numberoftrifaces);
         }
 
         // find out exactly which vertices are on the inside and outside
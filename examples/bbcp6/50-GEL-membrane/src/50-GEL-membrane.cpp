@@ -420,6 +420,9 @@ int main(int argc, char* argv[])
     // connect skin (mesh) to skeleton (GEM)
     defObject->connectVerticesToSkeleton(false);
 
+    // update skin normals together with skin vertices
+    defObject->m_skinning.m_updateNormals = true;
+
     // show/hide underlying dynamic skeleton model
     defObject->m_showSkeletonModel = false;
 
@@ -568,7 +571,6 @@ void updateGraphics(void)
 {
     // update mesh of deformable model
     defWorld->updateSkins();
-    defObject->computeAllNormals(true);
 
     // render world
     camera->renderView(displayW, displayH);
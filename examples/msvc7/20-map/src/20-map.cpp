@@ -690,6 +690,9 @@ void updateHaptics(void)
                 posVertex.z = posVertex.z + offsetVertexHeight;
                 vertex->setPos(posVertex);
             }
+
+            // update the vertices of the map for rendering and collision detection
+            object->markAllVerticesModified();
         }
 
         // move camera
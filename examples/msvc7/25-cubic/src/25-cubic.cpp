@@ -474,6 +474,9 @@ void resizeWindow(int w, int h)
         object->getVertex(vertices[i][2])->setTexCoord(txMax, tyMax);
         object->getVertex(vertices[i][3])->setTexCoord(txMin, tyMax);
     }
+
+    // send the new texture coordinates to the vertex streams
+    object->markModifiedVertices(0, object->getNumVertices(), false);
 }
 
 //---------------------------------------------------------------------------
@@ -0,0 +1,468 @@
+//===========================================================================
+/*
+    This file is part of the GEL dynamics engine.
+    Copyright (C) 2003-2009 by Francois Conti, Stanford University.
+    All rights reserved.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CGELCorotationalFEM.h"
+//---------------------------------------------------------------------------
+#include <math.h>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+// DEFINITION - DEFAULT VALUES:
+//===========================================================================
+
+double cGELCorotationalFEM::default_youngModulus          = 1000.0;  // [N/m^2]
+double cGELCorotationalFEM::default_poissonRatio          = 0.3;
+int    cGELCorotationalFEM::default_numRotationIterations = 3;
+bool   cGELCorotationalFEM::default_useMultithreading     = true;
+
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+/*!
+    Convert a unit quaternion (w, x, y, z) to a row-major rotation matrix.
+*/
+//---------------------------------------------------------------------------
+static inline void quaternionToMatrix(const double* a_q, double* a_m)
+{
+    double w = a_q[0], x = a_q[1], y = a_q[2], z = a_q[3];
+    a_m[0] = 1.0 - 2.0*(y*y + z*z);  a_m[1] = 2.0*(x*y - w*z);        a_m[2] = 2.0*(x*z + w*y);
+    a_m[3] = 2.0*(x*y + w*z);        a_m[4] = 1.0 - 2.0*(x*x + z*z);  a_m[5] = 2.0*(y*z - w*x);
+    a_m[6] = 2.0*(x*z - w*y);        a_m[7] = 2.0*(y*z + w*x);        a_m[8] = 1.0 - 2.0*(x*x + y*y);
+}
+
+
+//---------------------------------------------------------------------------
+/*!
+    Refine the rotation \e a_q closest to the row-major matrix \e a_f, by
+    rotating it towards the columns of \e a_f. The iteration remains
+    stable for degenerate and inverted elements.
+*/
+//---------------------------------------------------------------------------
+static inline void extractRotation(const double* a_f, double* a_q, int a_numIterations)
+{
+    double r[9];
+    for (int k=0; k<a_numIterations; k++)
+    {
+        quaternionToMatrix(a_q, r);
+
+        double ox = 0.0, oy = 0.0, oz = 0.0, dot = 0.0;
+        for (int c=0; c<3; c++)
+        {
+            double rx = r[c], ry = r[3+c], rz = r[6+c];
+            double fx = a_f[c], fy = a_f[3+c], fz = a_f[6+c];
+            ox += ry*fz - rz*fy;
+            oy += rz*fx - rx*fz;
+            oz += rx*fy - ry*fx;
+            dot += rx*fx + ry*fy + rz*fz;
+        }
+        double scale = 1.0 / (fabs(dot) + 1.0e-9);
+        ox *= scale;
+        oy *= scale;
+        oz *= scale;
+
+        double angle = sqrt(ox*ox + oy*oy + oz*oz);
+        if (angle < 1.0e-9) { break; }
+
+        double s = sin(0.5 * angle) / angle;
+        double dw = cos(0.5 * angle), dx = ox * s, dy = oy * s, dz = oz * s;
+        double w = a_q[0], x = a_q[1], y = a_q[2], z = a_q[3];
+        a_q[0] = dw*w - dx*x - dy*y - dz*z;
+        a_q[1] = dw*x + dx*w + dy*z - dz*y;
+        a_q[2] = dw*y - dx*z + dy*w + dz*x;
+        a_q[3] = dw*z + dx*y - dy*x + dz*w;
+
+        double length = sqrt(a_q[0]*a_q[0] + a_q[1]*a_q[1] + a_q[2]*a_q[2] + a_q[3]*a_q[3]);
+        a_q[0] /= length;
+        a_q[1] /= length;
+        a_q[2] /= length;
+        a_q[3] /= length;
+    }
+}
+#endif // DOXYGEN_SHOULD_SKIP_THIS
+
+
+//===========================================================================
+/*!
+    Constructor of cGELCorotationalFEM.
+
+    \fn       cGELCorotationalFEM::cGELCorotationalFEM()
+*/
+//===========================================================================
+cGELCorotationalFEM::cGELCorotationalFEM()
+{
+    m_youngModulus          = default_youngModulus;
+    m_poissonRatio          = default_poissonRatio;
+    m_numRotationIterations = default_numRotationIterations;
+    m_useMultithreading     = default_useMultithreading;
+    m_minParallelElements   = 512;
+    m_built                 = false;
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cGELCorotationalFEM.
+
+    \fn       cGELCorotationalFEM::~cGELCorotationalFEM()
+*/
+//===========================================================================
+cGELCorotationalFEM::~cGELCorotationalFEM()
+{
+}
+
+
+//===========================================================================
+/*!
+    Clear all elements.
+
+    \fn       void cGELCorotationalFEM::clear()
+*/
+//===========================================================================
+void cGELCorotationalFEM::clear()
+{
+    m_particles.clear();
+    m_incidenceOffsets.clear();
+    m_incidences.clear();
+    m_elements.clear();
+    m_restEdges.clear();
+    m_invRest.clear();
+    m_stiffness.clear();
+    m_volumes.clear();
+    m_rotations.clear();
+    m_elementForces.clear();
+    m_built = false;
+}
+
+
+//===========================================================================
+/*!
+    Build the elements from a list of tetrahedra. Each tetrahedron is given
+    by the indices of its four vertices in \e a_vertices, whose mass
+    particles become the nodes of the element. Rest shapes are taken from
+    the current particle positions. Degenerate tetrahedra and tetrahedra
+    with a vertex lacking a mass particle are ignored.
+
+    \fn       void cGELCorotationalFEM::build(vector<cGELVertex>& a_vertices,
+                                  const vector<unsigned int>& a_tetrahedra)
+    \param    a_vertices  Deformable vertices of the mesh.
+    \param    a_tetrahedra  Vertex indices of the tetrahedra (4 per tetrahedron).
+*/
+//===========================================================================
+void cGELCorotationalFEM::build(vector<cGELVertex>& a_vertices,
+                                const vector<unsigned int>& a_tetrahedra)
+{
+    clear();
+
+    // particle table, indexed like the vertices
+    unsigned int numVertices = (unsigned int)(a_vertices.size());
+    vector<int> particleIndex(numVertices, -1);
+    unsigned int i, j;
+    for (i=0; i<numVertices; i++)
+    {
+        if (a_vertices[i].m_massParticle == NULL) { continue; }
+        particleIndex[i] = (int)(m_particles.size());
+        m_particles.push_back(a_vertices[i].m_massParticle);
+    }
+
+    // Lame coefficients
+    double nu = cClamp(m_poissonRatio, 0.0, 0.49);
+    double lambda = m_youngModulus * nu / ((1.0 + nu) * (1.0 - 2.0 * nu));
+    double mu = m_youngModulus / (2.0 * (1.0 + nu));
+
+    unsigned int numTetrahedra = (unsigned int)(a_tetrahedra.size() / 4);
+    for (i=0; i<numTetrahedra; i++)
+    {
+        int index[4];
+        bool valid = true;
+        for (int k=0; k<4; k++)
+        {
+            unsigned int v = a_tetrahedra[4*i+k];
+            index[k] = (v < numVertices) ? particleIndex[v] : -1;
+            if (index[k] < 0) { valid = false; }
+        }
+        if (!valid) { continue; }
+
+        // rest edges as columns of a matrix
+        cVector3d x0 = m_particles[index[0]]->m_pos;
+        cVector3d e1 = cSub(m_particles[index[1]]->m_pos, x0);
+        cVector3d e2 = cSub(m_particles[index[2]]->m_pos, x0);
+        cVector3d e3 = cSub(m_particles[index[3]]->m_pos, x0);
+        double det = cDot(e1, cCross(e2, e3));
+        double volume = fabs(det) / 6.0;
+        if (volume < CHAI_SMALL) { continue; }
+
+        // inverse of the edge matrix: rows are the shape function gradients
+        cVector3d g[4];
+        g[1] = cDiv(det, cCross(e2, e3));
+        g[2] = cDiv(det, cCross(e3, e1));
+        g[3] = cDiv(det, cCross(e1, e2));
+        g[0] = cMul(-1.0, cAdd(g[1], cAdd(g[2], g[3])));
+
+        for (int k=0; k<4; k++)
+        {
+            m_elements.push_back(index[k]);
+        }
+        double rest[9] = { e1.x, e1.y, e1.z, e2.x, e2.y, e2.z, e3.x, e3.y, e3.z };
+        m_restEdges.insert(m_restEdges.end(), rest, rest + 9);
+        for (int r=1; r<4; r++)
+        {
+            m_invRest.push_back(g[r].x);
+            m_invRest.push_back(g[r].y);
+            m_invRest.push_back(g[r].z);
+        }
+        m_volumes.push_back(volume);
+
+        // isotropic linear elasticity:
+        // K_ij = V * (lambda * g_i g_j^T + mu * g_j g_i^T + mu * (g_i . g_j) I)
+        unsigned int offset = (unsigned int)(m_stiffness.size());
+        m_stiffness.resize(offset + 144);
+        double* k = &m_stiffness[offset];
+        for (int a=0; a<4; a++)
+        {
+            for (int b=0; b<4; b++)
+            {
+                double gg = cDot(g[a], g[b]);
+                for (int r=0; r<3; r++)
+                {
+                    for (int c=0; c<3; c++)
+                    {
+                        double value = lambda * g[a][r] * g[b][c] + mu * g[b][r] * g[a][c];
+                        if (r == c) { value += mu * gg; }
+                        k[(3*a+r)*12 + 3*b+c] = volume * value;
+                    }
+                }
+            }
+        }
+    }
+
+    unsigned int numElements = (unsigned int)(m_volumes.size());
+    m_rotations.resize(4 * numElements);
+    for (i=0; i<numElements; i++)
+    {
+        m_rotations[4*i+0] = 1.0;
+        m_rotations[4*i+1] = 0.0;
+        m_rotations[4*i+2] = 0.0;
+        m_rotations[4*i+3] = 0.0;
+    }
+    m_elementForces.assign(12 * numElements, 0.0);
+
+    // incidences of each particle, counting sort by particle
+    unsigned int numParticles = (unsigned int)(m_particles.size());
+    m_incidenceOffsets.assign(numParticles + 1, 0);
+    for (i=0; i<4*numElements; i++)
+    {
+        m_incidenceOffsets[m_elements[i] + 1]++;
+    }
+    for (i=0; i<numParticles; i++)
+    {
+        m_incidenceOffsets[i + 1] += m_incidenceOffsets[i];
+    }
+    m_incidences.resize(4 * numElements);
+    vector<unsigned int> fill(m_incidenceOffsets.begin(), m_incidenceOffsets.end() - 1);
+    for (j=0; j<4*numElements; j++)
+    {
+        m_incidences[fill[m_elements[j]]++] = j;
+    }
+
+    m_built = true;
+}
+
+
+//===========================================================================
+/*!
+    Add the elastic forces of all elements to their mass particles. Call
+    between cGELMassParticle::clearForces() and computeNextPose().
+
+    \fn       void cGELCorotationalFEM::computeForces()
+*/
+//===========================================================================
+void cGELCorotationalFEM::computeForces()
+{
+    if (!m_built) { return; }
+
+    process(elementTask, getNumElements());
+    process(gatherTask, getNumParticles());
+}
+
+
+//===========================================================================
+/*!
+    Compute the forces of a range of elements. The rotation R of each
+    element is extracted from its deformation gradient F = Ds * Dm^-1,
+    where Ds and Dm are the current and rest edge matrices. The local
+    displacements u_j = R^T (x_j - x_0) - (X_j - X_0) are multiplied by
+    the rest stiffness matrix, and the resulting forces are rotated back.
+
+    \fn       void cGELCorotationalFEM::computeElementForces(unsigned int a_begin,
+                                                             unsigned int a_end)
+    \param    a_begin  First element.
+    \param    a_end  Last element (excluded).
+*/
+//===========================================================================
+void cGELCorotationalFEM::computeElementForces(unsigned int a_begin, unsigned int a_end)
+{
+    for (unsigned int e=a_begin; e<a_end; e++)
+    {
+        const unsigned int* index = &m_elements[4*e];
+        const cVector3d& x0 = m_particles[index[0]]->m_pos;
+
+        // current edges
+        double ds[9];
+        for (int j=0; j<3; j++)
+        {
+            const cVector3d& xj = m_particles[index[j+1]]->m_pos;
+            ds[j*3+0] = xj.x - x0.x;
+            ds[j*3+1] = xj.y - x0.y;
+            ds[j*3+2] = xj.z - x0.z;
+        }
+
+        // deformation gradient F = Ds * Dm^-1 (row-major, edges stored by column)
+        const double* inv = &m_invRest[9*e];
+        double f[9];
+        for (int r=0; r<3; r++)
+        {
+            for (int c=0; c<3; c++)
+            {
+                f[3*r+c] = ds[0*3+r] * inv[0*3+c] +
+                           ds[1*3+r] * inv[1*3+c] +
+                           ds[2*3+r] * inv[2*3+c];
+            }
+        }
+
+        double* q = &m_rotations[4*e];
+        extractRotation(f, q, m_numRotationIterations);
+        double rot[9];
+        quaternionToMatrix(q, rot);
+
+        // local displacements, corner 0 is the origin
+        const double* rest = &m_restEdges[9*e];
+        double u[12];
+        u[0] = u[1] = u[2] = 0.0;
+        for (int j=0; j<3; j++)
+        {
+            const double* d = &ds[3*j];
+            for (int r=0; r<3; r++)
+            {
+                u[3*(j+1)+r] = rot[r]*d[0] + rot[3+r]*d[1] + rot[6+r]*d[2] - rest[3*j+r];
+            }
+        }
+
+        // local forces, then rotated to world frame
+        const double* k = &m_stiffness[144*e];
+        double* force = &m_elementForces[12*e];
+        for (int a=0; a<4; a++)
+        {
+            double local[3];
+            for (int r=0; r<3; r++)
+            {
+                const double* row = &k[(3*a+r)*12 + 3];
+                double sum = 0.0;
+                for (int c=0; c<9; c++)
+                {
+                    sum += row[c] * u[3+c];
+                }
+                local[r] = -sum;
+            }
+            for (int r=0; r<3; r++)
+            {
+                force[3*a+r] = rot[3*r]*local[0] + rot[3*r+1]*local[1] + rot[3*r+2]*local[2];
+            }
+        }
+    }
+}
+
+
+//===========================================================================
+/*!
+    Sum the element forces acting on a range of particles and add them to
+    the particles.
+
+    \fn       void cGELCorotationalFEM::gatherForces(unsigned int a_begin,
+                                                     unsigned int a_end)
+    \param    a_begin  First particle.
+    \param    a_end  Last particle (excluded).
+*/
+//===========================================================================
+void cGELCorotationalFEM::gatherForces(unsigned int a_begin, unsigned int a_end)
+{
+    for (unsigned int i=a_begin; i<a_end; i++)
+    {
+        unsigned int first = m_incidenceOffsets[i];
+        unsigned int last = m_incidenceOffsets[i + 1];
+        if (first == last) { continue; }
+
+        cVector3d force(0.0, 0.0, 0.0);
+        for (unsigned int j=first; j<last; j++)
+        {
+            const double* f = &m_elementForces[3*m_incidences[j]];
+            force.x += f[0];
+            force.y += f[1];
+            force.z += f[2];
+        }
+        m_particles[i]->addForce(force);
+    }
+}
+
+
+//===========================================================================
+/*!
+    Run a task over [0, a_count), on the shared thread pool if there are
+    enough elements.
+
+    \fn       void cGELCorotationalFEM::process(cThreadPoolTask a_task,
+                                                unsigned int a_count)
+    \param    a_task  Task to execute.
+    \param    a_count  Number of items.
+*/
+//===========================================================================
+void cGELCorotationalFEM::process(cThreadPoolTask a_task, unsigned int a_count)
+{
+    if (a_count == 0) { return; }
+
+    if ((m_useMultithreading) && (getNumElements() >= m_minParallelElements))
+    {
+        cThreadPool::getDefaultPool()->parallelFor(a_task, this, a_count, 128);
+    }
+    else
+    {
+        a_task(this, 0, a_count);
+    }
+}
+
+
+//===========================================================================
+/*!
+    Thread pool task for computeElementForces().
+
+    \fn       void cGELCorotationalFEM::elementTask(void* a_data, unsigned int a_begin,
+                                                    unsigned int a_end)
+*/
+//===========================================================================
+void cGELCorotationalFEM::elementTask(void* a_data, unsigned int a_begin, unsigned int a_end)
+{
+    ((cGELCorotationalFEM*)a_data)->computeElementForces(a_begin, a_end);
+}
+
+
+//===========================================================================
+/*!
+    Thread pool task for gatherForces().
+
+    \fn       void cGELCorotationalFEM::gatherTask(void* a_data, unsigned int a_begin,
+                                                   unsigned int a_end)
+*/
+//===========================================================================
+void cGELCorotationalFEM::gatherTask(void* a_data, unsigned int a_begin, unsigned int a_end)
+{
+    ((cGELCorotationalFEM*)a_data)->gatherForces(a_begin, a_end);
+}
@@ -0,0 +1,199 @@
+//===========================================================================
+/*
+    This file is part of the GEL dynamics engine.
+    Copyright (C) 2003-2009 by Francois Conti, Stanford University.
+    All rights reserved.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CGELCorotationalFEMH
+#define CGELCorotationalFEMH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CGELMassParticle.h"
+#include "CGELVertex.h"
+#include <vector>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CGELCorotationalFEM.h
+
+    \brief
+    <b> GEL Module </b> \n
+    Co-rotational Linear Finite Element Model.
+*/
+//===========================================================================
+
+//===========================================================================
+/*!
+    \class      cGELCorotationalFEM
+    \ingroup    GEL
+
+    \brief
+    cGELCorotationalFEM computes the elastic forces of a volumetric mesh of
+    linear tetrahedral elements whose nodes are the mass particles of a
+    deformable mesh. It is an alternative to connecting every tetrahedron
+    edge with a linear spring: the material is described by its Young's
+    modulus and Poisson ratio, volume is preserved, and element stiffness
+    does not depend on mesh orientation.
+
+    The 12x12 stiffness matrix of each element is computed once from the
+    rest shape. At each step, the rotation of each element is extracted
+    from its deformation gradient, and the linear forces are evaluated in
+    the rotated frame (co-rotational formulation), which keeps the model
+    valid for large rotations. Element forces are computed in parallel,
+    then gathered per particle in parallel from a precomputed incidence
+    table, so that no two threads write to the same particle.
+*/
+//===========================================================================
+class cGELCorotationalFEM
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cGELCorotationalFEM.
+    cGELCorotationalFEM();
+
+    //! Destructor of cGELCorotationalFEM.
+    ~cGELCorotationalFEM();
+
+
+	//-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Build elements from tetrahedra given as vertex indices (4 per tetrahedron).
+    void build(vector<cGELVertex>& a_vertices, const vector<unsigned int>& a_tetrahedra);
+
+    //! Clear all elements.
+    void clear();
+
+    //! Add elastic forces to the mass particles.
+    void computeForces();
+
+    //! Return \b true if the elements have been built.
+    bool isBuilt() const { return (m_built); }
+
+    //! Number of mass particles.
+    unsigned int getNumParticles() const { return (unsigned int)(m_particles.size()); }
+
+    //! Number of elements.
+    unsigned int getNumElements() const { return (unsigned int)(m_volumes.size()); }
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - SETTINGS:
+    //-----------------------------------------------------------------------
+
+    //! Young's modulus of the material [N/m^2], used by build().
+    double m_youngModulus;
+
+    //! Poisson ratio of the material (0 to 0.5), used by build().
+    double m_poissonRatio;
+
+    //! Number of iterations of the rotation extraction per step.
+    int m_numRotationIterations;
+
+    //! If \b true, forces are computed on the shared thread pool.
+    bool m_useMultithreading;
+
+    //! Minimum number of elements for forces to be computed in parallel.
+    unsigned int m_minParallelElements;
+
+
+  public:
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - DEFAULT SETTINGS:
+    //-----------------------------------------------------------------------
+
+    //! Default property - Young's modulus.
+    static double default_youngModulus;
+
+    //! Default property - Poisson ratio.
+    static double default_poissonRatio;
+
+    //! Default property - rotation extraction iterations.
+    static int default_numRotationIterations;
+
+    //! Default property - multithreading.
+    static bool default_useMultithreading;
+
+
+  protected:
+
+	//-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Compute the forces of elements [a_begin, a_end) into m_elementForces.
+    void computeElementForces(unsigned int a_begin, unsigned int a_end);
+
+    //! Add the element forces of particles [a_begin, a_end) to the particles.
+    void gatherForces(unsigned int a_begin, unsigned int a_end);
+
+    //! Run a task over [0, a_count), in parallel if large enough.
+    void process(cThreadPoolTask a_task, unsigned int a_count);
+
+    //! Thread pool task for computeElementForces().
+    static void elementTask(void* a_data, unsigned int a_begin, unsigned int a_end);
+
+    //! Thread pool task for gatherForces().
+    static void gatherTask(void* a_data, unsigned int a_begin, unsigned int a_end);
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - PARTICLES:
+    //-----------------------------------------------------------------------
+
+    //! Mass particles used as element nodes.
+    vector<cGELMassParticle*> m_particles;
+
+    //! Index of the first incidence of each particle; last entry is its size.
+    vector<unsigned int> m_incidenceOffsets;
+
+    //! Incidences (element * 4 + corner) of each particle.
+    vector<unsigned int> m_incidences;
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - ELEMENTS:
+    //-----------------------------------------------------------------------
+
+    //! Particle indices of each element (4 per element).
+    vector<unsigned int> m_elements;
+
+    //! Rest positions of the corners relative to corner 0 (9 per element).
+    vector<double> m_restEdges;
+
+    //! Inverse of the rest edge matrix (9 per element, row-major).
+    vector<double> m_invRest;
+
+    //! Stiffness matrix of each element (144 per element, row-major).
+    vector<double> m_stiffness;
+
+    //! Rest volume of each element.
+    vector<double> m_volumes;
+
+    //! Rotation of each element as a quaternion (w, x, y, z), reused as initial guess.
+    vector<double> m_rotations;
+
+    //! Forces on the corners of each element (12 per element).
+    vector<double> m_elementForces;
+
+    //! \b true once the elements have been built.
+    bool m_built;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -29,6 +29,9 @@ void cGELMesh::initialise()
     m_showMassParticleModel = false;
     m_useSkeletonModel = false;
     m_useMassParticleModel = false;
+    m_usePositionBasedModel = false;
+    m_useSkinningTable = true;
+    m_useTetrahedralModel = false;
 }
 
 
@@ -110,7 +113,9 @@ void cGELMesh::computeForces()
             (*i)->computeForces();
         }
     }
-    if (m_useMassParticleModel)
+    // with the position based model, springs are handled as constraints
+    // by computeNextPose()
+    if ((m_useMassParticleModel) && (!m_usePositionBasedModel))
     {
         list<cGELLinearSpring*>::iterator i;
 
@@ -119,6 +124,14 @@ void cGELMesh::computeForces()
             (*i)->computeForces();
         }
     }
+    if ((m_useMassParticleModel) && (m_useTetrahedralModel))
+    {
+        if (!m_tetrahedralModel.isBuilt())
+        {
+            buildTetrahedralModel();
+        }
+        m_tetrahedralModel.computeForces();
+    }
 }
 
 //===========================================================================
@@ -147,10 +160,53 @@ void cGELMesh::computeNextPose(double a_timeInterval)
         {
             i->m_massParticle->computeNextPose(a_timeInterval);
         }
+
+        // project distance constraints on the predicted positions
+        if (m_usePositionBasedModel)
+        {
+            if (!m_positionBasedSolver.isBuilt())
+            {
+                buildPositionBasedConstraints();
+            }
+            m_positionBasedSolver.solve(a_timeInterval);
+        }
     }
 }
 
 
+//===========================================================================
+/*!
+    Build the distance constraints of the position based model. Each
+    linear spring becomes a constraint between the mass particles it
+    connects. Call this method again after adding or removing springs;
+    it is otherwise called automatically on the first time step.
+
+    \fn       void cGELMesh::buildPositionBasedConstraints()
+*/
+//===========================================================================
+void cGELMesh::buildPositionBasedConstraints()
+{
+    m_positionBasedSolver.build(m_gelVertices, m_linearSprings);
+}
+
+
+//===========================================================================
+/*!
+    Build the finite elements of the tetrahedral model. The rest shape of
+    each element is taken from the current positions of its mass
+    particles. Call this method again after modifying m_tetrahedra or the
+    material of m_tetrahedralModel; it is otherwise called automatically
+    on the first time step.
+
+    \fn       void cGELMesh::buildTetrahedralModel()
+*/
+//===========================================================================
+void cGELMesh::buildTetrahedralModel()
+{
+    m_tetrahedralModel.build(m_gelVertices, m_tetrahedra);
+}
+
+
 //===========================================================================
 /*!
     Apply the next pose of each node.
@@ -258,6 +314,8 @@ void cGELMesh::buildVertices()
 {
     // clear all deformable vertices
     m_gelVertices.clear();
+    m_skinning.clear();
+    m_tetrahedralModel.clear();
 
     // get number of vertices
     int numVertices = getNumVertices(true);
@@ -371,19 +429,36 @@ void cGELMesh::connectVerticesToSkeleton(bool a_connectToNodesOnly)
             curVertex->m_massParticle->m_pos = cMul(cInv(rot), posRel);
         }
     }
+
+    // attachments have changed, skinning table must be rebuilt
+    m_skinning.clear();
 }
 
 
 //===========================================================================
 /*!
-    Update position of vertices connected to skeleton.
+    Update position of vertices connected to skeleton. If m_useSkinningTable
+    is \b true, the precomputed table in m_skinning is used; set
+    m_skinning.m_updateNormals to also update the normals of the skin.
 
     \fn       void cGELMesh::updateVertexPosition()
 */
 //===========================================================================
 void cGELMesh::updateVertexPosition()
 {
-    if (m_useSkeletonModel)
+    if ((m_useSkeletonModel) && (m_useSkinningTable))
+    {
+        // build skinning table on first use
+        if (!m_skinning.isBuilt())
+        {
+            m_skinning.build(this, m_gelVertices);
+        }
+
+        // update vertices attached to nodes or links which moved
+        m_skinning.update();
+    }
+
+    else if (m_useSkeletonModel)
     {
         // get number of vertices
         int numVertices = m_gelVertices.size();
@@ -416,6 +491,9 @@ void cGELMesh::updateVertexPosition()
                 curVertex->m_vertex->setPos(newPos);
             }
         }
+
+        // report the new positions to the meshes
+        markAllVerticesModified();
     }
 
     if (m_useMassParticleModel)
@@ -435,6 +513,9 @@ void cGELMesh::updateVertexPosition()
                 curVertex->m_vertex->setPos(curVertex->m_massParticle->m_pos);
             }
         }
+
+        // report the new positions to the meshes
+        markAllVerticesModified();
     }
 }
 
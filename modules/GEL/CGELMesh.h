@@ -18,6 +18,9 @@
 #include "CGELSkeletonLink.h"
 #include "CGELLinearSpring.h"
 #include "CGELVertex.h"
+#include "CGELPositionBasedSolver.h"
+#include "CGELSkinning.h"
+#include "CGELCorotationalFEM.h"
 #include "chai3d.h"
 #include <typeinfo>
 #include <vector>
@@ -90,9 +93,18 @@ class cGELMesh : public cMesh
     //! Apply new computed pose.
     void applyNextPose();
 
+    //! Build the distance constraints of the position based model from the linear springs.
+    void buildPositionBasedConstraints();
+
+    //! Build the finite elements of the tetrahedral model from m_tetrahedra.
+    void buildTetrahedralModel();
+
     //! Render deformable mesh.
     virtual void render(const int a_renderMode=CHAI_RENDER_MODE_RENDER_ALL);
 
+    //! The skeleton is drawn by render(), so the mesh is not sorted by a render queue.
+    virtual bool enqueue(cRenderQueue* a_queue) { return (cGenericObject::enqueue(a_queue)); }
+
 
 	//-----------------------------------------------------------------------
     // MEMBERS:
@@ -122,6 +134,34 @@ class cGELMesh : public cMesh
     //! Use vertex mass particle model.
     bool m_useMassParticleModel;
 
+    /*!
+        If \b true, the linear springs of the mass particle model are solved
+        as position based (XPBD) distance constraints instead of forces.
+    */
+    bool m_usePositionBasedModel;
+
+    //! Constraint solver of the position based model.
+    cGELPositionBasedSolver m_positionBasedSolver;
+
+    //! If \b true, skin vertices are updated from a precomputed skinning table.
+    bool m_useSkinningTable;
+
+    //! Skinning table, rebuilt after each call to connectVerticesToSkeleton().
+    cGELSkinning m_skinning;
+
+    //! Vertex indices of the tetrahedra of the volumetric mesh (4 per tetrahedron).
+    vector<unsigned int> m_tetrahedra;
+
+    /*!
+        If \b true, the mass particles are connected by co-rotational linear
+        finite elements built from m_tetrahedra, in addition to the linear
+        springs.
+    */
+    bool m_useTetrahedralModel;
+
+    //! Finite element model of the tetrahedra.
+    cGELCorotationalFEM m_tetrahedralModel;
+
 
   private:
 
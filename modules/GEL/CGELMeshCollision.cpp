@@ -0,0 +1,589 @@
+//===========================================================================
+/*
+    This file is part of the GEL dynamics engine.
+    Copyright (C) 2003-2009 by Francois Conti, Stanford University.
+    All rights reserved.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CGELMeshCollision.h"
+//---------------------------------------------------------------------------
+#include <algorithm>
+#include <map>
+#include <math.h>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+// DEFINITION - DEFAULT VALUES:
+//===========================================================================
+
+// Contact properties:
+double cGELMeshCollision::default_thickness        = 0.01;   // [m]
+double cGELMeshCollision::default_margin           = 0.02;   // [m]
+double cGELMeshCollision::default_stiffness        = 500.0;  // [N/m]
+double cGELMeshCollision::default_damping          = 0.05;   // [N.s/m]
+bool   cGELMeshCollision::default_useSelfCollision = true;
+
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+/*!
+    Closest point of triangle (a, b, c) to point p, returned as barycentric
+    weights (see Ericson, Real-Time Collision Detection, 5.1.5).
+*/
+//---------------------------------------------------------------------------
+static void closestPointOnTriangle(const cVector3d& p, const cVector3d& a,
+                                   const cVector3d& b, const cVector3d& c,
+                                   double& u, double& v, double& w)
+{
+    cVector3d ab = cSub(b, a);
+    cVector3d ac = cSub(c, a);
+    cVector3d ap = cSub(p, a);
+    double d1 = cDot(ab, ap);
+    double d2 = cDot(ac, ap);
+    if ((d1 <= 0.0) && (d2 <= 0.0)) { u = 1.0; v = 0.0; w = 0.0; return; }
+
+    cVector3d bp = cSub(p, b);
+    double d3 = cDot(ab, bp);
+    double d4 = cDot(ac, bp);
+    if ((d3 >= 0.0) && (d4 <= d3)) { u = 0.0; v = 1.0; w = 0.0; return; }
+
+    double vc = d1*d4 - d3*d2;
+    if ((vc <= 0.0) && (d1 >= 0.0) && (d3 <= 0.0))
+    {
+        v = d1 / (d1 - d3); u = 1.0 - v; w = 0.0; return;
+    }
+
+    cVector3d cp = cSub(p, c);
+    double d5 = cDot(ab, cp);
+    double d6 = cDot(ac, cp);
+    if ((d6 >= 0.0) && (d5 <= d6)) { u = 0.0; v = 0.0; w = 1.0; return; }
+
+    double vb = d5*d2 - d1*d6;
+    if ((vb <= 0.0) && (d2 >= 0.0) && (d6 <= 0.0))
+    {
+        w = d2 / (d2 - d6); u = 1.0 - w; v = 0.0; return;
+    }
+
+    double va = d3*d6 - d5*d4;
+    if ((va <= 0.0) && ((d4 - d3) >= 0.0) && ((d5 - d6) >= 0.0))
+    {
+        w = (d4 - d3) / ((d4 - d3) + (d5 - d6)); v = 1.0 - w; u = 0.0; return;
+    }
+
+    double denom = 1.0 / (va + vb + vc);
+    v = vb * denom;
+    w = vc * denom;
+    u = 1.0 - v - w;
+}
+
+//---------------------------------------------------------------------------
+/*!
+    Hash table bucket of a grid cell.
+*/
+//---------------------------------------------------------------------------
+static inline unsigned int cellBucket(const int a_x, const int a_y, const int a_z,
+                                      const unsigned int a_mask)
+{
+    unsigned int h = ((unsigned int)(a_x) * 73856093u) ^
+                     ((unsigned int)(a_y) * 19349663u) ^
+                     ((unsigned int)(a_z) * 83492791u);
+    return (h & a_mask);
+}
+#endif // DOXYGEN_SHOULD_SKIP_THIS
+
+
+//===========================================================================
+/*!
+    Constructor of cGELMeshCollision.
+
+    \fn       cGELMeshCollision::cGELMeshCollision()
+*/
+//===========================================================================
+cGELMeshCollision::cGELMeshCollision()
+{
+    m_thickness           = default_thickness;
+    m_margin              = default_margin;
+    m_stiffness           = default_stiffness;
+    m_damping             = default_damping;
+    m_useSelfCollision    = default_useSelfCollision;
+    m_useBroadphaseThread = true;
+    m_backReady           = false;
+    m_numContacts         = 0;
+    m_built               = false;
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cGELMeshCollision.
+
+    \fn       cGELMeshCollision::~cGELMeshCollision()
+*/
+//===========================================================================
+cGELMeshCollision::~cGELMeshCollision()
+{
+    m_worker.waitAll();
+}
+
+
+//===========================================================================
+/*!
+    Clear all tables. Must be called (followed by build()) when meshes are
+    added to or removed from the world.
+
+    \fn       void cGELMeshCollision::clear()
+*/
+//===========================================================================
+void cGELMeshCollision::clear()
+{
+    // the broadphase may still be reading the tables
+    m_worker.waitAll();
+
+    m_particles.clear();
+    m_particleMesh.clear();
+    m_triangles.clear();
+    m_triangleMesh.clear();
+    m_neighborOffsets.clear();
+    m_neighbors.clear();
+    m_snapshot.clear();
+    m_bounds.clear();
+    m_cells.clear();
+    m_unsortedCells.clear();
+    m_cellBuckets.clear();
+    m_bucketStart.clear();
+    m_largeTriangles.clear();
+    m_backPairs.clear();
+    m_pairs.clear();
+    m_backReady = false;
+    m_numContacts = 0;
+    m_built = false;
+}
+
+
+//===========================================================================
+/*!
+    Build the particle and triangle tables from the meshes using the mass
+    particle model. Triangles are expressed by the indices of the particles
+    attached to their vertices. A first broadphase is computed immediately
+    so that contacts are handled from the first step.
+
+    \fn       void cGELMeshCollision::build(list<cGELMesh*>& a_meshes)
+    \param    a_meshes  Deformable meshes.
+*/
+//===========================================================================
+void cGELMeshCollision::build(list<cGELMesh*>& a_meshes)
+{
+    clear();
+
+    unsigned int meshIndex = 0;
+    list<cGELMesh*>::iterator it;
+    for(it = a_meshes.begin(); it != a_meshes.end(); ++it, meshIndex++)
+    {
+        cGELMesh* mesh = *it;
+        if (!mesh->m_useMassParticleModel) { continue; }
+
+        // particles of the mesh
+        std::map<cVertex*, unsigned int> particleIndex;
+        unsigned int i, numVertices = (unsigned int)(mesh->m_gelVertices.size());
+        for (i=0; i<numVertices; i++)
+        {
+            cGELVertex* vertex = &mesh->m_gelVertices[i];
+            if (vertex->m_massParticle == NULL) { continue; }
+            particleIndex[vertex->m_vertex] = (unsigned int)(m_particles.size());
+            m_particles.push_back(vertex->m_massParticle);
+            m_particleMesh.push_back(meshIndex);
+        }
+
+        // triangles whose three vertices carry a particle
+        unsigned int numTriangles = mesh->getNumTriangles(true);
+        for (i=0; i<numTriangles; i++)
+        {
+            cTriangle* triangle = mesh->getTriangle(i, true);
+            if ((triangle == NULL) || (!triangle->allocated())) { continue; }
+
+            unsigned int index[3];
+            bool valid = true;
+            for (int k=0; k<3; k++)
+            {
+                std::map<cVertex*, unsigned int>::iterator p = particleIndex.find(triangle->getVertex(k));
+                if (p == particleIndex.end()) { valid = false; break; }
+                index[k] = p->second;
+            }
+            if (!valid) { continue; }
+
+            m_triangles.push_back(index[0]);
+            m_triangles.push_back(index[1]);
+            m_triangles.push_back(index[2]);
+            m_triangleMesh.push_back(meshIndex);
+        }
+    }
+
+    // particles sharing a triangle are neighbors
+    unsigned int numParticles = (unsigned int)(m_particles.size());
+    unsigned int numTriangles = (unsigned int)(m_triangleMesh.size());
+    vector< vector<unsigned int> > neighbors(numParticles);
+    unsigned int i, j;
+    for (i=0; i<numTriangles; i++)
+    {
+        for (int k=0; k<3; k++)
+        {
+            neighbors[m_triangles[3*i+k]].push_back(m_triangles[3*i+(k+1)%3]);
+            neighbors[m_triangles[3*i+k]].push_back(m_triangles[3*i+(k+2)%3]);
+        }
+    }
+
+    m_neighborOffsets.push_back(0);
+    for (i=0; i<numParticles; i++)
+    {
+        vector<unsigned int>& list = neighbors[i];
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+        for (j=0; j<list.size(); j++)
+        {
+            m_neighbors.push_back(list[j]);
+        }
+        m_neighborOffsets.push_back((unsigned int)(m_neighbors.size()));
+    }
+
+    // first broadphase
+    takeSnapshot();
+    computeBroadphase();
+    m_pairs.swap(m_backPairs);
+    m_backReady = false;
+
+    m_built = true;
+}
+
+
+//===========================================================================
+/*!
+    Compute contact forces. The latest broadphase result is picked up if
+    the background thread has finished, in which case a new broadphase
+    is started from the current positions. Candidate pairs are then
+    tested against the current positions: if a particle lies closer than
+    m_thickness to its nearest triangle, a damped penalty force pushes the
+    particle away and the opposite force is distributed on the triangle
+    particles according to the barycentric coordinates of the contact.
+
+    \fn       void cGELMeshCollision::computeForces()
+*/
+//===========================================================================
+void cGELMeshCollision::computeForces()
+{
+    m_numContacts = 0;
+    if (!m_built) { return; }
+
+    // refresh candidate pairs
+    if (m_useBroadphaseThread)
+    {
+        if (m_worker.getNumPendingTasks() == 0)
+        {
+            if (m_backReady)
+            {
+                m_pairs.swap(m_backPairs);
+                m_backReady = false;
+            }
+            takeSnapshot();
+            m_worker.post(broadphaseTask, this);
+        }
+    }
+    else
+    {
+        takeSnapshot();
+        computeBroadphase();
+        m_pairs.swap(m_backPairs);
+        m_backReady = false;
+    }
+
+    // narrowphase: pairs are grouped by particle; only the closest
+    // triangle of each particle is used, so that a particle touching
+    // several adjacent triangles does not receive a multiple force
+    double thicknessSq = m_thickness * m_thickness;
+    unsigned int numPairs = (unsigned int)(m_pairs.size() / 2);
+    unsigned int i = 0;
+    while (i < numPairs)
+    {
+        unsigned int index = m_pairs[2*i];
+        cGELMassParticle* particle = m_particles[index];
+
+        unsigned int nearest = 0;
+        double nearestSq = thicknessSq;
+        double nearestU = 0.0, nearestV = 0.0, nearestW = 0.0;
+        bool found = false;
+        for (; (i < numPairs) && (m_pairs[2*i] == index); i++)
+        {
+            const unsigned int* tri = &m_triangles[3*m_pairs[2*i+1]];
+            const cVector3d& a = m_particles[tri[0]]->m_pos;
+            const cVector3d& b = m_particles[tri[1]]->m_pos;
+            const cVector3d& c = m_particles[tri[2]]->m_pos;
+
+            double u, v, w;
+            closestPointOnTriangle(particle->m_pos, a, b, c, u, v, w);
+            cVector3d closest = cAdd(cMul(u, a), cAdd(cMul(v, b), cMul(w, c)));
+            double distanceSq = cDistanceSq(particle->m_pos, closest);
+            if (distanceSq < nearestSq)
+            {
+                nearest = m_pairs[2*i+1];
+                nearestSq = distanceSq;
+                nearestU = u;
+                nearestV = v;
+                nearestW = w;
+                found = true;
+            }
+        }
+        if (!found) { continue; }
+
+        const unsigned int* tri = &m_triangles[3*nearest];
+        cGELMassParticle* p0 = m_particles[tri[0]];
+        cGELMassParticle* p1 = m_particles[tri[1]];
+        cGELMassParticle* p2 = m_particles[tri[2]];
+        cVector3d closest = cAdd(cMul(nearestU, p0->m_pos), cAdd(cMul(nearestV, p1->m_pos), cMul(nearestW, p2->m_pos)));
+        cVector3d normal = cSub(particle->m_pos, closest);
+
+        // contact normal, triangle normal if the particle lies on the triangle
+        double distance = sqrt(nearestSq);
+        if (distance > CHAI_SMALL)
+        {
+            normal.div(distance);
+        }
+        else
+        {
+            normal = cCross(cSub(p1->m_pos, p0->m_pos), cSub(p2->m_pos, p0->m_pos));
+            if (normal.lengthsq() < CHAI_SMALL) { continue; }
+            normal.normalize();
+        }
+
+        // damped penalty force
+        cVector3d vel = cAdd(cMul(nearestU, p0->m_vel), cAdd(cMul(nearestV, p1->m_vel), cMul(nearestW, p2->m_vel)));
+        double normalVel = cDot(cSub(particle->m_vel, vel), normal);
+        double magnitude = m_stiffness * (m_thickness - distance) - m_damping * normalVel;
+        if (magnitude <= 0.0) { continue; }
+
+        cVector3d force = cMul(magnitude, normal);
+        particle->addForce(force);
+        cVector3d f0 = cMul(-nearestU, force);
+        cVector3d f1 = cMul(-nearestV, force);
+        cVector3d f2 = cMul(-nearestW, force);
+        p0->addForce(f0);
+        p1->addForce(f1);
+        p2->addForce(f2);
+
+        m_numContacts++;
+    }
+}
+
+
+//===========================================================================
+/*!
+    Copy the current particle positions to the broadphase snapshot.
+
+    \fn       void cGELMeshCollision::takeSnapshot()
+*/
+//===========================================================================
+void cGELMeshCollision::takeSnapshot()
+{
+    unsigned int numParticles = (unsigned int)(m_particles.size());
+    m_snapshot.resize(numParticles, cVector3d(0.0, 0.0, 0.0));
+    for (unsigned int i=0; i<numParticles; i++)
+    {
+        m_snapshot[i] = m_particles[i]->m_pos;
+    }
+}
+
+
+//===========================================================================
+/*!
+    Find candidate pairs from the position snapshot. The bounding box of
+    each triangle, grown by m_thickness and m_margin, is inserted in every
+    cell of a uniform grid it overlaps; grid cells are hashed into a table
+    sized from the number of insertions. Each particle then looks up the
+    cell which contains it. Candidates are found from the snapshot, so
+    they remain valid as long as particles move less than m_margin
+    before the next broadphase completes.
+
+    This method only reads the snapshot and the topology tables, and only
+    writes the broadphase members, so it can run on the worker thread.
+
+    \fn       void cGELMeshCollision::computeBroadphase()
+*/
+//===========================================================================
+void cGELMeshCollision::computeBroadphase()
+{
+    m_backPairs.clear();
+
+    unsigned int numTriangles = (unsigned int)(m_triangleMesh.size());
+    unsigned int numParticles = (unsigned int)(m_snapshot.size());
+    if ((numTriangles == 0) || (numParticles == 0)) { m_backReady = true; return; }
+
+    // grown bounding boxes and cell size
+    double grow = m_thickness + m_margin;
+    double sumExtent = 0.0;
+    unsigned int i, j;
+    m_bounds.resize(6 * numTriangles);
+    for (i=0; i<numTriangles; i++)
+    {
+        const cVector3d& a = m_snapshot[m_triangles[3*i+0]];
+        const cVector3d& b = m_snapshot[m_triangles[3*i+1]];
+        const cVector3d& c = m_snapshot[m_triangles[3*i+2]];
+        double* box = &m_bounds[6*i];
+        for (int k=0; k<3; k++)
+        {
+            box[k]   = cMin(a[k], cMin(b[k], c[k])) - grow;
+            box[k+3] = cMax(a[k], cMax(b[k], c[k])) + grow;
+            sumExtent += box[k+3] - box[k];
+        }
+    }
+    double cellSize = sumExtent / (3.0 * numTriangles);
+    if (cellSize < CHAI_SMALL) { cellSize = 1.0; }
+    double invCellSize = 1.0 / cellSize;
+
+    // insert triangles in the cells overlapped by their box; triangles
+    // much larger than the average (a ground plane for instance) are
+    // kept aside and tested against every particle
+    m_unsortedCells.clear();
+    m_largeTriangles.clear();
+    cGELMeshCollisionCell cell;
+    for (i=0; i<numTriangles; i++)
+    {
+        const double* box = &m_bounds[6*i];
+        int x0 = (int)floor(box[0] * invCellSize), x1 = (int)floor(box[3] * invCellSize);
+        int y0 = (int)floor(box[1] * invCellSize), y1 = (int)floor(box[4] * invCellSize);
+        int z0 = (int)floor(box[2] * invCellSize), z1 = (int)floor(box[5] * invCellSize);
+        double count = ((double)x1 - x0 + 1) * ((double)y1 - y0 + 1) * ((double)z1 - z0 + 1);
+        if (count > 64.0)
+        {
+            m_largeTriangles.push_back(i);
+            continue;
+        }
+
+        cell.m_triangle = i;
+        for (int x=x0; x<=x1; x++)
+        {
+            for (int y=y0; y<=y1; y++)
+            {
+                for (int z=z0; z<=z1; z++)
+                {
+                    cell.m_cell[0] = x;
+                    cell.m_cell[1] = y;
+                    cell.m_cell[2] = z;
+                    m_unsortedCells.push_back(cell);
+                }
+            }
+        }
+    }
+
+    // counting sort of cells by bucket
+    unsigned int numCells = (unsigned int)(m_unsortedCells.size());
+    unsigned int numBuckets = 1;
+    while (numBuckets < numCells) { numBuckets <<= 1; }
+    unsigned int mask = numBuckets - 1;
+
+    m_bucketStart.assign(numBuckets + 1, 0);
+    m_cellBuckets.resize(numCells);
+    for (i=0; i<numCells; i++)
+    {
+        const int* c = m_unsortedCells[i].m_cell;
+        m_cellBuckets[i] = cellBucket(c[0], c[1], c[2], mask);
+        m_bucketStart[m_cellBuckets[i] + 1]++;
+    }
+    for (i=0; i<numBuckets; i++)
+    {
+        m_bucketStart[i + 1] += m_bucketStart[i];
+    }
+    m_cells.resize(numCells);
+    vector<unsigned int> fill(m_bucketStart.begin(), m_bucketStart.end() - 1);
+    for (i=0; i<numCells; i++)
+    {
+        m_cells[fill[m_cellBuckets[i]]++] = m_unsortedCells[i];
+    }
+
+    // query the cell of each particle
+    for (i=0; i<numParticles; i++)
+    {
+        const cVector3d& p = m_snapshot[i];
+        int x = (int)floor(p.x * invCellSize);
+        int y = (int)floor(p.y * invCellSize);
+        int z = (int)floor(p.z * invCellSize);
+        unsigned int b = cellBucket(x, y, z, mask);
+
+        for (j=m_bucketStart[b]; j<m_bucketStart[b + 1]; j++)
+        {
+            const cGELMeshCollisionCell& c = m_cells[j];
+            if ((c.m_cell[0] != x) || (c.m_cell[1] != y) || (c.m_cell[2] != z)) { continue; }
+
+            const double* box = &m_bounds[6*c.m_triangle];
+            if ((p.x < box[0]) || (p.y < box[1]) || (p.z < box[2]) ||
+                (p.x > box[3]) || (p.y > box[4]) || (p.z > box[5])) { continue; }
+
+            if (isExcluded(i, c.m_triangle)) { continue; }
+
+            m_backPairs.push_back(i);
+            m_backPairs.push_back(c.m_triangle);
+        }
+
+        for (j=0; j<m_largeTriangles.size(); j++)
+        {
+            unsigned int t = m_largeTriangles[j];
+            const double* box = &m_bounds[6*t];
+            if ((p.x < box[0]) || (p.y < box[1]) || (p.z < box[2]) ||
+                (p.x > box[3]) || (p.y > box[4]) || (p.z > box[5])) { continue; }
+
+            if (isExcluded(i, t)) { continue; }
+
+            m_backPairs.push_back(i);
+            m_backPairs.push_back(t);
+        }
+    }
+
+    m_backReady = true;
+}
+
+
+//===========================================================================
+/*!
+    Return \b true if a particle must be ignored for a triangle: the
+    particle is a vertex of the triangle or one of its neighbors, or
+    both belong to the same mesh and self-collision is disabled.
+
+    \fn       bool cGELMeshCollision::isExcluded(unsigned int a_particle,
+                                                 unsigned int a_triangle) const
+    \param    a_particle  Particle index.
+    \param    a_triangle  Triangle index.
+    \return   Return \b true if the pair is excluded.
+*/
+//===========================================================================
+bool cGELMeshCollision::isExcluded(unsigned int a_particle, unsigned int a_triangle) const
+{
+    if (m_particleMesh[a_particle] != m_triangleMesh[a_triangle]) { return (false); }
+    if (!m_useSelfCollision) { return (true); }
+
+    const unsigned int* first = &m_neighbors[0] + m_neighborOffsets[a_particle];
+    const unsigned int* last = &m_neighbors[0] + m_neighborOffsets[a_particle + 1];
+    for (int k=0; k<3; k++)
+    {
+        unsigned int vertex = m_triangles[3*a_triangle+k];
+        if (vertex == a_particle) { return (true); }
+        if (std::binary_search(first, last, vertex)) { return (true); }
+    }
+    return (false);
+}
+
+
+//===========================================================================
+/*!
+    Worker thread task running the broadphase.
+
+    \fn       void cGELMeshCollision::broadphaseTask(void* a_data)
+    \param    a_data  Pointer to the cGELMeshCollision.
+*/
+//===========================================================================
+void cGELMeshCollision::broadphaseTask(void* a_data)
+{
+    ((cGELMeshCollision*)a_data)->computeBroadphase();
+}
@@ -0,0 +1,244 @@
+//===========================================================================
+/*
+    This file is part of the GEL dynamics engine.
+    Copyright (C) 2003-2009 by Francois Conti, Stanford University.
+    All rights reserved.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CGELMeshCollisionH
+#define CGELMeshCollisionH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CGELMesh.h"
+#include <vector>
+#include <list>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CGELMeshCollision.h
+
+    \brief
+    <b> GEL Module </b> \n
+    Collisions between Deformable Meshes.
+*/
+//===========================================================================
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+/*!
+    Grid cell overlapped by the bounding box of a triangle.
+*/
+//---------------------------------------------------------------------------
+struct cGELMeshCollisionCell
+{
+    int m_cell[3];
+    unsigned int m_triangle;
+};
+#endif // DOXYGEN_SHOULD_SKIP_THIS
+
+
+//===========================================================================
+/*!
+    \class      cGELMeshCollision
+    \ingroup    GEL
+
+    \brief
+    cGELMeshCollision handles contacts between the mass particles and the
+    skin triangles of deformable meshes, both between different meshes
+    and within a mesh (self-collision). Only meshes using the mass particle
+    model take part, since their skin is defined by particle positions.
+
+    Candidate particle/triangle pairs are found by a hash grid broadphase
+    which runs on a background thread from a snapshot of the particle
+    positions. Triangle bounding boxes are grown by a safety margin so
+    that the candidate list remains valid for a few simulation steps.
+    The simulation thread only evaluates the latest candidate list and
+    applies penalty forces to particles closer than m_thickness to a
+    triangle; it never waits for the broadphase.
+*/
+//===========================================================================
+class cGELMeshCollision
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cGELMeshCollision.
+    cGELMeshCollision();
+
+    //! Destructor of cGELMeshCollision.
+    ~cGELMeshCollision();
+
+
+	//-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Build particle and triangle tables of a list of meshes.
+    void build(list<cGELMesh*>& a_meshes);
+
+    //! Clear all tables.
+    void clear();
+
+    //! Add contact forces to the particles. Call between computeForces() and computeNextPose().
+    void computeForces();
+
+    //! Return \b true if the tables have been built.
+    bool isBuilt() const { return (m_built); }
+
+    //! Number of particles taking part in collisions.
+    unsigned int getNumParticles() const { return (unsigned int)(m_particles.size()); }
+
+    //! Number of triangles taking part in collisions.
+    unsigned int getNumTriangles() const { return (unsigned int)(m_triangleMesh.size()); }
+
+    //! Number of candidate pairs of the current broadphase result.
+    unsigned int getNumCandidates() const { return (unsigned int)(m_pairs.size() / 2); }
+
+    //! Number of contacts found by the last call to computeForces().
+    unsigned int getNumContacts() const { return (m_numContacts); }
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - SETTINGS:
+    //-----------------------------------------------------------------------
+
+    //! Distance below which a particle is in contact with a triangle.
+    double m_thickness;
+
+    //! Additional distance by which triangle bounds are grown in the broadphase.
+    double m_margin;
+
+    //! Stiffness of contacts [N/m].
+    double m_stiffness;
+
+    //! Damping of contacts along the contact normal [N.s/m].
+    double m_damping;
+
+    //! If \b true, particles also collide with triangles of their own mesh.
+    bool m_useSelfCollision;
+
+    //! If \b true, the broadphase runs on a background thread.
+    bool m_useBroadphaseThread;
+
+
+  public:
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - DEFAULT SETTINGS:
+    //-----------------------------------------------------------------------
+
+    //! Default property - contact thickness.
+    static double default_thickness;
+
+    //! Default property - broadphase margin.
+    static double default_margin;
+
+    //! Default property - contact stiffness.
+    static double default_stiffness;
+
+    //! Default property - contact damping.
+    static double default_damping;
+
+    //! Default property - self-collision.
+    static bool default_useSelfCollision;
+
+
+  protected:
+
+	//-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Copy current particle positions to the broadphase snapshot.
+    void takeSnapshot();
+
+    //! Find candidate pairs from the snapshot into m_backPairs.
+    void computeBroadphase();
+
+    //! Return \b true if a particle must not collide with a triangle.
+    bool isExcluded(unsigned int a_particle, unsigned int a_triangle) const;
+
+    //! Worker thread task running computeBroadphase().
+    static void broadphaseTask(void* a_data);
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - TABLES:
+    //-----------------------------------------------------------------------
+
+    //! Particles of all meshes.
+    vector<cGELMassParticle*> m_particles;
+
+    //! Mesh index of each particle.
+    vector<unsigned int> m_particleMesh;
+
+    //! Particle indices of each triangle (3 per triangle).
+    vector<unsigned int> m_triangles;
+
+    //! Mesh index of each triangle.
+    vector<unsigned int> m_triangleMesh;
+
+    //! Index of the first neighbor of each particle in m_neighbors; last entry is its size.
+    vector<unsigned int> m_neighborOffsets;
+
+    //! Sorted particles sharing a triangle with each particle.
+    vector<unsigned int> m_neighbors;
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - BROADPHASE:
+    //-----------------------------------------------------------------------
+
+    //! Particle positions read by the broadphase.
+    vector<cVector3d> m_snapshot;
+
+    //! Grown bounding box of each triangle (min and max, 6 per triangle).
+    vector<double> m_bounds;
+
+    //! Cells overlapped by triangles, sorted by bucket.
+    vector<cGELMeshCollisionCell> m_cells;
+
+    //! Cells before sorting.
+    vector<cGELMeshCollisionCell> m_unsortedCells;
+
+    //! Bucket of each unsorted cell.
+    vector<unsigned int> m_cellBuckets;
+
+    //! Index of the first cell of each bucket; last entry is the number of cells.
+    vector<unsigned int> m_bucketStart;
+
+    //! Triangles overlapping too many cells, tested against all particles.
+    vector<unsigned int> m_largeTriangles;
+
+    //! Candidate pairs (particle, triangle) written by the broadphase.
+    vector<unsigned int> m_backPairs;
+
+    //! \b true when m_backPairs holds a result not yet used.
+    bool m_backReady;
+
+    //! Candidate pairs (particle, triangle) used by the simulation thread.
+    vector<unsigned int> m_pairs;
+
+    //! Number of contacts of the last step.
+    unsigned int m_numContacts;
+
+    //! \b true once the tables have been built.
+    bool m_built;
+
+    //! Thread running the broadphase (destroyed first).
+    cWorkerThread m_worker;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
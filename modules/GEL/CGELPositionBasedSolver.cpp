@@ -0,0 +1,467 @@
+//===========================================================================
+/*
+    This file is part of the GEL dynamics engine.
+    Copyright (C) 2003-2009 by Francois Conti, Stanford University.
+    All rights reserved.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 248 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CGELPositionBasedSolver.h"
+//---------------------------------------------------------------------------
+#include <algorithm>
+#include <map>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+// DEFINITION - DEFAULT VALUES:
+//===========================================================================
+
+// Solver properties:
+int    cGELPositionBasedSolver::default_numIterations     = 8;
+bool   cGELPositionBasedSolver::default_useJacobi         = false;
+double cGELPositionBasedSolver::default_jacobiRelaxation  = 1.5;
+bool   cGELPositionBasedSolver::default_useMultithreading = true;
+
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+/*!
+    Range of constraints handed to the thread pool.
+*/
+//---------------------------------------------------------------------------
+struct cGELPositionBasedBatch
+{
+    cGELPositionBasedSolver* m_solver;
+    unsigned int m_offset;
+};
+#endif // DOXYGEN_SHOULD_SKIP_THIS
+
+
+//===========================================================================
+/*!
+    Constructor of cGELPositionBasedSolver.
+
+    \fn       cGELPositionBasedSolver::cGELPositionBasedSolver()
+*/
+//===========================================================================
+cGELPositionBasedSolver::cGELPositionBasedSolver()
+{
+    m_numIterations          = default_numIterations;
+    m_useJacobi              = default_useJacobi;
+    m_jacobiRelaxation       = default_jacobiRelaxation;
+    m_useMultithreading      = default_useMultithreading;
+    m_minParallelConstraints = 256;
+    m_invTimeIntervalSq      = 0.0;
+    m_built                  = false;
+    m_colorOffsets.push_back(0);
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cGELPositionBasedSolver.
+
+    \fn       cGELPositionBasedSolver::~cGELPositionBasedSolver()
+*/
+//===========================================================================
+cGELPositionBasedSolver::~cGELPositionBasedSolver()
+{
+}
+
+
+//===========================================================================
+/*!
+    Clear all particles and constraints.
+
+    \fn       void cGELPositionBasedSolver::clear()
+*/
+//===========================================================================
+void cGELPositionBasedSolver::clear()
+{
+    m_particles.clear();
+    m_pos.clear();
+    m_invMass.clear();
+    m_delta.clear();
+    m_numDeltas.clear();
+    m_index0.clear();
+    m_index1.clear();
+    m_restLength.clear();
+    m_compliance.clear();
+    m_lambda.clear();
+    m_colorOffsets.clear();
+    m_colorOffsets.push_back(0);
+    m_built = false;
+}
+
+
+//===========================================================================
+/*!
+    Build the particle and constraint tables. The mass particle of each
+    deformable vertex becomes a particle, and each linear spring becomes
+    a distance constraint with the spring's rest length and a compliance
+    equal to the inverse of its stiffness (springs with a null stiffness
+    are treated as inextensible). Constraints are then greedily colored
+    and sorted by color.
+
+    This method must be called again whenever springs or vertices are
+    added or removed.
+
+    \fn       void cGELPositionBasedSolver::build(vector<cGELVertex>& a_vertices,
+                                                  list<cGELLinearSpring*>& a_springs)
+    \param    a_vertices  Deformable vertices of the mesh.
+    \param    a_springs  Linear springs of the mesh.
+*/
+//===========================================================================
+void cGELPositionBasedSolver::build(vector<cGELVertex>& a_vertices,
+                                    list<cGELLinearSpring*>& a_springs)
+{
+    clear();
+
+    // register the mass particle of each vertex
+    std::map<cGELMassParticle*, unsigned int> particleIndices;
+    unsigned int i, numVertices = (unsigned int)(a_vertices.size());
+    for (i=0; i<numVertices; i++)
+    {
+        cGELMassParticle* particle = a_vertices[i].m_massParticle;
+        if (particleIndices.find(particle) == particleIndices.end())
+        {
+            particleIndices[particle] = (unsigned int)(m_particles.size());
+            m_particles.push_back(particle);
+        }
+    }
+
+    // create a constraint for each spring. springs may also connect
+    // particles that do not belong to a vertex of the mesh.
+    vector<unsigned int> index0, index1, colors;
+    vector<double> restLength, compliance;
+    vector< vector<unsigned int> > particleColors;
+    unsigned int numColors = 0;
+
+    list<cGELLinearSpring*>::iterator j;
+    for(j = a_springs.begin(); j != a_springs.end(); ++j)
+    {
+        cGELLinearSpring* spring = *j;
+        unsigned int n[2];
+        cGELMassParticle* nodes[2] = { spring->m_node0, spring->m_node1 };
+
+        for (int k=0; k<2; k++)
+        {
+            std::map<cGELMassParticle*, unsigned int>::iterator it = particleIndices.find(nodes[k]);
+            if (it == particleIndices.end())
+            {
+                n[k] = (unsigned int)(m_particles.size());
+                particleIndices[nodes[k]] = n[k];
+                m_particles.push_back(nodes[k]);
+            }
+            else
+            {
+                n[k] = it->second;
+            }
+        }
+        if (n[0] == n[1]) { continue; }
+
+        // pick the lowest color not yet used by either particle
+        if (particleColors.size() < m_particles.size())
+        {
+            particleColors.resize(m_particles.size());
+        }
+        vector<unsigned int>& c0 = particleColors[n[0]];
+        vector<unsigned int>& c1 = particleColors[n[1]];
+        unsigned int color = 0;
+        bool used = true;
+        while (used)
+        {
+            used = false;
+            unsigned int k;
+            for (k=0; (k<c0.size()) && (!used); k++) { if (c0[k] == color) { used = true; } }
+            for (k=0; (k<c1.size()) && (!used); k++) { if (c1[k] == color) { used = true; } }
+            if (used) { color++; }
+        }
+        c0.push_back(color);
+        c1.push_back(color);
+        if (color >= numColors) { numColors = color + 1; }
+
+        index0.push_back(n[0]);
+        index1.push_back(n[1]);
+        colors.push_back(color);
+        restLength.push_back(spring->m_length0);
+        if (spring->m_kSpringElongation > 0.0)
+        {
+            compliance.push_back(1.0 / spring->m_kSpringElongation);
+        }
+        else
+        {
+            compliance.push_back(0.0);
+        }
+    }
+
+    // sort constraints by color (counting sort)
+    unsigned int numConstraints = (unsigned int)(index0.size());
+    m_colorOffsets.assign(numColors + 1, 0);
+    for (i=0; i<numConstraints; i++)
+    {
+        m_colorOffsets[colors[i] + 1]++;
+    }
+    for (i=0; i<numColors; i++)
+    {
+        m_colorOffsets[i + 1] += m_colorOffsets[i];
+    }
+
+    m_index0.resize(numConstraints);
+    m_index1.resize(numConstraints);
+    m_restLength.resize(numConstraints);
+    m_compliance.resize(numConstraints);
+    m_lambda.assign(numConstraints, 0.0);
+
+    vector<unsigned int> next(m_colorOffsets.begin(), m_colorOffsets.end() - 1);
+    for (i=0; i<numConstraints; i++)
+    {
+        unsigned int dst = next[colors[i]]++;
+        m_index0[dst]     = index0[i];
+        m_index1[dst]     = index1[i];
+        m_restLength[dst] = restLength[i];
+        m_compliance[dst] = compliance[i];
+    }
+
+    // allocate working arrays
+    unsigned int numParticles = (unsigned int)(m_particles.size());
+    m_pos.assign(numParticles, cVector3d(0.0, 0.0, 0.0));
+    m_invMass.resize(numParticles);
+    m_delta.assign(numParticles, cVector3d(0.0, 0.0, 0.0));
+    m_numDeltas.resize(numParticles);
+
+    m_built = true;
+}
+
+
+//===========================================================================
+/*!
+    Project all constraints on the predicted particle positions. The
+    particles must have been advanced with
+    cGELMassParticle::computeNextPose(), which integrates external
+    forces, gravity and damping into \e m_nextPos. The corrected
+    positions are written back to \e m_nextPos and the velocities
+    are recomputed from the total displacement over the time step.
+
+    \fn       void cGELPositionBasedSolver::solve(double a_timeInterval)
+    \param    a_timeInterval  Time step [s].
+*/
+//===========================================================================
+void cGELPositionBasedSolver::solve(double a_timeInterval)
+{
+    if ((!m_built) || (a_timeInterval <= 0.0)) { return; }
+
+    unsigned int i, numParticles = (unsigned int)(m_particles.size());
+    unsigned int numColors = getNumColors();
+    m_invTimeIntervalSq = 1.0 / (a_timeInterval * a_timeInterval);
+
+    // gather predicted positions and inverse masses
+    for (i=0; i<numParticles; i++)
+    {
+        cGELMassParticle* particle = m_particles[i];
+        m_pos[i] = particle->m_nextPos;
+        if ((particle->m_fixed) || (particle->m_mass <= 0.0))
+        {
+            m_invMass[i] = 0.0;
+        }
+        else
+        {
+            m_invMass[i] = 1.0 / particle->m_mass;
+        }
+    }
+
+    // reset multipliers
+    std::fill(m_lambda.begin(), m_lambda.end(), 0.0);
+
+    // iterate
+    for (int iteration=0; iteration<m_numIterations; iteration++)
+    {
+        unsigned int c;
+        if (m_useJacobi)
+        {
+            for (i=0; i<numParticles; i++)
+            {
+                m_delta[i].zero();
+                m_numDeltas[i] = 0;
+            }
+
+            for (c=0; c<numColors; c++)
+            {
+                processColor(c, accumulateTask);
+            }
+
+            for (i=0; i<numParticles; i++)
+            {
+                if (m_numDeltas[i] > 0)
+                {
+                    m_pos[i].add(cMul(m_jacobiRelaxation / (double)(m_numDeltas[i]), m_delta[i]));
+                }
+            }
+        }
+        else
+        {
+            for (c=0; c<numColors; c++)
+            {
+                processColor(c, projectTask);
+            }
+        }
+    }
+
+    // write back positions and update velocities
+    double invTimeInterval = 1.0 / a_timeInterval;
+    for (i=0; i<numParticles; i++)
+    {
+        cGELMassParticle* particle = m_particles[i];
+        if (m_invMass[i] > 0.0)
+        {
+            particle->m_nextPos = m_pos[i];
+            particle->m_vel = cMul(invTimeInterval, cSub(m_pos[i], particle->m_pos));
+        }
+    }
+}
+
+
+//===========================================================================
+/*!
+    Process the constraints of one color. Constraints of the same color
+    share no particle and can therefore be processed concurrently.
+
+    \fn       void cGELPositionBasedSolver::processColor(unsigned int a_color,
+                                                         cThreadPoolTask a_task)
+    \param    a_color  Color index.
+    \param    a_task  Task applied to the constraints.
+*/
+//===========================================================================
+void cGELPositionBasedSolver::processColor(unsigned int a_color, cThreadPoolTask a_task)
+{
+    cGELPositionBasedBatch batch;
+    batch.m_solver = this;
+    batch.m_offset = m_colorOffsets[a_color];
+    unsigned int count = m_colorOffsets[a_color + 1] - batch.m_offset;
+
+    if ((m_useMultithreading) && (count >= m_minParallelConstraints))
+    {
+        cThreadPool::getDefaultPool()->parallelFor(a_task, &batch, count, 64);
+    }
+    else
+    {
+        a_task(&batch, 0, count);
+    }
+}
+
+
+//===========================================================================
+/*!
+    Gauss-Seidel projection of constraints [a_begin, a_end). Each
+    correction is applied immediately to the particle positions.
+
+    \fn       void cGELPositionBasedSolver::projectConstraints(unsigned int a_begin,
+                                                               unsigned int a_end)
+    \param    a_begin  First constraint.
+    \param    a_end  Constraint following the last one.
+*/
+//===========================================================================
+void cGELPositionBasedSolver::projectConstraints(unsigned int a_begin, unsigned int a_end)
+{
+    for (unsigned int i=a_begin; i<a_end; i++)
+    {
+        unsigned int n0 = m_index0[i];
+        unsigned int n1 = m_index1[i];
+        double w0 = m_invMass[n0];
+        double w1 = m_invMass[n1];
+        double alpha = m_compliance[i] * m_invTimeIntervalSq;
+        double w = w0 + w1 + alpha;
+        if (w <= 0.0) { continue; }
+
+        cVector3d d;
+        m_pos[n0].subr(m_pos[n1], d);
+        double length = d.length();
+        if (length < 0.000001) { continue; }
+
+        // XPBD multiplier update
+        double C = length - m_restLength[i];
+        double dLambda = (-C - alpha * m_lambda[i]) / w;
+        m_lambda[i] += dLambda;
+
+        // apply correction along constraint direction
+        d.mul(dLambda / length);
+        m_pos[n0].add(cMul(w0, d));
+        m_pos[n1].sub(cMul(w1, d));
+    }
+}
+
+
+//===========================================================================
+/*!
+    Jacobi accumulation of constraints [a_begin, a_end). Corrections are
+    summed per particle and applied once all colors have been processed.
+
+    \fn       void cGELPositionBasedSolver::accumulateConstraints(unsigned int a_begin,
+                                                                  unsigned int a_end)
+    \param    a_begin  First constraint.
+    \param    a_end  Constraint following the last one.
+*/
+//===========================================================================
+void cGELPositionBasedSolver::accumulateConstraints(unsigned int a_begin, unsigned int a_end)
+{
+    for (unsigned int i=a_begin; i<a_end; i++)
+    {
+        unsigned int n0 = m_index0[i];
+        unsigned int n1 = m_index1[i];
+        double w0 = m_invMass[n0];
+        double w1 = m_invMass[n1];
+        double alpha = m_compliance[i] * m_invTimeIntervalSq;
+        double w = w0 + w1 + alpha;
+        if (w <= 0.0) { continue; }
+
+        cVector3d d;
+        m_pos[n0].subr(m_pos[n1], d);
+        double length = d.length();
+        if (length < 0.000001) { continue; }
+
+        double C = length - m_restLength[i];
+        double dLambda = (-C - alpha * m_lambda[i]) / w;
+        m_lambda[i] += dLambda;
+
+        d.mul(dLambda / length);
+        m_delta[n0].add(cMul(w0, d));
+        m_delta[n1].sub(cMul(w1, d));
+        m_numDeltas[n0]++;
+        m_numDeltas[n1]++;
+    }
+}
+
+
+//===========================================================================
+/*!
+    Thread pool task for Gauss-Seidel projection.
+
+    \fn       void cGELPositionBasedSolver::projectTask(void* a_data,
+                                         unsigned int a_begin, unsigned int a_end)
+*/
+//===========================================================================
+void cGELPositionBasedSolver::projectTask(void* a_data, unsigned int a_begin, unsigned int a_end)
+{
+    cGELPositionBasedBatch* batch = (cGELPositionBasedBatch*)a_data;
+    batch->m_solver->projectConstraints(batch->m_offset + a_begin, batch->m_offset + a_end);
+}
+
+
+//===========================================================================
+/*!
+    Thread pool task for Jacobi accumulation.
+
+    \fn       void cGELPositionBasedSolver::accumulateTask(void* a_data,
+                                         unsigned int a_begin, unsigned int a_end)
+*/
+//===========================================================================
+void cGELPositionBasedSolver::accumulateTask(void* a_data, unsigned int a_begin, unsigned int a_end)
+{
+    cGELPositionBasedBatch* batch = (cGELPositionBasedBatch*)a_data;
+    batch->m_solver->accumulateConstraints(batch->m_offset + a_begin, batch->m_offset + a_end);
+}
@@ -0,0 +1,208 @@
+//===========================================================================
+/*
+    This file is part of the GEL dynamics engine.
+    Copyright (C) 2003-2009 by Francois Conti, Stanford University.
+    All rights reserved.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CGELPositionBasedSolverH
+#define CGELPositionBasedSolverH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CGELMassParticle.h"
+#include "CGELLinearSpring.h"
+#include "CGELVertex.h"
+#include <vector>
+#include <list>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CGELPositionBasedSolver.h
+
+    \brief
+    <b> GEL Module </b> \n
+    Position Based Dynamics Solver.
+*/
+//===========================================================================
+
+//===========================================================================
+/*!
+    \class      cGELPositionBasedSolver
+    \ingroup    GEL
+
+    \brief
+    cGELPositionBasedSolver projects the linear springs of a deformable
+    mesh as extended position based dynamics (XPBD) distance constraints.
+    The compliance of each constraint is the inverse of the spring
+    stiffness, so the same model can be simulated with either forces
+    or constraints. Unlike explicit spring forces, the projection remains
+    stable for any stiffness and time step; the number of iterations
+    trades accuracy against computation time.
+
+    Constraints are graph colored at build time so that no two
+    constraints of the same color share a particle. Each color can then
+    be projected in parallel (Gauss-Seidel) or accumulated in parallel
+    and applied at the end of the iteration (Jacobi).
+*/
+//===========================================================================
+class cGELPositionBasedSolver
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cGELPositionBasedSolver.
+    cGELPositionBasedSolver();
+
+    //! Destructor of cGELPositionBasedSolver.
+    ~cGELPositionBasedSolver();
+
+
+	//-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Build the particle and constraint tables from vertices and springs.
+    void build(vector<cGELVertex>& a_vertices, list<cGELLinearSpring*>& a_springs);
+
+    //! Clear all particles and constraints.
+    void clear();
+
+    //! Project constraints on the predicted positions (m_nextPos) of the particles.
+    void solve(double a_timeInterval);
+
+    //! Return \b true if the tables have been built.
+    bool isBuilt() const { return (m_built); }
+
+    //! Number of particles.
+    unsigned int getNumParticles() const { return (unsigned int)(m_particles.size()); }
+
+    //! Number of distance constraints.
+    unsigned int getNumConstraints() const { return (unsigned int)(m_restLength.size()); }
+
+    //! Number of colors (independent constraint sets).
+    unsigned int getNumColors() const { return (unsigned int)(m_colorOffsets.size() - 1); }
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - SETTINGS:
+    //-----------------------------------------------------------------------
+
+    //! Number of solver iterations per time step.
+    int m_numIterations;
+
+    //! If \b true, use Jacobi iterations, otherwise Gauss-Seidel.
+    bool m_useJacobi;
+
+    //! Over-relaxation factor applied to averaged Jacobi corrections.
+    double m_jacobiRelaxation;
+
+    //! If \b true, constraint colors are projected on the shared thread pool.
+    bool m_useMultithreading;
+
+    //! Minimum number of constraints of a color for it to be processed in parallel.
+    unsigned int m_minParallelConstraints;
+
+
+  public:
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - DEFAULT SETTINGS:
+    //-----------------------------------------------------------------------
+
+    //! Default property - number of iterations.
+    static int default_numIterations;
+
+    //! Default property - Jacobi iterations.
+    static bool default_useJacobi;
+
+    //! Default property - Jacobi over-relaxation.
+    static double default_jacobiRelaxation;
+
+    //! Default property - multithreading.
+    static bool default_useMultithreading;
+
+
+  protected:
+
+	//-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Project constraints [a_begin, a_end) directly on the positions.
+    void projectConstraints(unsigned int a_begin, unsigned int a_end);
+
+    //! Accumulate corrections of constraints [a_begin, a_end) (Jacobi).
+    void accumulateConstraints(unsigned int a_begin, unsigned int a_end);
+
+    //! Process constraints of one color, in parallel if large enough.
+    void processColor(unsigned int a_color, cThreadPoolTask a_task);
+
+    //! Thread pool task for Gauss-Seidel projection.
+    static void projectTask(void* a_data, unsigned int a_begin, unsigned int a_end);
+
+    //! Thread pool task for Jacobi accumulation.
+    static void accumulateTask(void* a_data, unsigned int a_begin, unsigned int a_end);
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - PARTICLES:
+    //-----------------------------------------------------------------------
+
+    //! Particles simulated by the solver.
+    vector<cGELMassParticle*> m_particles;
+
+    //! Working copy of the predicted particle positions.
+    vector<cVector3d> m_pos;
+
+    //! Inverse mass of each particle (0 for fixed particles).
+    vector<double> m_invMass;
+
+    //! Accumulated Jacobi corrections.
+    vector<cVector3d> m_delta;
+
+    //! Number of Jacobi corrections accumulated on each particle.
+    vector<unsigned int> m_numDeltas;
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - CONSTRAINTS (sorted by color):
+    //-----------------------------------------------------------------------
+
+    //! Index of the first particle of each constraint.
+    vector<unsigned int> m_index0;
+
+    //! Index of the second particle of each constraint.
+    vector<unsigned int> m_index1;
+
+    //! Rest length of each constraint.
+    vector<double> m_restLength;
+
+    //! Compliance (inverse stiffness) of each constraint.
+    vector<double> m_compliance;
+
+    //! Accumulated Lagrange multiplier of each constraint.
+    vector<double> m_lambda;
+
+    //! Index of the first constraint of each color; last entry is the number of constraints.
+    vector<unsigned int> m_colorOffsets;
+
+    //! Compliance scaling term (1 / dt^2) of the current time step.
+    double m_invTimeIntervalSq;
+
+    //! \b true once the tables have been built.
+    bool m_built;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,631 @@
+//===========================================================================
+/*
+    This file is part of the GEL dynamics engine.
+    Copyright (C) 2003-2009 by Francois Conti, Stanford University.
+    All rights reserved.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CGELSkinning.h"
+//---------------------------------------------------------------------------
+#include <map>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+// DEFINITION - DEFAULT VALUES:
+//===========================================================================
+
+// Skinning properties:
+bool cGELSkinning::default_updateNormals     = false;
+bool cGELSkinning::default_useMultithreading = true;
+
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+/*!
+    Compute the range [a_first, a_last) of indices of the vertices of
+    \e a_vertices which lie in the vertex array [a_begin, a_end).
+*/
+//---------------------------------------------------------------------------
+static void findVertexRange(const vector<cVertex*>& a_vertices,
+                            const cVertex* a_begin, const cVertex* a_end,
+                            unsigned int& a_first, unsigned int& a_last)
+{
+    a_first = (unsigned int)(a_end - a_begin);
+    a_last = 0;
+    for (unsigned int i=0; i<a_vertices.size(); i++)
+    {
+        const cVertex* vertex = a_vertices[i];
+        if ((vertex < a_begin) || (vertex >= a_end)) { continue; }
+
+        unsigned int index = (unsigned int)(vertex - a_begin);
+        if (index < a_first) { a_first = index; }
+        if (index >= a_last) { a_last = index + 1; }
+    }
+}
+#endif  // DOXYGEN_SHOULD_SKIP_THIS
+
+
+//===========================================================================
+/*!
+    Constructor of cGELSkinning.
+
+    \fn       cGELSkinning::cGELSkinning()
+*/
+//===========================================================================
+cGELSkinning::cGELSkinning()
+{
+    m_updateNormals       = default_updateNormals;
+    m_useMultithreading   = default_useMultithreading;
+    m_minParallelVertices = 1024;
+    m_framesValid         = false;
+    m_built               = false;
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cGELSkinning.
+
+    \fn       cGELSkinning::~cGELSkinning()
+*/
+//===========================================================================
+cGELSkinning::~cGELSkinning()
+{
+}
+
+
+//===========================================================================
+/*!
+    Clear the table. It must be rebuilt each time vertices are connected
+    to the skeleton.
+
+    \fn       void cGELSkinning::clear()
+*/
+//===========================================================================
+void cGELSkinning::clear()
+{
+    m_boneNodes.clear();
+    m_boneLinks.clear();
+    m_frames.clear();
+    m_boneDirty.clear();
+    m_vertices.clear();
+    m_vertexBones.clear();
+    m_localPos.clear();
+    m_faceVertices.clear();
+    m_faceBones.clear();
+    m_faceNormals.clear();
+    m_faceDirty.clear();
+    m_normalVertices.clear();
+    m_normalOffsets.clear();
+    m_normalFaces.clear();
+    m_meshes.clear();
+    m_meshRanges.clear();
+    m_framesValid = false;
+    m_built = false;
+}
+
+
+//===========================================================================
+/*!
+    Build the skinning table. Each vertex attached to a node or link by
+    cGELMesh::connectVerticesToSkeleton() is stored with the index of its
+    bone and its local coordinates. The faces of \e a_mesh (and its
+    children) which surround attached vertices are stored as well, with
+    the list of faces adjacent to each vertex, for the normal update.
+
+    \fn       void cGELSkinning::build(cMesh* a_mesh, vector<cGELVertex>& a_vertices)
+    \param    a_mesh  Mesh (and children) owning the vertices.
+    \param    a_vertices  Deformable vertices of the mesh.
+*/
+//===========================================================================
+void cGELSkinning::build(cMesh* a_mesh, vector<cGELVertex>& a_vertices)
+{
+    clear();
+
+    // collect attached vertices and the bones they reference
+    std::map<cGELSkeletonNode*, unsigned int> nodeBones;
+    std::map<cGELSkeletonLink*, unsigned int> linkBones;
+    vector<bool> isLink;
+    unsigned int i, numVertices = (unsigned int)(a_vertices.size());
+
+    for (i=0; i<numVertices; i++)
+    {
+        cGELVertex* curVertex = &a_vertices[i];
+        unsigned int bone;
+
+        if (curVertex->m_node != NULL)
+        {
+            std::map<cGELSkeletonNode*, unsigned int>::iterator it = nodeBones.find(curVertex->m_node);
+            if (it == nodeBones.end())
+            {
+                bone = (unsigned int)(m_boneNodes.size());
+                nodeBones[curVertex->m_node] = bone;
+                m_boneNodes.push_back(curVertex->m_node);
+            }
+            else
+            {
+                bone = it->second;
+            }
+            isLink.push_back(false);
+        }
+        else if (curVertex->m_link != NULL)
+        {
+            std::map<cGELSkeletonLink*, unsigned int>::iterator it = linkBones.find(curVertex->m_link);
+            if (it == linkBones.end())
+            {
+                bone = (unsigned int)(m_boneLinks.size());
+                linkBones[curVertex->m_link] = bone;
+                m_boneLinks.push_back(curVertex->m_link);
+            }
+            else
+            {
+                bone = it->second;
+            }
+            isLink.push_back(true);
+        }
+        else
+        {
+            continue;
+        }
+
+        // connectVerticesToSkeleton() stores local coordinates in the mass particle
+        cVector3d local = curVertex->m_massParticle->m_pos;
+        m_vertices.push_back(curVertex->m_vertex);
+        m_vertexBones.push_back(bone);
+        m_localPos.push_back(local.x);
+        m_localPos.push_back(local.y);
+        m_localPos.push_back(local.z);
+    }
+
+    // links are numbered after nodes
+    unsigned int numNodes = (unsigned int)(m_boneNodes.size());
+    unsigned int numSkin = (unsigned int)(m_vertices.size());
+    for (i=0; i<numSkin; i++)
+    {
+        if (isLink[i]) { m_vertexBones[i] += numNodes; }
+    }
+
+    unsigned int numBones = numNodes + (unsigned int)(m_boneLinks.size());
+    m_frames.resize(12 * numBones, 0.0);
+    m_boneDirty.resize(numBones, 1);
+
+    // bone of each attached vertex
+    std::map<cVertex*, int> vertexBone;
+    for (i=0; i<numSkin; i++)
+    {
+        vertexBone[m_vertices[i]] = (int)(m_vertexBones[i]);
+    }
+
+    // vertices whose normal depends on an attached vertex
+    unsigned int t, k, numTriangles = a_mesh->getNumTriangles(true);
+    std::map<cVertex*, unsigned int> normalIndex;
+    for (t=0; t<numTriangles; t++)
+    {
+        cTriangle* triangle = a_mesh->getTriangle(t, true);
+        if ((triangle == NULL) || (!triangle->allocated())) { continue; }
+
+        bool attached = false;
+        for (k=0; k<3; k++)
+        {
+            if (vertexBone.find(triangle->getVertex(k)) != vertexBone.end()) { attached = true; }
+        }
+        if (!attached) { continue; }
+
+        for (k=0; k<3; k++)
+        {
+            cVertex* vertex = triangle->getVertex(k);
+            if (normalIndex.find(vertex) == normalIndex.end())
+            {
+                normalIndex[vertex] = (unsigned int)(m_normalVertices.size());
+                m_normalVertices.push_back(vertex);
+            }
+        }
+    }
+
+    // faces adjacent to these vertices
+    unsigned int numNormals = (unsigned int)(m_normalVertices.size());
+    vector<unsigned int> faceOwners;
+    m_normalOffsets.resize(numNormals + 1, 0);
+    for (t=0; t<numTriangles; t++)
+    {
+        cTriangle* triangle = a_mesh->getTriangle(t, true);
+        if ((triangle == NULL) || (!triangle->allocated())) { continue; }
+
+        bool adjacent = false;
+        for (k=0; k<3; k++)
+        {
+            if (normalIndex.find(triangle->getVertex(k)) != normalIndex.end()) { adjacent = true; }
+        }
+        if (!adjacent) { continue; }
+
+        unsigned int face = (unsigned int)(m_faceNormals.size());
+        for (k=0; k<3; k++)
+        {
+            cVertex* vertex = triangle->getVertex(k);
+            std::map<cVertex*, int>::iterator b = vertexBone.find(vertex);
+            m_faceVertices.push_back(vertex);
+            m_faceBones.push_back((b == vertexBone.end()) ? -1 : b->second);
+
+            std::map<cVertex*, unsigned int>::iterator n = normalIndex.find(vertex);
+            if (n != normalIndex.end())
+            {
+                m_normalOffsets[n->second + 1]++;
+                faceOwners.push_back(n->second);
+                faceOwners.push_back(face);
+            }
+        }
+        m_faceNormals.push_back(cVector3d(0.0, 0.0, 0.0));
+        m_faceDirty.push_back(1);
+    }
+
+    // compressed adjacency lists
+    for (i=0; i<numNormals; i++)
+    {
+        m_normalOffsets[i + 1] += m_normalOffsets[i];
+    }
+    m_normalFaces.resize(m_normalOffsets[numNormals]);
+    vector<unsigned int> fill(m_normalOffsets.begin(), m_normalOffsets.end() - 1);
+    for (i=0; i<faceOwners.size(); i+=2)
+    {
+        m_normalFaces[fill[faceOwners[i]]++] = faceOwners[i + 1];
+    }
+
+    // faces without attached vertices never move; compute their normal once
+    updateFaceNormals(0, (unsigned int)(m_faceNormals.size()));
+
+    // vertices to mark in each mesh after an update
+    addMeshRanges(a_mesh);
+
+    m_built = true;
+}
+
+
+//===========================================================================
+/*!
+    Update the position of all vertices attached to bones which moved
+    since the last call. If m_updateNormals is \b true, the normals of
+    the vertices adjacent to a moved face are then recomputed. The
+    vertices are written by the threads of the pool, and marked as
+    modified in their mesh once all threads are done.
+
+    \fn       void cGELSkinning::update()
+*/
+//===========================================================================
+void cGELSkinning::update()
+{
+    if (!updateFrames()) { return; }
+
+    process(skinTask, (unsigned int)(m_vertices.size()));
+
+    if (m_updateNormals)
+    {
+        process(faceNormalTask, (unsigned int)(m_faceNormals.size()));
+        process(vertexNormalTask, (unsigned int)(m_normalVertices.size()));
+    }
+
+    markModifiedVertices();
+}
+
+
+//===========================================================================
+/*!
+    Read the frame of every bone. A node frame is its position and
+    rotation; a link frame is the position of its first node and the
+    axes (A0, B0, link) in world coordinates.
+
+    \fn       bool cGELSkinning::updateFrames()
+    \return   Return \b true if at least one bone moved.
+*/
+//===========================================================================
+bool cGELSkinning::updateFrames()
+{
+    unsigned int numNodes = (unsigned int)(m_boneNodes.size());
+    unsigned int numBones = (unsigned int)(m_boneDirty.size());
+    bool moved = false;
+    double frame[12];
+
+    for (unsigned int b=0; b<numBones; b++)
+    {
+        if (b < numNodes)
+        {
+            cGELSkeletonNode* node = m_boneNodes[b];
+            frame[0] = node->m_pos.x;
+            frame[1] = node->m_pos.y;
+            frame[2] = node->m_pos.z;
+            for (int r=0; r<3; r++)
+            {
+                frame[3+3*r+0] = node->m_rot.m[r][0];
+                frame[3+3*r+1] = node->m_rot.m[r][1];
+                frame[3+3*r+2] = node->m_rot.m[r][2];
+            }
+        }
+        else
+        {
+            cGELSkeletonLink* link = m_boneLinks[b - numNodes];
+            frame[0] = link->m_node0->m_pos.x;
+            frame[1] = link->m_node0->m_pos.y;
+            frame[2] = link->m_node0->m_pos.z;
+            for (int r=0; r<3; r++)
+            {
+                frame[3+3*r+0] = link->m_wA0[r];
+                frame[3+3*r+1] = link->m_wB0[r];
+                frame[3+3*r+2] = link->m_wLink01[r];
+            }
+        }
+
+        double* dst = &m_frames[12*b];
+        bool changed = !m_framesValid;
+        for (int k=0; k<12; k++)
+        {
+            if (dst[k] != frame[k])
+            {
+                dst[k] = frame[k];
+                changed = true;
+            }
+        }
+
+        m_boneDirty[b] = changed ? 1 : 0;
+        if (changed) { moved = true; }
+    }
+
+    m_framesValid = true;
+    return (moved);
+}
+
+
+//===========================================================================
+/*!
+    Transform vertices [a_begin, a_end) by the frame of their bone.
+
+    \fn       void cGELSkinning::skinVertices(unsigned int a_begin,
+                                              unsigned int a_end)
+    \param    a_begin  First vertex.
+    \param    a_end  Vertex following the last one.
+*/
+//===========================================================================
+void cGELSkinning::skinVertices(unsigned int a_begin, unsigned int a_end)
+{
+    const unsigned int* bones = &m_vertexBones[0];
+    const unsigned char* dirty = &m_boneDirty[0];
+    const double* frames = &m_frames[0];
+    const double* local = &m_localPos[0];
+
+    for (unsigned int i=a_begin; i<a_end; i++)
+    {
+        unsigned int b = bones[i];
+        if (!dirty[b]) { continue; }
+
+        const double* f = &frames[12*b];
+        const double* p = &local[3*i];
+        m_vertices[i]->m_localPos.set(f[0] + f[3]*p[0] + f[4]*p[1]  + f[5]*p[2],
+                                      f[1] + f[6]*p[0] + f[7]*p[1]  + f[8]*p[2],
+                                      f[2] + f[9]*p[0] + f[10]*p[1] + f[11]*p[2]);
+    }
+}
+
+
+//===========================================================================
+/*!
+    Compute the unit normal of faces [a_begin, a_end) with at least one
+    vertex attached to a bone which moved.
+
+    \fn       void cGELSkinning::updateFaceNormals(unsigned int a_begin,
+                                                   unsigned int a_end)
+    \param    a_begin  First face.
+    \param    a_end  Face following the last one.
+*/
+//===========================================================================
+void cGELSkinning::updateFaceNormals(unsigned int a_begin, unsigned int a_end)
+{
+    for (unsigned int i=a_begin; i<a_end; i++)
+    {
+        const int* bones = &m_faceBones[3*i];
+        // before the first update, every face is computed
+        unsigned char dirty = m_framesValid ? 0 : 1;
+        for (int k=0; k<3; k++)
+        {
+            if ((bones[k] >= 0) && (m_boneDirty[bones[k]])) { dirty = 1; }
+        }
+        m_faceDirty[i] = dirty;
+        if (!dirty) { continue; }
+
+        cVertex** vertices = &m_faceVertices[3*i];
+        cVector3d v01, v02, normal;
+        vertices[1]->m_localPos.subr(vertices[0]->m_localPos, v01);
+        vertices[2]->m_localPos.subr(vertices[0]->m_localPos, v02);
+        v01.crossr(v02, normal);
+
+        // same threshold as cMesh::computeAllNormals()
+        double length = normal.length();
+        if (length > 0.0000001)
+        {
+            normal.div(length);
+        }
+        else
+        {
+            normal.zero();
+        }
+        m_faceNormals[i] = normal;
+    }
+}
+
+
+//===========================================================================
+/*!
+    Sum the normals of the faces adjacent to vertices [a_begin, a_end)
+    if any of them moved.
+
+    \fn       void cGELSkinning::updateVertexNormals(unsigned int a_begin,
+                                                     unsigned int a_end)
+    \param    a_begin  First vertex.
+    \param    a_end  Vertex following the last one.
+*/
+//===========================================================================
+void cGELSkinning::updateVertexNormals(unsigned int a_begin, unsigned int a_end)
+{
+    for (unsigned int i=a_begin; i<a_end; i++)
+    {
+        unsigned int first = m_normalOffsets[i];
+        unsigned int last = m_normalOffsets[i + 1];
+        unsigned int j;
+
+        bool dirty = false;
+        for (j=first; j<last; j++)
+        {
+            if (m_faceDirty[m_normalFaces[j]]) { dirty = true; break; }
+        }
+        if (!dirty) { continue; }
+
+        cVector3d normal(0.0, 0.0, 0.0);
+        for (j=first; j<last; j++)
+        {
+            normal.add(m_faceNormals[m_normalFaces[j]]);
+        }
+        if (normal.lengthsq() > CHAI_SMALL)
+        {
+            normal.normalize();
+        }
+        m_normalVertices[i]->m_normal = normal;
+    }
+}
+
+
+//===========================================================================
+/*!
+    Run a task over [0, a_count), on the shared thread pool if the table
+    is large enough.
+
+    \fn       void cGELSkinning::process(cThreadPoolTask a_task,
+                                         unsigned int a_count)
+    \param    a_task  Task to execute.
+    \param    a_count  Number of items.
+*/
+//===========================================================================
+void cGELSkinning::process(cThreadPoolTask a_task, unsigned int a_count)
+{
+    if (a_count == 0) { return; }
+
+    if ((m_useMultithreading) && (a_count >= m_minParallelVertices))
+    {
+        cThreadPool::getDefaultPool()->parallelFor(a_task, this, a_count, 256);
+    }
+    else
+    {
+        a_task(this, 0, a_count);
+    }
+}
+
+
+//===========================================================================
+/*!
+    Thread pool task for skinVertices().
+
+    \fn       void cGELSkinning::skinTask(void* a_data, unsigned int a_begin,
+                                          unsigned int a_end)
+*/
+//===========================================================================
+void cGELSkinning::skinTask(void* a_data, unsigned int a_begin, unsigned int a_end)
+{
+    ((cGELSkinning*)a_data)->skinVertices(a_begin, a_end);
+}
+
+
+//===========================================================================
+/*!
+    Thread pool task for updateFaceNormals().
+
+    \fn       void cGELSkinning::faceNormalTask(void* a_data, unsigned int a_begin,
+                                                unsigned int a_end)
+*/
+//===========================================================================
+void cGELSkinning::faceNormalTask(void* a_data, unsigned int a_begin, unsigned int a_end)
+{
+    ((cGELSkinning*)a_data)->updateFaceNormals(a_begin, a_end);
+}
+
+
+//===========================================================================
+/*!
+    Thread pool task for updateVertexNormals().
+
+    \fn       void cGELSkinning::vertexNormalTask(void* a_data, unsigned int a_begin,
+                                                  unsigned int a_end)
+*/
+//===========================================================================
+void cGELSkinning::vertexNormalTask(void* a_data, unsigned int a_begin, unsigned int a_end)
+{
+    ((cGELSkinning*)a_data)->updateVertexNormals(a_begin, a_end);
+}
+
+
+//===========================================================================
+/*!
+    Record, for \e a_mesh and each of its children, the range of its
+    vertices which are skin vertices and the range of its vertices whose
+    normal is updated.
+
+    \fn       void cGELSkinning::addMeshRanges(cMesh* a_mesh)
+    \param    a_mesh  Mesh.
+*/
+//===========================================================================
+void cGELSkinning::addMeshRanges(cMesh* a_mesh)
+{
+    unsigned int numVertices = a_mesh->getNumVertices();
+    if (numVertices > 0)
+    {
+        const cVertex* begin = a_mesh->getVertex(0);
+        const cVertex* end = begin + numVertices;
+        unsigned int ranges[4];
+        findVertexRange(m_vertices, begin, end, ranges[0], ranges[1]);
+        findVertexRange(m_normalVertices, begin, end, ranges[2], ranges[3]);
+
+        if ((ranges[0] < ranges[1]) || (ranges[2] < ranges[3]))
+        {
+            m_meshes.push_back(a_mesh);
+            m_meshRanges.insert(m_meshRanges.end(), ranges, ranges + 4);
+        }
+    }
+
+    unsigned int i, numChildren = a_mesh->getNumChildren();
+    for (i=0; i<numChildren; i++)
+    {
+        cMesh* child = dynamic_cast<cMesh*>(a_mesh->getChild(i));
+        if (child != NULL)
+        {
+            addMeshRanges(child);
+        }
+    }
+}
+
+
+//===========================================================================
+/*!
+    Mark the skin vertices, and the normal vertices if normals are
+    updated, as modified in the mesh owning them. This is done once per
+    update, after the threads of the pool have finished, since the
+    modified ranges of a mesh cannot be marked concurrently.
+
+    \fn       void cGELSkinning::markModifiedVertices()
+*/
+//===========================================================================
+void cGELSkinning::markModifiedVertices()
+{
+    for (unsigned int k=0; k<m_meshes.size(); k++)
+    {
+        const unsigned int* ranges = &m_meshRanges[4*k];
+        if (ranges[0] < ranges[1])
+        {
+            m_meshes[k]->markModifiedVertices(ranges[0], ranges[1]);
+        }
+        if ((m_updateNormals) && (ranges[2] < ranges[3]))
+        {
+            m_meshes[k]->markModifiedVertices(ranges[2], ranges[3], false);
+        }
+    }
+}
@@ -0,0 +1,228 @@
+//===========================================================================
+/*
+    This file is part of the GEL dynamics engine.
+    Copyright (C) 2003-2009 by Francois Conti, Stanford University.
+    All rights reserved.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CGELSkinningH
+#define CGELSkinningH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CGELSkeletonNode.h"
+#include "CGELSkeletonLink.h"
+#include "CGELVertex.h"
+#include <vector>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CGELSkinning.h
+
+    \brief
+    <b> GEL Module </b> \n
+    Skinning Table.
+*/
+//===========================================================================
+
+//===========================================================================
+/*!
+    \class      cGELSkinning
+    \ingroup    GEL
+
+    \brief
+    cGELSkinning stores the attachment of the skin vertices of a deformable
+    mesh to its skeleton in flat arrays. Nodes and links are both expressed
+    as a frame (origin and 3x3 matrix), so that every vertex is updated by
+    the same branch free transformation of its local coordinates.
+
+    Frames that did not move since the previous update are skipped, and
+    the normals of the vertices surrounding moved vertices can be updated
+    in place of a full cMesh::computeAllNormals().
+*/
+//===========================================================================
+class cGELSkinning
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cGELSkinning.
+    cGELSkinning();
+
+    //! Destructor of cGELSkinning.
+    ~cGELSkinning();
+
+
+	//-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Build the skinning table from vertices attached to the skeleton of a mesh.
+    void build(cMesh* a_mesh, vector<cGELVertex>& a_vertices);
+
+    //! Clear the table.
+    void clear();
+
+    //! Update the position (and optionally the normal) of the skin vertices.
+    void update();
+
+    //! Return \b true if the table has been built.
+    bool isBuilt() const { return (m_built); }
+
+    //! Number of vertices attached to the skeleton.
+    unsigned int getNumVertices() const { return (unsigned int)(m_vertices.size()); }
+
+    //! Number of skeleton nodes and links referenced by the table.
+    unsigned int getNumBones() const { return (unsigned int)(m_boneDirty.size()); }
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - SETTINGS:
+    //-----------------------------------------------------------------------
+
+    //! If \b true, normals of vertices surrounding moved vertices are updated.
+    bool m_updateNormals;
+
+    //! If \b true, large tables are processed on the shared thread pool.
+    bool m_useMultithreading;
+
+    //! Minimum number of vertices for the table to be processed in parallel.
+    unsigned int m_minParallelVertices;
+
+
+  public:
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - DEFAULT SETTINGS:
+    //-----------------------------------------------------------------------
+
+    //! Default property - normal update.
+    static bool default_updateNormals;
+
+    //! Default property - multithreading.
+    static bool default_useMultithreading;
+
+
+  protected:
+
+	//-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Read the frames of all bones and flag the ones which moved.
+    bool updateFrames();
+
+    //! Transform vertices [a_begin, a_end).
+    void skinVertices(unsigned int a_begin, unsigned int a_end);
+
+    //! Compute normals of faces [a_begin, a_end) which have a moved vertex.
+    void updateFaceNormals(unsigned int a_begin, unsigned int a_end);
+
+    //! Sum face normals of vertices [a_begin, a_end) which have a moved face.
+    void updateVertexNormals(unsigned int a_begin, unsigned int a_end);
+
+    //! Run a task over [0, a_count), in parallel if large enough.
+    void process(cThreadPoolTask a_task, unsigned int a_count);
+
+    //! Thread pool task for skinVertices().
+    static void skinTask(void* a_data, unsigned int a_begin, unsigned int a_end);
+
+    //! Thread pool task for updateFaceNormals().
+    static void faceNormalTask(void* a_data, unsigned int a_begin, unsigned int a_end);
+
+    //! Thread pool task for updateVertexNormals().
+    static void vertexNormalTask(void* a_data, unsigned int a_begin, unsigned int a_end);
+
+    //! Record the range of skin and normal vertices owned by a mesh and its children.
+    void addMeshRanges(cMesh* a_mesh);
+
+    //! Mark the vertices updated by the last update as modified in their mesh.
+    void markModifiedVertices();
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - BONES:
+    //-----------------------------------------------------------------------
+
+    //! Skeleton nodes referenced by the table (bone i).
+    vector<cGELSkeletonNode*> m_boneNodes;
+
+    //! Skeleton links referenced by the table (bone m_boneNodes.size() + i).
+    vector<cGELSkeletonLink*> m_boneLinks;
+
+    //! Frame of each bone: origin (3) followed by a row major 3x3 matrix (9).
+    vector<double> m_frames;
+
+    //! Non zero for bones which moved since the last update.
+    vector<unsigned char> m_boneDirty;
+
+    //! \b false until frames have been read once after building.
+    bool m_framesValid;
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - VERTICES:
+    //-----------------------------------------------------------------------
+
+    //! Skin vertices.
+    vector<cVertex*> m_vertices;
+
+    //! Bone of each skin vertex.
+    vector<unsigned int> m_vertexBones;
+
+    //! Coordinates of each skin vertex in the frame of its bone (3 per vertex).
+    vector<double> m_localPos;
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - NORMALS:
+    //-----------------------------------------------------------------------
+
+    //! Vertices of the faces surrounding skin vertices (3 per face).
+    vector<cVertex*> m_faceVertices;
+
+    //! Bone of each face vertex, -1 if the vertex is not attached (3 per face).
+    vector<int> m_faceBones;
+
+    //! Unit normal of each face, zero if degenerated.
+    vector<cVector3d> m_faceNormals;
+
+    //! Non zero for faces which moved during the last update.
+    vector<unsigned char> m_faceDirty;
+
+    //! Vertices whose normal depends on a skin vertex.
+    vector<cVertex*> m_normalVertices;
+
+    //! Index of the first face of each normal vertex in m_normalFaces; last entry is its size.
+    vector<unsigned int> m_normalOffsets;
+
+    //! Faces adjacent to each normal vertex.
+    vector<unsigned int> m_normalFaces;
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - MESHES:
+    //-----------------------------------------------------------------------
+
+    //! Meshes owning skin vertices or normal vertices.
+    vector<cMesh*> m_meshes;
+
+    //! Range of skin vertices, then of normal vertices, in each mesh (4 per mesh).
+    vector<unsigned int> m_meshRanges;
+
+    //! \b true once the table has been built.
+    bool m_built;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
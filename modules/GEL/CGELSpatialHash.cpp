@@ -0,0 +1,309 @@
+//===========================================================================
+/*
+    This file is part of the GEL dynamics engine.
+    Copyright (C) 2003-2009 by Francois Conti, Stanford University.
+    All rights reserved.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CGELSpatialHash.h"
+//---------------------------------------------------------------------------
+#include <math.h>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cGELSpatialHash.
+
+    \fn       cGELSpatialHash::cGELSpatialHash()
+*/
+//===========================================================================
+cGELSpatialHash::cGELSpatialHash()
+{
+    m_cellSize        = 0.0;
+    m_tableMask       = 0;
+    m_currentCellSize = 1.0;
+    m_invCellSize     = 1.0;
+    m_maxRadius       = 0.0;
+    m_bucketStart.resize(2, 0);
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cGELSpatialHash.
+
+    \fn       cGELSpatialHash::~cGELSpatialHash()
+*/
+//===========================================================================
+cGELSpatialHash::~cGELSpatialHash()
+{
+}
+
+
+//===========================================================================
+/*!
+    Clear the table.
+
+    \fn       void cGELSpatialHash::clear()
+*/
+//===========================================================================
+void cGELSpatialHash::clear()
+{
+    m_entries.clear();
+    m_unsorted.clear();
+    m_unsortedBuckets.clear();
+    m_bucketStart.assign(2, 0);
+    m_tableMask = 0;
+    m_maxRadius = 0.0;
+}
+
+
+//===========================================================================
+/*!
+    Rebuild the table from the skeleton nodes of meshes using the skeleton
+    model and the mass particles of meshes using the mass particle model.
+    Entries are counting sorted by bucket so that each bucket is stored
+    contiguously.
+
+    \fn       void cGELSpatialHash::update(list<cGELMesh*>& a_meshes)
+    \param    a_meshes  Deformable meshes.
+*/
+//===========================================================================
+void cGELSpatialHash::update(list<cGELMesh*>& a_meshes)
+{
+    // collect nodes and particles
+    m_unsorted.clear();
+    m_maxRadius = 0.0;
+    cVector3d minPos( CHAI_LARGE,  CHAI_LARGE,  CHAI_LARGE);
+    cVector3d maxPos(-CHAI_LARGE, -CHAI_LARGE, -CHAI_LARGE);
+    cGELSpatialHashEntry entry;
+
+    list<cGELMesh*>::iterator i;
+    for(i = a_meshes.begin(); i != a_meshes.end(); ++i)
+    {
+        cGELMesh* mesh = *i;
+
+        if (mesh->m_useSkeletonModel)
+        {
+            list<cGELSkeletonNode*>::iterator n;
+            for(n = mesh->m_nodes.begin(); n != mesh->m_nodes.end(); ++n)
+            {
+                entry.m_pos = (*n)->m_pos;
+                entry.m_radius = (*n)->m_radius;
+                entry.m_node = *n;
+                entry.m_particle = NULL;
+                m_unsorted.push_back(entry);
+                m_maxRadius = cMax(m_maxRadius, entry.m_radius);
+            }
+        }
+
+        if (mesh->m_useMassParticleModel)
+        {
+            unsigned int p, numVertices = (unsigned int)(mesh->m_gelVertices.size());
+            for (p=0; p<numVertices; p++)
+            {
+                cGELMassParticle* particle = mesh->m_gelVertices[p].m_massParticle;
+                if (particle == NULL) { continue; }
+                entry.m_pos = particle->m_pos;
+                entry.m_radius = 0.0;
+                entry.m_node = NULL;
+                entry.m_particle = particle;
+                m_unsorted.push_back(entry);
+            }
+        }
+    }
+
+    unsigned int numEntries = (unsigned int)(m_unsorted.size());
+    unsigned int k;
+    for (k=0; k<numEntries; k++)
+    {
+        minPos.x = cMin(minPos.x, m_unsorted[k].m_pos.x);
+        minPos.y = cMin(minPos.y, m_unsorted[k].m_pos.y);
+        minPos.z = cMin(minPos.z, m_unsorted[k].m_pos.z);
+        maxPos.x = cMax(maxPos.x, m_unsorted[k].m_pos.x);
+        maxPos.y = cMax(maxPos.y, m_unsorted[k].m_pos.y);
+        maxPos.z = cMax(maxPos.z, m_unsorted[k].m_pos.z);
+    }
+
+    // choose cell size: node diameter, or average spacing of the items
+    if (m_cellSize > 0.0)
+    {
+        m_currentCellSize = m_cellSize;
+    }
+    else if (m_maxRadius > 0.0)
+    {
+        m_currentCellSize = 2.0 * m_maxRadius;
+    }
+    else if (numEntries > 1)
+    {
+        double extent = cMax(maxPos.x - minPos.x, cMax(maxPos.y - minPos.y, maxPos.z - minPos.z));
+        m_currentCellSize = extent / pow((double)numEntries, 1.0 / 3.0);
+    }
+    if (m_currentCellSize < CHAI_SMALL) { m_currentCellSize = 1.0; }
+    m_invCellSize = 1.0 / m_currentCellSize;
+
+    // size table to about twice the number of entries
+    unsigned int numBuckets = 1;
+    while (numBuckets < 2 * numEntries) { numBuckets <<= 1; }
+    m_tableMask = numBuckets - 1;
+
+    // compute cells and count entries per bucket
+    m_bucketStart.assign(numBuckets + 1, 0);
+    m_unsortedBuckets.resize(numEntries);
+    for (k=0; k<numEntries; k++)
+    {
+        cGELSpatialHashEntry& e = m_unsorted[k];
+        e.m_cell[0] = (int)floor(e.m_pos.x * m_invCellSize);
+        e.m_cell[1] = (int)floor(e.m_pos.y * m_invCellSize);
+        e.m_cell[2] = (int)floor(e.m_pos.z * m_invCellSize);
+        unsigned int b = bucket(e.m_cell[0], e.m_cell[1], e.m_cell[2]);
+        m_unsortedBuckets[k] = b;
+        m_bucketStart[b + 1]++;
+    }
+
+    for (k=0; k<numBuckets; k++)
+    {
+        m_bucketStart[k + 1] += m_bucketStart[k];
+    }
+
+    // scatter entries to their bucket
+    m_entries.resize(numEntries);
+    vector<unsigned int> fill(m_bucketStart.begin(), m_bucketStart.end() - 1);
+    for (k=0; k<numEntries; k++)
+    {
+        m_entries[fill[m_unsortedBuckets[k]]++] = m_unsorted[k];
+    }
+}
+
+
+//===========================================================================
+/*!
+    Find skeleton nodes whose sphere intersects a sphere.
+
+    \fn       unsigned int cGELSpatialHash::queryNodes(const cVector3d& a_pos,
+                                  const double a_radius,
+                                  vector<cGELSkeletonNode*>& a_nodes) const
+    \param    a_pos  Center of the query sphere.
+    \param    a_radius  Radius of the query sphere.
+    \param    a_nodes  List to which nodes are appended.
+    \return   Return the number of nodes appended.
+*/
+//===========================================================================
+unsigned int cGELSpatialHash::queryNodes(const cVector3d& a_pos,
+                                         const double a_radius,
+                                         vector<cGELSkeletonNode*>& a_nodes) const
+{
+    unsigned int size = (unsigned int)(a_nodes.size());
+    query(a_pos, a_radius, &a_nodes, NULL);
+    return ((unsigned int)(a_nodes.size()) - size);
+}
+
+
+//===========================================================================
+/*!
+    Find mass particles located inside a sphere.
+
+    \fn       unsigned int cGELSpatialHash::queryMassParticles(const cVector3d& a_pos,
+                                  const double a_radius,
+                                  vector<cGELMassParticle*>& a_particles) const
+    \param    a_pos  Center of the query sphere.
+    \param    a_radius  Radius of the query sphere.
+    \param    a_particles  List to which particles are appended.
+    \return   Return the number of particles appended.
+*/
+//===========================================================================
+unsigned int cGELSpatialHash::queryMassParticles(const cVector3d& a_pos,
+                                                 const double a_radius,
+                                                 vector<cGELMassParticle*>& a_particles) const
+{
+    unsigned int size = (unsigned int)(a_particles.size());
+    query(a_pos, a_radius, NULL, &a_particles);
+    return ((unsigned int)(a_particles.size()) - size);
+}
+
+
+//===========================================================================
+/*!
+    Visit the cells overlapping a sphere, grown by the largest node radius,
+    and append the entries which intersect it. Entries whose cell differs
+    from the visited cell are skipped, so that cells sharing a bucket do
+    not report an entry twice.
+
+    \fn       void cGELSpatialHash::query(const cVector3d& a_pos,
+                                  const double a_radius,
+                                  vector<cGELSkeletonNode*>* a_nodes,
+                                  vector<cGELMassParticle*>* a_particles) const
+    \param    a_pos  Center of the query sphere.
+    \param    a_radius  Radius of the query sphere.
+    \param    a_nodes  List of nodes found, or NULL.
+    \param    a_particles  List of particles found, or NULL.
+*/
+//===========================================================================
+void cGELSpatialHash::query(const cVector3d& a_pos,
+                            const double a_radius,
+                            vector<cGELSkeletonNode*>* a_nodes,
+                            vector<cGELMassParticle*>* a_particles) const
+{
+    unsigned int numEntries = (unsigned int)(m_entries.size());
+    if (numEntries == 0) { return; }
+
+    double reach = a_radius + m_maxRadius;
+    int x0 = (int)floor((a_pos.x - reach) * m_invCellSize);
+    int y0 = (int)floor((a_pos.y - reach) * m_invCellSize);
+    int z0 = (int)floor((a_pos.z - reach) * m_invCellSize);
+    int x1 = (int)floor((a_pos.x + reach) * m_invCellSize);
+    int y1 = (int)floor((a_pos.y + reach) * m_invCellSize);
+    int z1 = (int)floor((a_pos.z + reach) * m_invCellSize);
+
+    // large queries are cheaper as a linear scan
+    double numCells = ((double)x1 - x0 + 1) * ((double)y1 - y0 + 1) * ((double)z1 - z0 + 1);
+    bool scan = (numCells >= (double)numEntries);
+    if (scan)
+    {
+        x1 = x0;
+        y1 = y0;
+        z1 = z0;
+    }
+
+    for (int x=x0; x<=x1; x++)
+    {
+        for (int y=y0; y<=y1; y++)
+        {
+            for (int z=z0; z<=z1; z++)
+            {
+                unsigned int first = 0;
+                unsigned int last = numEntries;
+                if (!scan)
+                {
+                    unsigned int b = bucket(x, y, z);
+                    first = m_bucketStart[b];
+                    last = m_bucketStart[b + 1];
+                }
+
+                for (unsigned int k=first; k<last; k++)
+                {
+                    const cGELSpatialHashEntry& e = m_entries[k];
+                    if ((!scan) && ((e.m_cell[0] != x) || (e.m_cell[1] != y) || (e.m_cell[2] != z))) { continue; }
+
+                    double r = a_radius + e.m_radius;
+                    if (cDistanceSq(a_pos, e.m_pos) > (r * r)) { continue; }
+
+                    if ((e.m_node != NULL) && (a_nodes != NULL))
+                    {
+                        a_nodes->push_back(e.m_node);
+                    }
+                    else if ((e.m_particle != NULL) && (a_particles != NULL))
+                    {
+                        a_particles->push_back(e.m_particle);
+                    }
+                }
+            }
+        }
+    }
+}
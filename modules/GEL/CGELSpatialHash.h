@@ -0,0 +1,184 @@
+//===========================================================================
+/*
+    This file is part of the GEL dynamics engine.
+    Copyright (C) 2003-2009 by Francois Conti, Stanford University.
+    All rights reserved.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CGELSpatialHashH
+#define CGELSpatialHashH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CGELMesh.h"
+#include <vector>
+#include <list>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CGELSpatialHash.h
+
+    \brief
+    <b> GEL Module </b> \n
+    Spatial Hash of Nodes and Particles.
+*/
+//===========================================================================
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+/*!
+    Node or mass particle stored in a cGELSpatialHash.
+*/
+//---------------------------------------------------------------------------
+struct cGELSpatialHashEntry
+{
+    //! Constructor of cGELSpatialHashEntry.
+    cGELSpatialHashEntry() : m_pos(0.0, 0.0, 0.0), m_radius(0.0), m_node(NULL), m_particle(NULL)
+    {
+        m_cell[0] = 0;
+        m_cell[1] = 0;
+        m_cell[2] = 0;
+    }
+
+    //! Position of the node or particle.
+    cVector3d m_pos;
+
+    //! Radius of the node, 0 for particles.
+    double m_radius;
+
+    //! Grid cell containing the position.
+    int m_cell[3];
+
+    //! Skeleton node, or NULL.
+    cGELSkeletonNode* m_node;
+
+    //! Mass particle, or NULL.
+    cGELMassParticle* m_particle;
+};
+#endif // DOXYGEN_SHOULD_SKIP_THIS
+
+
+//===========================================================================
+/*!
+    \class      cGELSpatialHash
+    \ingroup    GEL
+
+    \brief
+    cGELSpatialHash sorts the skeleton nodes and mass particles of a set
+    of deformable meshes into a uniform grid. Grid cells are hashed into
+    a fixed size table, so memory only depends on the number of items
+    and not on the extent of the scene. The table is rebuilt in linear
+    time from the current positions by update(); radius queries then
+    only visit the cells overlapping the query sphere.
+*/
+//===========================================================================
+class cGELSpatialHash
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cGELSpatialHash.
+    cGELSpatialHash();
+
+    //! Destructor of cGELSpatialHash.
+    ~cGELSpatialHash();
+
+
+	//-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Rebuild the table from the nodes and particles of a list of meshes.
+    void update(list<cGELMesh*>& a_meshes);
+
+    //! Clear the table.
+    void clear();
+
+    //! Find nodes whose sphere intersects the sphere (\e a_pos, \e a_radius).
+    unsigned int queryNodes(const cVector3d& a_pos, const double a_radius,
+                            vector<cGELSkeletonNode*>& a_nodes) const;
+
+    //! Find mass particles located within \e a_radius of \e a_pos.
+    unsigned int queryMassParticles(const cVector3d& a_pos, const double a_radius,
+                                    vector<cGELMassParticle*>& a_particles) const;
+
+    //! Number of nodes and particles stored in the table.
+    unsigned int getNumEntries() const { return (unsigned int)(m_entries.size()); }
+
+    //! Size of the grid cells used by the last update.
+    double getCurrentCellSize() const { return (m_currentCellSize); }
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    /*!
+        Size of the grid cells. If zero or negative, the size is chosen at
+        each update from the node radii or from the spacing of particles.
+    */
+    double m_cellSize;
+
+
+  protected:
+
+	//-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Hash table bucket of a grid cell.
+    inline unsigned int bucket(const int a_x, const int a_y, const int a_z) const
+    {
+        unsigned int h = ((unsigned int)(a_x) * 73856093u) ^
+                         ((unsigned int)(a_y) * 19349663u) ^
+                         ((unsigned int)(a_z) * 83492791u);
+        return (h & m_tableMask);
+    }
+
+    //! Append nodes and/or particles overlapping a sphere to the lists which are not NULL.
+    void query(const cVector3d& a_pos, const double a_radius,
+               vector<cGELSkeletonNode*>* a_nodes,
+               vector<cGELMassParticle*>* a_particles) const;
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Entries sorted by bucket.
+    vector<cGELSpatialHashEntry> m_entries;
+
+    //! Unsorted entries collected during update.
+    vector<cGELSpatialHashEntry> m_unsorted;
+
+    //! Bucket of each unsorted entry.
+    vector<unsigned int> m_unsortedBuckets;
+
+    //! Index of the first entry of each bucket; last entry is the number of entries.
+    vector<unsigned int> m_bucketStart;
+
+    //! Number of buckets minus one (number of buckets is a power of two).
+    unsigned int m_tableMask;
+
+    //! Cell size used by the last update.
+    double m_currentCellSize;
+
+    //! Inverse of m_currentCellSize.
+    double m_invCellSize;
+
+    //! Largest node radius stored in the table.
+    double m_maxRadius;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
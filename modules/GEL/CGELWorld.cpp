@@ -63,6 +63,16 @@ cGELWorld::cGELWorld()
     // set a default value for the integration time step [s].
     m_integrationTime = 1.0f / 400.0f;
 
+    // spatial hash is disabled by default
+    m_useSpatialHash = false;
+
+    // collisions between meshes are disabled by default
+    m_useMeshCollision = false;
+
+    // the collision handler starts a worker thread, so it is only created
+    // when collisions are enabled
+    m_meshCollision = NULL;
+
     // create a collision detector for world
     m_collisionDetector = new cGELWorldCollision(this);
 }
@@ -78,6 +88,11 @@ cGELWorld::cGELWorld()
 cGELWorld::~cGELWorld()
 {
     m_gelMeshes.clear();
+
+    if (m_meshCollision != NULL)
+    {
+        delete m_meshCollision;
+    }
 }
 
 
@@ -150,6 +165,20 @@ void cGELWorld::updateDynamics(double a_time)
             nextItem->computeForces();
         }
 
+        // add contact forces between meshes
+        if (m_useMeshCollision)
+        {
+            if (m_meshCollision == NULL)
+            {
+                m_meshCollision = new cGELMeshCollision();
+            }
+            if (!m_meshCollision->isBuilt())
+            {
+                m_meshCollision->build(m_gelMeshes);
+            }
+            m_meshCollision->computeForces();
+        }
+
         // compute next pose of model
         for(i = m_gelMeshes.begin(); i != m_gelMeshes.end(); ++i)
         {
@@ -164,6 +193,12 @@ void cGELWorld::updateDynamics(double a_time)
             nextItem->applyNextPose();
         }
 
+        // update spatial hash with new pose
+        if (m_useSpatialHash)
+        {
+            m_spatialHash.update(m_gelMeshes);
+        }
+
         // update simulation time
         m_simulationTime = m_simulationTime + m_integrationTime;
     }
@@ -187,3 +222,17 @@ void cGELWorld::updateSkins()
     }
 }
 
+
+//===========================================================================
+/*!
+    Rebuild the spatial hash from the current position of the nodes and
+    mass particles of all objects. This is done automatically after each
+    integration step if m_useSpatialHash is \b true.
+
+    \fn       void cGELWorld::updateSpatialHash()
+*/
+//===========================================================================
+void cGELWorld::updateSpatialHash()
+{
+    m_spatialHash.update(m_gelMeshes);
+}
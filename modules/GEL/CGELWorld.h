@@ -16,6 +16,8 @@
 //---------------------------------------------------------------------------
 #include "chai3d.h"
 #include "CGELMesh.h"
+#include "CGELSpatialHash.h"
+#include "CGELMeshCollision.h"
 //---------------------------------------------------------------------------
 
 //===========================================================================
@@ -65,6 +67,9 @@ class cGELWorld : public cGenericObject
     //! Update vertices of all objects.
     void updateSkins();
 
+    //! Rebuild the spatial hash from the current nodes and particles.
+    void updateSpatialHash();
+
 
 	//-----------------------------------------------------------------------
     // MEMBERS:
@@ -82,6 +87,18 @@ class cGELWorld : public cGenericObject
     //! Gravity constant.
     cVector3d m_gravity;
 
+    //! If \b true, the spatial hash is rebuilt after each integration step.
+    bool m_useSpatialHash;
+
+    //! Spatial hash of the nodes and mass particles of all objects.
+    cGELSpatialHash m_spatialHash;
+
+    //! If \b true, contacts between mass particle meshes are computed at each step.
+    bool m_useMeshCollision;
+
+    //! Collision handler between mass particle meshes, created on first use (call clear() when meshes change).
+    cGELMeshCollision* m_meshCollision;
+
 
   private:
 
@@ -34,7 +34,12 @@
 #include "CGELSkeletonNode.h"
 #include "CGELSkeletonLink.h"
 #include "CGELVertex.h"
+#include "CGELPositionBasedSolver.h"
+#include "CGELSkinning.h"
+#include "CGELCorotationalFEM.h"
 #include "CGELMesh.h"
+#include "CGELSpatialHash.h"
+#include "CGELMeshCollision.h"
 #include "CGELWorld.h"
 
 //---------------------------------------------------------------------------
@@ -70,9 +70,15 @@
 #include "graphics/CGenericTexture.h"
 #include "graphics/CMacrosGL.h"
 #include "graphics/CMaterial.h"
+#include "graphics/CMipmapChain.h"
 #include "graphics/CTexture2D.h"
 #include "graphics/CTriangle.h"
 #include "graphics/CVertex.h"
+#include "graphics/CVertexStreams.h"
+#include "graphics/CVertexBuffer.h"
+#include "graphics/CDirtyRange.h"
+#include "graphics/CVertexHash.h"
+#include "graphics/CRenderQueue.h"
 
 
 //---------------------------------------------------------------------------
@@ -152,16 +158,21 @@
 //---------------------------------------------------------------------------
 #include "timers/CPrecisionClock.h"
 #include "timers/CThread.h"
+#include "timers/CThreadPool.h"
+#include "timers/CWorkerThread.h"
 
 
 //---------------------------------------------------------------------------
 //!     \defgroup   files  Files
 //---------------------------------------------------------------------------
+#include "files/CAsyncLoader.h"
 #include "files/CFileLoader3DS.h"
+#include "files/CFileLoaderBIN.h"
 #include "files/CFileLoaderBMP.h"
 #include "files/CFileLoaderOBJ.h"
 #include "files/CFileLoaderTGA.h"
 #include "files/CImageLoader.h"
+#include "files/CMappedFile.h"
 #include "files/CMeshLoader.h"
 
 
@@ -21,13 +21,51 @@
 
 //---------------------------------------------------------------------------
 #include "collisions/CCollisionAABB.h"
+#include "files/CMappedFile.h"
 #include <iostream>
+#include <stdio.h>
 using namespace std;
 //---------------------------------------------------------------------------
 //! Pointer to first free location in array of AABB tree nodes.
 cCollisionAABBInternal* g_nextFreeNode;
 //---------------------------------------------------------------------------
 
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+// File identifier of AABB trees
+static const char* AABB_TREE_MAGIC = "CHAIAABB";
+
+// An internal node of a saved tree (56 bytes). Children are node indices,
+// or leaf indices flagged with CHAI_COLLISION_TREE_LEAF.
+struct cAABBNodeRecord
+{
+    double m_min[3];
+    double m_max[3];
+    unsigned int m_left;
+    unsigned int m_right;
+};
+
+// A leaf of a saved tree (56 bytes)
+struct cAABBLeafRecord
+{
+    double m_min[3];
+    double m_max[3];
+    unsigned int m_triangle;
+    unsigned int m_reserved;
+};
+
+//---------------------------------------------------------------------------
+// Copy a bounding box into a record.
+//---------------------------------------------------------------------------
+static void store_box(const cCollisionAABBBox& a_box, double* a_min, double* a_max)
+{
+    a_min[0] = a_box.m_min.x;  a_min[1] = a_box.m_min.y;  a_min[2] = a_box.m_min.z;
+    a_max[0] = a_box.m_max.x;  a_max[1] = a_box.m_max.y;  a_max[2] = a_box.m_max.z;
+}
+
+#endif  // DOXYGEN_SHOULD_SKIP_THIS
+
+
 //===========================================================================
 /*!
     Constructor of cCollisionAABB.
@@ -48,6 +86,7 @@ cCollisionAABB::cCollisionAABB(vector<cTriangle> *a_triangles, bool a_useNeighbo
     m_leaves        = NULL;
     m_numTriangles  = 0;
     m_useNeighbors  = a_useNeighbors;
+    m_radius        = 0;
 }
 
 
@@ -100,13 +139,20 @@ void cCollisionAABB::initialize(double a_radius)
 {
     unsigned int i;
     m_lastCollision = NULL;
+    m_radius = a_radius;
 
     // if a previous tree was created, delete it
-    if (m_root != NULL)
+    if (m_internalNodes != NULL)
     {
-        delete[] m_root;
-        m_root = NULL;
+        delete [] m_internalNodes;
+        m_internalNodes = NULL;
+    }
+    if (m_leaves != NULL)
+    {
+        delete [] m_leaves;
+        m_leaves = NULL;
     }
+    m_root = NULL;
 
     // reset triangle counter
     m_numTriangles = 0;
@@ -162,6 +208,286 @@ void cCollisionAABB::initialize(double a_radius)
 }
 
 
+//===========================================================================
+/*!
+    Save the tree to a file, so that it can be loaded with loadTree()
+    instead of being built again the next time the same mesh is used.
+    Nodes and leaves are stored by index, with the bounding boxes computed
+    by initialize().
+
+    \fn       bool cCollisionAABB::saveTree(const string& a_fileName)
+    \param    a_fileName  Name of the file.
+    \return   Return \b true if the file was written.
+*/
+//===========================================================================
+bool cCollisionAABB::saveTree(const string& a_fileName)
+{
+    unsigned int numNodes = (m_numTriangles >= 2) ? m_numTriangles - 1 : 0;
+
+    cCollisionTreeHeader header;
+    if (!initTreeHeader(header, AABB_TREE_MAGIC, m_triangles, m_radius,
+                        numNodes, sizeof(cAABBNodeRecord),
+                        m_numTriangles, sizeof(cAABBLeafRecord)))
+    {
+        return (false);
+    }
+
+    FILE* file = fopen(a_fileName.c_str(), "wb");
+    if (file == NULL) { return (false); }
+    bool result = (fwrite(&header, sizeof(header), 1, file) == 1);
+
+    // internal nodes, in the order of the node array
+    for (unsigned int i=0; (i<numNodes) && result; i++)
+    {
+        cCollisionAABBInternal* node = &m_internalNodes[i];
+        cAABBNodeRecord record;
+        store_box(node->m_bbox, record.m_min, record.m_max);
+
+        cCollisionAABBNode* children[2] = { node->m_leftSubTree, node->m_rightSubTree };
+        unsigned int indices[2];
+        for (unsigned int k=0; k<2; k++)
+        {
+            if (children[k]->m_nodeType == AABB_NODE_LEAF)
+            {
+                indices[k] = (unsigned int)((cCollisionAABBLeaf*)children[k] - m_leaves) |
+                             CHAI_COLLISION_TREE_LEAF;
+            }
+            else
+            {
+                indices[k] = (unsigned int)((cCollisionAABBInternal*)children[k] - m_internalNodes);
+            }
+        }
+        record.m_left = indices[0];
+        record.m_right = indices[1];
+
+        result = (fwrite(&record, sizeof(record), 1, file) == 1);
+    }
+
+    // leaves
+    for (unsigned int i=0; (i<m_numTriangles) && result; i++)
+    {
+        cAABBLeafRecord record;
+        store_box(m_leaves[i].m_bbox, record.m_min, record.m_max);
+        record.m_triangle = (unsigned int)(m_leaves[i].m_triangle - &(*m_triangles)[0]);
+        record.m_reserved = 0;
+
+        result = (fwrite(&record, sizeof(record), 1, file) == 1);
+    }
+
+    if (fclose(file) != 0) { result = false; }
+    if (!result) { remove(a_fileName.c_str()); }
+    return (result);
+}
+
+
+//===========================================================================
+/*!
+    Load a tree saved by saveTree(). The file is only used if it was saved
+    for the same radius, and for a mesh with the same triangles and vertex
+    positions; its structure is checked before the current tree is
+    replaced. If the file can not be used, the current tree is kept and
+    initialize() must be called to build a new one.
+
+    \fn       bool cCollisionAABB::loadTree(const string& a_fileName, double a_radius)
+    \param    a_fileName  Name of the file.
+    \param    a_radius  Radius around the triangles, as passed to initialize().
+    \return   Return \b true if the tree was loaded.
+*/
+//===========================================================================
+bool cCollisionAABB::loadTree(const string& a_fileName, double a_radius)
+{
+    cMappedFile file;
+    if (!file.open(a_fileName.c_str())) { return (false); }
+    if (!checkTreeHeader(file.getData(), file.getSize(), AABB_TREE_MAGIC,
+                         m_triangles, a_radius,
+                         sizeof(cAABBNodeRecord), sizeof(cAABBLeafRecord)))
+    {
+        return (false);
+    }
+
+    const char* data = file.getData();
+    const cCollisionTreeHeader* header = (const cCollisionTreeHeader*)data;
+    const cAABBNodeRecord* nodes = (const cAABBNodeRecord*)(data + header->m_nodeOffset);
+    const cAABBLeafRecord* leaves = (const cAABBLeafRecord*)(data + header->m_leafOffset);
+    unsigned int numNodes = header->m_numNodes;
+    unsigned int numLeaves = header->m_numLeaves;
+    unsigned int numTriangles = (unsigned int)m_triangles->size();
+
+    // the tree has one leaf per allocated triangle
+    unsigned int numAllocated = 0;
+    for (unsigned int i=0; i<numTriangles; i++)
+    {
+        if ((*m_triangles)[i].allocated()) { numAllocated++; }
+    }
+    if ((numLeaves != numAllocated) ||
+        (numNodes != ((numLeaves >= 2) ? numLeaves - 1 : 0)))
+    {
+        return (false);
+    }
+
+    vector<char> used(numTriangles, 0);
+    for (unsigned int i=0; i<numLeaves; i++)
+    {
+        unsigned int triangle = leaves[i].m_triangle;
+        if ((triangle >= numTriangles) || used[triangle] ||
+            (!(*m_triangles)[triangle].allocated()))
+        {
+            return (false);
+        }
+        used[triangle] = 1;
+    }
+
+    // every node but the root, and every leaf, must have exactly one parent.
+    // Nodes are stored before their children, so the file can not describe
+    // a cycle.
+    vector<char> nodeUsed(numNodes, 0);
+    vector<char> leafUsed(numLeaves, 0);
+    for (unsigned int i=0; i<numNodes; i++)
+    {
+        unsigned int children[2] = { nodes[i].m_left, nodes[i].m_right };
+        for (unsigned int k=0; k<2; k++)
+        {
+            unsigned int index = children[k] & ~CHAI_COLLISION_TREE_LEAF;
+            if (children[k] & CHAI_COLLISION_TREE_LEAF)
+            {
+                if ((index >= numLeaves) || leafUsed[index]) { return (false); }
+                leafUsed[index] = 1;
+            }
+            else
+            {
+                if ((index <= i) || (index >= numNodes) || nodeUsed[index]) { return (false); }
+                nodeUsed[index] = 1;
+            }
+        }
+    }
+
+    // release the previous tree
+    if (m_internalNodes != NULL)
+    {
+        delete [] m_internalNodes;
+        m_internalNodes = NULL;
+    }
+    if (m_leaves != NULL)
+    {
+        delete [] m_leaves;
+        m_leaves = NULL;
+    }
+    m_root = NULL;
+    m_lastCollision = NULL;
+    m_radius = a_radius;
+    m_numTriangles = numLeaves;
+    if (numLeaves == 0) { return (true); }
+
+    // create the leaves
+    m_leaves = new cCollisionAABBLeaf[numLeaves];
+    for (unsigned int i=0; i<numLeaves; i++)
+    {
+        const cAABBLeafRecord& record = leaves[i];
+        m_leaves[i].m_triangle = &(*m_triangles)[record.m_triangle];
+        m_leaves[i].m_bbox.setValue(cVector3d(record.m_min[0], record.m_min[1], record.m_min[2]),
+                                    cVector3d(record.m_max[0], record.m_max[1], record.m_max[2]));
+    }
+
+    // create the internal nodes; depths are assigned from the root down
+    if (numNodes > 0)
+    {
+        m_internalNodes = new cCollisionAABBInternal[numNodes];
+        m_internalNodes[0].m_depth = 0;
+        for (unsigned int i=0; i<numNodes; i++)
+        {
+            const cAABBNodeRecord& record = nodes[i];
+            cCollisionAABBInternal* node = &m_internalNodes[i];
+            node->m_bbox.setValue(cVector3d(record.m_min[0], record.m_min[1], record.m_min[2]),
+                                  cVector3d(record.m_max[0], record.m_max[1], record.m_max[2]));
+            node->m_testLineBox = true;
+
+            unsigned int children[2] = { record.m_left, record.m_right };
+            cCollisionAABBNode* subTrees[2];
+            for (unsigned int k=0; k<2; k++)
+            {
+                unsigned int index = children[k] & ~CHAI_COLLISION_TREE_LEAF;
+                if (children[k] & CHAI_COLLISION_TREE_LEAF)
+                {
+                    subTrees[k] = &m_leaves[index];
+                }
+                else
+                {
+                    subTrees[k] = &m_internalNodes[index];
+                }
+                subTrees[k]->m_depth = node->m_depth + 1;
+            }
+            node->m_leftSubTree = subTrees[0];
+            node->m_rightSubTree = subTrees[1];
+        }
+        m_root = m_internalNodes;
+    }
+    else
+    {
+        m_root = &m_leaves[0];
+    }
+
+    // assign parent relationships in the tree
+    m_root->setParent(0,1);
+
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Update the tree after the mesh has been modified. If triangles have
+    been added or removed, the tree is built again. Otherwise only the
+    leaves of triangles which use a modified vertex are fitted again, and
+    their ancestors are enlarged or shrunk up to the first one whose box
+    does not change. The structure of the tree is kept, so its quality
+    slowly degrades under large deformations.
+
+    \fn       void cCollisionAABB::update(const cDirtyRange& a_vertices,
+                                          const cDirtyRange& a_triangles)
+    \param    a_vertices  Modified vertices.
+    \param    a_triangles  Modified triangles.
+*/
+//===========================================================================
+void cCollisionAABB::update(const cDirtyRange& a_vertices, const cDirtyRange& a_triangles)
+{
+    // a different set of triangles requires a new tree
+    if (!a_triangles.isEmpty())
+    {
+        initialize(m_radius);
+        return;
+    }
+    if ((a_vertices.isEmpty()) || (m_root == NULL)) { return; }
+
+    for (unsigned int i=0; i<m_numTriangles; i++)
+    {
+        cCollisionAABBLeaf* leaf = &m_leaves[i];
+        cTriangle* triangle = leaf->m_triangle;
+        if ((!a_vertices.contains(triangle->m_indexVertex0)) &&
+            (!a_vertices.contains(triangle->m_indexVertex1)) &&
+            (!a_vertices.contains(triangle->m_indexVertex2)))
+        {
+            continue;
+        }
+
+        leaf->fitBBox(m_radius);
+
+        // propagate to the ancestors while their box changes
+        cCollisionAABBNode* node = leaf->m_parent;
+        while (node != NULL)
+        {
+            cVector3d min = node->m_bbox.m_min;
+            cVector3d max = node->m_bbox.m_max;
+            node->fitBBox(m_radius);
+            if (min.equals(node->m_bbox.m_min) && max.equals(node->m_bbox.m_max))
+            {
+                break;
+            }
+            node = node->m_parent;
+        }
+    }
+}
+
+
 //===========================================================================
 /*!
     Check if the given line segment intersects any triangle of the mesh.  If so,
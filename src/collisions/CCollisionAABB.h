@@ -75,6 +75,15 @@ class cCollisionAABB : public cGenericCollision
     //! Build the AABB Tree for the first time.
     void initialize(double a_radius = 0);
 
+    //! Save the AABB Tree to a file.
+    bool saveTree(const string& a_fileName);
+
+    //! Load an AABB Tree saved for the same mesh and radius, instead of building it.
+    bool loadTree(const string& a_fileName, double a_radius = 0);
+
+    //! Refit the boxes of modified triangles, or rebuild the tree if triangles were added or removed.
+    void update(const cDirtyRange& a_vertices, const cDirtyRange& a_triangles);
+
     //! Draw the bounding boxes in OpenGL.
     void render();
 
@@ -112,6 +121,9 @@ class cCollisionAABB : public cGenericCollision
 
     //! Use list of triangles' neighbors to speed up collision detection?
     bool m_useNeighbors;
+
+    //! Radius around the triangles, as passed to initialize().
+    double m_radius;
 };
 
 //---------------------------------------------------------------------------
@@ -21,7 +21,9 @@
 
 //---------------------------------------------------------------------------
 #include "collisions/CCollisionSpheres.h"
+#include "files/CMappedFile.h"
 #include <algorithm>
+#include <stdio.h>
 //---------------------------------------------------------------------------
 //! Pointer to first free location in array of sphere tree internal nodes.
 cCollisionSpheresNode* g_nextInternalNode;
@@ -38,6 +40,32 @@ const double LARGE = 1e10;
 //cTriangle* secret2;
 //---------------------------------------------------------------------------
 
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+// File identifier of sphere trees
+static const char* SPHERE_TREE_MAGIC = "CHAISPHR";
+
+// An internal node of a saved tree (40 bytes). Children are node indices,
+// or leaf indices flagged with CHAI_COLLISION_TREE_LEAF.
+struct cSphereNodeRecord
+{
+    double m_center[3];
+    double m_radius;
+    unsigned int m_left;
+    unsigned int m_right;
+};
+
+// A leaf of a saved tree (8 bytes). Its sphere is computed again from
+// the triangle, which is faster than reading it.
+struct cSphereLeafRecord
+{
+    unsigned int m_triangle;
+    unsigned int m_reserved;
+};
+
+#endif  // DOXYGEN_SHOULD_SKIP_THIS
+
+
 
 //===========================================================================
 /*!
@@ -56,6 +84,7 @@ cCollisionSpheres::cCollisionSpheres(vector<cTriangle> *a_triangles,
     m_useNeighbors = a_useNeighbors;
     m_root = NULL;
     m_firstLeaf = 0;
+    m_radius = 0;
 
     // set material properties
     m_material.m_ambient.set(0.1, 0.3, 0.1, 0.3);
@@ -74,9 +103,9 @@ cCollisionSpheres::cCollisionSpheres(vector<cTriangle> *a_triangles,
 //===========================================================================
 cCollisionSpheres::~cCollisionSpheres()
 {
-    // delete array of internal nodes
-    if (m_root != NULL)
-        delete [] m_root;
+    // delete array of internal nodes (with a single triangle, the root is the leaf)
+    if ((m_root != NULL) && ((void*)m_root != (void*)m_firstLeaf))
+        delete [] (cCollisionSpheresNode*)m_root;
 
     // delete array of leaf nodes
     // if ((m_trigs) && (m_trigs->size() > 1) && (m_firstLeaf))
@@ -103,6 +132,7 @@ cCollisionSpheres::~cCollisionSpheres()
 void cCollisionSpheres::initialize(double a_radius)
 {
 	secret = NULL;
+    m_radius = a_radius;
 
     // initialize number of triangles, root pointer, and last intersected triangle
     int numTriangles = m_trigs->size();
@@ -143,6 +173,246 @@ void cCollisionSpheres::initialize(double a_radius)
 }
 
 
+//===========================================================================
+/*!
+    Save the tree to a file, so that it can be loaded with loadTree()
+    instead of being built again the next time the same mesh is used.
+
+    \fn       bool cCollisionSpheres::saveTree(const string& a_fileName)
+    \param    a_fileName  Name of the file.
+    \return   Return \b true if the file was written.
+*/
+//===========================================================================
+bool cCollisionSpheres::saveTree(const string& a_fileName)
+{
+    unsigned int numLeaves = (m_root != NULL) ? (unsigned int)m_trigs->size() : 0;
+    unsigned int numNodes = (numLeaves >= 2) ? numLeaves - 1 : 0;
+    cCollisionSpheresNode* internalNodes = (numNodes > 0) ? (cCollisionSpheresNode*)m_root : NULL;
+
+    cCollisionTreeHeader header;
+    if (!initTreeHeader(header, SPHERE_TREE_MAGIC, m_trigs, m_radius,
+                        numNodes, sizeof(cSphereNodeRecord),
+                        numLeaves, sizeof(cSphereLeafRecord)))
+    {
+        return (false);
+    }
+
+    FILE* file = fopen(a_fileName.c_str(), "wb");
+    if (file == NULL) { return (false); }
+    bool result = (fwrite(&header, sizeof(header), 1, file) == 1);
+
+    // internal nodes, in the order of the node array
+    for (unsigned int i=0; (i<numNodes) && result; i++)
+    {
+        cCollisionSpheresNode* node = &internalNodes[i];
+        cSphereNodeRecord record;
+        const cVector3d& center = node->getCenter();
+        record.m_center[0] = center.x;
+        record.m_center[1] = center.y;
+        record.m_center[2] = center.z;
+        record.m_radius = node->getRadius();
+
+        cCollisionSpheresSphere* children[2] = { node->m_left, node->m_right };
+        unsigned int indices[2];
+        for (unsigned int k=0; k<2; k++)
+        {
+            if (children[k]->isLeaf())
+            {
+                indices[k] = (unsigned int)((cCollisionSpheresLeaf*)children[k] - m_firstLeaf) |
+                             CHAI_COLLISION_TREE_LEAF;
+            }
+            else
+            {
+                indices[k] = (unsigned int)((cCollisionSpheresNode*)children[k] - internalNodes);
+            }
+        }
+        record.m_left = indices[0];
+        record.m_right = indices[1];
+
+        result = (fwrite(&record, sizeof(record), 1, file) == 1);
+    }
+
+    // leaves
+    for (unsigned int i=0; (i<numLeaves) && result; i++)
+    {
+        cCollisionSpheresTri* triangle = (cCollisionSpheresTri*)m_firstLeaf[i].m_prim;
+        cSphereLeafRecord record;
+        record.m_triangle = (unsigned int)(triangle->getOriginal() - &(*m_trigs)[0]);
+        record.m_reserved = 0;
+
+        result = (fwrite(&record, sizeof(record), 1, file) == 1);
+    }
+
+    if (fclose(file) != 0) { result = false; }
+    if (!result) { remove(a_fileName.c_str()); }
+    return (result);
+}
+
+
+//===========================================================================
+/*!
+    Load a tree saved by saveTree(). The file is only used if it was saved
+    for the same radius, and for a mesh with the same triangles and vertex
+    positions; its structure is checked before the current tree is
+    replaced. If the file can not be used, the current tree is kept and
+    initialize() must be called to build a new one.
+
+    \fn       bool cCollisionSpheres::loadTree(const string& a_fileName, double a_radius)
+    \param    a_fileName  Name of the file.
+    \param    a_radius  Radius around the triangles, as passed to initialize().
+    \return   Return \b true if the tree was loaded.
+*/
+//===========================================================================
+bool cCollisionSpheres::loadTree(const string& a_fileName, double a_radius)
+{
+    cMappedFile file;
+    if (!file.open(a_fileName.c_str())) { return (false); }
+    if (!checkTreeHeader(file.getData(), file.getSize(), SPHERE_TREE_MAGIC,
+                         m_trigs, a_radius,
+                         sizeof(cSphereNodeRecord), sizeof(cSphereLeafRecord)))
+    {
+        return (false);
+    }
+
+    const char* data = file.getData();
+    const cCollisionTreeHeader* header = (const cCollisionTreeHeader*)data;
+    const cSphereNodeRecord* nodes = (const cSphereNodeRecord*)(data + header->m_nodeOffset);
+    const cSphereLeafRecord* leaves = (const cSphereLeafRecord*)(data + header->m_leafOffset);
+    unsigned int numNodes = header->m_numNodes;
+    unsigned int numLeaves = header->m_numLeaves;
+    unsigned int numTriangles = (unsigned int)m_trigs->size();
+
+    // the tree has one leaf per triangle
+    if ((numLeaves != numTriangles) ||
+        (numNodes != ((numLeaves >= 2) ? numLeaves - 1 : 0)))
+    {
+        return (false);
+    }
+
+    vector<char> used(numTriangles, 0);
+    for (unsigned int i=0; i<numLeaves; i++)
+    {
+        unsigned int triangle = leaves[i].m_triangle;
+        if ((triangle >= numTriangles) || used[triangle]) { return (false); }
+        used[triangle] = 1;
+    }
+
+    // every node but the root, and every leaf, must have exactly one parent.
+    // Nodes are stored before their children, so the file can not describe
+    // a cycle.
+    vector<char> nodeUsed(numNodes, 0);
+    vector<char> leafUsed(numLeaves, 0);
+    for (unsigned int i=0; i<numNodes; i++)
+    {
+        unsigned int children[2] = { nodes[i].m_left, nodes[i].m_right };
+        for (unsigned int k=0; k<2; k++)
+        {
+            unsigned int index = children[k] & ~CHAI_COLLISION_TREE_LEAF;
+            if (children[k] & CHAI_COLLISION_TREE_LEAF)
+            {
+                if ((index >= numLeaves) || leafUsed[index]) { return (false); }
+                leafUsed[index] = 1;
+            }
+            else
+            {
+                if ((index <= i) || (index >= numNodes) || nodeUsed[index]) { return (false); }
+                nodeUsed[index] = 1;
+            }
+        }
+    }
+
+    // release the previous tree (with a single triangle, the root is the leaf)
+    if ((m_root != NULL) && ((void*)m_root != (void*)m_firstLeaf))
+    {
+        delete [] (cCollisionSpheresNode*)m_root;
+    }
+    if (m_firstLeaf)
+    {
+        delete [] m_firstLeaf;
+        m_firstLeaf = 0;
+    }
+    m_root = NULL;
+    m_lastCollision = NULL;
+    secret = NULL;
+    m_radius = a_radius;
+    if (numLeaves == 0) { return (true); }
+
+    m_firstLeaf = new cCollisionSpheresLeaf[numLeaves];
+
+    // a single triangle is enclosed by a leaf at the root, as in initialize()
+    if (numNodes == 0)
+    {
+        new(&m_firstLeaf[0]) cCollisionSpheresLeaf(&((*m_trigs)[leaves[0].m_triangle]));
+        m_root = m_firstLeaf;
+        return (true);
+    }
+
+    // create the internal nodes, from the root down, and the leaves below them
+    cCollisionSpheresNode* internalNodes = new cCollisionSpheresNode[numNodes];
+    for (unsigned int i=0; i<numNodes; i++)
+    {
+        const cSphereNodeRecord& record = nodes[i];
+        cCollisionSpheresNode* node = &internalNodes[i];
+        node->m_center.set(record.m_center[0], record.m_center[1], record.m_center[2]);
+        node->m_radius = record.m_radius;
+
+        unsigned int children[2] = { record.m_left, record.m_right };
+        cCollisionSpheresSphere* subTrees[2];
+        for (unsigned int k=0; k<2; k++)
+        {
+            unsigned int index = children[k] & ~CHAI_COLLISION_TREE_LEAF;
+            if (children[k] & CHAI_COLLISION_TREE_LEAF)
+            {
+                cTriangle* triangle = &(*m_trigs)[leaves[index].m_triangle];
+                subTrees[k] = new(&m_firstLeaf[index]) cCollisionSpheresLeaf(triangle, node, a_radius);
+            }
+            else
+            {
+                subTrees[k] = &internalNodes[index];
+                subTrees[k]->m_parent = node;
+                subTrees[k]->m_depth = node->m_depth + 1;
+            }
+        }
+        node->m_left = subTrees[0];
+        node->m_right = subTrees[1];
+    }
+    m_root = internalNodes;
+
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Build the sphere tree again if vertices or triangles of the mesh have
+    been modified. The previous tree is released first.
+
+    \fn       void cCollisionSpheres::update(const cDirtyRange& a_vertices,
+                                             const cDirtyRange& a_triangles)
+    \param    a_vertices  Modified vertices.
+    \param    a_triangles  Modified triangles.
+*/
+//===========================================================================
+void cCollisionSpheres::update(const cDirtyRange& a_vertices, const cDirtyRange& a_triangles)
+{
+    if (a_vertices.isEmpty() && a_triangles.isEmpty()) { return; }
+
+    // release the previous tree (with a single triangle, the root is the leaf)
+    if ((m_root != NULL) && ((void*)m_root != (void*)m_firstLeaf))
+    {
+        delete [] (cCollisionSpheresNode*)m_root;
+    }
+    if (m_firstLeaf)
+    {
+        delete [] m_firstLeaf;
+        m_firstLeaf = 0;
+    }
+    m_root = NULL;
+
+    initialize(m_radius);
+}
+
+
 //===========================================================================
 /*!
     Draw the collision spheres at the given level.
@@ -216,13 +486,14 @@ bool cCollisionSpheres::computeCollision(cVector3d& a_segmentPointA,
     // only neighbors of the triangle from the first collision detection
     // need to be checked
     if ((m_useNeighbors) && (m_root != NULL) &&
-        (m_lastCollision != NULL) && (m_lastCollision->m_neighbors != NULL))
+        (m_lastCollision != NULL) && (m_lastCollision->getNumNeighbors() > 0))
     {
         // check each neighbor, and find the closest for which there is a
         // collision, if any
-        for (unsigned int i=0; i<m_lastCollision->m_neighbors->size(); i++)
+        unsigned int numNeighbors = m_lastCollision->getNumNeighbors();
+        for (unsigned int i=0; i<numNeighbors; i++)
         {
-            ((*(m_lastCollision->m_neighbors))[i])->computeCollision(
+            m_lastCollision->getNeighbor(i)->computeCollision(
                     a_segmentPointA, a_segmentPointB, a_recorder, a_settings);
         }
 
@@ -90,6 +90,15 @@ class cCollisionSpheres : public cGenericCollision
     //! Build the sphere tree based on the given triangles.
     void initialize(double a_radius = 0);
 
+    //! Save the sphere tree to a file.
+    bool saveTree(const string& a_fileName);
+
+    //! Load a sphere tree saved for the same mesh and radius, instead of building it.
+    bool loadTree(const string& a_fileName, double a_radius = 0);
+
+    //! Build the sphere tree again after the mesh has been modified.
+    void update(const cDirtyRange& a_vertices, const cDirtyRange& a_triangles);
+
     //! Draw the collision spheres in OpenGL.
     void render();
 
@@ -121,6 +130,9 @@ class cCollisionSpheres : public cGenericCollision
 
     //! For internal and debug usage.
 	cTriangle* secret;
+
+    //! Radius around the triangles, as passed to initialize().
+    double m_radius;
 };
 
 
@@ -146,6 +158,9 @@ class cCollisionSpheresSphere
     //! Leaf nodes of the collision sphere tree.
     friend class cCollisionSpheresLeaf;
 
+    //! Sphere tree, which restores the nodes of a saved tree.
+    friend class cCollisionSpheres;
+
 
   public:
     
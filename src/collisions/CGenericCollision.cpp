@@ -20,8 +20,23 @@
 
 //---------------------------------------------------------------------------
 #include "collisions/CGenericCollision.h"
+#include "graphics/CTriangle.h"
+#include <string.h>
 //---------------------------------------------------------------------------
 
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+//---------------------------------------------------------------------------
+// Add a 32 bit word to an FNV-1a hash.
+//---------------------------------------------------------------------------
+static inline unsigned int hash_word(unsigned int a_hash, unsigned int a_word)
+{
+    return ((a_hash ^ a_word) * 16777619u);
+}
+
+#endif  // DOXYGEN_SHOULD_SKIP_THIS
+
+
 //===========================================================================
 /*!
     Constructor of cGenericCollision.
@@ -41,3 +56,160 @@ cGenericCollision::cGenericCollision()
     m_displayDepth = 3;
 }
 
+
+//===========================================================================
+/*!
+    Compute a hash of the triangles of a mesh (allocation state and vertex
+    indices) and of the positions of the vertices of the mesh. A collision
+    tree saved to a file is only loaded if this hash has not changed.
+
+    \fn       unsigned int cGenericCollision::computeMeshHash(vector<cTriangle>* a_triangles)
+    \param    a_triangles  Triangles of the mesh.
+    \return   Return the hash.
+*/
+//===========================================================================
+unsigned int cGenericCollision::computeMeshHash(vector<cTriangle>* a_triangles)
+{
+    unsigned int hash = 2166136261u;
+    unsigned int numTriangles = (unsigned int)a_triangles->size();
+    hash = hash_word(hash, numTriangles);
+    if (numTriangles == 0) { return (hash); }
+
+    const cTriangle* triangles = &(*a_triangles)[0];
+    for (unsigned int i=0; i<numTriangles; i++)
+    {
+        hash = hash_word(hash, triangles[i].m_allocated ? 1 : 0);
+        hash = hash_word(hash, triangles[i].m_indexVertex0);
+        hash = hash_word(hash, triangles[i].m_indexVertex1);
+        hash = hash_word(hash, triangles[i].m_indexVertex2);
+    }
+
+    // all triangles of the array belong to the same mesh
+    cMesh* mesh = triangles[0].m_parent;
+    if (mesh == NULL) { return (hash); }
+    vector<cVertex>* vertices = mesh->pVertices();
+    unsigned int numVertices = (unsigned int)vertices->size();
+    hash = hash_word(hash, numVertices);
+    for (unsigned int i=0; i<numVertices; i++)
+    {
+        const cVector3d& pos = (*vertices)[i].m_localPos;
+        unsigned int words[6];
+        memcpy(words, &pos.x, sizeof(double));
+        memcpy(words + 2, &pos.y, sizeof(double));
+        memcpy(words + 4, &pos.z, sizeof(double));
+        for (unsigned int j=0; j<6; j++)
+        {
+            hash = hash_word(hash, words[j]);
+        }
+    }
+
+    return (hash);
+}
+
+
+//===========================================================================
+/*!
+    Fill the header of a collision tree file. The array of nodes follows
+    the header, and the array of leaves follows the nodes.
+
+    \fn       bool cGenericCollision::initTreeHeader(cCollisionTreeHeader& a_header,
+              const char* a_magic, vector<cTriangle>* a_triangles, double a_radius,
+              unsigned int a_numNodes, unsigned int a_nodeSize,
+              unsigned int a_numLeaves, unsigned int a_leafSize)
+    \param    a_header  Header to fill.
+    \param    a_magic  File identifier (8 characters).
+    \param    a_triangles  Triangles of the mesh.
+    \param    a_radius  Radius passed to initialize().
+    \param    a_numNodes  Number of internal nodes.
+    \param    a_nodeSize  Size of a node record.
+    \param    a_numLeaves  Number of leaves.
+    \param    a_leafSize  Size of a leaf record.
+    \return   Return \b false if the file would be too large.
+*/
+//===========================================================================
+bool cGenericCollision::initTreeHeader(cCollisionTreeHeader& a_header,
+                                       const char* a_magic,
+                                       vector<cTriangle>* a_triangles,
+                                       double a_radius,
+                                       unsigned int a_numNodes,
+                                       unsigned int a_nodeSize,
+                                       unsigned int a_numLeaves,
+                                       unsigned int a_leafSize)
+{
+    memset(&a_header, 0, sizeof(cCollisionTreeHeader));
+    memcpy(a_header.m_magic, a_magic, sizeof(a_header.m_magic));
+    a_header.m_version = CHAI_COLLISION_TREE_VERSION;
+    a_header.m_byteOrder = CHAI_COLLISION_TREE_BYTE_ORDER;
+    a_header.m_numTriangles = (unsigned int)a_triangles->size();
+    a_header.m_meshHash = computeMeshHash(a_triangles);
+    a_header.m_numNodes = a_numNodes;
+    a_header.m_numLeaves = a_numLeaves;
+    a_header.m_radius = a_radius;
+
+    double fileSize = (double)sizeof(cCollisionTreeHeader) +
+                      (double)a_numNodes * a_nodeSize +
+                      (double)a_numLeaves * a_leafSize;
+    if (fileSize > 4294967295.0) { return (false); }
+
+    a_header.m_nodeOffset = sizeof(cCollisionTreeHeader);
+    a_header.m_leafOffset = a_header.m_nodeOffset + a_numNodes * a_nodeSize;
+    a_header.m_fileSize = a_header.m_leafOffset + a_numLeaves * a_leafSize;
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Check that the content of a collision tree file was created for the
+    current triangles and vertices of a mesh with the same radius, and that
+    its arrays of nodes and leaves lie within the file.
+
+    \fn       bool cGenericCollision::checkTreeHeader(const char* a_data,
+              size_t a_size, const char* a_magic, vector<cTriangle>* a_triangles,
+              double a_radius, unsigned int a_nodeSize, unsigned int a_leafSize)
+    \param    a_data  Content of the file.
+    \param    a_size  Size of the file.
+    \param    a_magic  Expected file identifier (8 characters).
+    \param    a_triangles  Triangles of the mesh.
+    \param    a_radius  Radius passed to initialize().
+    \param    a_nodeSize  Size of a node record.
+    \param    a_leafSize  Size of a leaf record.
+    \return   Return \b true if the file can be loaded.
+*/
+//===========================================================================
+bool cGenericCollision::checkTreeHeader(const char* a_data, size_t a_size,
+                                        const char* a_magic,
+                                        vector<cTriangle>* a_triangles,
+                                        double a_radius,
+                                        unsigned int a_nodeSize,
+                                        unsigned int a_leafSize)
+{
+    if ((a_data == NULL) || (a_size < sizeof(cCollisionTreeHeader))) { return (false); }
+    const cCollisionTreeHeader* header = (const cCollisionTreeHeader*)a_data;
+
+    if ((memcmp(header->m_magic, a_magic, sizeof(header->m_magic)) != 0) ||
+        (header->m_version != CHAI_COLLISION_TREE_VERSION) ||
+        (header->m_byteOrder != CHAI_COLLISION_TREE_BYTE_ORDER) ||
+        (header->m_fileSize != a_size) ||
+        (header->m_radius != a_radius) ||
+        (header->m_numTriangles != a_triangles->size()))
+    {
+        return (false);
+    }
+
+    // the arrays must be aligned and lie within the file
+    double nodeEnd = (double)header->m_nodeOffset + (double)header->m_numNodes * a_nodeSize;
+    double leafEnd = (double)header->m_leafOffset + (double)header->m_numLeaves * a_leafSize;
+    if ((header->m_nodeOffset < sizeof(cCollisionTreeHeader)) ||
+        (header->m_leafOffset < sizeof(cCollisionTreeHeader)) ||
+        ((header->m_nodeOffset % 8) != 0) ||
+        ((header->m_leafOffset % 8) != 0) ||
+        (nodeEnd > (double)a_size) ||
+        (leafEnd > (double)a_size))
+    {
+        return (false);
+    }
+
+    // the mesh must not have changed since the tree was saved
+    return (header->m_meshHash == computeMeshHash(a_triangles));
+}
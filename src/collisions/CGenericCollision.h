@@ -23,8 +23,61 @@
 #define CGenericCollisionH
 //---------------------------------------------------------------------------
 #include "../collisions/CCollisionBasics.h"
+#include "../graphics/CDirtyRange.h"
+#include <string>
 //---------------------------------------------------------------------------
 using std::vector;
+using std::string;
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+
+//===========================================================================
+// INTERNAL DEFINITIONS FOR COLLISION TREE FILES:
+//===========================================================================
+
+/*
+    A collision tree file holds the header below, followed by the array of
+    internal nodes and the array of leaves of the tree. Nodes refer to their
+    children, and leaves to their triangles, by index, so that a tree can
+    be loaded at any address. Data is stored in the byte order of the
+    machine that wrote the file.
+*/
+
+// File version and byte order
+#define CHAI_COLLISION_TREE_VERSION     1
+#define CHAI_COLLISION_TREE_BYTE_ORDER  0x01020304
+
+// Flag set in the index of a child node which is a leaf
+#define CHAI_COLLISION_TREE_LEAF        0x80000000
+
+// File header (64 bytes)
+struct cCollisionTreeHeader
+{
+    char m_magic[8];
+    unsigned int m_version;
+    unsigned int m_byteOrder;
+
+    // size and content hash of the triangle array of the mesh
+    unsigned int m_numTriangles;
+    unsigned int m_meshHash;
+
+    unsigned int m_numNodes;
+    unsigned int m_numLeaves;
+
+    // radius passed to initialize()
+    double m_radius;
+
+    unsigned int m_nodeOffset;
+    unsigned int m_leafOffset;
+    unsigned int m_fileSize;
+    unsigned int m_reserved[3];
+};
+
+//---------------------------------------------------------------------------
+#endif  // DOXYGEN_SHOULD_SKIP_THIS
 //---------------------------------------------------------------------------
 
 //===========================================================================
@@ -69,9 +122,18 @@ class cGenericCollision
     //! Do any necessary initialization, such as building trees.
     virtual void initialize(double a_radius = 0) {};
 
+    //! Update after vertices or triangles of the mesh have been modified.
+    virtual void update(const cDirtyRange& a_vertices, const cDirtyRange& a_triangles) {};
+
     //! Provide a visual representation of the method.
     virtual void render() {};
 
+    //! Save the collision tree to a file. Returns \b false if the method has no tree.
+    virtual bool saveTree(const string& a_fileName) { return (false); }
+
+    //! Load a collision tree saved by saveTree(), instead of calling initialize().
+    virtual bool loadTree(const string& a_fileName, double a_radius = 0) { return (false); }
+
     //! Return the triangles intersected by the given segment, if any.
     virtual bool computeCollision(cVector3d& a_segmentPointA,
                                   cVector3d& a_segmentPointB,
@@ -96,6 +158,25 @@ class cGenericCollision
 
   protected:
 
+	//-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Compute a hash of the triangles and vertex positions of a mesh.
+    static unsigned int computeMeshHash(vector<cTriangle>* a_triangles);
+
+    //! Fill the header of a collision tree file. Returns \b false if the tree is too large.
+    static bool initTreeHeader(cCollisionTreeHeader& a_header, const char* a_magic,
+                               vector<cTriangle>* a_triangles, double a_radius,
+                               unsigned int a_numNodes, unsigned int a_nodeSize,
+                               unsigned int a_numLeaves, unsigned int a_leafSize);
+
+    //! Check that a collision tree file matches a mesh and a radius.
+    static bool checkTreeHeader(const char* a_data, size_t a_size, const char* a_magic,
+                                vector<cTriangle>* a_triangles, double a_radius,
+                                unsigned int a_nodeSize, unsigned int a_leafSize);
+
+
 	//-----------------------------------------------------------------------
     // MEMBERS:
     //-----------------------------------------------------------------------
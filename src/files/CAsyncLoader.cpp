@@ -0,0 +1,462 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "files/CAsyncLoader.h"
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+
+//===========================================================================
+// Collect the meshes of a subtree, and the distinct textures they use.
+//===========================================================================
+static void collectMeshes(cGenericObject* a_object,
+                          std::vector<cMesh*>& a_meshes,
+                          std::vector<cTexture2D*>& a_textures)
+{
+    cMesh* mesh = dynamic_cast<cMesh*>(a_object);
+    if (mesh != NULL)
+    {
+        a_meshes.push_back(mesh);
+    }
+
+    cTexture2D* texture = a_object->m_texture;
+    if (texture != NULL)
+    {
+        bool found = false;
+        for (unsigned int i=0; i<a_textures.size(); i++)
+        {
+            if (a_textures[i] == texture) { found = true; break; }
+        }
+        if (!found) { a_textures.push_back(texture); }
+    }
+
+    for (unsigned int i=0; i<a_object->getNumChildren(); i++)
+    {
+        collectMeshes(a_object->getChild(i), a_meshes, a_textures);
+    }
+}
+
+//---------------------------------------------------------------------------
+#endif  // DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+
+
+//===========================================================================
+/*!
+    Constructor of cAsyncLoadRequest.
+
+    \fn       cAsyncLoadRequest::cAsyncLoadRequest()
+*/
+//===========================================================================
+cAsyncLoadRequest::cAsyncLoadRequest()
+{
+    m_loader = NULL;
+    m_isMesh = true;
+    m_parent = NULL;
+    m_collisionType = CHAI_ASYNC_COLLISION_NONE;
+    m_collisionRadius = 0;
+    m_callback = NULL;
+    m_callbackData = NULL;
+    m_mesh = NULL;
+    m_texture = NULL;
+    m_loaded = false;
+    m_done = false;
+}
+
+
+//===========================================================================
+/*!
+    Constructor of cAsyncLoader.
+
+    \fn       cAsyncLoader::cAsyncLoader(cWorld* a_world)
+    \param    a_world  World to which the loaded objects are added.
+*/
+//===========================================================================
+cAsyncLoader::cAsyncLoader(cWorld* a_world)
+{
+    m_world = a_world;
+    m_numPending = 0;
+
+#if defined(_WIN32)
+    InitializeCriticalSection(&m_mutex);
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_mutex_init(&m_mutex, NULL);
+#endif
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cAsyncLoader. The loads in progress are completed, then
+    every object which has not been added to the world is deleted, along
+    with all the requests.
+
+    \fn       cAsyncLoader::~cAsyncLoader()
+*/
+//===========================================================================
+cAsyncLoader::~cAsyncLoader()
+{
+    m_worker.waitAll();
+
+    for (unsigned int i=0; i<m_requests.size(); i++)
+    {
+        cAsyncLoadRequest* request = m_requests[i];
+        if (!request->m_done)
+        {
+            if (request->m_mesh != NULL)
+            {
+                // textures loaded with the mesh are not owned by any world yet
+                std::vector<cMesh*> meshes;
+                std::vector<cTexture2D*> textures;
+                collectMeshes(request->m_mesh, meshes, textures);
+                for (unsigned int j=0; j<textures.size(); j++)
+                {
+                    delete textures[j];
+                }
+                delete request->m_mesh;
+            }
+            if (request->m_texture != NULL)
+            {
+                delete request->m_texture;
+            }
+        }
+        delete request;
+    }
+
+#if defined(_WIN32)
+    DeleteCriticalSection(&m_mutex);
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+
+//===========================================================================
+/*!
+    Load a mesh file on the background thread. The file is read with
+    cMesh::loadFromFile(), so every supported format and loader option
+    applies, and the requested collision detector is built on the
+    background thread too. Once update() has published the request, the
+    mesh is a child of \e a_parent, or of the world if \e a_parent is
+    \b NULL.
+
+    \fn       cAsyncLoadRequest* cAsyncLoader::loadMesh(const string& a_fileName,
+              cGenericObject* a_parent,
+              const chai_async_collision_types a_collisionType,
+              const double a_collisionRadius,
+              cAsyncLoadCallback a_callback, void* a_callbackData)
+    \param    a_fileName  Name of the mesh file.
+    \param    a_parent  Object to which the mesh is added, or \b NULL.
+    \param    a_collisionType  Collision detector built for the mesh.
+    \param    a_collisionRadius  Radius of the collision detector.
+    \param    a_callback  Function called once the request is done, or \b NULL.
+    \param    a_callbackData  User pointer passed to the callback.
+    \return   Return the request, owned by the loader.
+*/
+//===========================================================================
+cAsyncLoadRequest* cAsyncLoader::loadMesh(const string& a_fileName,
+                                          cGenericObject* a_parent,
+                                          const chai_async_collision_types a_collisionType,
+                                          const double a_collisionRadius,
+                                          cAsyncLoadCallback a_callback,
+                                          void* a_callbackData)
+{
+    cAsyncLoadRequest* request = new cAsyncLoadRequest();
+    request->m_fileName = a_fileName;
+    request->m_isMesh = true;
+    request->m_parent = a_parent;
+    request->m_collisionType = a_collisionType;
+    request->m_collisionRadius = a_collisionRadius;
+    request->m_callback = a_callback;
+    request->m_callbackData = a_callbackData;
+
+    post(request);
+    return (request);
+}
+
+
+//===========================================================================
+/*!
+    Load an image file as a texture on the background thread. Once
+    update() has published the request, the texture belongs to the world.
+
+    \fn       cAsyncLoadRequest* cAsyncLoader::loadTexture(const string& a_fileName,
+              cAsyncLoadCallback a_callback, void* a_callbackData)
+    \param    a_fileName  Name of the image file.
+    \param    a_callback  Function called once the request is done, or \b NULL.
+    \param    a_callbackData  User pointer passed to the callback.
+    \return   Return the request, owned by the loader.
+*/
+//===========================================================================
+cAsyncLoadRequest* cAsyncLoader::loadTexture(const string& a_fileName,
+                                             cAsyncLoadCallback a_callback,
+                                             void* a_callbackData)
+{
+    cAsyncLoadRequest* request = new cAsyncLoadRequest();
+    request->m_fileName = a_fileName;
+    request->m_isMesh = false;
+    request->m_callback = a_callback;
+    request->m_callbackData = a_callbackData;
+
+    post(request);
+    return (request);
+}
+
+
+//===========================================================================
+/*!
+    Queue a request on the background thread.
+
+    \fn       void cAsyncLoader::post(cAsyncLoadRequest* a_request)
+    \param    a_request  Request to execute.
+*/
+//===========================================================================
+void cAsyncLoader::post(cAsyncLoadRequest* a_request)
+{
+    a_request->m_loader = this;
+    m_requests.push_back(a_request);
+    m_numPending++;
+
+    m_worker.post(loadTask, a_request);
+}
+
+
+//===========================================================================
+/*!
+    Execute a request on the background thread. The objects are created
+    without a world, so that nothing shared with the main thread is
+    modified until the request is published.
+
+    \fn       void cAsyncLoader::loadTask(void* a_data)
+    \param    a_data  Request to execute.
+*/
+//===========================================================================
+void cAsyncLoader::loadTask(void* a_data)
+{
+    cAsyncLoadRequest* request = (cAsyncLoadRequest*)a_data;
+
+    if (request->m_isMesh)
+    {
+        cMesh* mesh = new cMesh(NULL);
+        if (mesh->loadFromFile(request->m_fileName))
+        {
+            switch (request->m_collisionType)
+            {
+                case CHAI_ASYNC_COLLISION_BRUTE_FORCE:
+                    mesh->createBruteForceCollisionDetector(true, false);
+                    break;
+
+                case CHAI_ASYNC_COLLISION_AABB:
+                    mesh->createAABBCollisionDetector(request->m_collisionRadius, true, false);
+                    break;
+
+                case CHAI_ASYNC_COLLISION_SPHERE_TREE:
+                    mesh->createSphereTreeCollisionDetector(request->m_collisionRadius, true, false);
+                    break;
+
+                default:
+                    break;
+            }
+            request->m_mesh = mesh;
+            request->m_loaded = true;
+        }
+        else
+        {
+            delete mesh;
+        }
+    }
+    else
+    {
+        cTexture2D* texture = new cTexture2D();
+        if (texture->loadFromFile(request->m_fileName.c_str()))
+        {
+            request->m_texture = texture;
+            request->m_loaded = true;
+        }
+        else
+        {
+            delete texture;
+        }
+    }
+
+    request->m_loader->complete(request);
+}
+
+
+//===========================================================================
+/*!
+    Hand a request over to the main thread, which publishes it on its
+    next call to update().
+
+    \fn       void cAsyncLoader::complete(cAsyncLoadRequest* a_request)
+    \param    a_request  Request loaded by the background thread.
+*/
+//===========================================================================
+void cAsyncLoader::complete(cAsyncLoadRequest* a_request)
+{
+#if defined(_WIN32)
+    EnterCriticalSection(&m_mutex);
+    m_completed.push_back(a_request);
+    LeaveCriticalSection(&m_mutex);
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_mutex_lock(&m_mutex);
+    m_completed.push_back(a_request);
+    pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+
+//===========================================================================
+/*!
+    Publish the requests completed by the background thread since the
+    last call: loaded meshes are added to the scene graph and loaded
+    textures to the world, then the callback of each request is called,
+    whether the file was loaded or not. This method must be called from
+    the thread which renders and updates the world.
+
+    \fn       unsigned int cAsyncLoader::update()
+    \return   Return the number of requests published.
+*/
+//===========================================================================
+unsigned int cAsyncLoader::update()
+{
+    // take the completed requests, without holding the lock while publishing
+    std::list<cAsyncLoadRequest*> completed;
+
+#if defined(_WIN32)
+    EnterCriticalSection(&m_mutex);
+    completed.swap(m_completed);
+    LeaveCriticalSection(&m_mutex);
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_mutex_lock(&m_mutex);
+    completed.swap(m_completed);
+    pthread_mutex_unlock(&m_mutex);
+#endif
+
+    unsigned int count = 0;
+    std::list<cAsyncLoadRequest*>::iterator it;
+    for (it = completed.begin(); it != completed.end(); ++it)
+    {
+        cAsyncLoadRequest* request = *it;
+
+        if (request->m_mesh != NULL)
+        {
+            publishMesh(request);
+        }
+        else if ((request->m_texture != NULL) && (m_world != NULL))
+        {
+            m_world->addTexture(request->m_texture);
+        }
+
+        request->m_done = true;
+        m_numPending--;
+        count++;
+
+        if (request->m_callback != NULL)
+        {
+            request->m_callback(request, request->m_callbackData);
+        }
+    }
+
+    return (count);
+}
+
+
+//===========================================================================
+/*!
+    Add a loaded mesh to the scene graph. The meshes of the subtree are
+    attached to the world and their textures handed over to it, then the
+    whole subtree is added to its parent at once, with its global
+    positions up to date.
+
+    \fn       void cAsyncLoader::publishMesh(cAsyncLoadRequest* a_request)
+    \param    a_request  Request which holds the loaded mesh.
+*/
+//===========================================================================
+void cAsyncLoader::publishMesh(cAsyncLoadRequest* a_request)
+{
+    cMesh* mesh = a_request->m_mesh;
+
+    std::vector<cMesh*> meshes;
+    std::vector<cTexture2D*> textures;
+    collectMeshes(mesh, meshes, textures);
+
+    for (unsigned int i=0; i<meshes.size(); i++)
+    {
+        meshes[i]->setParentWorld(m_world);
+    }
+
+    if (m_world != NULL)
+    {
+        for (unsigned int i=0; i<textures.size(); i++)
+        {
+            m_world->addTexture(textures[i]);
+        }
+    }
+
+    cGenericObject* parent = a_request->m_parent;
+    if (parent == NULL) { parent = m_world; }
+    if (parent != NULL)
+    {
+        parent->addChild(mesh);
+        mesh->computeGlobalPositions(true, parent->getGlobalPos(), parent->getGlobalRot());
+    }
+}
+
+
+//===========================================================================
+/*!
+    Return the number of requests which have not been published yet by
+    update().
+
+    \fn       unsigned int cAsyncLoader::getNumPendingRequests() const
+    \return   Return the number of pending requests.
+*/
+//===========================================================================
+unsigned int cAsyncLoader::getNumPendingRequests() const
+{
+    return (m_numPending);
+}
+
+
+//===========================================================================
+/*!
+    Block until the background thread has executed every request, then
+    publish them all.
+
+    \fn       void cAsyncLoader::waitAll()
+*/
+//===========================================================================
+void cAsyncLoader::waitAll()
+{
+    m_worker.waitAll();
+    update();
+}
@@ -0,0 +1,280 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CAsyncLoaderH
+#define CAsyncLoaderH
+//---------------------------------------------------------------------------
+#include "../graphics/CTexture2D.h"
+#include "../scenegraph/CMesh.h"
+#include "../scenegraph/CWorld.h"
+#include "../timers/CWorkerThread.h"
+#include <list>
+#include <string>
+#include <vector>
+//---------------------------------------------------------------------------
+using std::string;
+//---------------------------------------------------------------------------
+class cAsyncLoader;
+class cAsyncLoadRequest;
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CAsyncLoader.h
+
+    \brief
+    <b> Files </b> \n
+    Background loading of meshes and textures.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+//! Collision detectors which cAsyncLoader can create for a loaded mesh.
+typedef enum {
+  CHAI_ASYNC_COLLISION_NONE = 0,
+  CHAI_ASYNC_COLLISION_BRUTE_FORCE,
+  CHAI_ASYNC_COLLISION_AABB,
+  CHAI_ASYNC_COLLISION_SPHERE_TREE
+} chai_async_collision_types;
+
+//---------------------------------------------------------------------------
+/*!
+    Function called by cAsyncLoader::update() on the main thread once a
+    request has completed; \e a_data is the user pointer passed with the
+    request.
+*/
+//---------------------------------------------------------------------------
+typedef void (*cAsyncLoadCallback)(cAsyncLoadRequest* a_request, void* a_data);
+
+
+//===========================================================================
+/*!
+    \class      cAsyncLoadRequest
+    \ingroup    files
+
+    \brief
+    cAsyncLoadRequest follows a mesh or texture loaded by a cAsyncLoader.
+    It is marked as done by cAsyncLoader::update(), once its result has
+    been added to the world. Requests belong to their loader and remain
+    valid until the loader is deleted.
+*/
+//===========================================================================
+class cAsyncLoadRequest
+{
+    //-----------------------------------------------------------------------
+    // FRIENDS:
+    //-----------------------------------------------------------------------
+
+    //! The loader sets up and completes its requests.
+    friend class cAsyncLoader;
+
+
+  public:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Return \b true once the request has been completed by cAsyncLoader::update().
+    bool isDone() const { return (m_done); }
+
+    //! Return \b true if the file was loaded. Only meaningful once isDone() returns \b true.
+    bool isLoaded() const { return (m_loaded); }
+
+    //! Return the loaded mesh, or \b NULL (texture request, or failure).
+    cMesh* getMesh() const { return (m_mesh); }
+
+    //! Return the loaded texture, or \b NULL (mesh request, or failure).
+    cTexture2D* getTexture() const { return (m_texture); }
+
+    //! Return the name of the file.
+    const string& getFileName() const { return (m_fileName); }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cAsyncLoadRequest.
+    cAsyncLoadRequest();
+
+    //! Destructor of cAsyncLoadRequest.
+    ~cAsyncLoadRequest() {}
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Loader which executes the request.
+    cAsyncLoader* m_loader;
+
+    //! Name of the file.
+    string m_fileName;
+
+    //! If \b true, the file is a mesh, otherwise it is a texture.
+    bool m_isMesh;
+
+    //! Object to which a loaded mesh is added.
+    cGenericObject* m_parent;
+
+    //! Collision detector created for a loaded mesh.
+    chai_async_collision_types m_collisionType;
+
+    //! Radius of the collision detector.
+    double m_collisionRadius;
+
+    //! Function called once the request is done.
+    cAsyncLoadCallback m_callback;
+
+    //! User pointer passed to the callback.
+    void* m_callbackData;
+
+    //! Loaded mesh.
+    cMesh* m_mesh;
+
+    //! Loaded texture.
+    cTexture2D* m_texture;
+
+    //! If \b true, the file was loaded.
+    bool m_loaded;
+
+    //! If \b true, the request has been completed by cAsyncLoader::update().
+    bool m_done;
+};
+
+
+//===========================================================================
+/*!
+    \class      cAsyncLoader
+    \ingroup    files
+
+    \brief
+    cAsyncLoader loads meshes and textures on a background thread, so that
+    the graphics loop keeps running while a new model is read during a
+    session.
+
+    The background thread parses the geometry, decodes the texture images
+    and builds the collision detector of each mesh, without touching the
+    world. Finished requests are then published by update(), which must be
+    called regularly from the thread which owns the world (for instance
+    from the GLUT idle or display callback): each loaded mesh is added to
+    the world in a single step, and the callback of the request is called.
+    OpenGL textures and buffers are created later, by the graphic
+    rendering thread, the first time the new objects are rendered.
+*/
+//===========================================================================
+class cAsyncLoader
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cAsyncLoader.
+    cAsyncLoader(cWorld* a_world);
+
+    //! Destructor of cAsyncLoader. Pending loads are completed and discarded.
+    ~cAsyncLoader();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Load a mesh in the background, and add it to \e a_parent (or the world) once loaded.
+    cAsyncLoadRequest* loadMesh(const string& a_fileName,
+                                cGenericObject* a_parent = NULL,
+                                const chai_async_collision_types a_collisionType = CHAI_ASYNC_COLLISION_NONE,
+                                const double a_collisionRadius = 0,
+                                cAsyncLoadCallback a_callback = NULL,
+                                void* a_callbackData = NULL);
+
+    //! Load a texture in the background, and add it to the world once loaded.
+    cAsyncLoadRequest* loadTexture(const string& a_fileName,
+                                   cAsyncLoadCallback a_callback = NULL,
+                                   void* a_callbackData = NULL);
+
+    //! Publish the requests completed since the last call. Returns the number of requests published.
+    unsigned int update();
+
+    //! Number of requests which have not been published yet.
+    unsigned int getNumPendingRequests() const;
+
+    //! Wait until every request has been loaded, then publish them.
+    void waitAll();
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Queue a request on the background thread.
+    void post(cAsyncLoadRequest* a_request);
+
+    //! Execute a request on the background thread.
+    static void loadTask(void* a_data);
+
+    //! Hand a loaded request over to the main thread.
+    void complete(cAsyncLoadRequest* a_request);
+
+    //! Add a loaded mesh to the world.
+    void publishMesh(cAsyncLoadRequest* a_request);
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! World to which the loaded objects are added.
+    cWorld* m_world;
+
+    //! All requests, in the order in which they were posted.
+    std::vector<cAsyncLoadRequest*> m_requests;
+
+    //! Requests loaded by the background thread and not yet published.
+    std::list<cAsyncLoadRequest*> m_completed;
+
+    //! Number of requests not yet published.
+    unsigned int m_numPending;
+
+    //! Background thread.
+    cWorkerThread m_worker;
+
+#if defined(_WIN32)
+    //! Protects the list of completed requests.
+    CRITICAL_SECTION m_mutex;
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    //! Protects the list of completed requests.
+    pthread_mutex_t m_mutex;
+#endif
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -21,10 +21,10 @@
 
 //---------------------------------------------------------------------------
 #include "files/CFileLoader3DS.h"
+#include "files/CMappedFile.h"
 //---------------------------------------------------------------------------
 #include <algorithm>
 #include <cstring>
-#include <map>
 //---------------------------------------------------------------------------
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 //---------------------------------------------------------------------------
@@ -41,7 +41,6 @@
 */
 
 //---------------------------------------------------------------------------
-typedef std::map<unsigned int, unsigned int> uint_uint_map;
 bool g_3dsLoaderShouldGenerateExtraVertices = false;
 //---------------------------------------------------------------------------
 #endif   // DOXYGEN_SHOULD_SKIP_THIS
@@ -60,8 +59,6 @@ bool g_3dsLoaderShouldGenerateExtraVertices = false;
 //===========================================================================
 bool cLoadFile3DS(cMesh* a_mesh, const string& a_fileName)
 {
-    int k;
-
     // Instantiate a loader
     L3DS loader;
 
@@ -94,9 +91,6 @@ bool cLoadFile3DS(cMesh* a_mesh, const string& a_fileName)
         // Assign a name to this mesh
         strncpy(sub_mesh->m_objectName,(const char*)(cur_mesh.GetName().c_str()),CHAI_SIZE_NAME);
 
-        // Create a vertex map for each submesh
-        sub_mesh->m_userData = new uint_uint_map;
-
         a_mesh->addChild(sub_mesh);
 
         // For each mesh in the file, we're going to create an additional mesh for
@@ -127,7 +121,6 @@ bool cLoadFile3DS(cMesh* a_mesh, const string& a_fileName)
                 snprintf(newMesh->m_objectName,CHAI_SIZE_NAME,"%s",
                 (const char*)(cur_mesh.GetName().c_str()));
 
-                newMesh->m_userData = new uint_uint_map;
                 sub_mesh->addChild(newMesh);
 
                 // Set up material properties for each mesh
@@ -143,7 +136,8 @@ bool cLoadFile3DS(cMesh* a_mesh, const string& a_fileName)
 
                 if (strlen(curmap.mapName) > 0) 
                 {
-                    cTexture2D *newTexture = world->newTexture();
+                    // without a world (see cAsyncLoader), textures are added to a world later
+                    cTexture2D *newTexture = (world != NULL) ? world->newTexture() : new cTexture2D();
                     int result = newTexture->loadFromFile(curmap.mapName);
 
                     // If this didn't work out, try again in the 3ds file's path
@@ -171,6 +165,7 @@ bool cLoadFile3DS(cMesh* a_mesh, const string& a_fileName)
                         #if defined(_WIN32)
 		                //	CHAI_DEBUG_PRINT("Could not load texture map %s\n",curmap.mapName);
                         #endif
+                        if (world == NULL) { delete newTexture; }
                     }
                 }
 
@@ -214,142 +209,129 @@ bool cLoadFile3DS(cMesh* a_mesh, const string& a_fileName)
 
         } // If this submesh has materials
 
-        // Local copy of the material list, for quick lookup
-        vector<uint> materials = cur_mesh.m_materials;
+        // Table from global to local material ids, for quick lookup
+        vector<int> local_ids;
+        for(unsigned int k=0; k<cur_mesh.m_materials.size(); k++) 
+        {
+            uint global_mat_id = cur_mesh.m_materials[k];
+            if (global_mat_id >= local_ids.size()) local_ids.resize(global_mat_id+1, -1);
+            if (local_ids[global_mat_id] == -1) local_ids[global_mat_id] = k;
+        }
 
-        // Now loop over all the triangles in this mesh and put them in the right
-        // place in our CHAI meshes...
+        // Now sort the triangles of this mesh by the CHAI mesh they go into:
+        // slot 0 is the material-independent submesh, slot k+1 the mesh of
+        // local material k
         unsigned int num_triangles = cur_mesh.GetTriangleCount();
+        unsigned int num_slots = num_materials + 1;
 
+        vector<unsigned int> tri_slots(num_triangles, 0);
+        vector<unsigned int> slot_offsets(num_slots + 1, 0);
         for(unsigned int cur_tri_index=0; cur_tri_index<num_triangles; cur_tri_index++) 
         {
-            // Get all the information about this triangle
-            // LTriangle2& cur_tri = cur_mesh.GetTriangle2(cur_tri_index);
-
-            // Get the vertex indices for this triangle...
-            const LTriangle& cur_indexed_tri = cur_mesh.GetTriangle(cur_tri_index);
-
-            // Which CHAI mesh are we going to insert this triangle into?
-            cMesh* cur_chai_mesh;
-
             // Default to the material-independent submesh
-            cur_chai_mesh = sub_mesh;
+            unsigned int slot = 0;
 
             // Look for a material-specific submesh for this triangle if there is one...
             if (num_materials > 0) 
             {
-                int curMaterialId = cur_mesh.m_tris[cur_tri_index].materialId;
-
-                // This material id is in terms of the global material id, but we need the
-                // local material id to find the right CHAI mesh...
-                int global_mat_id = curMaterialId;
-
-                int local_mat_id = -1;
-
-                // So we look it up in the list
-                for(unsigned int k=0; k<materials.size(); k++) 
-                {
-                    if ((int)(materials[k]) == global_mat_id) 
-                    {
-                        local_mat_id = k;
-                        break;
-                    }
-                }
+                uint global_mat_id = cur_mesh.m_tris[cur_tri_index].materialId;
+                if ((global_mat_id < local_ids.size()) && (local_ids[global_mat_id] >= 0))
+                    slot = local_ids[global_mat_id] + 1;
+            }
+            tri_slots[cur_tri_index] = slot;
+            slot_offsets[slot + 1]++;
+        }
+        for(unsigned int slot=0; slot<num_slots; slot++) 
+            slot_offsets[slot + 1] += slot_offsets[slot];
 
-                if (local_mat_id == -1) {
+        vector<unsigned int> sorted_tris(num_triangles);
+        vector<unsigned int> slot_fill(slot_offsets.begin(), slot_offsets.end() - 1);
+        for(unsigned int cur_tri_index=0; cur_tri_index<num_triangles; cur_tri_index++) 
+            sorted_tris[slot_fill[tri_slots[cur_tri_index]]++] = cur_tri_index;
 
-                // Error finding the right mesh to put this triangle in
-                // continue;
+        // Then build each CHAI mesh in one step: its vertices are the 3ds
+        // vertices used by its triangles, in order of first use, found through
+        // a table indexed by 3ds vertex (a new vertex per corner if extra
+        // vertices are requested)
+        vector<int> vertex_map(cur_mesh.GetVertexCount(), -1);
+        vector<uint> used_vertices;
+        vector<unsigned int> indices;
 
-                // If there's no material, put it in the material-independent sub-mesh
-                cur_chai_mesh = sub_mesh;
-                }
+        for(unsigned int slot=0; slot<num_slots; slot++) 
+        {
+            unsigned int first_tri = slot_offsets[slot];
+            unsigned int count = slot_offsets[slot + 1] - first_tri;
+            if (count == 0) continue;
 
-                else cur_chai_mesh = newMeshes[local_mat_id];
-            }
+            cMesh* cur_chai_mesh = (slot == 0) ? sub_mesh : newMeshes[slot - 1];
 
-            unsigned int indexTriangle = 0;  
-            if (g_3dsLoaderShouldGenerateExtraVertices == false) 
+            used_vertices.clear();
+            indices.resize(3 * count);
+            for(unsigned int j=0; j<count; j++) 
             {
-                uint_uint_map* vertex_map = (uint_uint_map*)cur_chai_mesh->m_userData;
-                unsigned short indices[3];
-                unsigned short* pindex = (unsigned short*)(&cur_indexed_tri);
-                uint_uint_map::iterator viter; 
+                const LTriangle& cur_indexed_tri = cur_mesh.GetTriangle(sorted_tris[first_tri + j]);
+                const uint pindex[3] = { cur_indexed_tri.a, cur_indexed_tri.b, cur_indexed_tri.c };
 
-                // For each vertex indexed by this triangle...
                 for(int k=0; k<3; k++) 
                 {
-                    indices[k] = pindex[k];
-                    viter = vertex_map->find(indices[k]);
-
-                    LVector4 v = cur_mesh.GetVertex(indices[k]);
-                    // If we've never seen this vertex before...
-                    if (viter == vertex_map->end()) 
+                    uint curindex = pindex[k];
+                    if (g_3dsLoaderShouldGenerateExtraVertices == true) 
                     {
-                        // Create a new vertex and put him in this map
-                        int newVertexIndex = cur_chai_mesh->newVertex(v.x,v.y,v.z);
-                        (*vertex_map)[(indices[k])] = newVertexIndex;
-                        indices[k] = newVertexIndex;
+                        indices[3*j+k] = (unsigned int)used_vertices.size();
+                        used_vertices.push_back(curindex);
                     }
-                    else 
+                    else
                     {
-                        // Otherwise just grab his index...
-                        indices[k] = (*viter).second;
+                        // If we've never seen this vertex before, create a new vertex
+                        if (vertex_map[curindex] == -1) 
+                        {
+                            vertex_map[curindex] = (int)used_vertices.size();
+                            used_vertices.push_back(curindex);
+                        }
+                        indices[3*j+k] = vertex_map[curindex];
                     }
-                }        
-
-                // Create the new triangle...
-                indexTriangle = cur_chai_mesh->newTriangle(indices[0],indices[1],indices[2]);
-            }      
-
-            if (g_3dsLoaderShouldGenerateExtraVertices == true) 
-            {  
-                LVector4 v0 = cur_mesh.GetVertex(cur_indexed_tri.a);
-                LVector4 v1 = cur_mesh.GetVertex(cur_indexed_tri.b);
-                LVector4 v2 = cur_mesh.GetVertex(cur_indexed_tri.c);
-
-                cVector3d vert0(v0.x,v0.y,v0.z);
-                cVector3d vert1(v1.x,v1.y,v1.z);
-                cVector3d vert2(v2.x,v2.y,v2.z);
-
-                indexTriangle = cur_chai_mesh->newTriangle(vert0,vert1,vert2);
+                }
             }
 
-            cTriangle* curTriangle = cur_chai_mesh->getTriangle(indexTriangle);
+            unsigned int num_vertices = (unsigned int)used_vertices.size();
+            cur_chai_mesh->reserve(cur_chai_mesh->getNumVertices() + num_vertices,
+                                   cur_chai_mesh->getNumTriangles() + count);
+            unsigned int first_vertex = cur_chai_mesh->appendVertices(num_vertices);
 
+            // Give properties to each vertex
             double transparency = cur_chai_mesh->m_material.m_diffuse.getA();
+            vector<cVertex>& vertices = *(cur_chai_mesh->pVertices());
 
-            // Give properties to each vertex of this triangle
-            unsigned short* pindex = (unsigned short*)(&cur_indexed_tri);
-
-            for(k=0; k<3; k++) 
+            for(unsigned int j=0; j<num_vertices; j++) 
             {
-                unsigned short curindex = pindex[k];
+                uint curindex = used_vertices[j];
 
+                LVector4 v = cur_mesh.GetVertex(curindex);
                 LVector3 norm = cur_mesh.GetNormal(curindex);
                 LVector2 uv = cur_mesh.GetUV(curindex);
                 LColor3 color = cur_mesh.GetColor(curindex);
 
-                cVertex* vertex = curTriangle->getVertex(k);
-                vertex->setNormal(norm.x,norm.y,norm.z);
-                vertex->setTexCoord(uv.x, 1.0 - uv.y);
-                vertex->setColor(color.r,color.g,color.b,(float)transparency);
+                cVertex& vertex = vertices[first_vertex + j];
+                vertex.setPos(v.x,v.y,v.z);
+                vertex.setNormal(norm.x,norm.y,norm.z);
+                vertex.setTexCoord(uv.x, 1.0 - uv.y);
+                vertex.setColor(color.r,color.g,color.b,(float)transparency);
+
+                // reset the table for the next mesh
+                vertex_map[curindex] = -1;
             }
 
-        } // For every triangle in this 3ds mesh
+            // Create the new triangles...
+            if (first_vertex > 0)
+            {
+                for(unsigned int j=0; j<3*count; j++) 
+                    indices[j] += first_vertex;
+            }
+            cur_chai_mesh->appendTriangles(&indices[0], count);
 
-        // We're now done with all the vertex maps for this mesh...
-        for(int i=0; i<num_materials; i++) 
-        {
-            cMesh* curMesh = newMeshes[i];
-            uint_uint_map* pmap = (uint_uint_map*)curMesh->m_userData;
-            delete pmap;
-        }
+        } // For every CHAI mesh of this 3ds mesh
 
         if (newMeshes) delete [] newMeshes;
-
-        uint_uint_map* pmap = (uint_uint_map*)sub_mesh->m_userData;
-        delete pmap;
         
     } // For every mesh in the 3ds file
 
@@ -1075,140 +1057,86 @@ void LMesh::CalcNormals(bool useSmoothingGroups)
         m_tris[i].normal = NormalizeVector(CrossProduct(b, a));
     }
 
-    vector< vector<int> > array;
-    array.resize(m_vertices.size());
-    for (i=0; i<m_triangles.size(); i++)
+    if (useSmoothingGroups)
     {
-        uint k = m_tris[i].a;
-        array[k].push_back(i);
-
-        k = m_tris[i].b;
-        array[k].push_back(i);
-
-        k = m_tris[i].c;
-        array[k].push_back(i);
-    } 
-
-    LVector3 temp;
-    
-    if (!useSmoothingGroups)
-    {
-        // now calculate the normals without using smoothing groups
-        for (i=0; i<m_vertices.size(); i++)
-        {
-            temp = zero3;
-            int t = array[i].size();
-
-            for (int k=0; k<t; k++)
-            {
-                temp.x += m_tris[array[i][k]].normal.x;
-                temp.y += m_tris[array[i][k]].normal.y;
-                temp.z += m_tris[array[i][k]].normal.z;
-            }
-            m_normals[i] = NormalizeVector(temp);
-        }
-    }
-    else
-    {
-        // now calculate the normals _USING_ smoothing groups
+        // duplicate the vertices so that there's only one smoothing group "per vertex"
         // I'm assuming a triangle can only belong to one smoothing group at a time!
-        vector<ulong> smGroups;
-        vector< vector <uint> > smList;
-        
-        uint loop_size = m_vertices.size();
+        //
+        // the copies of a vertex are chained from the original vertex, each one
+        // holding a single smoothing group, so a corner finds the vertex of its
+        // group by walking the few copies of its vertex rather than a list of
+        // all the faces sharing it.
+        uint count = m_vertices.size();
+        vector<uint> group(count, 0);
+        vector<int> next(count, -1);
+        vector<bool> used(count, false);
 
-        for (i=0; i<loop_size; i++)
+        for (i=0; i<m_triangles.size(); i++)
         {
-            int t = array[i].size();
-
-            if (t == 0)
-                continue;
+            uint* corners[3] = { &m_tris[i].a, &m_tris[i].b, &m_tris[i].c };
+            uint smoothingGroups = m_tris[i].smoothingGroups;
 
-            smGroups.clear();
-            smList.clear();
-            smGroups.push_back(m_tris[array[i][0]].smoothingGroups);
-            smList.resize(smGroups.size());
-            smList[smGroups.size()-1].push_back(array[i][0]);
-
-            // first build a list of smoothing groups for the vertex
-            for (int k=0; k<t; k++)
+            for (int k=0; k<3; k++)
             {
-                bool found = false;
-                for (uint j=0; j<smGroups.size(); j++)
+                uint v = *corners[k];
+                if (!used[v])
                 {
-                    if (m_tris[array[i][k]].smoothingGroups == smGroups[j])
-                    {
-                        smList[j].push_back(array[i][k]);
-                        found = true;
-                    }
+                    used[v] = true;
+                    group[v] = smoothingGroups;
+                    continue;
                 }
-                if (!found)
-                {
-                    smGroups.push_back(m_tris[array[i][k]].smoothingGroups);
-                    smList.resize(smGroups.size());
-                    smList[smGroups.size()-1].push_back(array[i][k]);
-                }
-            }
-            // now we have the list of faces for the vertex sorted by smoothing groups
 
+                while ((group[v] != smoothingGroups) && (next[v] >= 0))
+                    v = next[v];
 
-            // now duplicate the vertices so that there's only one smoothing group "per vertex"
-            if (smGroups.size() > 1)
-                for (uint j=1; j< smGroups.size(); j++)
+                if (group[v] != smoothingGroups)
                 {
-                    m_vertices.push_back(m_vertices[i]);
-                    m_normals.push_back(m_normals[i]);
-                    m_uv.push_back(m_uv[i]);
-                    m_colors.push_back(m_colors[i]);
-                    m_tangents.push_back(m_tangents[i]);
-                    m_binormals.push_back(m_binormals[i]);
-                    
-                    uint t = m_vertices.size()-1;
-                    for (uint h=0; h<smList[j].size(); h++)
-                    {
-                        if (m_tris[smList[j][h]].a == (int)i)
-                            m_tris[smList[j][h]].a = t;
-                        if (m_tris[smList[j][h]].b == (int)i)
-                            m_tris[smList[j][h]].b = t;
-                        if (m_tris[smList[j][h]].c == (int)i)
-                            m_tris[smList[j][h]].c = t;
-                    }
+                    uint original = *corners[k];
+                    uint t = m_vertices.size();
+
+                    LVector4 vertex = m_vertices[original];
+                    LVector3 normal = m_normals[original];
+                    LVector2 uv = m_uv[original];
+                    LColor3 color = m_colors[original];
+                    LVector3 tangent = m_tangents[original];
+                    LVector3 binormal = m_binormals[original];
+                    m_vertices.push_back(vertex);
+                    m_normals.push_back(normal);
+                    m_uv.push_back(uv);
+                    m_colors.push_back(color);
+                    m_tangents.push_back(tangent);
+                    m_binormals.push_back(binormal);
+
+                    group.push_back(smoothingGroups);
+                    next.push_back(-1);
+                    used.push_back(true);
+                    next[v] = t;
+                    v = t;
                 }
+                *corners[k] = v;
+            }
         }
-        
-        // now rebuild a face list for each vertex, since the old one is invalidated
-        for (i=0; i<array.size(); i++)
-            array[i].clear();
-        array.clear();
-        array.resize(m_vertices.size());
-        for (i=0; i<m_triangles.size(); i++)
-        {
-            uint k = m_tris[i].a;
-            array[k].push_back(i);
-
-            k = m_tris[i].b;
-            array[k].push_back(i);
+    }
 
-            k = m_tris[i].c;
-            array[k].push_back(i);
-        } 
+    // now compute the normals, by adding the normals of the faces at each vertex
+    for (i=0; i<m_vertices.size(); i++)
+        m_normals[i] = zero3;
 
-        // now compute the normals
-        for (i=0; i<m_vertices.size(); i++)
+    for (i=0; i<m_triangles.size(); i++)
+    {
+        const LVector3& normal = m_tris[i].normal;
+        uint corners[3] = { m_tris[i].a, m_tris[i].b, m_tris[i].c };
+        for (int k=0; k<3; k++)
         {
-            temp = zero3;
-            int t = array[i].size();
-
-            for (int k=0; k<t; k++)
-            {
-                temp.x += m_tris[array[i][k]].normal.x;
-                temp.y += m_tris[array[i][k]].normal.y;
-                temp.z += m_tris[array[i][k]].normal.z;
-            }
-            m_normals[i] = NormalizeVector(temp);
+            LVector3& temp = m_normals[corners[k]];
+            temp.x += normal.x;
+            temp.y += normal.y;
+            temp.z += normal.z;
         }
-
     }
+
+    for (i=0; i<m_vertices.size(); i++)
+        m_normals[i] = NormalizeVector(m_normals[i]);
    
     // copy m_tris to m_triangles
     for (i=0; i<m_triangles.size(); i++)
@@ -1780,42 +1708,30 @@ L3DS::L3DS(const char *filename)
 
 L3DS::~L3DS()
 {
-    if (m_bufferSize > 0)
-        free(m_buffer);
 }
 
 //---------------------------------------------------------------------------
 
 bool L3DS::LoadFile(const char *filename) 
 {
-    FILE *f;
-    f = fopen(filename, "rb");
-    if (f == 0)
+    // the file is mapped in memory and read in place, rather than copied
+    // into a buffer of its size
+    cMappedFile file;
+    if (!file.open(filename))
     {
         ErrorMsg("L3DS::LoadFile - cannot open file");
         return false;
     }
-    fseek(f, 0, SEEK_END);
-    m_bufferSize = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    m_buffer = (unsigned char*) calloc(m_bufferSize, 1);
-    if (m_buffer == 0)
+    if ((file.getSize() == 0) || (file.getSize() > 0xFFFFFFFF))
     {
-        ErrorMsg("L3DS::LoadFile - not enough memory (malloc failed)");
-        return false;
-    }
-    if (fread(m_buffer, m_bufferSize, 1, f) != 1)
-    {
-        fclose(f);
-        free(m_buffer);
-        m_bufferSize = 0;
         ErrorMsg("L3DS::LoadFile - error reading from file");
         return false;
     }
-    fclose(f);
+    m_buffer = (const unsigned char*)file.getData();
+    m_bufferSize = (uint)file.getSize();
     Clear();
     bool res = Read3DS();
-    free(m_buffer);
+    file.close();
     m_buffer = 0;
     m_bufferSize = 0;
 
@@ -1870,8 +1786,8 @@ short L3DS::ReadShort()
 {
     if ((m_buffer!=0) && (m_bufferSize != 0) && ((m_pos+2)<m_bufferSize))
     {
-        short *w = (short*)(m_buffer+m_pos);
-        short s = *w; //(short)*(m_buffer+m_pos);
+        short s;
+        memcpy(&s, m_buffer+m_pos, sizeof(s));
         m_pos += 2;
         return s;
     }
@@ -1885,8 +1801,8 @@ int L3DS::ReadInt()
 {
     if ((m_buffer!=0) && (m_bufferSize != 0) && ((m_pos+4)<m_bufferSize))
     {
-        int *w = (int*)(m_buffer+m_pos);
-        int s = *w;//(int)*(m_buffer+m_pos);
+        int s;
+        memcpy(&s, m_buffer+m_pos, sizeof(s));
         m_pos += 4;
         return s;
     }
@@ -1914,8 +1830,8 @@ float L3DS::ReadFloat()
 {
     if ((m_buffer!=0) && (m_bufferSize != 0) && ((m_pos+4)<m_bufferSize))
     {
-        float *w = (float*)(m_buffer+m_pos);
-        float s = *w;//(float)*(m_buffer+m_pos);
+        float s;
+        memcpy(&s, m_buffer+m_pos, sizeof(s));
         m_pos += 4;
         return s;
     }
@@ -1962,6 +1878,20 @@ int L3DS::ReadASCIIZ(char *buf, int max_count)
 
 //---------------------------------------------------------------------------
 
+const unsigned char* L3DS::ReadBlock(uint size)
+{
+    if ((m_buffer!=0) && (m_bufferSize != 0) && (size < m_bufferSize-m_pos))
+    {
+        const unsigned char* s = m_buffer+m_pos;
+        m_pos += size;
+        return s;
+    }
+    m_eof = true;
+    return 0;
+}
+
+//---------------------------------------------------------------------------
+
 void L3DS::Seek(int offset, int origin)
 {
     if (origin == SEEK_START)
@@ -1992,10 +1922,23 @@ uint L3DS::Pos()
 LChunk L3DS::ReadChunk()
 {
     LChunk chunk;
+    m_eof = false;
     chunk.id = ReadShort();
     int a = ReadInt();
     chunk.start = Pos();
     chunk.end = chunk.start+a-6;
+
+    // a chunk header cut by the end of the file ends the loops reading chunks,
+    // and a chunk with an invalid size is skipped, so that neither is read again
+    if (m_eof)
+    {
+        chunk.id = 0;
+        chunk.end = 0xFFFFFFFF;
+    }
+    else if (a < 6)
+    {
+        chunk.end = chunk.start;
+    }
     return chunk;
 }
 
@@ -2256,6 +2199,7 @@ void L3DS::ReadCamera(const LChunk &parent)
 void L3DS::ReadMesh(const LChunk &parent)
 {
     unsigned short count, i;
+    const unsigned char* data;
     LVector4 p;
     LMatrix4 m;
     LVector2 t;
@@ -2271,23 +2215,38 @@ void L3DS::ReadMesh(const LChunk &parent)
         case TRI_VERTEXLIST:
             count = ReadShort();
             mesh.SetVertexArraySize(count);
-            for (i=0; i < count; i++)
+            // the array is read in one block, vertices stay at zero if it is truncated
+            data = ReadBlock(count*3*sizeof(float));
+            if (data != 0)
             {
-                p.x = ReadFloat();
-                p.y = ReadFloat();
-                p.z = ReadFloat();
-                mesh.SetVertex(p, i);                
+                for (i=0; i < count; i++)
+                {
+                    float v[3];
+                    memcpy(v, data+i*sizeof(v), sizeof(v));
+                    p.x = v[0];
+                    p.y = v[1];
+                    p.z = v[2];
+                    mesh.m_vertices[i] = p;
+                }
             }
             break;
         case TRI_FACEMAPPING:
             count = ReadShort();
             if (mesh.GetVertexCount() == 0)
                 mesh.SetVertexArraySize(count);
-            for (i=0; i < count; i++)
+            data = ReadBlock(count*2*sizeof(float));
+            if (data != 0)
             {
-                t.x = ReadFloat();
-                t.y = ReadFloat();
-                mesh.SetUV(t, i);
+                if (count > mesh.GetVertexCount())
+                    count = mesh.GetVertexCount();
+                for (i=0; i < count; i++)
+                {
+                    float v[2];
+                    memcpy(v, data+i*sizeof(v), sizeof(v));
+                    t.x = v[0];
+                    t.y = v[1];
+                    mesh.m_uv[i] = t;
+                }
             }
             break;
         case TRI_FACELIST:
@@ -2332,6 +2291,23 @@ void L3DS::ReadMesh(const LChunk &parent)
             break;
         chunk = ReadChunk();
     }
+
+    // remove the faces which refer to missing vertices
+    uint count_valid = 0;
+    for (uint j=0; j<mesh.m_tris.size(); j++)
+    {
+        const LTri& tri = mesh.m_tris[j];
+        if ((tri.a < mesh.GetVertexCount()) && (tri.b < mesh.GetVertexCount()) && (tri.c < mesh.GetVertexCount()))
+        {
+            mesh.m_tris[count_valid++] = tri;
+        }
+    }
+    if (count_valid < mesh.m_tris.size())
+    {
+        ErrorMsg("L3DS::ReadMesh - faces with invalid vertex indices were removed");
+        mesh.SetTriangleArraySize(count_valid);
+    }
+
     m_meshes.push_back(mesh);
 }
 
@@ -2342,6 +2318,7 @@ void L3DS::ReadFaceList(const LChunk &chunk, LMesh &mesh)
     // variables 
     unsigned short count, t;    
     uint i;
+    const unsigned char* data;
     LTri tri;
     LChunk ch;
     char str[20];
@@ -2359,13 +2336,24 @@ void L3DS::ReadFaceList(const LChunk &chunk, LMesh &mesh)
     count = ReadShort();
     mesh.SetTriangleArraySize(count);    
     
-    for (i=0; i<(unsigned int)count; i++)
+    // each face is stored as three vertex indices and a flags word
+    data = ReadBlock(count*4*sizeof(unsigned short));
+    if (data != 0)
     {
-        tri.a = ReadShort();
-        tri.b = ReadShort();
-        tri.c = ReadShort();
-        ReadShort();
-        mesh.SetTri(tri, i);
+        for (i=0; i<(unsigned int)count; i++)
+        {
+            unsigned short face[4];
+            memcpy(face, data+i*sizeof(face), sizeof(face));
+            tri.a = face[0];
+            tri.b = face[1];
+            tri.c = face[2];
+            mesh.SetTri(tri, i);
+        }
+    }
+    else
+    {
+        for (i=0; i<(unsigned int)count; i++)
+            mesh.SetTri(tri, i);
     }
 
     // now read the optional chunks
@@ -2387,17 +2375,29 @@ void L3DS::ReadFaceList(const LChunk &chunk, LMesh &mesh)
             }
             
             count = ReadShort();
+            data = ReadBlock(count*sizeof(unsigned short));
             
-            for (i=0; i<(unsigned int)count; i++)  {
+            if (mat && (data != 0)) {
             
-              t = ReadShort();
-              if (mat) mesh.GetTri(t).materialId = mat_id;
+              for (i=0; i<(unsigned int)count; i++)  {
+            
+                memcpy(&t, data+i*sizeof(t), sizeof(t));
+                if (t < mesh.GetTriangleCount()) mesh.GetTri(t).materialId = mat_id;
+              }
             }                            
 
             break;
         case TRI_SMOOTH_GROUP:
-            for (i=0; i<mesh.GetTriangleCount(); i++)
-                mesh.GetTri(i).smoothingGroups = (ulong) ReadInt();
+            data = ReadBlock(mesh.GetTriangleCount()*sizeof(unsigned int));
+            if (data != 0)
+            {
+                for (i=0; i<mesh.GetTriangleCount(); i++)
+                {
+                    unsigned int smoothingGroups;
+                    memcpy(&smoothingGroups, data+i*sizeof(smoothingGroups), sizeof(smoothingGroups));
+                    mesh.GetTri(i).smoothingGroups = smoothingGroups;
+                }
+            }
             break;
         }
         SkipChunk(ch);
@@ -164,10 +164,10 @@ struct LChunk
 
 struct LTri
 {
-    unsigned short a;
-    unsigned short b;
-    unsigned short c;
-    unsigned long smoothingGroups;
+    uint a;
+    uint b;
+    uint c;
+    uint smoothingGroups;
     LVector3 normal;
     LVector3 tangent;
     LVector3 binormal;
@@ -184,9 +184,9 @@ struct LTri
 
 struct LTriangle
 {
-    unsigned short a;
-    unsigned short b;
-    unsigned short c;
+    uint a;
+    uint b;
+    uint c;
 };
 
 //---------------------------------------------------------------------------
@@ -725,8 +725,8 @@ class L3DS : public LImporter
     // true if end of file is reached
     bool m_eof;
 
-    // buffer for loading, used for speedup
-    unsigned char *m_buffer;
+    // content of the file, mapped in memory
+    const unsigned char *m_buffer;
 
     // the size of the buffer
     uint m_bufferSize;
@@ -752,6 +752,9 @@ class L3DS : public LImporter
     // reads an asciiz string
     int ReadASCIIZ(char *buf, int max_count);
 
+    // returns a block of "size" bytes and moves the cursor past it, or 0 if the block exceeds the buffer
+    const unsigned char* ReadBlock(uint size);
+
     // seek within the buffer
     void Seek(int offset, int origin);
 
@@ -0,0 +1,530 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "files/CFileLoaderBIN.h"
+#include "files/CFileLoaderOBJ.h"
+#include "files/CFileLoader3DS.h"
+#include "files/CMeshLoader.h"
+#include "files/CMappedFile.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+//---------------------------------------------------------------------------
+using std::vector;
+//---------------------------------------------------------------------------
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+// number of vertices converted at once while writing a file
+#define CHAI_BIN_WRITE_BLOCK 4096
+
+//---------------------------------------------------------------------------
+
+// round a file offset up to a multiple of 8 bytes
+static inline size_t align_offset(const size_t a_offset)
+{
+    return ((a_offset + 7) & ~((size_t)7));
+}
+
+//---------------------------------------------------------------------------
+
+// loader options which change the content of loaded meshes
+static unsigned int current_options()
+{
+    unsigned int options = 0;
+    if (g_objLoaderShouldGenerateExtraVertices) { options |= CHAI_BIN_OPTION_OBJ_EXTRA_VERTICES; }
+    if (g_3dsLoaderShouldGenerateExtraVertices) { options |= CHAI_BIN_OPTION_3DS_EXTRA_VERTICES; }
+    if (g_meshLoaderShouldWeldVertices) { options |= CHAI_BIN_OPTION_WELD_VERTICES; }
+    return (options);
+}
+
+//---------------------------------------------------------------------------
+
+// list a mesh and its mesh descendants depth-first, with their number of
+// mesh children
+static void collect_meshes(cMesh* a_mesh, vector<cMesh*>& a_meshes,
+                           vector<unsigned int>& a_numChildren)
+{
+    unsigned int index = (unsigned int)a_meshes.size();
+    a_meshes.push_back(a_mesh);
+    a_numChildren.push_back(0);
+
+    for (unsigned int i=0; i<a_mesh->getNumChildren(); i++)
+    {
+        cMesh* child = dynamic_cast<cMesh*>(a_mesh->getChild(i));
+        if (child != NULL)
+        {
+            a_numChildren[index]++;
+            collect_meshes(child, a_meshes, a_numChildren);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+
+// write zeros up to the next multiple of 8 bytes
+static void write_padding(FILE* a_file, const size_t a_size)
+{
+    static const char zeros[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    size_t padding = align_offset(a_size) - a_size;
+    if (padding > 0) { fwrite(zeros, 1, padding, a_file); }
+}
+
+//---------------------------------------------------------------------------
+
+// copy a name into a buffer of a_size bytes, truncating and terminating it;
+// the source is not read beyond a_size - 1 characters
+static void copy_name(char* a_dest, const char* a_src, const size_t a_size)
+{
+    size_t length = 0;
+    while ((length + 1 < a_size) && (a_src[length] != '\0')) { length++; }
+    memcpy(a_dest, a_src, length);
+    a_dest[length] = '\0';
+}
+
+#endif  // DOXYGEN_SHOULD_SKIP_THIS
+
+
+//===========================================================================
+/*!
+    Load a binary mesh file (.chaibin) into a mesh. The file is mapped in
+    memory and checked completely before the mesh is modified; vertices and
+    triangles are then created directly from the mapped arrays, without
+    parsing, and vertex normals are not recomputed.
+
+    If \e a_sourceFileName is not empty, the file is rejected when the
+    size or modification time of the source file, or the loader options,
+    differ from those recorded when the file was written.
+
+    \fn         bool cLoadFileBIN(cMesh* a_mesh, const string& a_fileName,
+                                  const string& a_sourceFileName)
+    \param      a_mesh            Mesh in which the file is loaded.
+    \param      a_fileName        Name of the binary file.
+    \param      a_sourceFileName  Name of the file the binary file was created from, or "".
+    \return     Return \b true if the file was loaded successfully, otherwise
+                return \b false.
+*/
+//===========================================================================
+bool cLoadFileBIN(cMesh* a_mesh, const string& a_fileName,
+                  const string& a_sourceFileName)
+{
+    if (a_mesh == NULL) { return (false); }
+
+    cMappedFile file;
+    if (!file.open(a_fileName.c_str())) { return (false); }
+
+    //-----------------------------------------------------------------------
+    // check header
+    //-----------------------------------------------------------------------
+    const char* data = file.getData();
+    size_t size = file.getSize();
+    if (size < sizeof(cBinFileHeader)) { return (false); }
+
+    const cBinFileHeader* header = (const cBinFileHeader*)data;
+    if ((memcmp(header->m_magic, CHAI_BIN_MAGIC, sizeof(CHAI_BIN_MAGIC)) != 0) ||
+        (header->m_version != CHAI_BIN_VERSION) ||
+        (header->m_byteOrder != CHAI_BIN_BYTE_ORDER) ||
+        (header->m_fileSize != size))
+    {
+        return (false);
+    }
+
+    // the file must match the current source file and loader options
+    if (a_sourceFileName.size() > 0)
+    {
+        unsigned int sourceSize[2], sourceTime[2];
+        if (!cMappedFile::getFileInfo(a_sourceFileName.c_str(), sourceSize, sourceTime)) { return (false); }
+        if ((header->m_options != current_options()) ||
+            (header->m_sourceSize[0] != sourceSize[0]) ||
+            (header->m_sourceSize[1] != sourceSize[1]) ||
+            (header->m_sourceTime[0] != sourceTime[0]) ||
+            (header->m_sourceTime[1] != sourceTime[1]))
+        {
+            return (false);
+        }
+    }
+
+    //-----------------------------------------------------------------------
+    // check tables and arrays, so that a damaged file can not be read
+    // out of bounds
+    //-----------------------------------------------------------------------
+    unsigned int numTextures = header->m_numTextures;
+    unsigned int numMeshes = header->m_numMeshes;
+    if ((numMeshes == 0) ||
+        (header->m_textureOffset % 8 != 0) || (header->m_meshOffset % 8 != 0) ||
+        (header->m_textureOffset > size) ||
+        ((size - header->m_textureOffset) / CHAI_BIN_TEXTURE_NAME_SIZE < numTextures) ||
+        (header->m_meshOffset > size) ||
+        ((size - header->m_meshOffset) / sizeof(cBinMeshRecord) < numMeshes))
+    {
+        return (false);
+    }
+
+    const char* textureNames = data + header->m_textureOffset;
+    const cBinMeshRecord* records = (const cBinMeshRecord*)(data + header->m_meshOffset);
+
+    unsigned int pending = 1;
+    for (unsigned int i=0; i<numMeshes; i++)
+    {
+        const cBinMeshRecord& record = records[i];
+
+        // records list a tree depth-first: each one is the child of a
+        // record whose children have not all been seen yet, and there
+        // must be enough records left for the children announced
+        if ((pending == 0) || (record.m_numChildren > numMeshes)) { return (false); }
+        pending = pending - 1 + record.m_numChildren;
+        if (pending > numMeshes - i - 1) { return (false); }
+
+        if ((record.m_texture < -1) || (record.m_texture >= (int)numTextures) ||
+            (record.m_vertexOffset % 8 != 0) || (record.m_triangleOffset % 4 != 0) ||
+            (record.m_vertexOffset > size) ||
+            ((size - record.m_vertexOffset) / sizeof(cBinVertex) < record.m_numVertices) ||
+            (record.m_triangleOffset > size) ||
+            ((size - record.m_triangleOffset) / (3 * sizeof(unsigned int)) < record.m_numTriangles))
+        {
+            return (false);
+        }
+
+        const unsigned int* indices = (const unsigned int*)(data + record.m_triangleOffset);
+        for (unsigned int j=0; j<3*record.m_numTriangles; j++)
+        {
+            if (indices[j] >= record.m_numVertices) { return (false); }
+        }
+    }
+    if (pending != 0) { return (false); }
+
+    //-----------------------------------------------------------------------
+    // build meshes
+    //-----------------------------------------------------------------------
+    cWorld* world = a_mesh->getParentWorld();
+
+    // clear all vertices and triangle of current mesh
+    a_mesh->clear();
+
+    // textures are loaded once, when first used
+    vector<cTexture2D*> textures(numTextures, (cTexture2D*)NULL);
+
+    // meshes whose children are being created, and their number of
+    // children left to create
+    vector<cMesh*> parents;
+    vector<unsigned int> remaining;
+
+    for (unsigned int i=0; i<numMeshes; i++)
+    {
+        const cBinMeshRecord& record = records[i];
+
+        // the first record is the mesh itself; others are children
+        cMesh* mesh = a_mesh;
+        if (i > 0)
+        {
+            while (remaining.back() == 0)
+            {
+                parents.pop_back();
+                remaining.pop_back();
+            }
+            remaining.back()--;
+            mesh = parents.back()->createMesh();
+            parents.back()->addChild(mesh);
+        }
+
+        // name and position
+        copy_name(mesh->m_objectName, record.m_name, CHAI_SIZE_NAME);
+        mesh->setPos(cVector3d(record.m_pos[0], record.m_pos[1], record.m_pos[2]));
+        cMatrix3d rot;
+        rot.set(record.m_rot[0], record.m_rot[1], record.m_rot[2],
+                record.m_rot[3], record.m_rot[4], record.m_rot[5],
+                record.m_rot[6], record.m_rot[7], record.m_rot[8]);
+        mesh->setRot(rot);
+
+        // material
+        const float* c;
+        c = record.m_ambient;  mesh->m_material.m_ambient.set(c[0], c[1], c[2], c[3]);
+        c = record.m_diffuse;  mesh->m_material.m_diffuse.set(c[0], c[1], c[2], c[3]);
+        c = record.m_specular; mesh->m_material.m_specular.set(c[0], c[1], c[2], c[3]);
+        c = record.m_emission; mesh->m_material.m_emission.set(c[0], c[1], c[2], c[3]);
+        mesh->m_material.setShininess(record.m_shininess);
+
+        // rendering options
+        mesh->setUseMaterial((record.m_flags & CHAI_BIN_MESH_USE_MATERIAL) != 0, false);
+        mesh->setUseVertexColors((record.m_flags & CHAI_BIN_MESH_USE_VERTEX_COLORS) != 0, false);
+        mesh->setUseTransparency((record.m_flags & CHAI_BIN_MESH_USE_TRANSPARENCY) != 0, false);
+        mesh->setUseCulling((record.m_flags & CHAI_BIN_MESH_USE_CULLING) != 0, false);
+
+        // texture
+        if (record.m_texture >= 0)
+        {
+            cTexture2D*& texture = textures[record.m_texture];
+            if (texture == NULL)
+            {
+                char name[CHAI_BIN_TEXTURE_NAME_SIZE];
+                memcpy(name, textureNames + record.m_texture * CHAI_BIN_TEXTURE_NAME_SIZE,
+                       CHAI_BIN_TEXTURE_NAME_SIZE);
+                name[CHAI_BIN_TEXTURE_NAME_SIZE-1] = '\0';
+
+                texture = (world != NULL) ? world->newTexture() : new cTexture2D();
+                texture->loadFromFile(name);
+            }
+            mesh->setTexture(texture);
+        }
+        mesh->setUseTexture((record.m_flags & CHAI_BIN_MESH_USE_TEXTURE) != 0, false);
+
+        // vertices
+        const cBinVertex* vertices = (const cBinVertex*)(data + record.m_vertexOffset);
+        mesh->reserve(record.m_numVertices, record.m_numTriangles);
+        unsigned int first = mesh->appendVertices(record.m_numVertices);
+        vector<cVertex>& meshVertices = *mesh->pVertices();
+        for (unsigned int j=0; j<record.m_numVertices; j++)
+        {
+            const cBinVertex& v = vertices[j];
+            cVertex& vertex = meshVertices[first + j];
+            vertex.m_localPos.set(v.m_pos[0], v.m_pos[1], v.m_pos[2]);
+            vertex.m_globalPos = vertex.m_localPos;
+            vertex.m_normal.set(v.m_normal[0], v.m_normal[1], v.m_normal[2]);
+            vertex.m_texCoord.set(v.m_texCoord[0], v.m_texCoord[1], v.m_texCoord[2]);
+            vertex.m_color.set(v.m_color[0], v.m_color[1], v.m_color[2], v.m_color[3]);
+        }
+
+        // triangles
+        const unsigned int* indices = (const unsigned int*)(data + record.m_triangleOffset);
+        mesh->appendTriangles(indices, record.m_numTriangles);
+
+        if (record.m_numChildren > 0)
+        {
+            parents.push_back(mesh);
+            remaining.push_back(record.m_numChildren);
+        }
+    }
+
+    // compute boundary boxes
+    a_mesh->computeBoundaryBox(true);
+
+    // update global position in world
+    if (world != NULL) world->computeGlobalPositions(true);
+
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Save a mesh and its mesh children to a binary mesh file (.chaibin).
+    Vertices, allocated triangles, materials, rendering options and the
+    file names of textures are written. Objects other than meshes are
+    not saved.
+
+    If \e a_sourceFileName is not empty, the size and modification time of
+    that file and the current loader options are recorded, so that
+    cLoadFileBIN() can detect an outdated file.
+
+    \fn         bool cSaveFileBIN(cMesh* a_mesh, const string& a_fileName,
+                                  const string& a_sourceFileName)
+    \param      a_mesh            Mesh to save.
+    \param      a_fileName        Name of the binary file.
+    \param      a_sourceFileName  Name of the file the mesh was loaded from, or "".
+    \return     Return \b true if the file was written successfully, otherwise
+                return \b false.
+*/
+//===========================================================================
+bool cSaveFileBIN(cMesh* a_mesh, const string& a_fileName,
+                  const string& a_sourceFileName)
+{
+    if (a_mesh == NULL) { return (false); }
+
+    //-----------------------------------------------------------------------
+    // header
+    //-----------------------------------------------------------------------
+    cBinFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_magic, CHAI_BIN_MAGIC, sizeof(CHAI_BIN_MAGIC));
+    header.m_version = CHAI_BIN_VERSION;
+    header.m_byteOrder = CHAI_BIN_BYTE_ORDER;
+    header.m_options = current_options();
+
+    if (a_sourceFileName.size() > 0)
+    {
+        if (!cMappedFile::getFileInfo(a_sourceFileName.c_str(), header.m_sourceSize, header.m_sourceTime))
+        {
+            return (false);
+        }
+    }
+
+    // meshes and their textures
+    vector<cMesh*> meshes;
+    vector<unsigned int> numChildren;
+    collect_meshes(a_mesh, meshes, numChildren);
+
+    vector<cTexture2D*> textures;
+    vector<cBinMeshRecord> records(meshes.size());
+
+    //-----------------------------------------------------------------------
+    // mesh records and layout of the file
+    //-----------------------------------------------------------------------
+    size_t offset = sizeof(cBinFileHeader);
+
+    // texture indices first, to know the size of the texture table
+    for (unsigned int i=0; i<meshes.size(); i++)
+    {
+        cMesh* mesh = meshes[i];
+        cBinMeshRecord& record = records[i];
+        memset(&record, 0, sizeof(record));
+
+        record.m_texture = -1;
+        cTexture2D* texture = mesh->getTexture();
+        if ((texture != NULL) && (texture->m_image.getFilename()[0] != '\0'))
+        {
+            unsigned int j = 0;
+            while ((j < textures.size()) && (textures[j] != texture)) { j++; }
+            if (j == textures.size()) { textures.push_back(texture); }
+            record.m_texture = (int)j;
+        }
+    }
+
+    header.m_numTextures = (unsigned int)textures.size();
+    header.m_textureOffset = (unsigned int)offset;
+    offset += textures.size() * CHAI_BIN_TEXTURE_NAME_SIZE;
+
+    header.m_numMeshes = (unsigned int)meshes.size();
+    header.m_meshOffset = (unsigned int)offset;
+    offset += meshes.size() * sizeof(cBinMeshRecord);
+
+    for (unsigned int i=0; i<meshes.size(); i++)
+    {
+        cMesh* mesh = meshes[i];
+        cBinMeshRecord& record = records[i];
+
+        copy_name(record.m_name, mesh->m_objectName, CHAI_SIZE_NAME);
+        record.m_numChildren = numChildren[i];
+        record.m_numVertices = (unsigned int)mesh->pVertices()->size();
+        record.m_numTriangles = mesh->getNumAllocatedTriangles();
+
+        if (mesh->getUseMaterial()) { record.m_flags |= CHAI_BIN_MESH_USE_MATERIAL; }
+        if (mesh->getUseVertexColors()) { record.m_flags |= CHAI_BIN_MESH_USE_VERTEX_COLORS; }
+        if (mesh->getUseTransparency()) { record.m_flags |= CHAI_BIN_MESH_USE_TRANSPARENCY; }
+        if (mesh->getUseTexture()) { record.m_flags |= CHAI_BIN_MESH_USE_TEXTURE; }
+        if (mesh->getUseCulling()) { record.m_flags |= CHAI_BIN_MESH_USE_CULLING; }
+
+        record.m_shininess = mesh->m_material.getShininess();
+        for (int k=0; k<4; k++)
+        {
+            record.m_ambient[k]  = mesh->m_material.m_ambient[k];
+            record.m_diffuse[k]  = mesh->m_material.m_diffuse[k];
+            record.m_specular[k] = mesh->m_material.m_specular[k];
+            record.m_emission[k] = mesh->m_material.m_emission[k];
+        }
+
+        cVector3d pos = mesh->getPos();
+        cMatrix3d rot = mesh->getRot();
+        record.m_pos[0] = pos.x;
+        record.m_pos[1] = pos.y;
+        record.m_pos[2] = pos.z;
+        for (int k=0; k<9; k++)
+        {
+            record.m_rot[k] = rot.m[k / 3][k % 3];
+        }
+
+        record.m_vertexOffset = (unsigned int)offset;
+        offset += record.m_numVertices * sizeof(cBinVertex);
+        record.m_triangleOffset = (unsigned int)offset;
+        offset = align_offset(offset + 3 * record.m_numTriangles * sizeof(unsigned int));
+
+        // offsets are stored on 32 bits
+        if (offset > 0xFFFFFFF0u) { return (false); }
+    }
+    header.m_fileSize = (unsigned int)offset;
+
+    //-----------------------------------------------------------------------
+    // write file
+    //-----------------------------------------------------------------------
+    FILE* file = fopen(a_fileName.c_str(), "wb");
+    if (file == NULL) { return (false); }
+
+    fwrite(&header, sizeof(header), 1, file);
+
+    for (unsigned int i=0; i<textures.size(); i++)
+    {
+        char name[CHAI_BIN_TEXTURE_NAME_SIZE];
+        memset(name, 0, sizeof(name));
+        copy_name(name, textures[i]->m_image.getFilename(), sizeof(name));
+        fwrite(name, sizeof(name), 1, file);
+    }
+
+    fwrite(&records[0], sizeof(cBinMeshRecord), records.size(), file);
+
+    vector<cBinVertex> block(CHAI_BIN_WRITE_BLOCK);
+    vector<unsigned int> indices;
+    for (unsigned int i=0; i<meshes.size(); i++)
+    {
+        cMesh* mesh = meshes[i];
+        const vector<cVertex>& vertices = *mesh->pVertices();
+
+        // vertices, converted by blocks
+        unsigned int numVertices = (unsigned int)vertices.size();
+        for (unsigned int first=0; first<numVertices; first+=CHAI_BIN_WRITE_BLOCK)
+        {
+            unsigned int count = numVertices - first;
+            if (count > CHAI_BIN_WRITE_BLOCK) { count = CHAI_BIN_WRITE_BLOCK; }
+
+            for (unsigned int j=0; j<count; j++)
+            {
+                const cVertex& vertex = vertices[first + j];
+                cBinVertex& v = block[j];
+                v.m_pos[0] = vertex.m_localPos.x;
+                v.m_pos[1] = vertex.m_localPos.y;
+                v.m_pos[2] = vertex.m_localPos.z;
+                v.m_normal[0] = vertex.m_normal.x;
+                v.m_normal[1] = vertex.m_normal.y;
+                v.m_normal[2] = vertex.m_normal.z;
+                v.m_texCoord[0] = vertex.m_texCoord.x;
+                v.m_texCoord[1] = vertex.m_texCoord.y;
+                v.m_texCoord[2] = vertex.m_texCoord.z;
+                for (int k=0; k<4; k++) { v.m_color[k] = vertex.m_color[k]; }
+            }
+            fwrite(&block[0], sizeof(cBinVertex), count, file);
+        }
+
+        // allocated triangles, in the order of the triangle array
+        vector<cTriangle>& triangles = *mesh->pTriangles();
+        indices.clear();
+        for (unsigned int j=0; j<triangles.size(); j++)
+        {
+            if (!triangles[j].m_allocated) { continue; }
+            indices.push_back(triangles[j].getVertexIndex(0));
+            indices.push_back(triangles[j].getVertexIndex(1));
+            indices.push_back(triangles[j].getVertexIndex(2));
+        }
+        if (indices.size() > 0)
+        {
+            fwrite(&indices[0], sizeof(unsigned int), indices.size(), file);
+        }
+        write_padding(file, indices.size() * sizeof(unsigned int));
+    }
+
+    bool success = (ferror(file) == 0);
+    if (fclose(file) != 0) { success = false; }
+
+    // do not leave an incomplete file
+    if (!success)
+    {
+        remove(a_fileName.c_str());
+    }
+
+    return (success);
+}
@@ -0,0 +1,174 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CFileLoaderBINH
+#define CFileLoaderBINH
+//---------------------------------------------------------------------------
+#include "../graphics/CVertex.h"
+#include "../graphics/CTriangle.h"
+#include "../graphics/CMaterial.h"
+#include "../graphics/CTexture2D.h"
+#include "../scenegraph/CMesh.h"
+#include "../scenegraph/CWorld.h"
+#include <string>
+//---------------------------------------------------------------------------
+using std::string;
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CFileLoaderBIN.h
+
+    \brief
+    <b> Files </b> \n
+    Binary mesh cache (.chaibin).
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+// GLOBAL UTILITY FUNCTIONS:
+//---------------------------------------------------------------------------
+
+/*!
+    \ingroup    files
+    \brief
+    Loads a binary mesh file (.chaibin) into a mesh. If a source file name
+    is given, the file is only loaded if it was created from the current
+    version of the source file, with the current loader options.
+*/
+bool cLoadFileBIN(cMesh* a_mesh, const string& a_fileName,
+                  const string& a_sourceFileName = "");
+
+/*!
+    \ingroup    files
+    \brief
+    Saves a mesh and its children to a binary mesh file (.chaibin),
+    optionally recording the source file it was loaded from.
+*/
+bool cSaveFileBIN(cMesh* a_mesh, const string& a_fileName,
+                  const string& a_sourceFileName = "");
+
+
+//---------------------------------------------------------------------------
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+
+//===========================================================================
+// INTERNAL DEFINITIONS FOR BINARY MESH FILES:
+//===========================================================================
+
+/*
+    A .chaibin file is laid out so that it can be mapped in memory and its
+    arrays used in place:
+
+        header                  cBinFileHeader
+        texture table           m_numTextures x char[CHAI_BIN_TEXTURE_NAME_SIZE]
+        mesh table              m_numMeshes x cBinMeshRecord (depth-first)
+        mesh data               per mesh, cBinVertex array and unsigned
+                                int triangle indices, each 8-byte aligned
+
+    All offsets are counted from the start of the file. Data is stored in
+    the byte order of the machine that wrote the file; files written with
+    another byte order are rejected.
+*/
+
+// File identifier and version
+#define CHAI_BIN_MAGIC              "CHAIBIN"
+#define CHAI_BIN_VERSION            1
+#define CHAI_BIN_BYTE_ORDER         0x01020304
+
+// Size of the texture file names
+#define CHAI_BIN_TEXTURE_NAME_SIZE  256
+
+// Flags of a mesh record
+#define CHAI_BIN_MESH_USE_MATERIAL      0x01
+#define CHAI_BIN_MESH_USE_VERTEX_COLORS 0x02
+#define CHAI_BIN_MESH_USE_TRANSPARENCY  0x04
+#define CHAI_BIN_MESH_USE_TEXTURE       0x08
+#define CHAI_BIN_MESH_USE_CULLING       0x10
+
+// Loader options which change the loaded meshes
+#define CHAI_BIN_OPTION_OBJ_EXTRA_VERTICES  0x01
+#define CHAI_BIN_OPTION_3DS_EXTRA_VERTICES  0x02
+#define CHAI_BIN_OPTION_WELD_VERTICES       0x04
+
+// File header (64 bytes)
+struct cBinFileHeader
+{
+    char m_magic[8];
+    unsigned int m_version;
+    unsigned int m_byteOrder;
+
+    // loader options used to create the file
+    unsigned int m_options;
+
+    // size (low and high words) and modification time of the source file
+    unsigned int m_sourceSize[2];
+    unsigned int m_sourceTime[2];
+
+    unsigned int m_numTextures;
+    unsigned int m_numMeshes;
+    unsigned int m_textureOffset;
+    unsigned int m_meshOffset;
+    unsigned int m_fileSize;
+    unsigned int m_reserved[2];
+};
+
+// A mesh of the file (256 bytes). Children follow their parent.
+struct cBinMeshRecord
+{
+    char m_name[CHAI_SIZE_NAME];
+
+    unsigned int m_numChildren;
+    unsigned int m_numVertices;
+    unsigned int m_numTriangles;
+    unsigned int m_flags;
+
+    // index in the texture table, or -1
+    int m_texture;
+    unsigned int m_shininess;
+
+    unsigned int m_vertexOffset;
+    unsigned int m_triangleOffset;
+
+    float m_ambient[4];
+    float m_diffuse[4];
+    float m_specular[4];
+    float m_emission[4];
+
+    double m_pos[3];
+    double m_rot[9];
+};
+
+// A vertex (88 bytes)
+struct cBinVertex
+{
+    double m_pos[3];
+    double m_normal[3];
+    double m_texCoord[3];
+    float m_color[4];
+};
+
+//---------------------------------------------------------------------------
+#endif  // DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
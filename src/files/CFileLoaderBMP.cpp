@@ -20,6 +20,8 @@
 
 //---------------------------------------------------------------------------
 #include "files/CFileLoaderBMP.h"
+#include "files/CMappedFile.h"
+#include <string.h>
 //---------------------------------------------------------------------------
 
 //===========================================================================
@@ -78,7 +80,9 @@ cFileLoaderBMP::~cFileLoaderBMP()
 
 //===========================================================================
 /*!
-    Load a bitmap from a file and represent it correctly in memory.
+    Load a bitmap from a file and represent it correctly in memory. The
+    file is mapped in memory and converted row by row to RGB pixels,
+    stored from the bottom row to the top row.
 
     \fn         bool cFileLoaderBMP::loadBMP(char* a_fileName)
     \param      a_fileName  Filename of image bitmap.
@@ -86,119 +90,117 @@ cFileLoaderBMP::~cFileLoaderBMP()
 //===========================================================================
 bool cFileLoaderBMP::loadBMP(char* a_fileName)
 {
-    FILE *in;               // file stream for reading
-    char *tempData;         // temp storage for image data
-    int numColors;         // total available colours
-
     // bitmap is not loaded yet
     m_loaded = false;
 
     // make sure memory is not lost
-    if (m_colors != 0)
+    if (m_colors != NULL)
     {
         delete[] m_colors;
+        m_colors = NULL;
     }
 
     if (m_pBitmap != NULL)
     {
         delete[] m_pBitmap;
+        m_pBitmap = NULL;
     }
 
-    // open the file for reading in binary mode
-    in = fopen(a_fileName, "rb");
-
-    // if the file does not exist return in error
-    if (in == NULL)
+    // map the file in memory
+    cMappedFile in;
+    if (!in.open(a_fileName))
     {
         m_errorMsg = "File does not exist.";
-        // fclose(in);
-        return false;
+        return (false);
     }
 
-    // rewind file
-    rewind (in);
+    const unsigned char* data = (const unsigned char*)in.getData();
+    size_t size = in.getSize();
 
-    // read in the entire BITMAPFILEHEADER
-    int s1 = sizeof(BITMAPFILEHEADER);
-    int ss1 = (int)fread(&m_bmfh, s1, 1, in);
+    // read in the entire BITMAPFILEHEADER and BITMAPINFOHEADER
+    if (size < sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER))
+    {
+        m_errorMsg = "File is too short.";
+        return (false);
+    }
+    memcpy(&m_bmfh, data, sizeof(BITMAPFILEHEADER));
+    memcpy(&m_bmih, data + sizeof(BITMAPFILEHEADER), sizeof(BITMAPINFOHEADER));
 
     // check for the magic number that says this is a bitmap
     if (m_bmfh.bfType != BITMAP_MAGIC_NUMBER)
     {
-        fclose(in);
-        return false;
+        return (false);
     }
 
-    // read in the entire BITMAPINFOHEADER
-    int s2 = sizeof(BITMAPINFOHEADER);
-    int ss2 = (int)fread(&m_bmih, s2, 1, in);
-  
-    // save the width, height and bits per pixel for external use
-    m_width = m_bmih.biWidth;
-    m_height = m_bmih.biHeight;
+    // save the width, height and bits per pixel for external use. The rows
+    // of a bitmap with a negative height are stored from top to bottom.
+    m_width = (m_bmih.biWidth > 0) ? m_bmih.biWidth : 0;
+    m_height = (m_bmih.biHeight < 0) ? 0u - (unsigned int)m_bmih.biHeight : m_bmih.biHeight;
     m_bpp = m_bmih.biBitCount;
 
-    // calculate the size of the image data with padding
-    m_dataSize = (m_width * m_height * (unsigned int)(m_bmih.biBitCount / 8.0));
-
-    // calculate the number of available colors
-    numColors = 1 << m_bmih.biBitCount;
-
-    // if the bitmap is not 8 bits per pixel or more return in error
-    if(m_bpp < 8)
+    // if the bitmap is not 8 or 24 bits per pixel return in error
+    if ((m_bpp != 8) && (m_bpp != 24))
     {
         m_errorMsg="File is not 8 or 24 bits per pixel.";
-        fclose(in);
         return (false);
     }
 
-    // load the palette for 8 bits per pixel
-    if(m_bpp == 8)
+    // compressed bitmaps are not supported
+    if (m_bmih.biCompression != 0)
     {
-    	m_colors =new RGBQUAD[numColors];
-    	fread(m_colors, sizeof(RGBQUAD), numColors, in);
+        m_errorMsg="Compressed bitmaps are not supported.";
+        return (false);
     }
 
-    // set up the temporary buffer for the image data
-    tempData = new char[m_dataSize];
-
-    // exit if there is not enough memory
-    if (tempData == NULL)
+    // calculate the witdh of the final image in bytes, and the width of
+    // the rows in the file, which are padded to 4 bytes
+    if ((m_width == 0) || (m_height == 0) || (m_width > 0x10000000))
     {
-        m_errorMsg = "Not enough memory to allocate a temporary buffer.";
-        fclose(in);
+        m_errorMsg = "Invalid image size.";
         return (false);
     }
+    m_byteWidth = m_width * (m_bpp / 8);
+    m_padWidth = (m_byteWidth + 3) & ~3u;
 
-    // read in the entire image
-    fread(tempData, sizeof(char), m_dataSize, in);
-
-    // close the file now that we have all the info
-    fclose(in);
-
-    // calculate the witdh of the final image in bytes
-    m_byteWidth = m_padWidth=(int)((float)m_width * (float)m_bpp / 8.0);
+    // calculate the size of the image data with padding
+    m_dataSize = m_padWidth * m_height;
 
-    // adjust the width for padding as necessary
-    while( (m_padWidth%4) != 0)
+    // check that the image data is in the file
+    size_t offset = m_bmfh.bfOffBits;
+    if ((offset > size) ||
+        ((size - offset) / m_padWidth < m_height - 1) ||
+        (size - offset - (size_t)m_padWidth * (m_height - 1) < m_byteWidth))
     {
-        m_padWidth++;
+        m_errorMsg = "File is too short.";
+        return (false);
     }
 
-    // change format from GBR to RGB
+    // load the palette for 8 bits per pixel; missing entries are black
     if (m_bpp == 8)
     {
-    	m_loaded = convert8(tempData);
-   	}
+        const int numColors = 256;
+        m_colors = new RGBQUAD[numColors];
+        memset(m_colors, 0, numColors * sizeof(RGBQUAD));
+
+        size_t paletteOffset = sizeof(BITMAPFILEHEADER) + m_bmih.biSize;
+        if (paletteOffset < offset)
+        {
+            size_t count = (offset - paletteOffset) / sizeof(RGBQUAD);
+            if (count > numColors) { count = numColors; }
+            if ((m_bmih.biClrUsed > 0) && (count > m_bmih.biClrUsed)) { count = m_bmih.biClrUsed; }
+            memcpy(m_colors, data + paletteOffset, count * sizeof(RGBQUAD));
+        }
+    }
 
     // change format from GBR to RGB
-    else if (m_bpp == 24)
+    if (m_bpp == 8)
     {
-    	m_loaded = convert24(tempData);
+        m_loaded = convert8(data + offset);
+    }
+    else
+    {
+        m_loaded = convert24(data + offset);
     }
-
-    // clean up memory
-    delete[] tempData;
 
     // bitmap is now loaded
     m_errorMsg = "Bitmap loaded";
@@ -228,70 +230,29 @@ void cFileLoaderBMP::reset()
 /*!
     Convert format from GBR to RGB - 24bits images
 
-    \fn        bool cFileLoaderBMP::convert24(char* tempData)
+    \fn        bool cFileLoaderBMP::convert24(const unsigned char* a_data)
+    \param     a_data  Image data of the file.
 */
 //===========================================================================
-bool cFileLoaderBMP::convert24(char* tempData)
+bool cFileLoaderBMP::convert24(const unsigned char* a_data)
 {
-	int offset,diff;
-	diff = m_width * m_height * RGB_BYTE_SIZE;
-
     //allocate the buffer for the final image data
-    m_pBitmap = new unsigned char[diff];
+    m_pBitmap = new unsigned char[(size_t)m_width * m_height * RGB_BYTE_SIZE];
 
-    //exit if there is not enough memory
-    if (m_pBitmap == NULL)
+    for (unsigned int i=0; i<m_height; i++)
     {
-        m_errorMsg = "Not enough memory to allocate an image buffer";
-        delete[] m_pBitmap;
-        return (false);
-    }
-
-    if (m_height > 0)
-    {
-        offset = m_padWidth - m_byteWidth;
-
-        //count backwards so you start at the front of the image
-        for (unsigned int i=0; i<m_dataSize; i+=3)
-        {
-            //jump over the padding at the start of a new line
-            if (((i+1) % m_padWidth) == 0)
-            {
-                i+=offset;
-            }
-
-            //transfer the data
-            *(m_pBitmap+i+2) =* (tempData+i);
-            *(m_pBitmap+i+1) =* (tempData+i+1);
-            *(m_pBitmap+i) =* (tempData+i+2);
-        }
-    }
-
-    //image parser for a forward image
-    else
-    {
-        offset = m_padWidth - m_byteWidth;
-        int j = m_dataSize-3;
-
-        //count backwards so you start at the front of the image
-        //here you can start from the back of the file or the front,
-        //after the header  The only problem is that some programs
-        //will pad not only the data, but also the file size to
-        //be divisible by 4 bytes.
-
-        for(unsigned int i=0; i<m_dataSize; i+=3)
+        // rows are stored from the bottom to the top of the image
+        unsigned int row = (m_bmih.biHeight < 0) ? m_height - 1 - i : i;
+        const unsigned char* src = a_data + (size_t)row * m_padWidth;
+        unsigned char* dst = m_pBitmap + (size_t)i * m_byteWidth;
+        unsigned char* end = dst + m_byteWidth;
+
+        //transfer the data
+        for (; dst < end; dst += 3, src += 3)
         {
-            //jump over the padding at the start of a new line
-            if(((i+1) % m_padWidth) == 0)
-            {
-                i+=offset;
-            }
-
-            //transfer the data
-            *(m_pBitmap + j + 2) =* (tempData + i);
-            *(m_pBitmap + j + 1) =* (tempData + i + 1);
-            *(m_pBitmap + j)     =*   (tempData + i + 2);
-            j-=3;
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
         }
     }
 
@@ -304,66 +265,30 @@ bool cFileLoaderBMP::convert24(char* tempData)
 /*!
     Convert format from GBR to RGB - 8bits images
 
-    \fn        bool cFileLoaderBMP::convert8(char* tempData)
+    \fn        bool cFileLoaderBMP::convert8(const unsigned char* a_data)
+    \param     a_data  Image data of the file.
 */
 //===========================================================================
-bool cFileLoaderBMP::convert8(char* tempData)
+bool cFileLoaderBMP::convert8(const unsigned char* a_data)
 {
-	int offset,diff;
-	diff = m_width * m_height * RGB_BYTE_SIZE;
-
     //allocate the buffer for the final image data
-    m_pBitmap = new unsigned char[diff];
+    m_pBitmap = new unsigned char[(size_t)m_width * m_height * RGB_BYTE_SIZE];
 
-    //exit if there is not enough memory
-    if(m_pBitmap == NULL)
+    for (unsigned int i=0; i<m_height; i++)
     {
-        m_errorMsg = "Not enough memory to allocate an image buffer";
-        delete[] m_pBitmap;
-        return (false);
-    }
-
-    if(m_height > 0)
-    {
-        offset = m_padWidth - m_byteWidth;
-        int j=0;
-
-        //count backwards so you start at the front of the image
-        for(unsigned int i=0; i<m_dataSize*RGB_BYTE_SIZE; i+=3)
-        {
-            //jump over the padding at the start of a new line
-            if(((i+1) % m_padWidth) == 0)
-            {
-                i+=offset;
-            }
-
-            //transfer the data
-            *(m_pBitmap+i)   = m_colors[*(tempData + j)].rgbRed;
-            *(m_pBitmap+i+1) = m_colors[*(tempData + j)].rgbGreen;
-            *(m_pBitmap+i+2) = m_colors[*(tempData + j)].rgbBlue;
-            j++;
-        }
-    }
-
-    //image parser for a forward image
-    else
-    {
-        offset = m_padWidth - m_byteWidth;
-        int j = m_dataSize - 1;
-
-        //count backwards so you start at the front of the image
-        for(unsigned int i=0; i<m_dataSize*RGB_BYTE_SIZE; i+=3)
+        // rows are stored from the bottom to the top of the image
+        unsigned int row = (m_bmih.biHeight < 0) ? m_height - 1 - i : i;
+        const unsigned char* src = a_data + (size_t)row * m_padWidth;
+        const unsigned char* end = src + m_width;
+        unsigned char* dst = m_pBitmap + (size_t)i * m_width * RGB_BYTE_SIZE;
+
+        //transfer the data
+        for (; src < end; src++, dst += 3)
         {
-            //jump over the padding at the start of a new line
-            if(((i+1) % m_padWidth) == 0)
-            {
-                i+=offset;
-            }
-            //transfer the data
-            *(m_pBitmap + i)     = m_colors[*(tempData + j)].rgbRed;
-            *(m_pBitmap + i + 1) = m_colors[*(tempData + j)].rgbGreen;
-            *(m_pBitmap + i + 2) = m_colors[*(tempData + j)].rgbBlue;
-            j--;
+            const RGBQUAD& color = m_colors[*src];
+            dst[0] = color.rgbRed;
+            dst[1] = color.rgbGreen;
+            dst[2] = color.rgbBlue;
         }
     }
 
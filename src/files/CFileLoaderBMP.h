@@ -201,10 +201,10 @@ class cFileLoaderBMP
     void reset(void);
 
     //! convert bitmap from GBR to RGB. 24 bits images.
-    bool convert24(char *);
+    bool convert24(const unsigned char* a_data);
 
     //! convert bitmap from GBR to RGB. 8 bits images.
-    bool convert8(char *);
+    bool convert8(const unsigned char* a_data);
 };
 
 //---------------------------------------------------------------------------
@@ -21,10 +21,108 @@
 
 //---------------------------------------------------------------------------
 #include "files/CFileLoaderOBJ.h"
+#include "files/CMappedFile.h"
+#include "timers/CThreadPool.h"
+#include <stdlib.h>
+#include <limits.h>
+#include <algorithm>
 //---------------------------------------------------------------------------
 bool g_objLoaderShouldGenerateExtraVertices = false;
+bool g_objLoaderUseParallelParsing = true;
+cThreadPool* g_objLoaderThreadPool = NULL;
 //---------------------------------------------------------------------------
 
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+// define snprintf alternative in non-posix environments
+#if defined(_WIN32)
+#define snprintf _snprintf
+#endif
+
+//! Hash map from the vertex/normal/texture sets of a mesh to its vertices.
+class cOBJVertexMap
+{
+  public:
+
+    cOBJVertexMap() : m_count(0) {}
+
+    // return the vertex of a set, adding it to the vertices of the mesh if needed
+    unsigned int getVertexIndex(const vertexIndexSet& a_vis)
+    {
+        // keep the table at most half full
+        if (2 * (m_count + 1) > m_slots.size()) { grow(); }
+
+        unsigned int mask = (unsigned int)(m_slots.size() - 1);
+        unsigned int slot = hash(a_vis) & mask;
+        while (m_slots[slot].m_index != (unsigned int)-1)
+        {
+            const cOBJVertexSlot& entry = m_slots[slot];
+            if ((entry.m_vis.vIndex == a_vis.vIndex) &&
+                (entry.m_vis.nIndex == a_vis.nIndex) &&
+                (entry.m_vis.tIndex == a_vis.tIndex))
+            {
+                return (entry.m_index);
+            }
+            slot = (slot + 1) & mask;
+        }
+
+        // first time we see this set: add a new vertex
+        unsigned int index = (unsigned int)m_vertices.size();
+        m_vertices.push_back(a_vis);
+        m_slots[slot].m_vis = a_vis;
+        m_slots[slot].m_index = index;
+        m_count++;
+        return (index);
+    }
+
+    // vertices of the mesh, as the sets they were created from
+    vector<vertexIndexSet> m_vertices;
+
+    // vertex indices of the triangles of the mesh
+    vector<unsigned int> m_triangles;
+
+  private:
+
+    struct cOBJVertexSlot
+    {
+        vertexIndexSet m_vis;
+        unsigned int m_index;
+    };
+
+    static unsigned int hash(const vertexIndexSet& a_vis)
+    {
+        return ((unsigned int)a_vis.vIndex * 73856093u) ^
+               ((unsigned int)a_vis.nIndex * 19349663u) ^
+               ((unsigned int)a_vis.tIndex * 83492791u);
+    }
+
+    void grow()
+    {
+        vector<cOBJVertexSlot> slots;
+        slots.swap(m_slots);
+
+        unsigned int size = 64;
+        while (size < 4 * (m_count + 1)) { size *= 2; }
+        cOBJVertexSlot empty;
+        empty.m_index = (unsigned int)-1;
+        m_slots.assign(size, empty);
+
+        unsigned int mask = size - 1;
+        for (unsigned int i=0; i<slots.size(); i++)
+        {
+            if (slots[i].m_index == (unsigned int)-1) { continue; }
+            unsigned int slot = hash(slots[i].m_vis) & mask;
+            while (m_slots[slot].m_index != (unsigned int)-1) { slot = (slot + 1) & mask; }
+            m_slots[slot] = slots[i];
+        }
+    }
+
+    vector<cOBJVertexSlot> m_slots;
+    unsigned int m_count;
+};
+
+#endif  // DOXYGEN_SHOULD_SKIP_THIS
+
 //===========================================================================
 /*!
     Load a Wavefront OBJ file format image into a mesh.
@@ -87,12 +185,13 @@ bool cLoadFileOBJ(cMesh* a_mesh, const string& a_fileName)
 
             // get next material
             cMaterial newMaterial;
-            cMaterialInfo material = fileObj.m_pMaterials[i];
+            cMaterialInfo& material = fileObj.m_materials[i];
 
             int textureId = material.m_textureID;
             if (textureId >= 1)
             {
-                cTexture2D *newTexture = world->newTexture();
+                // without a world (see cAsyncLoader), textures are added to a world later
+                cTexture2D *newTexture = (world != NULL) ? world->newTexture() : new cTexture2D();
                 int result = newTexture->loadFromFile(material.m_texture);
 
                 // If this didn't work out, try again in the obj file's path
@@ -120,6 +219,7 @@ bool cLoadFileOBJ(cMesh* a_mesh, const string& a_fileName)
                     #if defined(_WIN32)
                     // CHAI_DEBUG_PRINT("Could not load texture map %s\n",material.m_texture);
                     #endif
+                    if (world == NULL) { delete newTexture; }
                 }
             }
 
@@ -171,14 +271,14 @@ bool cLoadFileOBJ(cMesh* a_mesh, const string& a_fileName)
     }
 
     // Keep track of vertex mapping in each mesh; maps "old" vertices
-    // to new vertices
+    // to new vertices. The vertices and triangles of each mesh are collected
+    // first, then each mesh is built in one step.
     int nMeshes = a_mesh->getNumChildren();
-    vertexIndexSet_uint_map* vertexMaps = new vertexIndexSet_uint_map[nMeshes];
-    vertexIndexSet_uint_map::iterator vertexMapIter;
+    cOBJVertexMap* vertexMaps = new cOBJVertexMap[nMeshes];
 
     // build object
     {
-        int i = 0;
+        int numVertices = (int)fileObj.m_vertices.size();
 
         // get triangles
         int numTriangles = fileObj.m_OBJInfo.m_faceCount;
@@ -186,7 +286,9 @@ bool cLoadFileOBJ(cMesh* a_mesh, const string& a_fileName)
         while (j < numTriangles)
         {
             // get next face
-            cFace face = fileObj.m_pFaces[j];
+            const cOBJFace& face = fileObj.m_faces[j];
+            const cOBJCorner* corners = &fileObj.m_corners[face.m_firstCorner];
+            j++;
 
             // get material index attributed to the face
             int objIndex = face.m_materialIndex;
@@ -202,93 +304,115 @@ bool cLoadFileOBJ(cMesh* a_mesh, const string& a_fileName)
             }
 
             // get the vertex map for this mesh
-            vertexIndexSet_uint_map* curVertexMap = &(vertexMaps[objIndex]);
+            cOBJVertexMap* curVertexMap = &(vertexMaps[objIndex]);
 
             // number of vertices on face
             int vertCount = face.m_numVertices;
 
-            if (vertCount >= 3) 
+            // skip faces referring to vertices that are not defined
+            bool valid = (vertCount >= 3);
+            for (int k=0; k<vertCount; k++)
+            {
+                if ((corners[k].m_vertexIndex < 0) || (corners[k].m_vertexIndex >= numVertices))
+                {
+                    valid = false;
+                }
+            }
+
+            if (valid) 
             {
-                int indexV1 = face.m_pVertexIndices[0];
+                unsigned int indexV1 = 0;
 
                 if (g_objLoaderShouldGenerateExtraVertices==false) 
                 {
-                    vertexIndexSet vis(indexV1);
-                    if (numNormals  > 0) vis.nIndex = face.m_pNormalIndices[0];
-                    if (numTexCoord > 0) vis.tIndex = face.m_pTextureIndices[0];
-                    indexV1 = getVertexIndex(curMesh, &fileObj, curVertexMap, vis);
+                    vertexIndexSet vis(corners[0].m_vertexIndex);
+                    if (numNormals  > 0) vis.nIndex = corners[0].m_normalIndex;
+                    if (numTexCoord > 0) vis.tIndex = corners[0].m_texCoordIndex;
+                    indexV1 = curVertexMap->getVertexIndex(vis);
                 }                
 
                 for (int triangleVert = 2; triangleVert < vertCount; triangleVert++)
                 {
-                    int indexV2 = face.m_pVertexIndices[triangleVert-1];
-                    int indexV3 = face.m_pVertexIndices[triangleVert];
+                    const cOBJCorner& corner1 = corners[triangleVert-1];
+                    const cOBJCorner& corner2 = corners[triangleVert];
+                    unsigned int indexV2, indexV3;
+
                     if (g_objLoaderShouldGenerateExtraVertices==false) 
                     {
-                        vertexIndexSet vis(indexV2);
-                        if (numNormals  > 0) vis.nIndex = face.m_pNormalIndices[triangleVert-1];
-                        if (numTexCoord > 0) vis.tIndex = face.m_pTextureIndices[triangleVert-1];
-                        indexV2 = getVertexIndex(curMesh, &fileObj, curVertexMap, vis);
-                        vis.vIndex = indexV3;
-                        if (numNormals  > 0) vis.nIndex = face.m_pNormalIndices[triangleVert];
-                        if (numTexCoord > 0) vis.tIndex = face.m_pTextureIndices[triangleVert];
-                        indexV3 = getVertexIndex(curMesh, &fileObj, curVertexMap, vis);
+                        vertexIndexSet vis(corner1.m_vertexIndex);
+                        if (numNormals  > 0) vis.nIndex = corner1.m_normalIndex;
+                        if (numTexCoord > 0) vis.tIndex = corner1.m_texCoordIndex;
+                        indexV2 = curVertexMap->getVertexIndex(vis);
+                        vis.vIndex = corner2.m_vertexIndex;
+                        if (numNormals  > 0) vis.nIndex = corner2.m_normalIndex;
+                        if (numTexCoord > 0) vis.tIndex = corner2.m_texCoordIndex;
+                        indexV3 = curVertexMap->getVertexIndex(vis);
                     }                      
-
-                    // For debugging, I want to look for degenerate triangles, but
-                    // I don't want to assert here.
-                    if (indexV1 == indexV2 || indexV2 == indexV3 || indexV1 == indexV3) 
-                    {  
-                    }
-
-                    unsigned int indexTriangle;
-
-                    // create triangle:
-                    if (g_objLoaderShouldGenerateExtraVertices==false) 
-                    {                    
-                        indexTriangle =
-                        curMesh->newTriangle(indexV1,indexV2,indexV3);
-                    }
                     else 
                     {
-                        indexTriangle =
-                        curMesh->newTriangle(
-                        fileObj.m_pVertices[indexV1],
-                        fileObj.m_pVertices[indexV2],
-                        fileObj.m_pVertices[indexV3]
-                        );
+                        // three new vertices per triangle
+                        vector<vertexIndexSet>& vertices = curVertexMap->m_vertices;
+                        indexV1 = (unsigned int)vertices.size();
+                        vertices.push_back(vertexIndexSet(corners[0].m_vertexIndex, corners[0].m_normalIndex, corners[0].m_texCoordIndex));
+                        indexV2 = indexV1 + 1;
+                        vertices.push_back(vertexIndexSet(corner1.m_vertexIndex, corner1.m_normalIndex, corner1.m_texCoordIndex));
+                        indexV3 = indexV1 + 2;
+                        vertices.push_back(vertexIndexSet(corner2.m_vertexIndex, corner2.m_normalIndex, corner2.m_texCoordIndex));
                     }
-                    
-                    cTriangle* curTriangle = curMesh->getTriangle(indexTriangle,false);
 
-                    // assign normals:
-                    if (numNormals > 0)
-                    {
-                        // set normals
-                        curTriangle->getVertex0()->setNormal(face.m_pNormals[0]);
-                        curTriangle->getVertex1()->setNormal(face.m_pNormals[triangleVert-1]);
-                        curTriangle->getVertex2()->setNormal(face.m_pNormals[triangleVert]);
-                    }
+                    // create triangle:
+                    vector<unsigned int>& triangles = curVertexMap->m_triangles;
+                    triangles.push_back(indexV1);
+                    triangles.push_back(indexV2);
+                    triangles.push_back(indexV3);
+                }
+            }
+        }
 
-                    // assign texture coordinates
-                    if (numTexCoord > 0)
-                    {
-                        // set texture coordinates
-                        curTriangle->getVertex0()->setTexCoord(face.m_pTexCoords[0]);
-                        curTriangle->getVertex1()->setTexCoord(face.m_pTexCoords[triangleVert-1]);
-                        curTriangle->getVertex2()->setTexCoord(face.m_pTexCoords[triangleVert]);
-                    }
+        // build each mesh from its vertices and triangles
+        for (int i=0; i<nMeshes; i++)
+        {
+            const vector<vertexIndexSet>& sets = vertexMaps[i].m_vertices;
+            const vector<unsigned int>& triangles = vertexMaps[i].m_triangles;
+            if (triangles.empty()) { continue; }
+
+            cMesh* curMesh = (cMesh*)a_mesh->getChild(i);
+            unsigned int numMeshTriangles = (unsigned int)(triangles.size() / 3);
+            curMesh->reserve(curMesh->getNumVertices() + (unsigned int)sets.size(),
+                             curMesh->getNumTriangles() + numMeshTriangles);
+            unsigned int firstVertex = curMesh->appendVertices((unsigned int)sets.size());
+            vector<cVertex>& vertices = *(curMesh->pVertices());
+
+            for (unsigned int k=0; k<sets.size(); k++)
+            {
+                const vertexIndexSet& vis = sets[k];
+                cVertex& vertex = vertices[firstVertex + k];
+                vertex.setPos(fileObj.m_vertices[vis.vIndex]);
+
+                // assign normals
+                if ((vis.nIndex >= 0) && (vis.nIndex < numNormals))
+                {
+                    vertex.setNormal(fileObj.m_normals[vis.nIndex]);
+                }
+
+                // assign texture coordinates
+                if ((vis.tIndex >= 0) && (vis.tIndex < numTexCoord))
+                {
+                    vertex.setTexCoord(fileObj.m_texCoords[vis.tIndex]);
                 }
             }
-            else 
+
+            if (firstVertex == 0)
             {
-              // This faces doesn't have 3 vertices... this line is just
-              // here for debugging, since this should never happen, but
-              // I don't want to assert here.         
+                curMesh->appendTriangles(&triangles[0], numMeshTriangles);
+            }
+            else
+            {
+                vector<unsigned int> indices(triangles);
+                for (unsigned int k=0; k<indices.size(); k++) { indices[k] += firstVertex; }
+                curMesh->appendTriangles(&indices[0], numMeshTriangles);
             }
-            j++;
         }
-        i++;
     }
 
     delete [] vertexMaps;
@@ -318,37 +442,302 @@ bool cLoadFileOBJ(cMesh* a_mesh, const string& a_fileName)
 // OBJ PARSER IMPLEMENTATION:
 //===========================================================================
 
-cOBJModel::cOBJModel()
+// powers of ten that are exact in double precision
+static const double s_powersOfTen[23] =
 {
-    m_pVertices = NULL;
-    m_pFaces = NULL;
-    m_pNormals = NULL;
-    m_pTexCoords = NULL;
-    m_pMaterials = NULL;
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+//---------------------------------------------------------------------------
+
+static inline bool is_space(const char a_c)
+{
+    return ((a_c == ' ') || (a_c == '\t') || (a_c == '\r'));
 }
 
 //---------------------------------------------------------------------------
 
-cOBJModel::~cOBJModel()
+static inline const char* skip_spaces(const char* a_p, const char* a_end)
 {
-    if (m_pVertices) delete [] m_pVertices;
-    if (m_pNormals) delete [] m_pNormals;
-    if (m_pTexCoords) delete [] m_pTexCoords;
-    if (m_pMaterials) delete [] m_pMaterials;
-    if (m_pFaces)
+    while ((a_p < a_end) && is_space(*a_p)) { a_p++; }
+    return (a_p);
+}
+
+//---------------------------------------------------------------------------
+
+static inline const char* skip_token(const char* a_p, const char* a_end)
+{
+    while ((a_p < a_end) && !is_space(*a_p)) { a_p++; }
+    return (a_p);
+}
+
+//---------------------------------------------------------------------------
+
+// compare a token [a_begin, a_end) with an identifier
+static inline bool is_token(const char* a_begin, const char* a_end, const char* a_id)
+{
+    const char* p = a_begin;
+    while ((p < a_end) && (*a_id != '\0') && (*p == *a_id)) { p++; a_id++; }
+    return ((p == a_end) && (*a_id == '\0'));
+}
+
+//---------------------------------------------------------------------------
+
+// parse a float at a_p and advance a_p after it. The value is computed as
+// a double and then rounded to float, so it matches scanf("%f") except in
+// rare double-rounding cases; numbers with more than 15 significant digits
+// or large exponents go through strtod().
+static bool parse_float(const char*& a_p, const char* a_end, float& a_value)
+{
+    const char* p = skip_spaces(a_p, a_end);
+    const char* start = p;
+
+    bool negative = false;
+    if ((p < a_end) && ((*p == '-') || (*p == '+')))
+    {
+        negative = (*p == '-');
+        p++;
+    }
+
+    double mantissa = 0.0;
+    int numDigits = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+    bool exact = true;
+
+    // integer part
+    while ((p < a_end) && (*p >= '0') && (*p <= '9'))
     {
-        for (unsigned int i=0; i<m_OBJInfo.m_faceCount; i++)
+        anyDigit = true;
+        if ((numDigits > 0) || (*p != '0'))
         {
-            // Delete every pointer in the face structure
-            if (m_pFaces[i].m_pNormals) delete [] m_pFaces[i].m_pNormals;
-            if (m_pFaces[i].m_pNormalIndices) delete [] m_pFaces[i].m_pNormalIndices;
-            if (m_pFaces[i].m_pTexCoords)  delete [] m_pFaces[i].m_pTexCoords;
-            if (m_pFaces[i].m_pTextureIndices) delete [] m_pFaces[i].m_pTextureIndices;
-            if (m_pFaces[i].m_pVertices)  delete [] m_pFaces[i].m_pVertices;
-            if (m_pFaces[i].m_pVertexIndices)  delete [] m_pFaces[i].m_pVertexIndices;
+            if (numDigits < 15) { mantissa = 10.0 * mantissa + (*p - '0'); numDigits++; }
+            else { exact = false; exponent++; }
         }
-        delete [] m_pFaces;
+        p++;
     }
+
+    // fractional part
+    if ((p < a_end) && (*p == '.'))
+    {
+        p++;
+        while ((p < a_end) && (*p >= '0') && (*p <= '9'))
+        {
+            anyDigit = true;
+            if ((numDigits > 0) || (*p != '0'))
+            {
+                if (numDigits < 15) { mantissa = 10.0 * mantissa + (*p - '0'); numDigits++; exponent--; }
+                else { exact = false; }
+            }
+            else
+            {
+                exponent--;
+            }
+            p++;
+        }
+    }
+    if (!anyDigit) { return (false); }
+
+    // exponent
+    if ((p < a_end) && ((*p == 'e') || (*p == 'E')))
+    {
+        const char* q = p + 1;
+        bool negativeExponent = false;
+        if ((q < a_end) && ((*q == '-') || (*q == '+')))
+        {
+            negativeExponent = (*q == '-');
+            q++;
+        }
+        if ((q < a_end) && (*q >= '0') && (*q <= '9'))
+        {
+            int value = 0;
+            while ((q < a_end) && (*q >= '0') && (*q <= '9'))
+            {
+                if (value < 10000) { value = 10 * value + (*q - '0'); }
+                q++;
+            }
+            exponent += negativeExponent ? -value : value;
+            p = q;
+        }
+    }
+
+    // an exact mantissa and power of ten give a correctly rounded double,
+    // and rounding it to float is then also correct
+    if (exact && (exponent >= -22) && (exponent <= 22))
+    {
+        double value = (exponent < 0) ? (mantissa / s_powersOfTen[-exponent]) :
+                                        (mantissa * s_powersOfTen[exponent]);
+        a_value = (float)(negative ? -value : value);
+    }
+    else if (mantissa == 0.0)
+    {
+        a_value = negative ? -0.0f : 0.0f;
+    }
+    else
+    {
+        char buffer[CHAI_OBJ_MAX_STR_SIZE];
+        size_t length = (size_t)(p - start);
+        if (length >= sizeof(buffer)) { length = sizeof(buffer) - 1; }
+        memcpy(buffer, start, length);
+        buffer[length] = '\0';
+        a_value = (float)strtod(buffer, NULL);
+    }
+
+    a_p = p;
+    return (true);
+}
+
+//---------------------------------------------------------------------------
+
+// parse a signed integer at a_p and advance a_p after it
+static bool parse_int(const char*& a_p, const char* a_end, int& a_value)
+{
+    const char* p = a_p;
+    bool negative = false;
+    if ((p < a_end) && ((*p == '-') || (*p == '+')))
+    {
+        negative = (*p == '-');
+        p++;
+    }
+    if ((p >= a_end) || (*p < '0') || (*p > '9')) { return (false); }
+
+    // saturate long digit runs; such an index is then out of range
+    int value = 0;
+    while ((p < a_end) && (*p >= '0') && (*p <= '9'))
+    {
+        int digit = *p - '0';
+        if (value > (INT_MAX - digit) / 10)
+        {
+            value = INT_MAX;
+        }
+        else
+        {
+            value = 10 * value + digit;
+        }
+        p++;
+    }
+    a_value = negative ? -value : value;
+    a_p = p;
+    return (true);
+}
+
+//---------------------------------------------------------------------------
+
+// convert a one-based (or negative, relative) OBJ index to a zero-based one
+static inline int resolve_index(const int a_index, const unsigned int a_count)
+{
+    if (a_index > 0) { return (a_index - 1); }
+    if (a_index < 0) { return ((int)a_count + a_index); }
+    return (-1);
+}
+
+//---------------------------------------------------------------------------
+
+// parse up to three floats of a line into a vector (missing ones are zero)
+static cVector3d parse_vector(const char* a_p, const char* a_end)
+{
+    float value[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i=0; i<3; i++)
+    {
+        if (!parse_float(a_p, a_end, value[i])) { break; }
+    }
+    return (cVector3d(value[0], value[1], value[2]));
+}
+
+//---------------------------------------------------------------------------
+
+// copy the parameter of a token, without leading spaces and line ending
+static void copy_parameter(const char* a_p, const char* a_end,
+                           char a_str[], const unsigned int a_strSize)
+{
+    while ((a_p < a_end) && (*a_p == ' ')) { a_p++; }
+    while ((a_end > a_p) && ((a_end[-1] == '\r') || (a_end[-1] == '\n'))) { a_end--; }
+
+    size_t length = (size_t)(a_end - a_p);
+    if (length >= a_strSize) { length = a_strSize - 1; }
+    memcpy(a_str, a_p, length);
+    a_str[length] = '\0';
+}
+
+//---------------------------------------------------------------------------
+
+// statements of an OBJ file which change the state applied to the next faces
+enum cOBJStatementType
+{
+    CHAI_OBJ_STATEMENT_GROUP,
+    CHAI_OBJ_STATEMENT_USE_MTL,
+    CHAI_OBJ_STATEMENT_MTL_LIB
+};
+
+// a group or material statement, found before face m_faceIndex of its chunk
+struct cOBJStatement
+{
+    cOBJStatementType m_type;
+
+    // parameter of the statement in the mapped file
+    const char* m_begin;
+    const char* m_end;
+
+    unsigned int m_faceIndex;
+
+    // material and group of the faces following the statement
+    unsigned int m_materialIndex;
+    int m_groupIndex;
+};
+
+// part of an OBJ file, starting and ending at a line boundary
+struct cOBJChunk
+{
+    const char* m_begin;
+    const char* m_end;
+
+    // data parsed from the chunk
+    vector<cVector3d> m_vertices;
+    vector<cVector3d> m_normals;
+    vector<cVector3d> m_texCoords;
+    vector<cOBJFace> m_faces;
+    vector<cOBJCorner> m_corners;
+    vector<cOBJStatement> m_statements;
+
+    // corners holding negative indices, resolved relative to the start of
+    // the chunk: 3 * corner + 0 (vertex), 1 (normal) or 2 (texture coordinate)
+    vector<unsigned int> m_relativeIndices;
+
+    // number of faces and corners parsed
+    unsigned int m_numFaces;
+    unsigned int m_numCorners;
+
+    // position of the chunk data in the model arrays
+    unsigned int m_firstVertex;
+    unsigned int m_firstNormal;
+    unsigned int m_firstTexCoord;
+    unsigned int m_firstFace;
+    unsigned int m_firstCorner;
+
+    // material and group of the first faces of the chunk
+    unsigned int m_materialIndex;
+    int m_groupIndex;
+};
+
+// description of the chunk tasks run on the thread pool
+struct cOBJParseTask
+{
+    cOBJModel* m_model;
+    cOBJChunk* m_chunks;
+};
+
+//---------------------------------------------------------------------------
+
+cOBJModel::cOBJModel()
+{
+    memset(&m_OBJInfo, 0, sizeof(cOBJFileInfo));
+}
+
+//---------------------------------------------------------------------------
+
+cOBJModel::~cOBJModel()
+{
     for(unsigned int i=0; i<m_groupNames.size(); i++) {
       delete [] m_groupNames[i];
     }
@@ -359,350 +748,487 @@ cOBJModel::~cOBJModel()
 bool cOBJModel::LoadModel(const char a_fileName[])
 {
     //----------------------------------------------------------------------
-    // Load a OBJ file and render its data into a display list
+    // Load a OBJ file in a single pass over its mapped content
     //----------------------------------------------------------------------
 
-    cOBJFileInfo currentIndex;    // Current array index
-    char str[CHAI_OBJ_MAX_STR_SIZE];    // Buffer string for reading the file
     char basePath[CHAI_SIZE_PATH];   // Path were all paths in the OBJ start
-    int nScanReturn = 0;      // Return value of fscanf
-    unsigned int curMaterial = 0; // Current material
 
     // Get base path
-    strcpy(basePath, a_fileName);
+    strncpy(basePath, a_fileName, sizeof(basePath) - 1);
+    basePath[sizeof(basePath) - 1] = '\0';
     makePath(basePath);
 
     //----------------------------------------------------------------------
-    // Open the OBJ file
+    // Map the OBJ file
     //----------------------------------------------------------------------
-    FILE *hFile = fopen(a_fileName, "r");
+    cMappedFile file;
 
     // Success opening file?
-    if (!hFile)
+    if (!file.open(a_fileName))
     {
         return (false);
     }
 
+    m_vertices.clear();
+    m_normals.clear();
+    m_texCoords.clear();
+    m_faces.clear();
+    m_corners.clear();
+    m_materials.clear();
+
     //----------------------------------------------------------------------
-    // Allocate space for structures that hold the model data
+    // Split the file in chunks at line boundaries
     //----------------------------------------------------------------------
+    const char* data = file.getData();
+    size_t size = file.getSize();
+
+    cThreadPool* pool = NULL;
+    unsigned int numChunks = 1;
+    if (g_objLoaderUseParallelParsing && (size >= 2 * CHAI_OBJ_MIN_CHUNK_SIZE))
+    {
+        pool = g_objLoaderThreadPool;
+        if (pool == NULL) { pool = cThreadPool::getDefaultPool(); }
+
+        // a few chunks per thread balance the load between threads; with
+        // no worker thread, splitting would only add the merge copies
+        if (pool->getNumThreads() > 0)
+        {
+            unsigned int maxChunks = 4 * (pool->getNumThreads() + 1);
+            size_t sizeChunks = size / CHAI_OBJ_MIN_CHUNK_SIZE;
+            numChunks = (sizeChunks < maxChunks) ? (unsigned int)sizeChunks : maxChunks;
+        }
+    }
 
-    // Which data types are stored in the file ? How many of each type ?
-    getFileInfo(hFile, &m_OBJInfo, basePath);
-
-    // Vertices and faces
-    if (m_pVertices) delete [] m_pVertices;
-    if (m_pFaces) delete [] m_pFaces;
-    m_pVertices = new cVector3d[m_OBJInfo.m_vertexCount];
-    m_pFaces = new cFace[m_OBJInfo.m_faceCount];
-
-    // Allocate space for optional model data only if present.
-    if (m_pNormals) { delete [] m_pNormals; m_pNormals = NULL; }
-    if (m_pTexCoords) { delete [] m_pTexCoords; m_pTexCoords = NULL; }
-    if (m_pMaterials) { delete [] m_pMaterials; m_pMaterials = NULL; }
-    if (m_OBJInfo.m_normalCount)
-        m_pNormals = new cVector3d[m_OBJInfo.m_normalCount];
-    if (m_OBJInfo.m_texCoordCount)
-        m_pTexCoords = new cVector3d[m_OBJInfo.m_texCoordCount];
-    if (m_OBJInfo.m_materialCount)
-        m_pMaterials = new cMaterialInfo[m_OBJInfo.m_materialCount];
-
-    // Init structure that holds the current array index
-    memset(&currentIndex, 0, sizeof(cOBJFileInfo));
+    vector<cOBJChunk> chunks(numChunks);
+    chunks[0].m_begin = data;
+    for (unsigned int i=1; i<numChunks; i++)
+    {
+        const char* split = data + (size_t)(((double)size * i) / numChunks);
+        const char* lineEnd = (const char*)memchr(split, '\n', (size_t)(data + size - split));
+        split = (lineEnd != NULL) ? (lineEnd + 1) : (data + size);
+        if (split < chunks[i-1].m_begin) { split = chunks[i-1].m_begin; }
+        chunks[i-1].m_end = split;
+        chunks[i].m_begin = split;
+    }
+    chunks[numChunks-1].m_end = data + size;
 
     //----------------------------------------------------------------------
-    // Read the file contents
+    // Parse the chunks
     //----------------------------------------------------------------------
+    cOBJParseTask task;
+    task.m_model = this;
+    task.m_chunks = &chunks[0];
 
-    // Start reading the file from the start
-    rewind(hFile);
+    if (numChunks > 1)
+    {
+        pool->parallelFor(parseChunksTask, &task, numChunks);
+    }
+    else
+    {
+        parseChunksTask(&task, 0, 1);
+    }
+
+    //----------------------------------------------------------------------
+    // Merge the chunks
+    //----------------------------------------------------------------------
 
-    // Quit reading when end of file has been reached
-    while (!feof(hFile))
+    // prefix sums of the chunk sizes give their position in the model
+    unsigned int numVertices = 0, numNormals = 0, numTexCoords = 0;
+    unsigned int numFaces = 0, numCorners = 0;
+    for (unsigned int i=0; i<numChunks; i++)
     {
-        // Get next string
-        readNextString(str, hFile);
+        cOBJChunk& chunk = chunks[i];
+        chunk.m_firstVertex   = numVertices;
+        chunk.m_firstNormal   = numNormals;
+        chunk.m_firstTexCoord = numTexCoords;
+        chunk.m_firstFace     = numFaces;
+        chunk.m_firstCorner   = numCorners;
+        chunk.m_numFaces      = (unsigned int)chunk.m_faces.size();
+        chunk.m_numCorners    = (unsigned int)chunk.m_corners.size();
+        numVertices  += (unsigned int)chunk.m_vertices.size();
+        numNormals   += (unsigned int)chunk.m_normals.size();
+        numTexCoords += (unsigned int)chunk.m_texCoords.size();
+        numFaces     += chunk.m_numFaces;
+        numCorners   += chunk.m_numCorners;
+    }
 
-        // Next three elements are floats of a vertex
-        if (!strncmp(str, CHAI_OBJ_VERTEX_ID, sizeof(CHAI_OBJ_VERTEX_ID)))
-        {
-            // Read three floats out of the file
-            float fx, fy, fz;
-            nScanReturn = fscanf(hFile, "%f %f %f", &fx, &fy, &fz);
+    // material libraries, materials and groups are applied in file order
+    applyStatements(chunks, basePath);
 
-            m_pVertices[currentIndex.m_vertexCount].x = fx;
-            m_pVertices[currentIndex.m_vertexCount].y = fy;
-            m_pVertices[currentIndex.m_vertexCount].z = fz;
+    if (numChunks > 1)
+    {
+        m_vertices.resize(numVertices, cVector3d(0.0, 0.0, 0.0));
+        m_normals.resize(numNormals, cVector3d(0.0, 0.0, 0.0));
+        m_texCoords.resize(numTexCoords, cVector3d(0.0, 0.0, 0.0));
+        m_faces.resize(numFaces);
+        m_corners.resize(numCorners);
 
-            // Next vertex
-            currentIndex.m_vertexCount++;
-        }
+        pool->parallelFor(mergeChunksTask, &task, numChunks);
+    }
+    else
+    {
+        // a single chunk already holds the model arrays
+        m_vertices.swap(chunks[0].m_vertices);
+        m_normals.swap(chunks[0].m_normals);
+        m_texCoords.swap(chunks[0].m_texCoords);
+        m_faces.swap(chunks[0].m_faces);
+        m_corners.swap(chunks[0].m_corners);
+
+        mergeChunksTask(&task, 0, 1);
+    }
 
-        // Next two elements are floats of a texture coordinate
-        if (!strncmp(str, CHAI_OBJ_TEXCOORD_ID, sizeof(CHAI_OBJ_TEXCOORD_ID)))
-        {
-            // Read two floats out of the file
-            float fx, fy, fz;
-            nScanReturn = fscanf(hFile, "%f %f %f", &fx, &fy, &fz);
+    m_OBJInfo.m_vertexCount   = (unsigned int)m_vertices.size();
+    m_OBJInfo.m_texCoordCount = (unsigned int)m_texCoords.size();
+    m_OBJInfo.m_normalCount   = (unsigned int)m_normals.size();
+    m_OBJInfo.m_faceCount     = (unsigned int)m_faces.size();
+    m_OBJInfo.m_materialCount = (unsigned int)m_materials.size();
 
-            m_pTexCoords[currentIndex.m_texCoordCount].x = fx;
-            m_pTexCoords[currentIndex.m_texCoordCount].y = fy;
-            m_pTexCoords[currentIndex.m_texCoordCount].z = fz;
+    //----------------------------------------------------------------------
+    // Success
+    //----------------------------------------------------------------------
 
-            // Next texture coordinate
-            currentIndex.m_texCoordCount++;
-        }
+    return (true);
+}
 
-        // Next three elements are floats of a vertex normal
-        if (!strncmp(str, CHAI_OBJ_NORMAL_ID, sizeof(CHAI_OBJ_NORMAL_ID)))
-        {
-            // Read three floats out of the file
-            float fx, fy, fz;
-            nScanReturn = fscanf(hFile, "%f %f %f", &fx, &fy, &fz);
+//---------------------------------------------------------------------------
+
+void cOBJModel::parseChunksTask(void* a_data, unsigned int a_begin, unsigned int a_end)
+{
+    cOBJParseTask* task = (cOBJParseTask*)a_data;
+    for (unsigned int i=a_begin; i<a_end; i++)
+    {
+        parseChunk(task->m_chunks[i]);
+    }
+}
+
+//---------------------------------------------------------------------------
 
-            m_pNormals[currentIndex.m_normalCount].x = fx;
-            m_pNormals[currentIndex.m_normalCount].y = fy;
-            m_pNormals[currentIndex.m_normalCount].z = fz;
+void cOBJModel::mergeChunksTask(void* a_data, unsigned int a_begin, unsigned int a_end)
+{
+    cOBJParseTask* task = (cOBJParseTask*)a_data;
+    for (unsigned int i=a_begin; i<a_end; i++)
+    {
+        task->m_model->mergeChunk(task->m_chunks[i]);
+    }
+}
 
-            // Next normal
-            currentIndex.m_normalCount++;
+//---------------------------------------------------------------------------
+
+void cOBJModel::parseChunk(cOBJChunk& a_chunk)
+{
+    //----------------------------------------------------------------------
+    // Parse the lines of a chunk of an OBJ file
+    //----------------------------------------------------------------------
+
+    // a face line has at least 6 bytes; reserve for a typical mix of
+    // vertex and face lines to limit the reallocations of large files
+    size_t reserve = (size_t)(a_chunk.m_end - a_chunk.m_begin) / 64;
+    a_chunk.m_vertices.reserve(reserve);
+    a_chunk.m_faces.reserve(reserve);
+    a_chunk.m_corners.reserve(3 * reserve);
+
+    const char* line = a_chunk.m_begin;
+    const char* end = a_chunk.m_end;
+    while (line < end)
+    {
+        // find the end of the line
+        const char* lineEnd = (const char*)memchr(line, '\n', (size_t)(end - line));
+        if (lineEnd == NULL) { lineEnd = end; }
+
+        // get the identifier of the line
+        const char* token = skip_spaces(line, lineEnd);
+        const char* tokenEnd = skip_token(token, lineEnd);
+        line = lineEnd + 1;
+
+        if (token == tokenEnd) { continue; }
+
+        // Next three elements are floats of a vertex
+        if (is_token(token, tokenEnd, CHAI_OBJ_VERTEX_ID))
+        {
+            a_chunk.m_vertices.push_back(parse_vector(tokenEnd, lineEnd));
         }
 
         // Rest of the line contains face information
-        if (!strncmp(str, CHAI_OBJ_FACE_ID, sizeof(CHAI_OBJ_FACE_ID)))
+        else if (is_token(token, tokenEnd, CHAI_OBJ_FACE_ID))
         {
-            // Read the rest of the line (the complete face)
-            getTokenParameter(str, sizeof(str) ,hFile);
-
-            // Convert string into a face structure
-            parseFaceString(str, &m_pFaces[currentIndex.m_faceCount],
-            m_pVertices, m_pNormals, m_pTexCoords, curMaterial);
-            
-            // Next face
-            currentIndex.m_faceCount++;
+            parseFace(tokenEnd, lineEnd, a_chunk);
         }
 
-        // Rest of the line contains face information
-        if (!strncmp(str, CHAI_OBJ_NAME_ID, sizeof(CHAI_OBJ_NAME_ID)))
+        // Next three elements are floats of a vertex normal (used normalized)
+        else if (is_token(token, tokenEnd, CHAI_OBJ_NORMAL_ID))
         {
-            // Read the rest of the line (the complete face)
-            getTokenParameter(str, sizeof(str) ,hFile);
+            cVector3d normal = parse_vector(tokenEnd, lineEnd);
+            normal.normalize();
+            a_chunk.m_normals.push_back(normal);
+        }
 
-            char* name = new char[strlen(str)+1];
-            strcpy(name,str);
-            m_groupNames.push_back(name);
+        // Next two or three elements are floats of a texture coordinate
+        else if (is_token(token, tokenEnd, CHAI_OBJ_TEXCOORD_ID))
+        {
+            a_chunk.m_texCoords.push_back(parse_vector(tokenEnd, lineEnd));
         }
 
-        // Process material information only if needed
-        if (m_pMaterials)
+        // Group names, materials and material libraries are applied
+        // once all chunks are parsed
+        else
         {
-            // Rest of the line contains the name of a material
-            if (!strncmp(str, CHAI_OBJ_USE_MTL_ID, sizeof(CHAI_OBJ_USE_MTL_ID)))
+            cOBJStatement statement;
+            if (is_token(token, tokenEnd, CHAI_OBJ_NAME_ID))
             {
-                // Read the rest of the line (the complete material name)
-                getTokenParameter(str, sizeof(str), hFile);
-                // Are any materials loaded ?
-                if (m_pMaterials)
-                {
-                    // Find material array index for the material name
-                    for (unsigned i=0; i<m_OBJInfo.m_materialCount; i++)
-                    if (!strncmp(m_pMaterials[i].m_name, str, sizeof(str)))
-                    {
-                        curMaterial = i;
-                        break;
-                    }
-                }
+                statement.m_type = CHAI_OBJ_STATEMENT_GROUP;
             }
-
-            // Rest of the line contains the filename of a material library
-            if (!strncmp(str, CHAI_OBJ_MTL_LIB_ID, sizeof(CHAI_OBJ_MTL_LIB_ID)))
+            else if (is_token(token, tokenEnd, CHAI_OBJ_USE_MTL_ID))
             {
-                // Read the rest of the line (the complete filename)
-                getTokenParameter(str, sizeof(str), hFile);
-                // Append material library filename to the model's base path
-                char libraryFile[CHAI_SIZE_PATH];
-                strcpy(libraryFile, basePath);
-                strcat(libraryFile, str);
-
-                // Append .mtl
-                //strcat(szLibraryFile, ".mtl");
+                statement.m_type = CHAI_OBJ_STATEMENT_USE_MTL;
+            }
+            else if (is_token(token, tokenEnd, CHAI_OBJ_MTL_LIB_ID))
+            {
+                statement.m_type = CHAI_OBJ_STATEMENT_MTL_LIB;
+            }
 
-                // Load the material library
-                loadMaterialLib(libraryFile, m_pMaterials,
-                    &currentIndex.m_materialCount, basePath);
+            // comments and other statements are ignored
+            else
+            {
+                continue;
             }
+
+            statement.m_begin = tokenEnd;
+            statement.m_end = lineEnd;
+            statement.m_faceIndex = (unsigned int)a_chunk.m_faces.size();
+            a_chunk.m_statements.push_back(statement);
         }
     }
+}
 
-    // Close OBJ file
-    fclose(hFile);
+//---------------------------------------------------------------------------
 
+void cOBJModel::parseFace(const char* a_begin, const char* a_end, cOBJChunk& a_chunk)
+{
     //----------------------------------------------------------------------
-    // Success
+    // Convert a face line of the OBJ file into a face and its corners
     //----------------------------------------------------------------------
 
-    return (true);
+    cOBJFace face;
+    face.m_firstCorner = (unsigned int)a_chunk.m_corners.size();
+    face.m_numVertices = 0;
+
+    // set when the statements are applied
+    face.m_materialIndex = 0;
+    face.m_groupIndex = -1;
+
+    // negative indices are relative to the data parsed so far; they are
+    // resolved within the chunk, then offset when the chunk is merged
+    unsigned int numVertices = (unsigned int)a_chunk.m_vertices.size();
+    unsigned int numNormals = (unsigned int)a_chunk.m_normals.size();
+    unsigned int numTexCoords = (unsigned int)a_chunk.m_texCoords.size();
+
+    const char* p = skip_spaces(a_begin, a_end);
+    while (p < a_end)
+    {
+        // each corner is v, v/t, v//n or v/t/n
+        unsigned int cornerIndex = (unsigned int)a_chunk.m_corners.size();
+        cOBJCorner corner;
+        corner.m_normalIndex = -1;
+        corner.m_texCoordIndex = -1;
+
+        int index;
+        if (parse_int(p, a_end, index))
+        {
+            corner.m_vertexIndex = resolve_index(index, numVertices);
+            if (index < 0) { a_chunk.m_relativeIndices.push_back(3 * cornerIndex); }
+
+            if ((p < a_end) && (*p == '/'))
+            {
+                p++;
+                if (parse_int(p, a_end, index))
+                {
+                    corner.m_texCoordIndex = resolve_index(index, numTexCoords);
+                    if (index < 0) { a_chunk.m_relativeIndices.push_back(3 * cornerIndex + 2); }
+                }
+                if ((p < a_end) && (*p == '/'))
+                {
+                    p++;
+                    if (parse_int(p, a_end, index))
+                    {
+                        corner.m_normalIndex = resolve_index(index, numNormals);
+                        if (index < 0) { a_chunk.m_relativeIndices.push_back(3 * cornerIndex + 1); }
+                    }
+                }
+            }
+            a_chunk.m_corners.push_back(corner);
+            face.m_numVertices++;
+        }
+
+        // next corner
+        p = skip_spaces(skip_token(p, a_end), a_end);
+    }
+
+    a_chunk.m_faces.push_back(face);
 }
 
 //---------------------------------------------------------------------------
 
-void cOBJModel::parseFaceString(char a_faceString[], cFace *a_faceOut,
-                const cVector3d *a_pVertices,
-                const cVector3d *a_pNormals,
-                const cVector3d *a_pTexCoords,
-                const unsigned int a_materialIndex)
+void cOBJModel::applyStatements(vector<cOBJChunk>& a_chunks, const char a_basePath[])
 {
     //----------------------------------------------------------------------
-    // Convert face string from the OBJ file into a face structure
+    // Walk the group and material statements of the file in order
     //----------------------------------------------------------------------
 
-    unsigned int i;
-    int iVertex = 0, iTextureCoord = 0, iNormal = 0;
+    char str[CHAI_OBJ_MAX_STR_SIZE];    // Buffer for names
+    unsigned int curMaterial = 0;       // Current material
+    int curGroup = -1;                  // Current group
 
-    // Pointer to the face string. Will be incremented later to
-    // advance to the next triplet in the string.
-    char *pFaceString = a_faceString;
+    for (unsigned int i=0; i<a_chunks.size(); i++)
+    {
+        cOBJChunk& chunk = a_chunks[i];
+        chunk.m_materialIndex = curMaterial;
+        chunk.m_groupIndex = curGroup;
 
-    // Save the string positions of all triplets
-    int iTripletPos[CHAI_OBJ_MAX_VERTICES];
-    int iCurTriplet = 0;
+        for (unsigned int j=0; j<chunk.m_statements.size(); j++)
+        {
+            cOBJStatement& statement = chunk.m_statements[j];
+            copy_parameter(statement.m_begin, statement.m_end, str, sizeof(str));
+
+            // Rest of the line contains a group name
+            if (statement.m_type == CHAI_OBJ_STATEMENT_GROUP)
+            {
+                char* name = new char[strlen(str)+1];
+                strcpy(name,str);
+                m_groupNames.push_back(name);
+                curGroup = (int)m_groupNames.size() - 1;
+            }
+
+            // Rest of the line contains the name of a material
+            else if (statement.m_type == CHAI_OBJ_STATEMENT_USE_MTL)
+            {
+                // Find material array index for the material name
+                for (unsigned int k=0; k<m_materials.size(); k++)
+                {
+                    if (!strcmp(m_materials[k].m_name, str))
+                    {
+                        curMaterial = k;
+                        break;
+                    }
+                }
+            }
 
-    // Init the face structure
-    memset(a_faceOut, 0, sizeof(cFace));
+            // Rest of the line contains the filename of a material library
+            else
+            {
+                // Append material library filename to the model's base path
+                char libraryFile[CHAI_SIZE_PATH];
+                int length = snprintf(libraryFile, sizeof(libraryFile), "%s%s", a_basePath, str);
 
-    // The first vertex always starts at position 0 in the string
-    iTripletPos[0] = 0;
-    a_faceOut->m_numVertices = 1;
-    iCurTriplet++;
-      
-    if (m_groupNames.size() > 0) a_faceOut->m_groupIndex = m_groupNames.size() - 1;
-    else a_faceOut->m_groupIndex = -1;
+                // A truncated path would open another file
+                if ((length < 0) || (length >= (int)sizeof(libraryFile)))
+                {
+                    CHAI_DEBUG_PRINT("Error: material library path too long: %s%s\n", a_basePath, str);
+                }
 
-    //----------------------------------------------------------------------
-    // Get number of vertices in the face
-    //----------------------------------------------------------------------
+                // Load the material library
+                else
+                {
+                    char basePath[CHAI_SIZE_PATH];
+                    strcpy(basePath, a_basePath);
+                    loadMaterialLib(libraryFile, basePath);
+                }
+            }
 
-    // Loop trough the whole string
-    for (i=0; i<strlen(a_faceString); i++)
-    {
-        // Each triplet is separated by spaces
-        if (a_faceString[i] == ' ')
-        {
-            // One more vertex
-            a_faceOut->m_numVertices++;
-            // Save position of triplet
-            iTripletPos[iCurTriplet] = i;
-            // Next triplet
-            iCurTriplet++;
+            statement.m_materialIndex = curMaterial;
+            statement.m_groupIndex = curGroup;
         }
     }
+}
 
-    // Face has more vertices than spaces that separate them
-    // FaceOut->iNumVertices++;
+//---------------------------------------------------------------------------
 
+void cOBJModel::mergeChunk(cOBJChunk& a_chunk)
+{
     //----------------------------------------------------------------------
-    // Allocate space for structures that hold the face data
+    // Copy the chunk data to the model arrays, which have their final
+    // size, and fix the indices which depend on the chunk position
     //----------------------------------------------------------------------
 
-    // Vertices
-    a_faceOut->m_pVertices = new cVector3d[a_faceOut->m_numVertices];
-    a_faceOut->m_pVertexIndices = new int[a_faceOut->m_numVertices];
-
-    // Allocate space for normals and texture coordinates only if present
-    if (m_pNormals) {
-        a_faceOut->m_pNormals = new cVector3d[a_faceOut->m_numVertices];
-        a_faceOut->m_pNormalIndices = new int[a_faceOut->m_numVertices];
+    // arrays of a single chunk have been swapped into the model already
+    if (!a_chunk.m_vertices.empty())
+    {
+        copy(a_chunk.m_vertices.begin(), a_chunk.m_vertices.end(),
+             m_vertices.begin() + a_chunk.m_firstVertex);
+    }
+    if (!a_chunk.m_normals.empty())
+    {
+        copy(a_chunk.m_normals.begin(), a_chunk.m_normals.end(),
+             m_normals.begin() + a_chunk.m_firstNormal);
     }
-    else {
-        a_faceOut->m_pNormals = 0;
-        a_faceOut->m_pNormalIndices = 0;
+    if (!a_chunk.m_texCoords.empty())
+    {
+        copy(a_chunk.m_texCoords.begin(), a_chunk.m_texCoords.end(),
+             m_texCoords.begin() + a_chunk.m_firstTexCoord);
     }
-        
-    if (m_pTexCoords) {  
-        a_faceOut->m_pTexCoords = new cVector3d[a_faceOut->m_numVertices];
-        a_faceOut->m_pTextureIndices = new int[a_faceOut->m_numVertices];
+    if (!a_chunk.m_faces.empty())
+    {
+        copy(a_chunk.m_faces.begin(), a_chunk.m_faces.end(),
+             m_faces.begin() + a_chunk.m_firstFace);
     }
-    else {
-        a_faceOut->m_pTexCoords = 0;
-        a_faceOut->m_pTextureIndices = 0;
+    if (!a_chunk.m_corners.empty())
+    {
+        copy(a_chunk.m_corners.begin(), a_chunk.m_corners.end(),
+             m_corners.begin() + a_chunk.m_firstCorner);
     }
 
-    //----------------------------------------------------------------------
-    // Copy vertex, normal, material and texture data into the structure
-    //----------------------------------------------------------------------
-
-    // Set material
-    a_faceOut->m_materialIndex = a_materialIndex;
-
-    // Process per-vertex data
-    for (i=0; i<(unsigned int) a_faceOut->m_numVertices; i++)
+    // offset the relative indices by the data of the previous chunks
+    cOBJCorner* corners = (a_chunk.m_numCorners > 0) ? &m_corners[a_chunk.m_firstCorner] : NULL;
+    for (unsigned int i=0; i<a_chunk.m_relativeIndices.size(); i++)
     {
-        // Read one triplet from the face string
-
-        // Are vertices, normals and texture coordinates present ?
-        if (m_pNormals && m_pTexCoords)
-            // Yes
-            sscanf(pFaceString, "%i/%i/%i",
-            &iVertex, &iTextureCoord, &iNormal);
-
-        else if (m_pNormals && !m_pTexCoords)
-            // Vertices and normals but no texture coordinates
-            sscanf(pFaceString, "%i//%i", &iVertex, &iNormal);
-        else if (m_pTexCoords && !m_pNormals)
-            // Vertices and texture coordinates but no normals
-            sscanf(pFaceString, "%i/%i", &iVertex, &iTextureCoord);
-        else
-            // Only vertices
-            sscanf(pFaceString, "%i", &iVertex);
-
-        // Copy vertex into the face. Also check for normals and texture
-        // coordinates and copy them if present.
-        memcpy(&a_faceOut->m_pVertices[i], &m_pVertices[iVertex - 1],
-        sizeof(cVector3d));
-        a_faceOut->m_pVertexIndices[i] = iVertex-1;
-
-        if (m_pTexCoords) 
-        {    
-            memcpy(&a_faceOut->m_pTexCoords[i],
-            &m_pTexCoords[iTextureCoord - 1], sizeof(cVector3d));
-            a_faceOut->m_pTextureIndices[i] = iTextureCoord-1;
+        unsigned int index = a_chunk.m_relativeIndices[i];
+        cOBJCorner& corner = corners[index / 3];
+        switch (index % 3)
+        {
+            case 0: corner.m_vertexIndex   += (int)a_chunk.m_firstVertex; break;
+            case 1: corner.m_normalIndex   += (int)a_chunk.m_firstNormal; break;
+            case 2: corner.m_texCoordIndex += (int)a_chunk.m_firstTexCoord; break;
         }
-        if (m_pNormals) 
+    }
+
+    // set the position of the corners, the material and the group of each face
+    unsigned int materialIndex = a_chunk.m_materialIndex;
+    int groupIndex = a_chunk.m_groupIndex;
+    unsigned int statement = 0;
+    for (unsigned int i=0; i<a_chunk.m_numFaces; i++)
+    {
+        while ((statement < a_chunk.m_statements.size()) &&
+               (a_chunk.m_statements[statement].m_faceIndex <= i))
         {
-            memcpy(&a_faceOut->m_pNormals[i],
-            &m_pNormals[iNormal - 1], sizeof(cVector3d));
-            a_faceOut->m_pNormals[i].normalize();
-            a_faceOut->m_pNormalIndices[i] = iNormal-1;
+            materialIndex = a_chunk.m_statements[statement].m_materialIndex;
+            groupIndex = a_chunk.m_statements[statement].m_groupIndex;
+            statement++;
         }
 
-        // Set string pointer to the next triplet
-        pFaceString = &a_faceString[iTripletPos[i+1]];
+        cOBJFace& face = m_faces[a_chunk.m_firstFace + i];
+        face.m_firstCorner += a_chunk.m_firstCorner;
+        face.m_materialIndex = materialIndex;
+        face.m_groupIndex = groupIndex;
     }
- }
+}
 
 //---------------------------------------------------------------------------
 
-bool cOBJModel::loadMaterialLib(const char a_fileName[],
-                cMaterialInfo* a_pMaterials,
-                unsigned int* a_curMaterialIndex,
-                char a_basePath[])
+bool cOBJModel::loadMaterialLib(const char a_fileName[], char a_basePath[])
 {
     //----------------------------------------------------------------------
     // Loads a material library file (.mtl)
     //----------------------------------------------------------------------
 
     char str[CHAI_OBJ_MAX_STR_SIZE];    // Buffer used while reading the file
-    bool bFirstMaterial = true;         // Only increase index after first
-                                        // material has been set
 
     //----------------------------------------------------------------------
     // Open library file
     //----------------------------------------------------------------------
 
-    FILE *hFile = fopen(a_fileName, "r");
+    cMappedFile file;
 
     // Success ?
-    if (!hFile)
+    if (!file.open(a_fileName))
     {
         return (false);
     }
@@ -711,220 +1237,99 @@ bool cOBJModel::loadMaterialLib(const char a_fileName[],
     // Read all material definitions
     //----------------------------------------------------------------------
 
-    // Quit reading when end of file has been reached
-    while (!feof(hFile))
+    // properties are only read once a material has been declared
+    cMaterialInfo* material = NULL;
+
+    const char* line = file.getData();
+    const char* end = line + file.getSize();
+    while (line < end)
     {
-        // Get next string
-        readNextString(str, hFile);
+        const char* lineEnd = (const char*)memchr(line, '\n', (size_t)(end - line));
+        if (lineEnd == NULL) { lineEnd = end; }
+
+        const char* token = skip_spaces(line, lineEnd);
+        const char* tokenEnd = skip_token(token, lineEnd);
+        line = lineEnd + 1;
+
+        if (token == tokenEnd) { continue; }
 
         // Is it a "new material" identifier ?
-        if (!strncmp(str, CHAI_OBJ_NEW_MTL_ID, sizeof(CHAI_OBJ_NEW_MTL_ID)))
+        if (is_token(token, tokenEnd, CHAI_OBJ_NEW_MTL_ID))
         {
-        // Only increase index after first material has been set
-        if (bFirstMaterial == true)
-            // First material has been set
-            bFirstMaterial = false;
-        else
-            // Use next index
-            (*a_curMaterialIndex)++;
-        // Read material name
-        getTokenParameter(str, sizeof(str), hFile);
-        // Store material name in the structure
-        strcpy(m_pMaterials[*a_curMaterialIndex].m_name, str);
+            m_materials.push_back(cMaterialInfo());
+            material = &m_materials.back();
+
+            // Store material name in the structure
+            copy_parameter(tokenEnd, lineEnd, material->m_name, sizeof(material->m_name));
+            continue;
         }
 
+        if (material == NULL) { continue; }
+
         // Transparency
-        if (
-        (!strncmp(str, CHAI_OBJ_MTL_ALPHA_ID, sizeof(CHAI_OBJ_MTL_ALPHA_ID)))
-        ||
-        (!strncmp(str, CHAI_OBJ_MTL_ALPHA_ID_ALT, sizeof(CHAI_OBJ_MTL_ALPHA_ID_ALT)))
-        )
+        if (is_token(token, tokenEnd, CHAI_OBJ_MTL_ALPHA_ID) ||
+            is_token(token, tokenEnd, CHAI_OBJ_MTL_ALPHA_ID_ALT))
         {
-            // Read into current material
-            fscanf(hFile, "%f", &m_pMaterials[*a_curMaterialIndex].m_alpha);
+            parse_float(tokenEnd, lineEnd, material->m_alpha);
         }
 
         // Ambient material properties
-        if (!strncmp(str, CHAI_OBJ_MTL_AMBIENT_ID, sizeof(CHAI_OBJ_MTL_AMBIENT_ID)))
+        else if (is_token(token, tokenEnd, CHAI_OBJ_MTL_AMBIENT_ID))
         {
-            // Read into current material
-            fscanf(hFile, "%f %f %f",
-                &m_pMaterials[*a_curMaterialIndex].m_ambient[0],
-                &m_pMaterials[*a_curMaterialIndex].m_ambient[1],
-                &m_pMaterials[*a_curMaterialIndex].m_ambient[2]);
+            for (int i=0; (i<3) && parse_float(tokenEnd, lineEnd, material->m_ambient[i]); i++) {}
         }
 
         // Diffuse material properties
-        if (!strncmp(str, CHAI_OBJ_MTL_DIFFUSE_ID, sizeof(CHAI_OBJ_MTL_DIFFUSE_ID)))
+        else if (is_token(token, tokenEnd, CHAI_OBJ_MTL_DIFFUSE_ID))
         {
-            // Read into current material
-            fscanf(hFile, "%f %f %f",
-                &m_pMaterials[*a_curMaterialIndex].m_diffuse[0],
-                &m_pMaterials[*a_curMaterialIndex].m_diffuse[1],
-                &m_pMaterials[*a_curMaterialIndex].m_diffuse[2]);
+            for (int i=0; (i<3) && parse_float(tokenEnd, lineEnd, material->m_diffuse[i]); i++) {}
         }
 
         // Specular material properties
-        if (!strncmp(str, CHAI_OBJ_MTL_SPECULAR_ID, sizeof(CHAI_OBJ_MTL_SPECULAR_ID)))
+        else if (is_token(token, tokenEnd, CHAI_OBJ_MTL_SPECULAR_ID))
         {
-            // Read into current material
-            fscanf(hFile, "%f %f %f",
-                &m_pMaterials[*a_curMaterialIndex].m_specular[0],
-                &m_pMaterials[*a_curMaterialIndex].m_specular[1],
-                &m_pMaterials[*a_curMaterialIndex].m_specular[2]);
+            for (int i=0; (i<3) && parse_float(tokenEnd, lineEnd, material->m_specular[i]); i++) {}
         }
 
         // Texture map name
-        if (!strncmp(str, CHAI_OBJ_MTL_TEXTURE_ID, sizeof(CHAI_OBJ_MTL_TEXTURE_ID)))
+        else if (is_token(token, tokenEnd, CHAI_OBJ_MTL_TEXTURE_ID))
         {
             // Read texture filename
-            getTokenParameter(str, sizeof(str), hFile);
+            copy_parameter(tokenEnd, lineEnd, str, sizeof(str));
 
-            // Append material library filename to the model's base path
+            // Append texture filename to the model's base path
             char textureFile[CHAI_SIZE_PATH];
-            strcpy(textureFile, a_basePath);
-            strcat(textureFile, str);
-            
-            // Store texture filename in the structure
-            strcpy(m_pMaterials[*a_curMaterialIndex].m_texture, textureFile);
-            
-            // Load texture and store its ID in the structure
-            m_pMaterials[*a_curMaterialIndex].m_textureID = 1;//LoadTexture(szTextureFile);
-        }
+            int length = snprintf(textureFile, sizeof(textureFile), "%s%s", a_basePath, str);
 
-        // Shininess
-        if (!strncmp(str, CHAI_OBJ_MTL_SHININESS_ID, sizeof(CHAI_OBJ_MTL_SHININESS_ID)))
-        {
-            // Read into current material
-            fscanf(hFile, "%f",
-                &m_pMaterials[*a_curMaterialIndex].m_shininess);
+            // A truncated path would open another file
+            if ((length < 0) || (length >= (int)sizeof(textureFile)))
+            {
+                CHAI_DEBUG_PRINT("Error: texture path too long: %s%s\n", a_basePath, str);
+            }
+            else
+            {
+                // Store texture filename in the structure
+                strcpy(material->m_texture, textureFile);
 
-            // OBJ files use a shininess from 0 to 1000; Scale for OpenGL
-            m_pMaterials[*a_curMaterialIndex].m_shininess /= 1000.0f;
-            m_pMaterials[*a_curMaterialIndex].m_shininess *= 128.0f;
+                // Load texture and store its ID in the structure
+                material->m_textureID = 1;
+            }
         }
-    }
-
-    fclose(hFile);
-
-    // Increment index cause LoadMaterialLib() assumes that the passed
-    // index is always empty
-    (*a_curMaterialIndex)++;
-
-    return (true);
-}
-
-//---------------------------------------------------------------------------
-
-void cOBJModel::getFileInfo(FILE *a_hStream, cOBJFileInfo *a_info,
-              const char a_constBasePath[])
-{
-    //----------------------------------------------------------------------
-    // Read the count of all important identifiers out of the given stream
-    //----------------------------------------------------------------------
-
-    char str[CHAI_OBJ_MAX_STR_SIZE]; // Buffer for reading the file
-    char basePath[CHAI_SIZE_PATH];  // Needed to append a filename to the base path
-
-    // Init structure
-    memset(a_info, 0, sizeof(cOBJFileInfo));
-
-    // Rollback the stream
-    rewind(a_hStream);
-
-    // Quit reading when end of file has been reached
-    while (!feof(a_hStream))
-    {
-        // Get next string
-        readNextString(str, a_hStream);
-
-        // Vertex ?
-        if (!strncmp(str, CHAI_OBJ_VERTEX_ID, sizeof(CHAI_OBJ_VERTEX_ID)))
-        a_info->m_vertexCount++;
 
-        // Texture coordinate ?
-        if (!strncmp(str, CHAI_OBJ_TEXCOORD_ID, sizeof(CHAI_OBJ_TEXCOORD_ID)))
-        a_info->m_texCoordCount++;
-        
-        // Vertex normal ?
-        if (!strncmp(str, CHAI_OBJ_NORMAL_ID, sizeof(CHAI_OBJ_NORMAL_ID)))
-        a_info->m_normalCount++;
-        
-        // Face ?
-        if (!strncmp(str, CHAI_OBJ_FACE_ID, sizeof(CHAI_OBJ_FACE_ID)))
-        a_info->m_faceCount++;
-
-        // Material library definition ?
-        if (!strncmp(str, CHAI_OBJ_MTL_LIB_ID, sizeof(CHAI_OBJ_MTL_LIB_ID)))
-        {
-        // Read the filename of the library
-        getTokenParameter(str, sizeof(str), a_hStream);
-        
-        // Copy the model's base path into a none-constant string
-        strcpy(basePath, a_constBasePath);
-        
-        // Append material library filename to the model's base path
-        strcat(basePath, str);
-        
-        // Append .mtl
-        //strcat(szBasePath, ".mtl");
-        
-        // Open the library file
-        FILE *hMaterialLib = fopen(basePath, "r");
-        
-        // Success ?
-        if (hMaterialLib)
+        // Shininess
+        else if (is_token(token, tokenEnd, CHAI_OBJ_MTL_SHININESS_ID))
         {
-            // Quit reading when end of file has been reached
-            while (!feof(hMaterialLib))
+            // Read into current material
+            if (parse_float(tokenEnd, lineEnd, material->m_shininess))
             {
-                // Read next string
-                fscanf(hMaterialLib, "%s" ,str);
-
-                // Is it a "new material" identifier ?
-                if (!strncmp(str, CHAI_OBJ_NEW_MTL_ID, sizeof(CHAI_OBJ_NEW_MTL_ID)))
-                    // One more material defined
-                    a_info->m_materialCount++;
-                }
-                
-            // Close material library
-                fclose(hMaterialLib);
+                // OBJ files use a shininess from 0 to 1000; Scale for OpenGL
+                material->m_shininess /= 1000.0f;
+                material->m_shininess *= 128.0f;
             }
         }
-
-        // Clear string two avoid counting something twice
-        memset(str, '\0', sizeof(str));
     }
-}
-
-//---------------------------------------------------------------------------
 
-void cOBJModel::readNextString(char a_str[], FILE *a_hStream)
-{
-    //----------------------------------------------------------------------
-    // Read the next string that isn't a comment
-    //----------------------------------------------------------------------
-
-    bool bSkipLine = false; // Skip the current line ?
-    int nScanReturn = 0;  // Return value of fscanf
-
-    // Skip all strings that contain comments
-    do
-    {
-        // Read new string
-        nScanReturn = fscanf(a_hStream, "%s", a_str);
-        // Is rest of the line a comment ?
-        if (!strncmp(a_str, CHAI_OBJ_COMMENT_ID, sizeof(CHAI_OBJ_COMMENT_ID)))
-        {
-        // Skip the rest of the line
-        fgets(a_str, sizeof(a_str), a_hStream);
-        bSkipLine = true;
-        }
-        else
-            {
-                bSkipLine = false;
-            }
-    } while (bSkipLine == true);
+    return (true);
 }
 
 //---------------------------------------------------------------------------
@@ -955,58 +1360,6 @@ void cOBJModel::makePath(char a_fileAndPath[])
     a_fileAndPath[0] = char('\0');
 }
 
-//---------------------------------------------------------------------------
-
-void cOBJModel::getTokenParameter(char a_str[],
-                                  const unsigned int a_strSize, 
-                                  FILE *a_hFile)
-{
-    //----------------------------------------------------------------------
-    // Read the parameter of a token, remove space and newline character
-    //----------------------------------------------------------------------
-
-    // Read the parameter after the token
-    fgets(a_str, a_strSize, a_hFile);
-
-    char* first_non_whitespace_character = a_str;
-    while( *first_non_whitespace_character == ' ' ) first_non_whitespace_character++;
-
-    // Remove space before the token
-    strcpy(a_str, first_non_whitespace_character);
-
-    // Remove newline character after the token
-    if (a_str[strlen(a_str) - 1] == '\r' || a_str[strlen(a_str) - 1] == '\n')
-        a_str[strlen(a_str) - 1] = '\0';
-    if (a_str[strlen(a_str) - 1] == '\r' || a_str[strlen(a_str) - 1] == '\n')
-        a_str[strlen(a_str) - 1] = '\0';
-}
-
-//---------------------------------------------------------------------------
-
-unsigned int getVertexIndex(cMesh* a_mesh, cOBJModel* a_model,
-                            vertexIndexSet_uint_map* a_vertexMap, vertexIndexSet& vis) 
-{
-    unsigned int index;
-
-    // Have we seen this vertex before?
-    vertexIndexSet_uint_map::iterator vertexMapIter = a_vertexMap->find(vis);
-
-    // If we have, just grab the new index for this vertex
-    if (vertexMapIter != a_vertexMap->end()) 
-    {
-        index = (*vertexMapIter).second;
-        return index;
-    }
-
-    // Otherwise create a new vertex and put the mapping in our map
-    else 
-    {
-        index = a_mesh->newVertex(a_model->m_pVertices[vis.vIndex]);
-        (*a_vertexMap)[vis] = index;
-        return index;
-    }
-}
-
 //---------------------------------------------------------------------------
 #endif  // DOXYGEN_SHOULD_SKIP_THIS
 //---------------------------------------------------------------------------
@@ -34,7 +34,6 @@
 #include "../scenegraph/CLight.h"
 #include <string>
 #include <stdio.h>
-#include <map>
 //---------------------------------------------------------------------------
 
 //===========================================================================
@@ -66,6 +65,19 @@ bool cLoadFileOBJ(cMesh* iMesh, const string& iFileName);
 */
 extern bool g_objLoaderShouldGenerateExtraVertices;
 
+/*!
+    If \b true (default), large obj files are split at line boundaries and
+    the parts are parsed in parallel on the shared thread pool. The loaded
+    model is the same in both modes.
+*/
+extern bool g_objLoaderUseParallelParsing;
+
+/*!
+    Thread pool on which large obj files are parsed. If \b NULL (default),
+    the shared pool returned by cThreadPool::getDefaultPool() is used.
+*/
+extern cThreadPool* g_objLoaderThreadPool;
+
 
 //---------------------------------------------------------------------------
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
@@ -101,25 +113,6 @@ struct vertexIndexSet
 
 //---------------------------------------------------------------------------
 
-struct ltVertexIndexSet
-{
-    bool operator()(vertexIndexSet v1, vertexIndexSet v2) const
-    {
-        if (v1.vIndex < v2.vIndex) return 1;
-        if (v2.vIndex < v1.vIndex) return 0;
-        if (v1.nIndex < v2.nIndex) return 1;
-        if (v2.nIndex < v1.nIndex) return 0;
-        if (v1.tIndex < v2.tIndex) return 1;
-        return 0;
-    }
-};
-
-//---------------------------------------------------------------------------
-
-typedef std::map<vertexIndexSet,unsigned int,ltVertexIndexSet> vertexIndexSet_uint_map;
-
-//---------------------------------------------------------------------------
-
 //===========================================================================
 //  INTERNAL IMPLEMENTATION
 //===========================================================================
@@ -147,8 +140,11 @@ typedef std::map<vertexIndexSet,unsigned int,ltVertexIndexSet> vertexIndexSet_ui
 // Maximum size of a string that could be read out of the OBJ file
 #define CHAI_OBJ_MAX_STR_SIZE 1024
 
-// Maximum number of vertices a that a single face can have
-#define CHAI_OBJ_MAX_VERTICES 256
+// Minimum size in bytes of the parts of an OBJ file parsed in parallel
+#define CHAI_OBJ_MIN_CHUNK_SIZE 262144
+
+// Part of an OBJ file parsed by one task (see CFileLoaderOBJ.cpp)
+struct cOBJChunk;
 
 // Image File information.
 struct cOBJFileInfo
@@ -160,21 +156,25 @@ struct cOBJFileInfo
 	unsigned int m_materialCount;
 };
 
+// A corner of a face: indices of its vertex, normal and texture
+// coordinate in the model (-1 if absent).
+struct cOBJCorner
+{
+    int m_vertexIndex;
+    int m_normalIndex;
+    int m_texCoordIndex;
+};
+
 // Information about a surface face.
-struct cFace
+struct cOBJFace
 {
-	unsigned int	m_numVertices;
-	unsigned int	m_materialIndex;
-
-  // Which 'g ...' group does this face belong to?  -1 indicates no group.
-  int  m_groupIndex;
-
-	int			*m_pVertexIndices;
-	cVector3d	*m_pVertices;
-  int			*m_pNormalIndices;
-	cVector3d	*m_pNormals;
-  int			*m_pTextureIndices;
-	cVector3d	*m_pTexCoords;
+    // First corner of the face in cOBJModel::m_corners.
+    unsigned int m_firstCorner;
+    unsigned int m_numVertices;
+    unsigned int m_materialIndex;
+
+    // Which 'g ...' group does this face belong to?  -1 indicates no group.
+    int m_groupIndex;
 };
 
 // Information about a material property
@@ -210,7 +210,11 @@ struct cMaterialInfo
     \ingroup    files  
 
     \brief      
-    Implenentation of an OBJ file loader.
+    Implementation of an OBJ file loader. The file is mapped in memory
+    and parsed in a single pass; vertices, normals, texture coordinates,
+    faces and face corners are appended to growable arrays. Large files
+    are split in chunks at line boundaries, which are parsed in parallel
+    and then copied to the model arrays at their prefix-summed offsets.
 */
 //===========================================================================
 class cOBJModel
@@ -240,22 +244,25 @@ class cOBJModel
     //-----------------------------------------------------------------------
     
     //! List of vertices.
-  	cVector3d* m_pVertices;
+    vector<cVector3d> m_vertices;
     
     //! List of faces.
-	cFace* m_pFaces;
+    vector<cOBJFace> m_faces;
+
+    //! Corners of the faces.
+    vector<cOBJCorner> m_corners;
     
-    //! List of normals.
-	cVector3d* m_pNormals;
+    //! List of normals (normalized).
+    vector<cVector3d> m_normals;
     
     //! List of texture coordinates.
-	cVector3d* m_pTexCoords;
+    vector<cVector3d> m_texCoords;
     
     //! List of material and texture properties.
-	cMaterialInfo* m_pMaterials;
+    vector<cMaterialInfo> m_materials;
     
     //! Information about image file.
-	cOBJFileInfo m_OBJInfo;
+    cOBJFileInfo m_OBJInfo;
 
     //! List of names obtained from 'g' commands, with the most recent at the back...
     vector<char*> m_groupNames;
@@ -266,33 +273,31 @@ class cOBJModel
     // METHODS:
     //-----------------------------------------------------------------------
 
-    //! Read next string of file.
-    void  readNextString(char a_string[], FILE *hStream);
-    
-    //! Get next token from file.
-    void  getTokenParameter(char a_string[], const unsigned int a_strSize, FILE *a_hFile);
-    
+    //! Parse the lines of a chunk of an OBJ file.
+    static void parseChunk(cOBJChunk& a_chunk);
+
+    //! Parse the corners of a face line into a chunk.
+    static void parseFace(const char* a_begin, const char* a_end, cOBJChunk& a_chunk);
+
+    //! Apply the group and material statements of all chunks, in file order.
+    void  applyStatements(vector<cOBJChunk>& a_chunks, const char a_basePath[]);
+
+    //! Copy a parsed chunk to the model arrays.
+    void  mergeChunk(cOBJChunk& a_chunk);
+
+    //! Thread pool task parsing chunks.
+    static void parseChunksTask(void* a_data, unsigned int a_begin, unsigned int a_end);
+
+    //! Thread pool task merging chunks.
+    static void mergeChunksTask(void* a_data, unsigned int a_begin, unsigned int a_end);
+
     //! File path.
     void  makePath(char a_fileAndPath[]);
     
     //! Load material file [mtl].
-    bool  loadMaterialLib(const char a_fFileName[], cMaterialInfo *a_pMaterials,
-          unsigned int *a_curMaterialIndex, char a_basePath[]);
-    
-    //! Parse information about face.
-    void  parseFaceString(char a_faceString[], cFace *a_faceOut, const cVector3d *a_pVertices,
-        const cVector3d *a_pNormals, const cVector3d *a_pTexCoords, const unsigned int a_materialIndex);
-    
-    //! Read information about file.
-    void  getFileInfo(FILE *a_hStream, cOBJFileInfo *a_stat, const char a_constBasePath[]);    
+    bool  loadMaterialLib(const char a_fileName[], char a_basePath[]);
 };
 
-//! Internal: get a (possibly new) vertex index for a vertex.
-unsigned int getVertexIndex(cMesh* a_Mesh, 
-                            cOBJModel* a_model, 
-                            vertexIndexSet_uint_map* a_VertexMap, 
-                            vertexIndexSet& vis);
-
 //---------------------------------------------------------------------------
 #endif  // DOXYGEN_SHOULD_SKIP_THIS
 //---------------------------------------------------------------------------
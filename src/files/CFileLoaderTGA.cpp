@@ -21,31 +21,102 @@
 
 //---------------------------------------------------------------------------
 #include "files/CFileLoaderTGA.h"
+#include "files/CMappedFile.h"
 #include <stdlib.h>
+#include <string.h>
 //---------------------------------------------------------------------------
 
 //---------------------------------------------------------------------------
-// GLOBAL UTILITY FUNCTIONS:
-//--------------------------------------------------------------------------- 
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+
+// Size of the TGA file header
+#define CHAI_TGA_HEADER_SIZE 18
 
-static int TGAReadError = 0;
+// Image descriptor bit set when the first row is the top row of the image
+#define CHAI_TGA_TOP_ORIGIN 0x20
+
+// Read a little-endian 16-bit value
+static inline uint ReadShort(const byte* data)
+{
+    return ((uint)data[0] | ((uint)data[1] << 8));
+}
 
-static void ReadData(std::ifstream &file, char* data, uint size)
+// Expand the RLE packets of an image into a_dst. Returns false if the
+// packets end before the image is complete. Packets which would run past
+// the end of the image are cut.
+static bool ExpandRLE(const byte* a_src, const byte* a_srcEnd,
+                      byte* a_dst, byte* a_dstEnd, uint a_bytesPerPixel)
 {
-    if (!file.is_open())
-        return;
-    int a = (int)file.tellg();
-    a+= size;
-    file.read(data, size);
+    while (a_dst < a_dstEnd)
+    {
+        if (a_src >= a_srcEnd) { return (false); }
 
-    int g = (int)file.tellg();
+        uint packet = *a_src++;
+        size_t size = ((packet & 127) + 1) * a_bytesPerPixel;
+        size_t available = (size_t)(a_dstEnd - a_dst);
+        size_t count = (size < available) ? size : available;
 
-    if (a != g)
+        if ((packet & 128) != 0)
+        {
+            // run-length packet: one pixel repeated
+            if ((size_t)(a_srcEnd - a_src) < a_bytesPerPixel) { return (false); }
+            byte* end = a_dst + count;
+            if (a_bytesPerPixel == 1)
+            {
+                memset(a_dst, *a_src, count);
+            }
+            else if (a_bytesPerPixel == 4)
+            {
+                unsigned int pixel;
+                memcpy(&pixel, a_src, 4);
+                for (byte* p = a_dst; p + 4 <= end; p += 4) { memcpy(p, &pixel, 4); }
+            }
+            else
+            {
+                for (byte* p = a_dst; p + a_bytesPerPixel <= end; p += a_bytesPerPixel)
+                {
+                    for (uint j=0; j<a_bytesPerPixel; j++) { p[j] = a_src[j]; }
+                }
+            }
+            a_src += a_bytesPerPixel;
+        }
+        else
+        {
+            // raw packet
+            if ((size_t)(a_srcEnd - a_src) < size) { return (false); }
+            memcpy(a_dst, a_src, count);
+            a_src += size;
+        }
+        a_dst += count;
+    }
+    return (true);
+}
+
+// Swap the blue and red components of a row of BGR(A) pixels in place
+static void SwapRedBlue(byte* a_row, uint a_numPixels, uint a_bytesPerPixel)
+{
+    byte* end = a_row + a_numPixels * a_bytesPerPixel;
+    if (a_bytesPerPixel == 4)
     {
-        TGAReadError = 1;
+        for (byte* p = a_row; p < end; p += 4)
+        {
+            byte b = p[0]; p[0] = p[2]; p[2] = b;
+        }
+    }
+    else
+    {
+        for (byte* p = a_row; p < end; p += 3)
+        {
+            byte b = p[0]; p[0] = p[2]; p[2] = b;
+        }
     }
 }
 
+//---------------------------------------------------------------------------
+#endif  // DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+
 
 //---------------------------------------------------------------------------
 cFileLoaderTGA::cFileLoaderTGA()
@@ -88,29 +159,26 @@ bool cFileLoaderTGA::LoadFromFile(const std::string &filename)
         Clear();
     m_loaded = false;
 
-    std::ifstream file;
-    file.open(filename.c_str(), std::ios::binary);
-    if (!file.is_open())
+    // the file is mapped in memory and decoded in bulk
+    cMappedFile file;
+    if (!file.open(filename.c_str()))
+        return false;
+
+    const byte* data = (const byte*)file.getData();
+    const byte* dataEnd = data + file.getSize();
+    if (file.getSize() < CHAI_TGA_HEADER_SIZE)
         return false;
 
     bool rle = false;
     bool truecolor = false;
-    uint CurrentPixel = 0;
-    byte ch_buf1, ch_buf2;
-    byte buf1[1000];
 
-    byte IDLength;
-    byte IDColorMapType;
-    byte IDImageType;
-
-    ReadData(file, (char*)&IDLength, 1);
-    ReadData(file, (char*)&IDColorMapType, 1);
+    byte IDLength = data[0];
+    byte IDColorMapType = data[1];
+    byte IDImageType = data[2];
 
     if (IDColorMapType == 1)
         return false;
 
-    ReadData(file, (char*)&IDImageType, 1);
-
     switch (IDImageType)
     {
     case 2:
@@ -131,85 +199,93 @@ bool cFileLoaderTGA::LoadFromFile(const std::string &filename)
             return false;
     }
 
-    file.seekg(5, std::ios::cur);
-
-    file.seekg(4, std::ios::cur);
-    ReadData(file, (char*)&m_width, 2);
-    ReadData(file, (char*)&m_height, 2);
-    ReadData(file, (char*)&m_pixelDepth, 1);
+    m_width = ReadShort(data + 12);
+    m_height = ReadShort(data + 14);
+    m_pixelDepth = data[16];
 
     if (! ((m_pixelDepth == 8) || (m_pixelDepth ==  24) ||
              (m_pixelDepth == 16) || (m_pixelDepth == 32)))
         return false;
 
-    ReadData(file, (char*)&ch_buf1, 1);
-
-    ch_buf2 = 15; //00001111;
-    m_alphaDepth = ch_buf1 & ch_buf2;
+    byte descriptor = data[17];
+    m_alphaDepth = descriptor & 15;
 
     if (! ((m_alphaDepth == 0) || (m_alphaDepth == 8)))
         return false;
 
     if (truecolor)
     {
-        m_type = itRGB;
-        if (m_pixelDepth == 32)
+        // 16-bit color images are not supported
+        if (m_pixelDepth == 24)
+            m_type = itRGB;
+        else if (m_pixelDepth == 32)
             m_type = itRGBA;
     }
 
-    if (m_type == itUndefined)
+    if ((m_type == itUndefined) || (m_width == 0) || (m_height == 0))
+    {
+        Clear();
         return false;
+    }
 
-    file.seekg(IDLength, std::ios::cur);
-
-    m_pixels = (byte*) malloc(m_width*m_height*(m_pixelDepth/8));
-
-    if (!rle)
-        ReadData(file, (char*)m_pixels, m_width*m_height*(m_pixelDepth/8));
-    else
+    uint bytesPerPixel = m_pixelDepth / 8;
+    uint rowSize = m_width * bytesPerPixel;
+    size_t imageSize = (size_t)rowSize * m_height;
+    const byte* src = data + CHAI_TGA_HEADER_SIZE + IDLength;
+
+    // check that the file is large enough for the image before allocating
+    // it: a packet of (1 + bytesPerPixel) bytes encodes up to 128 pixels
+    size_t dataSize = (src <= dataEnd) ? (size_t)(dataEnd - src) : 0;
+    size_t numPixels = (size_t)m_width * m_height;
+    bool ok = rle ? ((dataSize / (1 + bytesPerPixel) + 1) * 128 >= numPixels) :
+                    (dataSize >= imageSize);
+    if (ok)
     {
-        while (CurrentPixel < m_width*m_height -1)
+        m_pixels = (byte*) malloc(imageSize);
+        ok = (m_pixels != 0);
+    }
+    if (ok)
+    {
+        if (!rle)
         {
-            ReadData(file, (char*)&ch_buf1, 1);
-            if ((ch_buf1 & 128) == 128)
-            {   // this is an rle packet
-                ch_buf2 = (byte)((ch_buf1 & 127) + 1);   // how many pixels are encoded using this packet
-                ReadData(file, (char*)buf1, m_pixelDepth/8);
-                for (uint i=CurrentPixel; i<CurrentPixel+ch_buf2; i++)
-                    for (uint j=0; j<m_pixelDepth/8; j++)
-                        m_pixels[i*m_pixelDepth/8+j] = buf1[j];
-                CurrentPixel += ch_buf2;
-            }
-            else
-            {   // this is a raw packet
-                ch_buf2 = (byte)((ch_buf1 & 127) + 1);
-                ReadData(file, (char*)buf1, m_pixelDepth/8*ch_buf2);
-                for (uint i=CurrentPixel; i<CurrentPixel+ch_buf2; i++)
-                    for (uint j=0; j<m_pixelDepth/8; j++)
-                        m_pixels[i*m_pixelDepth/8+j] =  buf1[(i-CurrentPixel)*m_pixelDepth/8+j];
-                CurrentPixel += ch_buf2;
-            }
+            memcpy(m_pixels, src, imageSize);
+        }
+        else
+        {
+            ok = ExpandRLE(src, dataEnd, m_pixels, m_pixels + imageSize, bytesPerPixel);
         }
     }
 
-    if (TGAReadError != 0)
+    if (!ok)
     {
         Clear();
         return false;
     }
     m_loaded = true;
 
-    // swap BGR(A) to RGB(A)
-
-    byte temp;
-    if ((m_type == itRGB) || (m_type == itRGBA))
-        if ((m_pixelDepth == 24) || (m_pixelDepth == 32))
-            for (uint i= 0; i<m_width*m_height; i++)
-            {
-                temp = m_pixels[i*m_pixelDepth/8];
-                m_pixels[i*m_pixelDepth/8] = m_pixels[i*m_pixelDepth/8+2];
-                m_pixels[i*m_pixelDepth/8+2] = temp;
-            }
+    // swap BGR(A) to RGB(A) row by row, and store the rows from bottom to
+    // top when the file starts with the top row
+    bool swap = (m_type == itRGB) || (m_type == itRGBA);
+    if ((descriptor & CHAI_TGA_TOP_ORIGIN) != 0)
+    {
+        byte* temp = (byte*) malloc(rowSize);
+        for (uint i=0; i<m_height/2; i++)
+        {
+            byte* top = m_pixels + (size_t)i * rowSize;
+            byte* bottom = m_pixels + (size_t)(m_height - 1 - i) * rowSize;
+            memcpy(temp, top, rowSize);
+            memcpy(top, bottom, rowSize);
+            memcpy(bottom, temp, rowSize);
+        }
+        free(temp);
+    }
+    if (swap)
+    {
+        for (uint i=0; i<m_height; i++)
+        {
+            SwapRedBlue(m_pixels + (size_t)i * rowSize, m_width, bytesPerPixel);
+        }
+    }
 
     return true;
 }
@@ -397,6 +397,7 @@ bool cImageLoader::loadFromFile(const char* filename)
         m_height = bmp_image.getHeight();
 
         m_bits_per_pixel = 24;
+        m_format = GL_RGB;
 
         m_data = new unsigned char[m_width*m_height*(m_bits_per_pixel/8)];
 
@@ -0,0 +1,222 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "files/CMappedFile.h"
+//---------------------------------------------------------------------------
+#include <sys/types.h>
+#include <sys/stat.h>
+#if defined(_LINUX) || defined(_MACOSX)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cMappedFile.
+
+    \fn       cMappedFile::cMappedFile()
+*/
+//===========================================================================
+cMappedFile::cMappedFile()
+{
+    m_data = NULL;
+    m_size = 0;
+    m_open = false;
+
+#if defined(_WIN32)
+    m_file = INVALID_HANDLE_VALUE;
+    m_mapping = NULL;
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    m_file = -1;
+#endif
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cMappedFile.
+
+    \fn       cMappedFile::~cMappedFile()
+*/
+//===========================================================================
+cMappedFile::~cMappedFile()
+{
+    close();
+}
+
+
+//===========================================================================
+/*!
+    Map the content of a file in memory, closing the previous file if any.
+    An empty file is opened successfully, with no data.
+
+    \fn       bool cMappedFile::open(const char* a_fileName)
+    \param    a_fileName  Name of the file.
+    \return   Return \b true if the file was opened and mapped.
+*/
+//===========================================================================
+bool cMappedFile::open(const char* a_fileName)
+{
+    close();
+
+#if defined(_WIN32)
+    m_file = CreateFileA(a_fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+                         OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m_file == INVALID_HANDLE_VALUE) { return (false); }
+
+    DWORD sizeHigh = 0;
+    DWORD sizeLow = GetFileSize(m_file, &sizeHigh);
+    if ((sizeLow == 0xFFFFFFFF) && (GetLastError() != NO_ERROR))
+    {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+        return (false);
+    }
+#if defined(_WIN64)
+    m_size = ((size_t)sizeHigh << 32) | (size_t)sizeLow;
+#else
+    // a 32 bit process can not map files of 4 GB or more
+    if (sizeHigh != 0)
+    {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+        return (false);
+    }
+    m_size = (size_t)sizeLow;
+#endif
+
+    if (m_size > 0)
+    {
+        m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (m_mapping != NULL)
+        {
+            m_data = (const char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+        }
+        if (m_data == NULL)
+        {
+            if (m_mapping != NULL) { CloseHandle(m_mapping); }
+            CloseHandle(m_file);
+            m_mapping = NULL;
+            m_file = INVALID_HANDLE_VALUE;
+            m_size = 0;
+            return (false);
+        }
+    }
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    m_file = ::open(a_fileName, O_RDONLY);
+    if (m_file < 0) { return (false); }
+
+    struct stat info;
+    if ((fstat(m_file, &info) != 0) || (!S_ISREG(info.st_mode)))
+    {
+        ::close(m_file);
+        m_file = -1;
+        return (false);
+    }
+    m_size = (size_t)info.st_size;
+
+    if (m_size > 0)
+    {
+        void* data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+        if (data == MAP_FAILED)
+        {
+            ::close(m_file);
+            m_file = -1;
+            m_size = 0;
+            return (false);
+        }
+        madvise(data, m_size, MADV_SEQUENTIAL);
+        m_data = (const char*)data;
+    }
+#endif
+
+    m_open = true;
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Unmap and close the file. Pointers returned by getData() are no
+    longer valid.
+
+    \fn       void cMappedFile::close()
+*/
+//===========================================================================
+void cMappedFile::close()
+{
+    if (!m_open) { return; }
+
+#if defined(_WIN32)
+    if (m_data != NULL) { UnmapViewOfFile(m_data); }
+    if (m_mapping != NULL) { CloseHandle(m_mapping); }
+    CloseHandle(m_file);
+    m_mapping = NULL;
+    m_file = INVALID_HANDLE_VALUE;
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    if (m_data != NULL) { munmap((void*)m_data, m_size); }
+    ::close(m_file);
+    m_file = -1;
+#endif
+
+    m_data = NULL;
+    m_size = 0;
+    m_open = false;
+}
+
+
+//===========================================================================
+/*!
+    Read the size and modification time of a file, without opening it.
+    Loaders store them next to cached data, to detect a changed source
+    file. Each value is split in two 32 bit words, low word first, so that
+    it can be written to a file in the same way on every platform.
+
+    n       bool cMappedFile::getFileInfo(const char* a_fileName,
+              unsigned int a_size[2], unsigned int a_time[2])
+    \param    a_fileName  Name of the file.
+    \param    a_size  Size of the file in bytes.
+    \param    a_time  Time of the last modification of the file.
+    eturn   Return \b true if the file exists.
+*/
+//===========================================================================
+bool cMappedFile::getFileInfo(const char* a_fileName, unsigned int a_size[2],
+                              unsigned int a_time[2])
+{
+    struct stat info;
+    if (stat(a_fileName, &info) != 0) { return (false); }
+
+    double size = (double)info.st_size;
+    double time = (double)info.st_mtime;
+    a_size[1] = (unsigned int)(size / 4294967296.0);
+    a_size[0] = (unsigned int)(size - 4294967296.0 * a_size[1]);
+    a_time[1] = (unsigned int)(time / 4294967296.0);
+    a_time[0] = (unsigned int)(time - 4294967296.0 * a_time[1]);
+    return (true);
+}
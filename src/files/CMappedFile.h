@@ -0,0 +1,120 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CMappedFileH
+#define CMappedFileH
+//---------------------------------------------------------------------------
+#include "../extras/CGlobals.h"
+#include <stddef.h>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CMappedFile.h
+
+    \brief
+    <b> Files </b> \n
+    Read-only memory mapped file.
+*/
+//===========================================================================
+
+//===========================================================================
+/*!
+    \class      cMappedFile
+    \ingroup    files
+
+    \brief
+    cMappedFile maps the content of a file in memory for reading. Pages
+    are loaded by the operating system as they are accessed, so a loader
+    can parse a large file directly from memory, in a single pass, without
+    copying it into buffers or reading it with stdio calls.
+*/
+//===========================================================================
+class cMappedFile
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cMappedFile.
+    cMappedFile();
+
+    //! Destructor of cMappedFile. The file is closed.
+    ~cMappedFile();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Map a file in memory. Returns \b false if the file can not be opened.
+    bool open(const char* a_fileName);
+
+    //! Unmap and close the file.
+    void close();
+
+    //! Return \b true if a file is open.
+    bool isOpen() const { return (m_open); }
+
+    //! Content of the file (not null-terminated), or \b NULL if the file is empty.
+    const char* getData() const { return (m_data); }
+
+    //! Size of the file in bytes.
+    size_t getSize() const { return (m_size); }
+
+    //! Read the size and modification time of a file, as pairs of 32 bit words (low word first).
+    static bool getFileInfo(const char* a_fileName, unsigned int a_size[2], unsigned int a_time[2]);
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Content of the file.
+    const char* m_data;
+
+    //! Size of the file in bytes.
+    size_t m_size;
+
+    //! If \b true, a file is open.
+    bool m_open;
+
+#if defined(_WIN32)
+    //! File handle.
+    HANDLE m_file;
+
+    //! File mapping handle.
+    HANDLE m_mapping;
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    //! File descriptor.
+    int m_file;
+#endif
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -20,15 +20,30 @@
 
 //---------------------------------------------------------------------------
 #include "files/CMeshLoader.h"
+#include "files/CFileLoaderBIN.h"
 //--------------------------------------------------------------------------
 
+//---------------------------------------------------------------------------
+// By default, loaded meshes are not welded
+bool g_meshLoaderShouldWeldVertices = false;
+
+// By default, loaded meshes are not cached
+bool g_meshLoaderShouldUseBinaryCache = false;
+//---------------------------------------------------------------------------
+
 //===========================================================================
 /*!
     Global function to load a file into a mesh (CHAI currently supports
-    .3ds and .obj files).  Returns true if the file is loaded successfully. \n
+    .3ds, .obj and .chaibin files).  Returns true if the file is loaded
+    successfully. \n
 
     The file type is determined based on the file extension supplied by
-    the caller.
+    the caller. \n
+
+    If g_meshLoaderShouldUseBinaryCache is \b true, a .3ds or .obj file is
+    loaded from its binary cache (the file name followed by .chaibin) when
+    the cache is up to date; otherwise the file is parsed and the cache
+    is written.
 
     \fn     bool cLoadMeshFromFile(cMesh* a_mesh, const string& a_fileName);
     \param  a_mesh  The mesh into which we should write the loaded data
@@ -58,6 +73,28 @@ bool cLoadMeshFromFile(cMesh* a_mesh, const string& a_fileName)
     // return value
     bool result = false;
 
+    // Load a binary mesh file
+    if (strcmp(lower_extension,"chaibin")==0)
+    {
+        result = cLoadFileBIN(a_mesh, a_fileName);
+        if (result)
+        {
+            a_mesh->setSuperParent(a_mesh, true);
+        }
+        return (result);
+    }
+
+    // Load from the binary cache if it is up to date
+    string cacheFileName = a_fileName + ".chaibin";
+    if (g_meshLoaderShouldUseBinaryCache)
+    {
+        if (cLoadFileBIN(a_mesh, cacheFileName, a_fileName))
+        {
+            a_mesh->setSuperParent(a_mesh, true);
+            return (true);
+        }
+    }
+
     // Load an .obj file
     if (strcmp(lower_extension,"obj")==0) 
     {
@@ -75,6 +112,18 @@ bool cLoadMeshFromFile(cMesh* a_mesh, const string& a_fileName)
     if (result)
     {
         a_mesh->setSuperParent(a_mesh, true);
+
+        // optionally merge duplicated vertices
+        if (g_meshLoaderShouldWeldVertices)
+        {
+            a_mesh->weldVertices(CHAI_SMALL, true, true);
+        }
+
+        // write the binary cache; loading succeeds even if it can not be written
+        if (g_meshLoaderShouldUseBinaryCache)
+        {
+            cSaveFileBIN(a_mesh, cacheFileName, a_fileName);
+        }
     }
 
     // return result
@@ -54,10 +54,28 @@
     \ingroup    files
     \brief
     Global function to load a file into a mesh.
-    (CHAI currently supports .3ds and .obj files).
+    (CHAI currently supports .3ds, .obj and .chaibin files).
 */
 bool cLoadMeshFromFile(cMesh* a_mesh, const string& a_fileName);
 
+/*!
+    Clients can use this to weld the vertices of loaded meshes. \n
+    If \b true, cLoadMeshFromFile() calls cMesh::weldVertices() on the
+    loaded mesh and its children, merging vertices at the same position
+    with the same attributes. Default is \b false.
+*/
+extern bool g_meshLoaderShouldWeldVertices;
+
+/*!
+    Clients can use this to cache loaded meshes in binary files. \n
+    If \b true, cLoadMeshFromFile() loads a .3ds or .obj file from a
+    binary file named after it (\e model.obj.chaibin), unless the model
+    file or the loader options changed since the binary file was written.
+    Otherwise the model file is loaded and the binary file is written.
+    Default is \b false.
+*/
+extern bool g_meshLoaderShouldUseBinaryCache;
+
 //---------------------------------------------------------------------------
 #endif
 //---------------------------------------------------------------------------
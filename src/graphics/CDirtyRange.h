@@ -0,0 +1,203 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CDirtyRangeH
+#define CDirtyRangeH
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CDirtyRange.h
+
+    \brief
+    <b> Graphics </b> \n
+    Range of modified elements.
+*/
+//===========================================================================
+
+//===========================================================================
+/*!
+    \class      cDirtyRange
+    \ingroup    graphics
+
+    \brief
+    cDirtyRange records which elements of an array (vertices or triangles
+    of a mesh) have been modified, as the smallest interval
+    [first, last) containing all of them. Marking an element is a couple
+    of comparisons, and the stage that consumes the range (rendering,
+    collision detection, normals) only processes the modified part of
+    the array.
+
+    A range is not protected against concurrent use: threads which
+    modify elements in parallel must leave the marking to the thread
+    that waits for them.
+*/
+//===========================================================================
+class cDirtyRange
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cDirtyRange. The range is empty.
+    cDirtyRange() : m_first(0), m_last(0) {}
+
+    //! Destructor of cDirtyRange.
+    ~cDirtyRange() {}
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //-----------------------------------------------------------------------
+    /*!
+        Mark one element as modified.
+
+        \param  a_index  Index of the element.
+    */
+    //-----------------------------------------------------------------------
+    inline void mark(const unsigned int a_index)
+    {
+        if (m_first >= m_last)
+        {
+            m_first = a_index;
+            m_last = a_index + 1;
+        }
+        else
+        {
+            if (a_index < m_first) { m_first = a_index; }
+            if (a_index >= m_last) { m_last = a_index + 1; }
+        }
+    }
+
+
+    //-----------------------------------------------------------------------
+    /*!
+        Mark elements [a_first, a_last) as modified.
+
+        \param  a_first  First element.
+        \param  a_last  Last element (excluded).
+    */
+    //-----------------------------------------------------------------------
+    inline void mark(const unsigned int a_first, const unsigned int a_last)
+    {
+        if (a_first >= a_last) { return; }
+        if (m_first >= m_last)
+        {
+            m_first = a_first;
+            m_last = a_last;
+        }
+        else
+        {
+            if (a_first < m_first) { m_first = a_first; }
+            if (a_last > m_last) { m_last = a_last; }
+        }
+    }
+
+
+    //-----------------------------------------------------------------------
+    /*!
+        Mark all elements as modified, whatever the size of the array.
+    */
+    //-----------------------------------------------------------------------
+    inline void markAll() { m_first = 0; m_last = 0xFFFFFFFF; }
+
+
+    //-----------------------------------------------------------------------
+    /*!
+        Add the elements of another range.
+
+        \param  a_range  Range to be merged.
+    */
+    //-----------------------------------------------------------------------
+    inline void merge(const cDirtyRange& a_range) { mark(a_range.m_first, a_range.m_last); }
+
+
+    //-----------------------------------------------------------------------
+    /*!
+        Mark all elements as unmodified.
+    */
+    //-----------------------------------------------------------------------
+    inline void clear() { m_first = 0; m_last = 0; }
+
+
+    //-----------------------------------------------------------------------
+    /*!
+        Return \b true if no element is modified.
+    */
+    //-----------------------------------------------------------------------
+    inline bool isEmpty() const { return (m_first >= m_last); }
+
+
+    //-----------------------------------------------------------------------
+    /*!
+        Return \b true if an element is modified.
+
+        \param  a_index  Index of the element.
+    */
+    //-----------------------------------------------------------------------
+    inline bool contains(const unsigned int a_index) const
+    {
+        return ((a_index >= m_first) && (a_index < m_last));
+    }
+
+
+    //-----------------------------------------------------------------------
+    /*!
+        Return the first modified element.
+    */
+    //-----------------------------------------------------------------------
+    inline unsigned int getFirst() const { return (m_first); }
+
+
+    //-----------------------------------------------------------------------
+    /*!
+        Return the element following the last modified one, clamped to the
+        size of the array.
+
+        \param  a_size  Number of elements in the array.
+    */
+    //-----------------------------------------------------------------------
+    inline unsigned int getLast(const unsigned int a_size) const
+    {
+        return ((m_last < a_size) ? m_last : a_size);
+    }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! First modified element.
+    unsigned int m_first;
+
+    //! Element following the last modified one.
+    unsigned int m_last;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
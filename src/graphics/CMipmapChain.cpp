@@ -0,0 +1,366 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "graphics/CMipmapChain.h"
+#include "files/CMappedFile.h"
+#include "timers/CThreadPool.h"
+#include <stdio.h>
+#include <string.h>
+//---------------------------------------------------------------------------
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+// File identifier and version of mipmap cache files
+#define CHAI_MIP_MAGIC          "CHAIMIP"
+#define CHAI_MIP_VERSION        1
+#define CHAI_MIP_BYTE_ORDER     0x01020304
+
+// Minimum number of rows of a level computed by each thread
+#define CHAI_MIP_MIN_PARALLEL_ROWS  32
+
+// Header of a mipmap cache file (64 bytes), followed by the pixels of
+// levels 1 and above
+struct cMipFileHeader
+{
+    char m_magic[8];
+    unsigned int m_version;
+    unsigned int m_byteOrder;
+
+    // size (low and high words) and modification time of the image file
+    unsigned int m_sourceSize[2];
+    unsigned int m_sourceTime[2];
+
+    unsigned int m_width;
+    unsigned int m_height;
+    unsigned int m_components;
+    unsigned int m_numLevels;
+    unsigned int m_reserved[4];
+};
+
+// A level computed from the previous one
+struct cMipReduceTask
+{
+    const unsigned char* m_src;
+    unsigned int m_srcWidth;
+    unsigned int m_srcHeight;
+    unsigned char* m_dst;
+    unsigned int m_dstWidth;
+    unsigned int m_components;
+};
+
+//---------------------------------------------------------------------------
+
+// compute rows [a_begin, a_end) of a level with a 2x2 box filter; as the
+// sizes are rounded down, the last column or row of an odd sized level is
+// dropped, and a level one pixel wide or high is sampled twice
+static void reduce_rows(void* a_data, unsigned int a_begin, unsigned int a_end)
+{
+    const cMipReduceTask& task = *(const cMipReduceTask*)a_data;
+    const unsigned int n = task.m_components;
+    const size_t srcRow = (size_t)task.m_srcWidth * n;
+
+    for (unsigned int y=a_begin; y<a_end; y++)
+    {
+        const unsigned char* src0 = task.m_src + (size_t)(2*y) * srcRow;
+        const unsigned char* src1 = (2*y+1 < task.m_srcHeight) ? src0 + srcRow : src0;
+        unsigned char* dst = task.m_dst + (size_t)y * task.m_dstWidth * n;
+
+        for (unsigned int x=0; x<task.m_dstWidth; x++)
+        {
+            unsigned int dx1 = (2*x+1 < task.m_srcWidth) ? n : 0;
+            for (unsigned int k=0; k<n; k++)
+            {
+                dst[k] = (unsigned char)((src0[k] + src0[k+dx1] +
+                                          src1[k] + src1[k+dx1] + 2) >> 2);
+            }
+            src0 += 2*n;
+            src1 += 2*n;
+            dst += n;
+        }
+    }
+}
+
+#endif  // DOXYGEN_SHOULD_SKIP_THIS
+
+
+//===========================================================================
+/*!
+    Constructor of cMipmapChain.
+
+    \fn         cMipmapChain::cMipmapChain()
+*/
+//===========================================================================
+cMipmapChain::cMipmapChain()
+{
+    m_components = 0;
+}
+
+
+//===========================================================================
+/*!
+    Compute the size of each level from the size of the image, and
+    allocate the levels. Each level is half the size of the previous one,
+    rounded down, until both sizes reach 1.
+
+    \fn         void cMipmapChain::setSize(const unsigned int a_width,
+                const unsigned int a_height, const unsigned int a_components)
+    \param      a_width  Width of the image.
+    \param      a_height  Height of the image.
+    \param      a_components  Number of bytes per pixel.
+*/
+//===========================================================================
+void cMipmapChain::setSize(const unsigned int a_width, const unsigned int a_height,
+                           const unsigned int a_components)
+{
+    clear();
+    m_components = a_components;
+
+    unsigned int width = a_width;
+    unsigned int height = a_height;
+    m_width.push_back(width);
+    m_height.push_back(height);
+
+    while ((width > 1) || (height > 1))
+    {
+        width = (width > 1) ? width / 2 : 1;
+        height = (height > 1) ? height / 2 : 1;
+        m_width.push_back(width);
+        m_height.push_back(height);
+    }
+
+    m_levels.resize(m_width.size() - 1);
+    for (unsigned int i=1; i<m_width.size(); i++)
+    {
+        m_levels[i-1].resize((size_t)m_width[i] * m_height[i] * a_components);
+    }
+}
+
+
+//===========================================================================
+/*!
+    Compute the levels of an image. Each level is filtered from the
+    previous one; the rows of large levels are computed in parallel.
+
+    \fn         bool cMipmapChain::build(const unsigned char* a_data,
+                const unsigned int a_width, const unsigned int a_height,
+                const unsigned int a_components)
+    \param      a_data  Pixels of the image, rows stored one after the other.
+    \param      a_width  Width of the image.
+    \param      a_height  Height of the image.
+    \param      a_components  Number of bytes per pixel (3 or 4).
+    \return     Return \b true if the levels were computed.
+*/
+//===========================================================================
+bool cMipmapChain::build(const unsigned char* a_data, const unsigned int a_width,
+                         const unsigned int a_height, const unsigned int a_components)
+{
+    if ((a_data == NULL) || (a_width == 0) || (a_height == 0) ||
+        ((a_components != 3) && (a_components != 4)))
+    {
+        clear();
+        return (false);
+    }
+
+    setSize(a_width, a_height, a_components);
+
+    const unsigned char* src = a_data;
+    for (unsigned int i=1; i<m_width.size(); i++)
+    {
+        cMipReduceTask task;
+        task.m_src = src;
+        task.m_srcWidth = m_width[i-1];
+        task.m_srcHeight = m_height[i-1];
+        task.m_dst = &m_levels[i-1][0];
+        task.m_dstWidth = m_width[i];
+        task.m_components = a_components;
+
+        cThreadPool::getDefaultPool()->parallelFor(reduce_rows, &task, m_height[i],
+                                                   CHAI_MIP_MIN_PARALLEL_ROWS);
+        src = task.m_dst;
+    }
+
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Remove all levels.
+
+    \fn         void cMipmapChain::clear()
+*/
+//===========================================================================
+void cMipmapChain::clear()
+{
+    m_width.clear();
+    m_height.clear();
+    m_levels.clear();
+    m_components = 0;
+}
+
+
+//===========================================================================
+/*!
+    Load the levels from a cache file. The file is only loaded if it was
+    written for the current version of the image file, and for an image
+    of the given size.
+
+    \fn         bool cMipmapChain::loadFromFile(const string& a_fileName,
+                const string& a_sourceFileName, const unsigned int a_width,
+                const unsigned int a_height, const unsigned int a_components)
+    \param      a_fileName  Name of the cache file.
+    \param      a_sourceFileName  Name of the image file.
+    \param      a_width  Width of the image.
+    \param      a_height  Height of the image.
+    \param      a_components  Number of bytes per pixel.
+    \return     Return \b true if the levels were loaded.
+*/
+//===========================================================================
+bool cMipmapChain::loadFromFile(const string& a_fileName, const string& a_sourceFileName,
+                                const unsigned int a_width, const unsigned int a_height,
+                                const unsigned int a_components)
+{
+    clear();
+
+    unsigned int sourceSize[2], sourceTime[2];
+    if (!cMappedFile::getFileInfo(a_sourceFileName.c_str(), sourceSize, sourceTime)) { return (false); }
+
+    cMappedFile file;
+    if (!file.open(a_fileName.c_str())) { return (false); }
+    if (file.getSize() < sizeof(cMipFileHeader)) { return (false); }
+
+    cMipFileHeader header;
+    memcpy(&header, file.getData(), sizeof(header));
+    if ((memcmp(header.m_magic, CHAI_MIP_MAGIC, sizeof(CHAI_MIP_MAGIC)) != 0) ||
+        (header.m_version != CHAI_MIP_VERSION) ||
+        (header.m_byteOrder != CHAI_MIP_BYTE_ORDER) ||
+        (header.m_sourceSize[0] != sourceSize[0]) ||
+        (header.m_sourceSize[1] != sourceSize[1]) ||
+        (header.m_sourceTime[0] != sourceTime[0]) ||
+        (header.m_sourceTime[1] != sourceTime[1]) ||
+        (header.m_width != a_width) ||
+        (header.m_height != a_height) ||
+        (header.m_components != a_components))
+    {
+        return (false);
+    }
+
+    setSize(a_width, a_height, a_components);
+
+    // check the number of levels and the size of the file
+    size_t size = sizeof(cMipFileHeader);
+    for (unsigned int i=0; i<m_levels.size(); i++)
+    {
+        size += m_levels[i].size();
+    }
+    if ((header.m_numLevels != getNumLevels()) || (file.getSize() != size))
+    {
+        clear();
+        return (false);
+    }
+
+    // read levels
+    const char* data = file.getData() + sizeof(cMipFileHeader);
+    for (unsigned int i=0; i<m_levels.size(); i++)
+    {
+        memcpy(&m_levels[i][0], data, m_levels[i].size());
+        data += m_levels[i].size();
+    }
+
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Save the levels to a cache file, with the size and modification time
+    of the image file they were computed from.
+
+    \fn         bool cMipmapChain::saveToFile(const string& a_fileName,
+                const string& a_sourceFileName) const
+    \param      a_fileName  Name of the cache file.
+    \param      a_sourceFileName  Name of the image file.
+    \return     Return \b true if the file was written.
+*/
+//===========================================================================
+bool cMipmapChain::saveToFile(const string& a_fileName, const string& a_sourceFileName) const
+{
+    if (getNumLevels() == 0) { return (false); }
+
+    cMipFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_magic, CHAI_MIP_MAGIC, sizeof(CHAI_MIP_MAGIC));
+    header.m_version = CHAI_MIP_VERSION;
+    header.m_byteOrder = CHAI_MIP_BYTE_ORDER;
+    if (!cMappedFile::getFileInfo(a_sourceFileName.c_str(), header.m_sourceSize, header.m_sourceTime))
+    {
+        return (false);
+    }
+    header.m_width = m_width[0];
+    header.m_height = m_height[0];
+    header.m_components = m_components;
+    header.m_numLevels = getNumLevels();
+
+    FILE* file = fopen(a_fileName.c_str(), "wb");
+    if (file == NULL) { return (false); }
+
+    bool ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+    for (unsigned int i=0; ok && (i<m_levels.size()); i++)
+    {
+        ok = (fwrite(&m_levels[i][0], 1, m_levels[i].size(), file) == m_levels[i].size());
+    }
+
+    // a partly written file is removed
+    if (fclose(file) != 0) { ok = false; }
+    if (!ok) { remove(a_fileName.c_str()); }
+
+    return (ok);
+}
+
+
+//===========================================================================
+/*!
+    Upload levels 1 and above to the texture bound to GL_TEXTURE_2D. Level
+    0 must have been uploaded by the caller, from the image itself.
+
+    \fn         void cMipmapChain::upload(const unsigned int a_format) const
+    \param      a_format  Internal format of the texture.
+*/
+//===========================================================================
+void cMipmapChain::upload(const unsigned int a_format) const
+{
+    GLenum format = (m_components == 3) ? GL_RGB : GL_RGBA;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (unsigned int i=1; i<getNumLevels(); i++)
+    {
+        glTexImage2D(GL_TEXTURE_2D,
+                     i,
+                     a_format,
+                     m_width[i],
+                     m_height[i],
+                     0,
+                     format,
+                     GL_UNSIGNED_BYTE,
+                     getData(i)
+            );
+    }
+}
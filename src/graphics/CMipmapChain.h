@@ -0,0 +1,144 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CMipmapChainH
+#define CMipmapChainH
+//---------------------------------------------------------------------------
+#include "../extras/CGlobals.h"
+#include <string>
+#include <vector>
+//---------------------------------------------------------------------------
+using std::string;
+using std::vector;
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CMipmapChain.h
+
+    \brief
+    <b> Graphics </b> \n
+    Precomputed mipmap levels of a texture image.
+*/
+//===========================================================================
+
+//===========================================================================
+/*!
+    \class      cMipmapChain
+    \ingroup    graphics
+
+    \brief
+    cMipmapChain holds the reduced levels of an 8-bit RGB or RGBA image,
+    from half its size down to 1x1. Level 0 is the image itself and is not
+    stored. Each level is computed from the previous one with a 2x2 box
+    filter; the rows of a level are split among the threads of the
+    default cThreadPool.
+
+    The levels can be saved to a cache file, which records the size and
+    modification time of the image file, so that they are computed only
+    once for a given image. Once built, the chain is kept in memory and
+    uploaded level by level each time the OpenGL texture is created.
+*/
+//===========================================================================
+class cMipmapChain
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cMipmapChain.
+    cMipmapChain();
+
+    //! Destructor of cMipmapChain.
+    ~cMipmapChain() {}
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Compute the levels of an image with 3 or 4 bytes per pixel.
+    bool build(const unsigned char* a_data, const unsigned int a_width,
+               const unsigned int a_height, const unsigned int a_components);
+
+    //! Load the levels from a cache file written for the given image file.
+    bool loadFromFile(const string& a_fileName, const string& a_sourceFileName,
+                      const unsigned int a_width, const unsigned int a_height,
+                      const unsigned int a_components);
+
+    //! Save the levels to a cache file, recording the image file they were computed from.
+    bool saveToFile(const string& a_fileName, const string& a_sourceFileName) const;
+
+    //! Remove all levels.
+    void clear();
+
+    //! Upload the levels to the bound GL_TEXTURE_2D, after level 0 has been uploaded.
+    void upload(const unsigned int a_format) const;
+
+    //! Number of levels, including level 0.
+    unsigned int getNumLevels() const { return (m_width.size() > 0) ? (unsigned int)m_levels.size() + 1 : 0; }
+
+    //! Width of a level.
+    unsigned int getWidth(const unsigned int a_level) const { return (m_width[a_level]); }
+
+    //! Height of a level.
+    unsigned int getHeight(const unsigned int a_level) const { return (m_height[a_level]); }
+
+    //! Pixels of a level, for levels 1 and above.
+    const unsigned char* getData(const unsigned int a_level) const { return (&m_levels[a_level-1][0]); }
+
+    //! Number of bytes per pixel.
+    unsigned int getComponents() const { return (m_components); }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Compute the size of each level from the size of the image.
+    void setSize(const unsigned int a_width, const unsigned int a_height,
+                 const unsigned int a_components);
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Width of each level, starting at level 0.
+    vector<unsigned int> m_width;
+
+    //! Height of each level, starting at level 0.
+    vector<unsigned int> m_height;
+
+    //! Pixels of each level, starting at level 1.
+    vector< vector<unsigned char> > m_levels;
+
+    //! Number of bytes per pixel.
+    unsigned int m_components;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
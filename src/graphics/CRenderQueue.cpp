@@ -0,0 +1,588 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "graphics/CRenderQueue.h"
+//---------------------------------------------------------------------------
+#include "graphics/CTriangle.h"
+#include <algorithm>
+#include <functional>
+//---------------------------------------------------------------------------
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+// client arrays of an item
+#define CHAI_RENDER_QUEUE_VERTEX_ARRAY      0x01
+#define CHAI_RENDER_QUEUE_NORMAL_ARRAY      0x02
+#define CHAI_RENDER_QUEUE_COLOR_ARRAY       0x04
+#define CHAI_RENDER_QUEUE_TEXCOORD_ARRAY    0x08
+
+// compare the OpenGL properties of two materials (-1, 0 or 1)
+static int compare_materials(cMaterial& a_material0, cMaterial& a_material1)
+{
+    const cColorf* colors0[4] = { &a_material0.m_ambient, &a_material0.m_diffuse,
+                                  &a_material0.m_specular, &a_material0.m_emission };
+    const cColorf* colors1[4] = { &a_material1.m_ambient, &a_material1.m_diffuse,
+                                  &a_material1.m_specular, &a_material1.m_emission };
+    for (unsigned int i=0; i<4; i++)
+    {
+        for (unsigned int j=0; j<4; j++)
+        {
+            GLfloat value0 = (*colors0[i])[j];
+            GLfloat value1 = (*colors1[i])[j];
+            if (value0 < value1) { return (-1); }
+            if (value0 > value1) { return (1); }
+        }
+    }
+    GLuint shininess0 = a_material0.getShininess();
+    GLuint shininess1 = a_material1.getShininess();
+    if (shininess0 < shininess1) { return (-1); }
+    if (shininess0 > shininess1) { return (1); }
+    return (0);
+}
+
+// order of opaque items: by texture, then material, then the other states
+struct cRenderQueueStateOrder
+{
+    const vector<cRenderQueueItem>* m_items;
+
+    bool operator()(const unsigned int a_index0, const unsigned int a_index1) const
+    {
+        const cRenderQueueItem& item0 = (*m_items)[a_index0];
+        const cRenderQueueItem& item1 = (*m_items)[a_index1];
+
+        // objects drawing themselves come last
+        if (item0.m_stateManaged != item1.m_stateManaged) { return (item0.m_stateManaged); }
+        if (!item0.m_stateManaged) { return (item0.m_order < item1.m_order); }
+
+        if (item0.m_texture != item1.m_texture)
+        {
+            return (std::less<cTexture2D*>()(item0.m_texture, item1.m_texture));
+        }
+
+        bool useMaterial0 = item0.m_mesh->getUseMaterial();
+        bool useMaterial1 = item1.m_mesh->getUseMaterial();
+        if (useMaterial0 != useMaterial1) { return (useMaterial1); }
+        if (useMaterial0)
+        {
+            int result = compare_materials(item0.m_mesh->m_material, item1.m_mesh->m_material);
+            if (result != 0) { return (result < 0); }
+        }
+
+        bool useVertexColors0 = item0.m_mesh->getUseVertexColors();
+        bool useVertexColors1 = item1.m_mesh->getUseVertexColors();
+        if (useVertexColors0 != useVertexColors1) { return (useVertexColors1); }
+
+        if (item0.m_clientArrays != item1.m_clientArrays) { return (item0.m_clientArrays < item1.m_clientArrays); }
+        if (item0.m_polygonMode != item1.m_polygonMode) { return (item0.m_polygonMode < item1.m_polygonMode); }
+        if (item0.m_culling != item1.m_culling) { return (item1.m_culling); }
+
+        return (item0.m_order < item1.m_order);
+    }
+};
+
+// order of transparent items: back to front
+struct cRenderQueueDepthOrder
+{
+    const vector<cRenderQueueItem>* m_items;
+
+    bool operator()(const unsigned int a_index0, const unsigned int a_index1) const
+    {
+        const cRenderQueueItem& item0 = (*m_items)[a_index0];
+        const cRenderQueueItem& item1 = (*m_items)[a_index1];
+        if (item0.m_depth != item1.m_depth) { return (item0.m_depth > item1.m_depth); }
+        return (item0.m_order < item1.m_order);
+    }
+};
+
+#endif  // DOXYGEN_SHOULD_SKIP_THIS
+
+
+//===========================================================================
+/*!
+    Constructor of cRenderQueue.
+
+    \fn       cRenderQueue::cRenderQueue()
+*/
+//===========================================================================
+cRenderQueue::cRenderQueue()
+{
+    m_useMultipassTransparency = false;
+    m_numTextureChanges = 0;
+    m_numMaterialChanges = 0;
+    invalidateState();
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cRenderQueue.
+
+    \fn       cRenderQueue::~cRenderQueue()
+*/
+//===========================================================================
+cRenderQueue::~cRenderQueue()
+{
+}
+
+
+//===========================================================================
+/*!
+    Remove all items. The memory of the queue is kept, so that the items
+    of the next frame are added without allocation.
+
+    \fn       void cRenderQueue::clear()
+*/
+//===========================================================================
+void cRenderQueue::clear()
+{
+    m_items.clear();
+    m_opaque.clear();
+    m_transparent.clear();
+}
+
+
+//===========================================================================
+/*!
+    Add an item for an object, with the current OpenGL modelview matrix
+    and the view depth of the center of its boundary box.
+
+    \fn       cRenderQueueItem& cRenderQueue::addItem(cGenericObject* a_object)
+    \param    a_object  Object to be drawn.
+    \return   Return the new item.
+*/
+//===========================================================================
+cRenderQueueItem& cRenderQueue::addItem(cGenericObject* a_object)
+{
+    m_items.resize(m_items.size() + 1);
+    cRenderQueueItem& item = m_items.back();
+
+    item.m_object = a_object;
+    item.m_mesh = NULL;
+    item.m_stateManaged = false;
+    item.m_texture = NULL;
+    item.m_clientArrays = 0;
+    item.m_polygonMode = a_object->m_triangleMode;
+    item.m_culling = a_object->m_cullingEnabled;
+    item.m_transparent = a_object->m_useTransparency;
+    item.m_order = (unsigned int)(m_items.size() - 1);
+
+    glGetDoublev(GL_MODELVIEW_MATRIX, item.m_modelview);
+
+    // the camera looks down the negative z axis
+    cVector3d center = cMul(0.5, cAdd(a_object->m_boundaryBoxMin, a_object->m_boundaryBoxMax));
+    const double* m = item.m_modelview;
+    item.m_depth = -(m[2] * center.x + m[6] * center.y + m[10] * center.z + m[14]);
+
+    return (item);
+}
+
+
+//===========================================================================
+/*!
+    Add a mesh, drawn with the current OpenGL modelview matrix. Its
+    material, texture and client arrays are set by the queue.
+
+    \fn       void cRenderQueue::addMesh(cMesh* a_mesh)
+    \param    a_mesh  Mesh to be drawn.
+*/
+//===========================================================================
+void cRenderQueue::addMesh(cMesh* a_mesh)
+{
+    cRenderQueueItem& item = addItem(a_mesh);
+    item.m_mesh = a_mesh;
+
+    // display lists record their own state
+    if (a_mesh->m_useDisplayList)
+    {
+        return;
+    }
+    item.m_stateManaged = true;
+
+    bool useTexture = ((a_mesh->m_texture != NULL) && (a_mesh->m_useTextureMapping));
+    if (useTexture)
+    {
+        item.m_texture = a_mesh->m_texture;
+    }
+
+    // buffer objects enable and disable their own arrays
+    bool useArrays = (a_mesh->m_useVertexArrays || a_mesh->m_useVertexStreams);
+    if (useArrays && !a_mesh->isRenderedWithBufferObjects())
+    {
+        item.m_clientArrays = CHAI_RENDER_QUEUE_VERTEX_ARRAY | CHAI_RENDER_QUEUE_NORMAL_ARRAY;
+        if (a_mesh->m_useVertexColors) { item.m_clientArrays |= CHAI_RENDER_QUEUE_COLOR_ARRAY; }
+        if (useTexture) { item.m_clientArrays |= CHAI_RENDER_QUEUE_TEXCOORD_ARRAY; }
+    }
+}
+
+
+//===========================================================================
+/*!
+    Add an object that draws itself through render(), with the current
+    OpenGL modelview matrix.
+
+    \fn       void cRenderQueue::addObject(cGenericObject* a_object)
+    \param    a_object  Object to be drawn.
+*/
+//===========================================================================
+void cRenderQueue::addObject(cGenericObject* a_object)
+{
+    addItem(a_object);
+}
+
+
+//===========================================================================
+/*!
+    Sort and draw all items: opaque items first, grouped by render state,
+    then transparent items from back to front. When multipass
+    transparency is enabled, the back faces then the front faces of each
+    transparent object are drawn, which replaces the three traversals of
+    the scene graph done by cCamera. The OpenGL state is restored to the
+    defaults set by cMesh::renderMesh().
+
+    \fn       void cRenderQueue::render()
+*/
+//===========================================================================
+void cRenderQueue::render()
+{
+    m_numTextureChanges = 0;
+    m_numMaterialChanges = 0;
+
+    unsigned int i, numItems = (unsigned int)(m_items.size());
+    if (numItems == 0) { return; }
+
+    // split and sort items
+    m_opaque.clear();
+    m_transparent.clear();
+    for (i=0; i<numItems; i++)
+    {
+        if (m_items[i].m_transparent) { m_transparent.push_back(i); }
+        else { m_opaque.push_back(i); }
+    }
+
+    cRenderQueueStateOrder stateOrder;
+    stateOrder.m_items = &m_items;
+    std::sort(m_opaque.begin(), m_opaque.end(), stateOrder);
+
+    cRenderQueueDepthOrder depthOrder;
+    depthOrder.m_items = &m_items;
+    std::sort(m_transparent.begin(), m_transparent.end(), depthOrder);
+
+    // state common to all items
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    invalidateState();
+    glEnable(GL_LIGHTING);
+    glEnable(GL_DEPTH_TEST);
+    glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+    glDisableClientState(GL_INDEX_ARRAY);
+    glDisableClientState(GL_EDGE_FLAG_ARRAY);
+
+    // opaque items
+    numItems = (unsigned int)(m_opaque.size());
+    for (i=0; i<numItems; i++)
+    {
+        const cRenderQueueItem& item = m_items[m_opaque[i]];
+        renderItem(item, CHAI_RENDER_MODE_RENDER_ALL, item.m_culling ? GL_BACK : 0);
+    }
+
+    // transparent items
+    numItems = (unsigned int)(m_transparent.size());
+    for (i=0; i<numItems; i++)
+    {
+        const cRenderQueueItem& item = m_items[m_transparent[i]];
+        if (m_useMultipassTransparency)
+        {
+            renderItem(item, CHAI_RENDER_MODE_TRANSPARENT_BACK_ONLY, GL_FRONT);
+            renderItem(item, CHAI_RENDER_MODE_TRANSPARENT_FRONT_ONLY, GL_BACK);
+        }
+        else
+        {
+            renderItem(item, CHAI_RENDER_MODE_RENDER_ALL, item.m_culling ? GL_BACK : 0);
+        }
+    }
+
+    // restore OpenGL settings to reasonable defaults
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_COLOR_MATERIAL);
+    glDisable(GL_TEXTURE_2D);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDisable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    setClientArrays(0);
+    invalidateState();
+
+    glPopMatrix();
+}
+
+
+//===========================================================================
+/*!
+    Draw one item, sending only the state that differs from the current
+    one.
+
+    \fn       void cRenderQueue::renderItem(const cRenderQueueItem& a_item,
+                                const int a_renderMode, const GLenum a_cullFace)
+    \param    a_item  Item to be drawn.
+    \param    a_renderMode  Rendering mode passed to objects drawing themselves.
+    \param    a_cullFace  Faces to be culled (GL_FRONT or GL_BACK), or 0.
+*/
+//===========================================================================
+void cRenderQueue::renderItem(const cRenderQueueItem& a_item, const int a_renderMode,
+                              const GLenum a_cullFace)
+{
+    glLoadMatrixd(a_item.m_modelview);
+
+    if (m_polygonMode != a_item.m_polygonMode)
+    {
+        glPolygonMode(GL_FRONT_AND_BACK, a_item.m_polygonMode);
+        m_polygonMode = a_item.m_polygonMode;
+    }
+
+    if (m_cullFace != (int)a_cullFace)
+    {
+        if (a_cullFace == 0)
+        {
+            glDisable(GL_CULL_FACE);
+        }
+        else
+        {
+            if (m_cullFace <= 0) { glEnable(GL_CULL_FACE); }
+            glCullFace(a_cullFace);
+        }
+        m_cullFace = (int)a_cullFace;
+    }
+
+    int blending = a_item.m_transparent ? 1 : 0;
+    if (m_blending != blending)
+    {
+        if (blending)
+        {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+        }
+        else
+        {
+            glDisable(GL_BLEND);
+            glDepthMask(GL_TRUE);
+        }
+        m_blending = blending;
+    }
+
+    // objects drawing themselves may change any state
+    if (!a_item.m_stateManaged)
+    {
+        if (a_item.m_mesh != NULL)
+        {
+            a_item.m_mesh->renderMesh(a_renderMode);
+        }
+        else
+        {
+            a_item.m_object->render(a_renderMode);
+        }
+        invalidateState();
+        glEnable(GL_LIGHTING);
+        glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+        return;
+    }
+
+    setMaterial(a_item.m_mesh);
+    setTexture(a_item.m_texture);
+    setClientArrays(a_item.m_clientArrays);
+    a_item.m_mesh->renderTriangles();
+
+    // buffer objects leave all client arrays disabled
+    if (a_item.m_clientArrays == 0)
+    {
+        m_clientArrays = 0;
+    }
+}
+
+
+//===========================================================================
+/*!
+    Set the material, vertex color and default color state of a mesh, as
+    cMesh::renderMesh() does. Material properties are only sent if they
+    differ from the last ones; GL_COLOR_MATERIAL overwrites them, so they
+    are sent again after a mesh using it.
+
+    \fn       void cRenderQueue::setMaterial(cMesh* a_mesh)
+    \param    a_mesh  Mesh to be drawn.
+*/
+//===========================================================================
+void cRenderQueue::setMaterial(cMesh* a_mesh)
+{
+    bool useMaterial = a_mesh->m_useMaterialProperty;
+    bool useVertexColors = a_mesh->m_useVertexColors;
+
+    if (useMaterial)
+    {
+        if ((!m_materialValid) || (compare_materials(m_material, a_mesh->m_material) != 0))
+        {
+            a_mesh->m_material.render();
+            m_material = a_mesh->m_material;
+            m_materialValid = true;
+            m_numMaterialChanges++;
+        }
+
+        // cMaterial::render() disables GL_COLOR_MATERIAL
+        m_colorMaterial = 0;
+    }
+
+    if (useVertexColors)
+    {
+        // clear the effects of material properties
+        if (!useMaterial)
+        {
+            float fnull[4] = {0,0,0,0};
+            glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, (const float *)&fnull);
+            glMaterialfv(GL_FRONT_AND_BACK, GL_EMISSION, (const float *)&fnull);
+        }
+        setColorMaterial(true);
+    }
+    else if (useMaterial)
+    {
+        setColorMaterial(false);
+    }
+    else
+    {
+        // default color for objects without vertex colors or material
+        setColorMaterial(true);
+        glColor4f(1,1,1,1);
+    }
+}
+
+
+//===========================================================================
+/*!
+    Enable or disable GL_COLOR_MATERIAL. While it is enabled, colors
+    overwrite the current material.
+
+    \fn       void cRenderQueue::setColorMaterial(const bool a_colorMaterial)
+    \param    a_colorMaterial  If \b true, GL_COLOR_MATERIAL is enabled.
+*/
+//===========================================================================
+void cRenderQueue::setColorMaterial(const bool a_colorMaterial)
+{
+    if (a_colorMaterial)
+    {
+        m_materialValid = false;
+    }
+
+    int colorMaterial = a_colorMaterial ? 1 : 0;
+    if (m_colorMaterial == colorMaterial) { return; }
+
+    if (a_colorMaterial)
+    {
+        glEnable(GL_COLOR_MATERIAL);
+    }
+    else
+    {
+        glDisable(GL_COLOR_MATERIAL);
+    }
+    m_colorMaterial = colorMaterial;
+}
+
+
+//===========================================================================
+/*!
+    Bind a texture, or disable texture mapping.
+
+    \fn       void cRenderQueue::setTexture(cTexture2D* a_texture)
+    \param    a_texture  Texture to be bound, or \b NULL.
+*/
+//===========================================================================
+void cRenderQueue::setTexture(cTexture2D* a_texture)
+{
+    if (m_textureValid && (m_texture == a_texture)) { return; }
+
+    if (a_texture != NULL)
+    {
+        glEnable(GL_TEXTURE_2D);
+        a_texture->render();
+        m_numTextureChanges++;
+    }
+    else
+    {
+        glDisable(GL_TEXTURE_2D);
+    }
+    m_texture = a_texture;
+    m_textureValid = true;
+}
+
+
+//===========================================================================
+/*!
+    Enable the client arrays of a set of flags and disable the others,
+    only calling OpenGL for the arrays that change.
+
+    \fn       void cRenderQueue::setClientArrays(const unsigned int a_clientArrays)
+    \param    a_clientArrays  Combination of CHAI_RENDER_QUEUE_*_ARRAY flags.
+*/
+//===========================================================================
+void cRenderQueue::setClientArrays(const unsigned int a_clientArrays)
+{
+    const unsigned int flags[4] = { CHAI_RENDER_QUEUE_VERTEX_ARRAY, CHAI_RENDER_QUEUE_NORMAL_ARRAY,
+                                    CHAI_RENDER_QUEUE_COLOR_ARRAY, CHAI_RENDER_QUEUE_TEXCOORD_ARRAY };
+    const GLenum arrays[4] = { GL_VERTEX_ARRAY, GL_NORMAL_ARRAY,
+                               GL_COLOR_ARRAY, GL_TEXTURE_COORD_ARRAY };
+
+    for (unsigned int i=0; i<4; i++)
+    {
+        bool enable = ((a_clientArrays & flags[i]) != 0);
+        bool enabled = ((m_clientArrays & flags[i]) != 0);
+        if (m_clientArraysValid && (enable == enabled)) { continue; }
+
+        if (enable)
+        {
+            glEnableClientState(arrays[i]);
+        }
+        else
+        {
+            glDisableClientState(arrays[i]);
+        }
+    }
+    m_clientArrays = a_clientArrays;
+    m_clientArraysValid = true;
+}
+
+
+//===========================================================================
+/*!
+    Forget the current OpenGL state, after an object that changes it
+    without telling the queue.
+
+    \fn       void cRenderQueue::invalidateState()
+*/
+//===========================================================================
+void cRenderQueue::invalidateState()
+{
+    m_materialValid = false;
+    m_texture = NULL;
+    m_textureValid = false;
+    m_clientArrays = 0;
+    m_clientArraysValid = false;
+    m_colorMaterial = -1;
+    m_blending = -1;
+    m_cullFace = -1;
+    m_polygonMode = -1;
+}
@@ -0,0 +1,248 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CRenderQueueH
+#define CRenderQueueH
+//---------------------------------------------------------------------------
+#include "../graphics/CMaterial.h"
+#include <vector>
+//---------------------------------------------------------------------------
+using std::vector;
+//---------------------------------------------------------------------------
+class cGenericObject;
+class cMesh;
+class cTexture2D;
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CRenderQueue.h
+
+    \brief
+    <b> Graphics </b> \n
+    Queue of draw items sorted by render state.
+*/
+//===========================================================================
+
+//===========================================================================
+/*!
+    \struct     cRenderQueueItem
+    \ingroup    graphics
+
+    \brief
+    cRenderQueueItem is an object recorded by cRenderQueue, with the
+    modelview matrix it must be drawn with and the render state it needs.
+*/
+//===========================================================================
+struct cRenderQueueItem
+{
+    //! Object to be drawn.
+    cGenericObject* m_object;
+
+    //! Object as a mesh, or \b NULL.
+    cMesh* m_mesh;
+
+    //! If \b true, the queue sets the material, texture and client arrays of the mesh.
+    bool m_stateManaged;
+
+    //! OpenGL modelview matrix of the object (column-major).
+    double m_modelview[16];
+
+    //! Distance from the camera to the center of the boundary box, along the view axis.
+    double m_depth;
+
+    //! Texture bound while drawing, or \b NULL if texture mapping is disabled.
+    cTexture2D* m_texture;
+
+    //! Client arrays enabled while drawing (see cRenderQueue::setClientArrays()).
+    unsigned int m_clientArrays;
+
+    //! OpenGL polygon mode.
+    int m_polygonMode;
+
+    //! If \b true, back faces are culled.
+    bool m_culling;
+
+    //! If \b true, the object is blended and drawn back-to-front.
+    bool m_transparent;
+
+    //! Position of the object in the traversal of the scene graph.
+    unsigned int m_order;
+};
+
+
+//===========================================================================
+/*!
+    \class      cRenderQueue
+    \ingroup    graphics
+
+    \brief
+    cRenderQueue collects the objects to be drawn during the traversal of
+    the scene graph (see cGenericObject::beginRenderQueue()), then draws
+    them in an order that minimizes OpenGL state changes: opaque meshes
+    are sorted by texture, material, vertex colors, client arrays, polygon
+    mode and culling, and transparent objects are sorted back-to-front.
+    The queue keeps track of the current OpenGL state and only sends the
+    calls that change it, where cMesh::renderMesh() sets and resets
+    everything for each mesh.
+
+    Meshes rendered with display lists, and objects other than meshes,
+    draw themselves through render(); the queue then forgets the state it
+    knows, since these objects may change any of it.
+*/
+//===========================================================================
+class cRenderQueue
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cRenderQueue.
+    cRenderQueue();
+
+    //! Destructor of cRenderQueue.
+    ~cRenderQueue();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Remove all items; memory is kept for the next frame.
+    void clear();
+
+    //! Add a mesh with the current OpenGL modelview matrix.
+    void addMesh(cMesh* a_mesh);
+
+    //! Add an object that draws itself, with the current OpenGL modelview matrix.
+    void addObject(cGenericObject* a_object);
+
+    //! Sort and draw all items.
+    void render();
+
+    //! Draw the back faces then the front faces of each transparent object.
+    void setUseMultipassTransparency(const bool a_useMultipassTransparency) { m_useMultipassTransparency = a_useMultipassTransparency; }
+
+    //! Are back and front faces of transparent objects drawn in separate passes?
+    bool getUseMultipassTransparency() const { return (m_useMultipassTransparency); }
+
+    //! Number of items in the queue.
+    unsigned int getNumItems() const { return ((unsigned int)m_items.size()); }
+
+    //! Number of textures bound during the last call to render().
+    unsigned int getNumTextureChanges() const { return (m_numTextureChanges); }
+
+    //! Number of materials sent during the last call to render().
+    unsigned int getNumMaterialChanges() const { return (m_numMaterialChanges); }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Add an item for an object, with the current OpenGL modelview matrix.
+    cRenderQueueItem& addItem(cGenericObject* a_object);
+
+    //! Draw one item in a rendering mode, culling the given faces (0 for none).
+    void renderItem(const cRenderQueueItem& a_item, const int a_renderMode,
+                    const GLenum a_cullFace);
+
+    //! Set the material, vertex color and default color state of a mesh.
+    void setMaterial(cMesh* a_mesh);
+
+    //! Bind a texture, or disable texture mapping if \b NULL.
+    void setTexture(cTexture2D* a_texture);
+
+    //! Enable exactly the client arrays of a set of flags.
+    void setClientArrays(const unsigned int a_clientArrays);
+
+    //! Enable or disable GL_COLOR_MATERIAL.
+    void setColorMaterial(const bool a_colorMaterial);
+
+    //! Forget the OpenGL state; all of it is sent again by the next item.
+    void invalidateState();
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Items added since the last call to clear().
+    vector<cRenderQueueItem> m_items;
+
+    //! Indices of the opaque items, in drawing order.
+    vector<unsigned int> m_opaque;
+
+    //! Indices of the transparent items, in drawing order.
+    vector<unsigned int> m_transparent;
+
+    //! If \b true, back and front faces of transparent objects are drawn in separate passes.
+    bool m_useMultipassTransparency;
+
+    //! Number of textures bound during the last rendering.
+    unsigned int m_numTextureChanges;
+
+    //! Number of materials sent during the last rendering.
+    unsigned int m_numMaterialChanges;
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS - CURRENT OPENGL STATE:
+    //-----------------------------------------------------------------------
+
+    //! Last material sent to OpenGL.
+    cMaterial m_material;
+
+    //! If \b true, m_material is the current OpenGL material.
+    bool m_materialValid;
+
+    //! Bound texture, or \b NULL if texture mapping is disabled.
+    cTexture2D* m_texture;
+
+    //! If \b true, m_texture is known.
+    bool m_textureValid;
+
+    //! Enabled client arrays.
+    unsigned int m_clientArrays;
+
+    //! If \b true, m_clientArrays is known.
+    bool m_clientArraysValid;
+
+    //! GL_COLOR_MATERIAL: 1 if enabled, 0 if disabled, -1 if unknown.
+    int m_colorMaterial;
+
+    //! Blending: 1 if enabled, 0 if disabled, -1 if unknown.
+    int m_blending;
+
+    //! Culled faces: GL_FRONT or GL_BACK, 0 if culling is disabled, -1 if unknown.
+    int m_cullFace;
+
+    //! Polygon mode, or -1 if unknown.
+    int m_polygonMode;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -23,6 +23,13 @@
 #include "graphics/CTexture2D.h"
 //---------------------------------------------------------------------------
 
+//---------------------------------------------------------------------------
+// GLOBAL VARIABLES:
+//---------------------------------------------------------------------------
+bool g_textureShouldUseMipmapCache = false;
+
+//---------------------------------------------------------------------------
+
 //===========================================================================
 /*!
     A texture contains a 2D bitmap which can be projected onto the
@@ -180,7 +187,94 @@ void cTexture2D::render()
 //===========================================================================
 bool cTexture2D::loadFromFile(const char* a_fileName)
 {
-    return (m_image.loadFromFile(a_fileName));
+    m_mipmaps.clear();
+    m_updateTextureFlag = true;
+
+    bool result = m_image.loadFromFile(a_fileName);
+
+    // compute the mipmap levels now rather than on the first frame
+    if (result && m_useMipmaps)
+    {
+        buildMipmaps();
+    }
+
+    return (result);
+}
+
+
+//===========================================================================
+/*!
+      Enable or disable mipmaps. The mipmap levels are computed by
+      buildMipmaps(), when the image is loaded or at the latest when the
+      texture is first rendered. They are only used by OpenGL with a
+      minifying function such as GL_LINEAR_MIPMAP_LINEAR.
+
+      \fn         void cTexture2D::setUseMipmaps(const bool a_useMipmaps)
+      \param      a_useMipmaps  If \b true, mipmaps are used.
+*/
+//===========================================================================
+void cTexture2D::setUseMipmaps(const bool a_useMipmaps)
+{
+    if (m_useMipmaps != a_useMipmaps)
+    {
+        m_useMipmaps = a_useMipmaps;
+        m_updateTextureFlag = true;
+    }
+}
+
+
+//===========================================================================
+/*!
+      Compute the mipmap levels of the image with a box filter, in
+      parallel. If g_textureShouldUseMipmapCache is \b true, the levels are
+      read from the cache file of the image when it is up to date, and
+      written to it otherwise. The levels are kept in memory, so that a
+      context reset only uploads them again.
+
+      Levels are only computed for images whose sizes are powers of two;
+      other images are scaled to such sizes by gluBuild2DMipmaps() when
+      the texture is created.
+
+      \fn         bool cTexture2D::buildMipmaps()
+      \return     Return \b true if the levels are available.
+*/
+//===========================================================================
+bool cTexture2D::buildMipmaps()
+{
+    m_mipmaps.clear();
+    m_updateTextureFlag = true;
+
+    if (m_image.initialized() == 0) return (false);
+
+    unsigned int width = m_image.getWidth();
+    unsigned int height = m_image.getHeight();
+    unsigned int components = (m_image.getFormat() == GL_RGB ? 3 : 4);
+
+    if (((width & (width - 1)) != 0) || ((height & (height - 1)) != 0))
+    {
+        return (false);
+    }
+
+    // read the levels from the cache file
+    string fileName = m_image.getFilename();
+    string cacheFileName = fileName + ".chaimip";
+    bool useCache = g_textureShouldUseMipmapCache && (fileName.size() > 0);
+    if (useCache && m_mipmaps.loadFromFile(cacheFileName, fileName, width, height, components))
+    {
+        return (true);
+    }
+
+    // compute the levels, and update the cache file
+    if (!m_mipmaps.build(m_image.getData(), width, height, components))
+    {
+        return (false);
+    }
+    if (useCache)
+    {
+        m_mipmaps.saveToFile(cacheFileName, fileName);
+    }
+
+    return (true);
 }
 
 
@@ -211,14 +305,37 @@ void cTexture2D::update()
     {
         int components = (m_image.getFormat() == GL_RGB ? 3 : 4);
 
-        gluBuild2DMipmaps(GL_TEXTURE_2D,
-						  components,
-						  m_image.getWidth(),
-						  m_image.getHeight(),
-						  m_image.getFormat(),
-						  GL_UNSIGNED_BYTE,
-						  m_image.getData()
-              );
+        // levels are computed once, and only uploaded after a context reset
+        if (m_mipmaps.getNumLevels() == 0)
+        {
+            buildMipmaps();
+        }
+
+        if (m_mipmaps.getNumLevels() > 0)
+        {
+            glTexImage2D(GL_TEXTURE_2D,
+                         0,
+                         components,
+                         m_image.getWidth(),
+                         m_image.getHeight(),
+                         0,
+                         m_image.getFormat(),
+                         GL_UNSIGNED_BYTE,
+                         m_image.getData()
+                );
+            m_mipmaps.upload(components);
+        }
+        else
+        {
+            gluBuild2DMipmaps(GL_TEXTURE_2D,
+                              components,
+                              m_image.getWidth(),
+                              m_image.getHeight(),
+                              m_image.getFormat(),
+                              GL_UNSIGNED_BYTE,
+                              m_image.getData()
+                );
+        }
     }
 
     else
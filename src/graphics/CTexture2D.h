@@ -26,6 +26,7 @@
 #include "../files/CImageLoader.h"
 #include "../graphics/CColor.h"
 #include "../graphics/CGenericTexture.h"
+#include "../graphics/CMipmapChain.h"
 #include <string>
 #include <stdio.h>
 //---------------------------------------------------------------------------
@@ -40,6 +41,20 @@
 */
 //===========================================================================
 
+//---------------------------------------------------------------------------
+// GLOBAL VARIABLES:
+//---------------------------------------------------------------------------
+
+/*!
+    Clients can use this to cache the mipmap levels of textures in files. \n
+    If \b true, the levels computed by cTexture2D::buildMipmaps() are
+    saved in a file named after the image (\e image.tga.chaimip), and read
+    from that file as long as the image file does not change.
+    Default is \b false.
+*/
+extern bool g_textureShouldUseMipmapCache;
+
+
 //===========================================================================
 /*!
     \class      cTexture2D
@@ -110,6 +125,15 @@ class cTexture2D : public cGenericTexture
     //! Get the status of the spherical mapping mode.
     bool getSphericalMappingEnabled() { return (m_useSphericalMapping); }
 
+    //! Enable or disable mipmaps. A minifying function which uses mipmaps must also be set.
+    void setUseMipmaps(const bool a_useMipmaps);
+
+    //! Get the status of mipmaps.
+    bool getUseMipmaps() { return (m_useMipmaps); }
+
+    //! Compute the mipmap levels of the image, or read them from the cache file. Call again after modifying the image.
+    bool buildMipmaps();
+
     //! Image loader (use this to get data about the texture itself).
     cImageLoader m_image;
 
@@ -151,9 +175,12 @@ class cTexture2D : public cGenericTexture
     //! Texture minifying function. (\e GL_NEAREST or \e GL_LINEAR).
     GLint m_minifyingFunction;
 
-    //! If \b true, we use GLU to build mipmaps.
+    //! If \b true, we use mipmaps.
     bool m_useMipmaps;
 
+    //! Mipmap levels of the image, kept to create the texture again after a context reset.
+    cMipmapChain m_mipmaps;
+
     //! If \b true, we use spherical mapping.
     bool m_useSphericalMapping;
 
@@ -70,7 +70,7 @@ class cTriangle
         const unsigned int a_indexVertex1, const unsigned int a_indexVertex2) :
         m_indexVertex0(a_indexVertex0), m_indexVertex1(a_indexVertex1),
         m_indexVertex2(a_indexVertex2), m_parent(a_parent), m_allocated(false),
-        m_tag(0), m_neighbors(0), m_index(0)
+        m_tag(0), m_index(0)
     { }
 
     //-----------------------------------------------------------------------
@@ -79,7 +79,7 @@ class cTriangle
     */
     //-----------------------------------------------------------------------
     cTriangle() : m_indexVertex0(0), m_indexVertex1(0), m_indexVertex2(0),
-        m_index(0), m_parent(0), m_allocated(false), m_tag(0), m_neighbors(0)
+        m_index(0), m_parent(0), m_allocated(false), m_tag(0)
     { }
 
 
@@ -88,13 +88,7 @@ class cTriangle
         Destructor of cTriangle.
     */
     //-----------------------------------------------------------------------
-    ~cTriangle() {
-      if (m_neighbors) {
-        m_neighbors->clear();
-        //delete m_neighbors;
-        //m_neighbors = 0;
-      }
-    }
+    ~cTriangle() {}
 
 
 	//-----------------------------------------------------------------------
@@ -214,6 +208,38 @@ class cTriangle
 		return 0;
     }
 
+
+    //-----------------------------------------------------------------------
+    /*!
+        Read the number of neighbor triangles (triangles sharing a vertex
+        with this one, itself included). Returns 0 if the neighbor list
+        of the mesh has not been created.
+
+        \return     Return number of neighbors.
+    */
+    //-----------------------------------------------------------------------
+    inline unsigned int getNumNeighbors() const
+    {
+        if (m_parent == NULL) { return (0); }
+        return (m_parent->getNumTriangleNeighbors(m_index));
+    }
+
+
+    //-----------------------------------------------------------------------
+    /*!
+        Access a neighbor triangle.
+
+        \param      a_index  Neighbor number, less than getNumNeighbors().
+        \return     Return pointer to the neighbor triangle.
+    */
+    //-----------------------------------------------------------------------
+    inline cTriangle* getNeighbor(const unsigned int a_index) const
+    {
+        unsigned int neighbor = m_parent->getTriangleNeighbors(m_index)[a_index];
+        return (m_parent->getTriangle(neighbor));
+    }
+
+
     //-----------------------------------------------------------------------
     /*!
         Read index number of vertex 0 (defines a location in my owning
@@ -692,9 +718,6 @@ class cTriangle
 
     //! For custom use. No specific purpose.
     int m_tag;
-
-    //! A mesh can be organized into a network of neighboring triangles, which are stored here...
-    std::vector<cTriangle*>* m_neighbors;
 };
 
 //---------------------------------------------------------------------------
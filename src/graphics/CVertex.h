@@ -68,7 +68,8 @@ class cVertex
     //-----------------------------------------------------------------------
     cVertex(const double a_x=0.0, const double a_y=0.0, const double a_z=0.0)
         : m_localPos(a_x, a_y, a_z), m_globalPos(a_x, a_y, a_z), m_normal(0.0, 0.0, 1.0),
-        m_index(-1), m_allocated(false), m_nTriangles(0)
+        m_texCoord(0.0, 0.0, 0.0), m_index(-1), m_allocated(false), m_nTriangles(0),
+        m_tag(0)
     {}
      
 
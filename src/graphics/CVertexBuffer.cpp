@@ -0,0 +1,496 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "graphics/CVertexBuffer.h"
+//---------------------------------------------------------------------------
+#include "graphics/CVertex.h"
+#include "graphics/CTriangle.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#if defined(_LINUX)
+#include <GL/glx.h>
+#endif
+//---------------------------------------------------------------------------
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+//---------------------------------------------------------------------------
+// OpenGL 1.5 buffer object constants, missing from older gl.h headers.
+//---------------------------------------------------------------------------
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER             0x8892
+#endif
+#ifndef GL_ELEMENT_ARRAY_BUFFER
+#define GL_ELEMENT_ARRAY_BUFFER     0x8893
+#endif
+#ifndef GL_STATIC_DRAW
+#define GL_STATIC_DRAW              0x88E4
+#endif
+#ifndef GL_DYNAMIC_DRAW
+#define GL_DYNAMIC_DRAW             0x88E8
+#endif
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+//! Number of floats of an interleaved vertex: position, normal, texture coordinate, color.
+static const unsigned int CHAI_VERTEX_BUFFER_STRIDE = 12;
+
+//---------------------------------------------------------------------------
+// Buffer object entry points. Mac OS X exports them directly; on other
+// systems they are loaded from the driver the first time isSupported()
+// is called.
+//---------------------------------------------------------------------------
+#if defined(_MACOSX)
+
+static bool loadBufferFunctions() { return (true); }
+#define cglBindBuffer       glBindBuffer
+#define cglDeleteBuffers    glDeleteBuffers
+#define cglGenBuffers       glGenBuffers
+#define cglBufferData       glBufferData
+#define cglBufferSubData    glBufferSubData
+
+#else
+
+typedef void (APIENTRY *cGLBindBufferProc)(GLenum, GLuint);
+typedef void (APIENTRY *cGLDeleteBuffersProc)(GLsizei, const GLuint*);
+typedef void (APIENTRY *cGLGenBuffersProc)(GLsizei, GLuint*);
+typedef void (APIENTRY *cGLBufferDataProc)(GLenum, ptrdiff_t, const GLvoid*, GLenum);
+typedef void (APIENTRY *cGLBufferSubDataProc)(GLenum, ptrdiff_t, ptrdiff_t, const GLvoid*);
+
+static cGLBindBufferProc    cglBindBuffer    = NULL;
+static cGLDeleteBuffersProc cglDeleteBuffers = NULL;
+static cGLGenBuffersProc    cglGenBuffers    = NULL;
+static cGLBufferDataProc    cglBufferData    = NULL;
+static cGLBufferSubDataProc cglBufferSubData = NULL;
+
+static void* getBufferFunction(const char* a_name)
+{
+    // core name first, then the ARB_vertex_buffer_object name
+    char name[64];
+    void* function = NULL;
+    for (int i=0; (i<2) && (function == NULL); i++)
+    {
+        sprintf(name, (i == 0) ? "%s" : "%sARB", a_name);
+#if defined(_WIN32)
+        function = (void*)wglGetProcAddress(name);
+#else
+        function = (void*)glXGetProcAddressARB((const GLubyte*)name);
+#endif
+    }
+    return (function);
+}
+
+static bool loadBufferFunctions()
+{
+    if (cglBindBuffer != NULL) { return (true); }
+
+    cglDeleteBuffers = (cGLDeleteBuffersProc)getBufferFunction("glDeleteBuffers");
+    cglGenBuffers    = (cGLGenBuffersProc)getBufferFunction("glGenBuffers");
+    cglBufferData    = (cGLBufferDataProc)getBufferFunction("glBufferData");
+    cglBufferSubData = (cGLBufferSubDataProc)getBufferFunction("glBufferSubData");
+    cGLBindBufferProc bindBuffer = (cGLBindBufferProc)getBufferFunction("glBindBuffer");
+
+    if ((cglDeleteBuffers == NULL) || (cglGenBuffers == NULL) ||
+        (cglBufferData == NULL) || (cglBufferSubData == NULL) || (bindBuffer == NULL))
+    {
+        return (false);
+    }
+
+    // set last, it marks the functions as loaded
+    cglBindBuffer = bindBuffer;
+    return (true);
+}
+
+#endif
+
+#endif // DOXYGEN_SHOULD_SKIP_THIS
+
+
+//===========================================================================
+/*!
+    Constructor of cVertexBuffer.
+
+    \fn       cVertexBuffer::cVertexBuffer()
+*/
+//===========================================================================
+cVertexBuffer::cVertexBuffer()
+{
+    m_vertexBuffer = 0;
+    m_indexBuffer = 0;
+    m_numBufferVertices = 0;
+    m_numBufferIndices = 0;
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cVertexBuffer. OpenGL buffers are not deleted since no
+    context may be current; call release() beforehand.
+
+    \fn       cVertexBuffer::~cVertexBuffer()
+*/
+//===========================================================================
+cVertexBuffer::~cVertexBuffer()
+{
+}
+
+
+//===========================================================================
+/*!
+    Check whether buffer objects are available (OpenGL 1.5 or the
+    ARB_vertex_buffer_object extension). An OpenGL context must be current
+    the first time this method is called; the result is then cached.
+
+    \fn       bool cVertexBuffer::isSupported()
+    \return   Return \b true if buffer objects can be used.
+*/
+//===========================================================================
+bool cVertexBuffer::isSupported()
+{
+    // the answer does not change for the lifetime of the application
+    static int supported = -1;
+    if (supported >= 0) { return (supported == 1); }
+
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    const char* version = (const char*)glGetString(GL_VERSION);
+    if ((extensions == NULL) || (version == NULL)) { return (false); }
+    supported = 0;
+
+    bool available = (strstr(extensions, "GL_ARB_vertex_buffer_object") != NULL);
+    if (!available)
+    {
+        int major = 0, minor = 0;
+        sscanf(version, "%d.%d", &major, &minor);
+        available = ((major > 1) || ((major == 1) && (minor >= 5)));
+    }
+    if (!available) { return (false); }
+
+    if (loadBufferFunctions()) { supported = 1; }
+    return (supported == 1);
+}
+
+
+//===========================================================================
+/*!
+    Delete the OpenGL buffers. The local copy is kept, so the buffers are
+    created and filled again by the next call to updateVertices() and
+    updateTriangles().
+
+    \fn       void cVertexBuffer::release()
+*/
+//===========================================================================
+void cVertexBuffer::release()
+{
+    if ((m_vertexBuffer != 0) && (cglDeleteBuffers != NULL))
+    {
+        cglDeleteBuffers(1, &m_vertexBuffer);
+    }
+    if ((m_indexBuffer != 0) && (cglDeleteBuffers != NULL))
+    {
+        cglDeleteBuffers(1, &m_indexBuffer);
+    }
+    reset();
+}
+
+
+//===========================================================================
+/*!
+    Forget the OpenGL buffers without deleting them, for instance after the
+    OpenGL context has been destroyed along with its buffers.
+
+    \fn       void cVertexBuffer::reset()
+*/
+//===========================================================================
+void cVertexBuffer::reset()
+{
+    m_vertexBuffer = 0;
+    m_indexBuffer = 0;
+    m_numBufferVertices = 0;
+    m_numBufferIndices = 0;
+}
+
+
+//===========================================================================
+/*!
+    Convert all vertices and upload them. The buffer is only reallocated
+    when the number of vertices changes.
+
+    \fn       void cVertexBuffer::updateVertices(const vector<cVertex>& a_vertices)
+    \param    a_vertices  Vertices of the mesh.
+*/
+//===========================================================================
+void cVertexBuffer::updateVertices(const vector<cVertex>& a_vertices)
+{
+    if (!loadBufferFunctions()) { return; }
+
+    unsigned int numVertices = (unsigned int)(a_vertices.size());
+    m_data.resize(CHAI_VERTEX_BUFFER_STRIDE * numVertices);
+    convertVertices(a_vertices, 0, numVertices);
+
+    if (m_vertexBuffer == 0)
+    {
+        cglGenBuffers(1, &m_vertexBuffer);
+        m_numBufferVertices = 0;
+    }
+
+    cglBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    ptrdiff_t size = (ptrdiff_t)(m_data.size() * sizeof(float));
+    const float* data = m_data.empty() ? NULL : &m_data[0];
+    if (numVertices != m_numBufferVertices)
+    {
+        cglBufferData(GL_ARRAY_BUFFER, size, data, GL_DYNAMIC_DRAW);
+        m_numBufferVertices = numVertices;
+    }
+    else if (size > 0)
+    {
+        cglBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+    }
+    cglBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+//===========================================================================
+/*!
+    Convert and upload the vertices of a range. If the number of vertices
+    has changed since the buffer was allocated, all vertices are uploaded.
+
+    \fn       void cVertexBuffer::updateVertices(const vector<cVertex>& a_vertices,
+                                     unsigned int a_first, unsigned int a_last)
+    \param    a_vertices  Vertices of the mesh.
+    \param    a_first  First vertex.
+    \param    a_last  Last vertex (excluded).
+*/
+//===========================================================================
+void cVertexBuffer::updateVertices(const vector<cVertex>& a_vertices,
+                                   unsigned int a_first, unsigned int a_last)
+{
+    unsigned int numVertices = (unsigned int)(a_vertices.size());
+    if ((m_vertexBuffer == 0) || (numVertices != m_numBufferVertices))
+    {
+        updateVertices(a_vertices);
+        return;
+    }
+
+    if (a_last > numVertices) { a_last = numVertices; }
+    if (a_first >= a_last) { return; }
+
+    convertVertices(a_vertices, a_first, a_last);
+
+    unsigned int stride = CHAI_VERTEX_BUFFER_STRIDE * sizeof(float);
+    cglBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    cglBufferSubData(GL_ARRAY_BUFFER,
+                     (ptrdiff_t)(a_first * stride),
+                     (ptrdiff_t)((a_last - a_first) * stride),
+                     &m_data[CHAI_VERTEX_BUFFER_STRIDE * a_first]);
+    cglBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+//===========================================================================
+/*!
+    Pack the vertex indices of the allocated triangles and upload them.
+
+    \fn       void cVertexBuffer::updateTriangles(const vector<cTriangle>& a_triangles)
+    \param    a_triangles  Triangles of the mesh.
+*/
+//===========================================================================
+void cVertexBuffer::updateTriangles(const vector<cTriangle>& a_triangles)
+{
+    if (!loadBufferFunctions()) { return; }
+
+    unsigned int numTriangles = (unsigned int)(a_triangles.size());
+    m_indices.clear();
+    m_indices.reserve(3 * numTriangles);
+    for (unsigned int i=0; i<numTriangles; i++)
+    {
+        const cTriangle& triangle = a_triangles[i];
+        if (!triangle.m_allocated) { continue; }
+
+        m_indices.push_back(triangle.m_indexVertex0);
+        m_indices.push_back(triangle.m_indexVertex1);
+        m_indices.push_back(triangle.m_indexVertex2);
+    }
+
+    uploadIndices();
+}
+
+
+//===========================================================================
+/*!
+    Upload the indices of the triangles listed by the mesh as allocated,
+    without testing each triangle.
+
+    \fn       void cVertexBuffer::updateTriangles(const vector<cTriangle>& a_triangles,
+                                     const vector<unsigned int>& a_allocatedTriangles)
+    \param    a_triangles  Triangles of the mesh.
+    \param    a_allocatedTriangles  Indices of the allocated triangles.
+*/
+//===========================================================================
+void cVertexBuffer::updateTriangles(const vector<cTriangle>& a_triangles,
+                                    const vector<unsigned int>& a_allocatedTriangles)
+{
+    if (!loadBufferFunctions()) { return; }
+
+    unsigned int numTriangles = (unsigned int)(a_allocatedTriangles.size());
+    m_indices.resize(3 * numTriangles);
+    for (unsigned int i=0; i<numTriangles; i++)
+    {
+        const cTriangle& triangle = a_triangles[a_allocatedTriangles[i]];
+        m_indices[3*i+0] = triangle.m_indexVertex0;
+        m_indices[3*i+1] = triangle.m_indexVertex1;
+        m_indices[3*i+2] = triangle.m_indexVertex2;
+    }
+
+    uploadIndices();
+}
+
+
+//===========================================================================
+/*!
+    Send the local copy of the indices to the index buffer, creating it
+    if needed.
+
+    \fn       void cVertexBuffer::uploadIndices()
+*/
+//===========================================================================
+void cVertexBuffer::uploadIndices()
+{
+    if (m_indexBuffer == 0)
+    {
+        cglGenBuffers(1, &m_indexBuffer);
+    }
+
+    cglBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    cglBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                  (ptrdiff_t)(m_indices.size() * sizeof(unsigned int)),
+                  m_indices.empty() ? NULL : &m_indices[0],
+                  GL_STATIC_DRAW);
+    cglBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    m_numBufferIndices = (unsigned int)(m_indices.size());
+}
+
+
+//===========================================================================
+/*!
+    Draw the triangles from the buffers. Client states for the requested
+    attributes are enabled and disabled here.
+
+    \fn       void cVertexBuffer::render(const bool a_useNormals,
+                                         const bool a_useTexCoords,
+                                         const bool a_useColors)
+    \param    a_useNormals  If \b true, normals are passed to OpenGL.
+    \param    a_useTexCoords  If \b true, texture coordinates are passed to OpenGL.
+    \param    a_useColors  If \b true, vertex colors are passed to OpenGL.
+*/
+//===========================================================================
+void cVertexBuffer::render(const bool a_useNormals, const bool a_useTexCoords,
+                           const bool a_useColors)
+{
+    if ((!isCreated()) || (m_numBufferIndices == 0)) { return; }
+
+    GLsizei stride = CHAI_VERTEX_BUFFER_STRIDE * sizeof(float);
+    const char* base = NULL;
+
+    cglBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    cglBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, stride, base);
+
+    if (a_useNormals)
+    {
+        glEnableClientState(GL_NORMAL_ARRAY);
+        glNormalPointer(GL_FLOAT, stride, base + 3 * sizeof(float));
+    }
+    else
+    {
+        glDisableClientState(GL_NORMAL_ARRAY);
+    }
+
+    if (a_useTexCoords)
+    {
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, stride, base + 6 * sizeof(float));
+    }
+    else
+    {
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    }
+
+    if (a_useColors)
+    {
+        glEnableClientState(GL_COLOR_ARRAY);
+        glColorPointer(4, GL_FLOAT, stride, base + 8 * sizeof(float));
+    }
+    else
+    {
+        glDisableClientState(GL_COLOR_ARRAY);
+    }
+
+    glDrawElements(GL_TRIANGLES, m_numBufferIndices, GL_UNSIGNED_INT, NULL);
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    cglBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    cglBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+//===========================================================================
+/*!
+    Convert a range of vertices to the interleaved local copy.
+
+    \fn       void cVertexBuffer::convertVertices(const vector<cVertex>& a_vertices,
+                                     unsigned int a_first, unsigned int a_last)
+    \param    a_vertices  Vertices of the mesh.
+    \param    a_first  First vertex.
+    \param    a_last  Last vertex (excluded).
+*/
+//===========================================================================
+void cVertexBuffer::convertVertices(const vector<cVertex>& a_vertices,
+                                    unsigned int a_first, unsigned int a_last)
+{
+    for (unsigned int i=a_first; i<a_last; i++)
+    {
+        const cVertex& vertex = a_vertices[i];
+        float* data = &m_data[CHAI_VERTEX_BUFFER_STRIDE * i];
+
+        data[0]  = (float)vertex.m_localPos.x;
+        data[1]  = (float)vertex.m_localPos.y;
+        data[2]  = (float)vertex.m_localPos.z;
+        data[3]  = (float)vertex.m_normal.x;
+        data[4]  = (float)vertex.m_normal.y;
+        data[5]  = (float)vertex.m_normal.z;
+        data[6]  = (float)vertex.m_texCoord.x;
+        data[7]  = (float)vertex.m_texCoord.y;
+
+        const float* color = vertex.m_color.pColor();
+        data[8]  = color[0];
+        data[9]  = color[1];
+        data[10] = color[2];
+        data[11] = color[3];
+    }
+}
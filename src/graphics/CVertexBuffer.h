@@ -0,0 +1,155 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CVertexBufferH
+#define CVertexBufferH
+//---------------------------------------------------------------------------
+#include "../extras/CGlobals.h"
+#include <vector>
+//---------------------------------------------------------------------------
+using std::vector;
+//---------------------------------------------------------------------------
+class cVertex;
+class cTriangle;
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CVertexBuffer.h
+
+    \brief
+    <b> Graphics </b> \n
+    OpenGL vertex and index buffer objects.
+*/
+//===========================================================================
+
+//===========================================================================
+/*!
+    \class      cVertexBuffer
+    \ingroup    graphics
+
+    \brief
+    cVertexBuffer keeps the vertices of a mesh in an OpenGL vertex buffer
+    object, interleaved as single precision position, normal, texture
+    coordinate and color (12 floats per vertex), and the allocated
+    triangles in an index buffer object. Data is uploaded once; afterwards
+    only modified vertex ranges are sent with glBufferSubData(), and the
+    index buffer is only sent again when triangles change.
+
+    All methods except the update of the local copy must be called with
+    an OpenGL context current, typically from cMesh::renderMesh().
+*/
+//===========================================================================
+class cVertexBuffer
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cVertexBuffer.
+    cVertexBuffer();
+
+    //! Destructor of cVertexBuffer. Call release() first while the context is current.
+    ~cVertexBuffer();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Return \b true if the current OpenGL context supports buffer objects.
+    static bool isSupported();
+
+    //! Upload all vertices, reallocating the buffer if the number of vertices changed.
+    void updateVertices(const vector<cVertex>& a_vertices);
+
+    //! Upload the vertices of range [a_first, a_last).
+    void updateVertices(const vector<cVertex>& a_vertices,
+                        unsigned int a_first, unsigned int a_last);
+
+    //! Upload the indices of the allocated triangles.
+    void updateTriangles(const vector<cTriangle>& a_triangles);
+
+    //! Upload the indices of a list of allocated triangles.
+    void updateTriangles(const vector<cTriangle>& a_triangles,
+                         const vector<unsigned int>& a_allocatedTriangles);
+
+    //! Draw the triangles.
+    void render(const bool a_useNormals, const bool a_useTexCoords, const bool a_useColors);
+
+    //! Delete the OpenGL buffers; they are created again by the next upload.
+    void release();
+
+    //! Forget the OpenGL buffers without deleting them (after the context was destroyed).
+    void reset();
+
+    //! Return \b true if the buffers have been created.
+    bool isCreated() const { return ((m_vertexBuffer != 0) && (m_indexBuffer != 0)); }
+
+    //! Number of vertices in the buffer.
+    unsigned int getNumVertices() const { return (m_numBufferVertices); }
+
+    //! Number of indices in the buffer (three per allocated triangle).
+    unsigned int getNumIndices() const { return (m_numBufferIndices); }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Send the local copy of the indices to the index buffer.
+    void uploadIndices();
+
+    //! Convert vertices [a_first, a_last) to the interleaved local copy.
+    void convertVertices(const vector<cVertex>& a_vertices,
+                         unsigned int a_first, unsigned int a_last);
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Local copy of the interleaved vertex data.
+    vector<float> m_data;
+
+    //! Local copy of the triangle indices.
+    vector<unsigned int> m_indices;
+
+    //! OpenGL vertex buffer object.
+    GLuint m_vertexBuffer;
+
+    //! OpenGL index buffer object.
+    GLuint m_indexBuffer;
+
+    //! Number of vertices allocated in the vertex buffer object.
+    unsigned int m_numBufferVertices;
+
+    //! Number of indices stored in the index buffer object.
+    unsigned int m_numBufferIndices;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
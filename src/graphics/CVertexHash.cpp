@@ -0,0 +1,179 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "graphics/CVertexHash.h"
+//---------------------------------------------------------------------------
+#include "graphics/CVertex.h"
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cVertexHash.
+
+    \fn       cVertexHash::cVertexHash()
+*/
+//===========================================================================
+cVertexHash::cVertexHash()
+{
+    m_tableMask = 0;
+    m_numGroups = 0;
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cVertexHash.
+
+    \fn       cVertexHash::~cVertexHash()
+*/
+//===========================================================================
+cVertexHash::~cVertexHash()
+{
+}
+
+
+//===========================================================================
+/*!
+    Clear the table and the groups, and release their memory.
+
+    \fn       void cVertexHash::clear()
+*/
+//===========================================================================
+void cVertexHash::clear()
+{
+    vector<unsigned int>().swap(m_groups);
+    vector<unsigned int>().swap(m_bucketHead);
+    vector<unsigned int>().swap(m_bucketNext);
+    vector<int>().swap(m_cells);
+    m_tableMask = 0;
+    m_numGroups = 0;
+}
+
+
+//===========================================================================
+/*!
+    Group the allocated vertices of an array by position. Vertices are
+    visited in order; a vertex joins the group of the first earlier vertex
+    found within the tolerance, or starts a new group. Only the first
+    vertex of each group is stored in the table.
+
+    Grid cells are at least as large as the tolerance, so a matching
+    vertex is at most one cell away along each axis; in most cases only
+    the cell of the vertex is searched.
+
+    \fn       unsigned int cVertexHash::build(const vector<cVertex>& a_vertices,
+                                              const double a_tolerance)
+    \param    a_vertices  Vertices to be grouped.
+    \param    a_tolerance  Largest difference between the coordinates of
+                           two vertices of a group.
+    \return   Return the number of groups of allocated vertices.
+*/
+//===========================================================================
+unsigned int cVertexHash::build(const vector<cVertex>& a_vertices, const double a_tolerance)
+{
+    unsigned int numVertices = (unsigned int)(a_vertices.size());
+    unsigned int i;
+    m_numGroups = 0;
+
+    m_groups.resize(numVertices);
+    m_bucketNext.resize(numVertices);
+    m_cells.resize(3 * numVertices);
+    if (numVertices == 0) { return (0); }
+
+    // bounding box of the allocated vertices
+    cVector3d lower( CHAI_LARGE,  CHAI_LARGE,  CHAI_LARGE);
+    cVector3d upper(-CHAI_LARGE, -CHAI_LARGE, -CHAI_LARGE);
+    for (i=0; i<numVertices; i++)
+    {
+        if (!a_vertices[i].m_allocated) { continue; }
+        const cVector3d& pos = a_vertices[i].m_localPos;
+        lower.x = cMin(lower.x, pos.x);  upper.x = cMax(upper.x, pos.x);
+        lower.y = cMin(lower.y, pos.y);  upper.y = cMax(upper.y, pos.y);
+        lower.z = cMin(lower.z, pos.z);  upper.z = cMax(upper.z, pos.z);
+    }
+
+    // cells are no smaller than the tolerance, and there are at most a
+    // million cells along each axis so that cell coordinates fit in an int
+    double tolerance = cMax(a_tolerance, 0.0);
+    double extent = cMax3(upper.x - lower.x, upper.y - lower.y, upper.z - lower.z);
+    double cellSize = cMax(tolerance, 0.000001 * extent);
+    if (cellSize <= 0.0) { cellSize = 1.0; }
+    double invCellSize = 1.0 / cellSize;
+
+    // table of about twice the number of vertices
+    unsigned int numBuckets = 1;
+    while (numBuckets < 2 * numVertices) { numBuckets <<= 1; }
+    m_tableMask = numBuckets - 1;
+    m_bucketHead.assign(numBuckets, 0xFFFFFFFF);
+
+    for (i=0; i<numVertices; i++)
+    {
+        m_groups[i] = i;
+        if (!a_vertices[i].m_allocated) { continue; }
+        const cVector3d& pos = a_vertices[i].m_localPos;
+
+        // range of cells which may contain a matching vertex
+        int x0 = (int)floor((pos.x - tolerance - lower.x) * invCellSize);
+        int y0 = (int)floor((pos.y - tolerance - lower.y) * invCellSize);
+        int z0 = (int)floor((pos.z - tolerance - lower.z) * invCellSize);
+        int x1 = (int)floor((pos.x + tolerance - lower.x) * invCellSize);
+        int y1 = (int)floor((pos.y + tolerance - lower.y) * invCellSize);
+        int z1 = (int)floor((pos.z + tolerance - lower.z) * invCellSize);
+
+        bool found = false;
+        for (int x=x0; (x<=x1) && (!found); x++)
+        {
+            for (int y=y0; (y<=y1) && (!found); y++)
+            {
+                for (int z=z0; (z<=z1) && (!found); z++)
+                {
+                    unsigned int j = m_bucketHead[bucket(x, y, z)];
+                    while (j != 0xFFFFFFFF)
+                    {
+                        const int* cell = &m_cells[3*j];
+                        if ((cell[0] == x) && (cell[1] == y) && (cell[2] == z) &&
+                            cEqualPoints(pos, a_vertices[j].m_localPos, tolerance))
+                        {
+                            m_groups[i] = j;
+                            found = true;
+                            break;
+                        }
+                        j = m_bucketNext[j];
+                    }
+                }
+            }
+        }
+        if (found) { continue; }
+
+        // start a new group, stored in the cell of the vertex
+        int* cell = &m_cells[3*i];
+        cell[0] = (int)floor((pos.x - lower.x) * invCellSize);
+        cell[1] = (int)floor((pos.y - lower.y) * invCellSize);
+        cell[2] = (int)floor((pos.z - lower.z) * invCellSize);
+
+        unsigned int b = bucket(cell[0], cell[1], cell[2]);
+        m_bucketNext[i] = m_bucketHead[b];
+        m_bucketHead[b] = i;
+        m_numGroups++;
+    }
+
+    return (m_numGroups);
+}
@@ -0,0 +1,138 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CVertexHashH
+#define CVertexHashH
+//---------------------------------------------------------------------------
+#include "../math/CMaths.h"
+#include <vector>
+//---------------------------------------------------------------------------
+using std::vector;
+//---------------------------------------------------------------------------
+class cVertex;
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CVertexHash.h
+
+    \brief
+    <b> Graphics </b> \n
+    Grouping of vertices located at the same position.
+*/
+//===========================================================================
+
+//===========================================================================
+/*!
+    \class      cVertexHash
+    \ingroup    graphics
+
+    \brief
+    cVertexHash finds the vertices of an array which are located at the
+    same position, within a tolerance, as an earlier vertex of the array.
+    Positions are sorted into a uniform grid whose cells are hashed into
+    a table of about twice the number of vertices, so grouping takes
+    linear time whatever the distribution of the vertices, including
+    meshes where many vertices share a coordinate.
+
+    Each allocated vertex is assigned to a group, identified by the index
+    of the first vertex of the group. Two vertices belong to the same
+    group if each coordinate of their positions differs by less than the
+    tolerance from the first vertex of the group (see cEqualPoints()).
+*/
+//===========================================================================
+class cVertexHash
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cVertexHash.
+    cVertexHash();
+
+    //! Destructor of cVertexHash.
+    ~cVertexHash();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Group the allocated vertices of an array by position. Returns the number of groups.
+    unsigned int build(const vector<cVertex>& a_vertices, const double a_tolerance=CHAI_SMALL);
+
+    //! Clear the table and the groups.
+    void clear();
+
+    //! Group of a vertex: index of the first vertex located at its position.
+    inline unsigned int getGroup(const unsigned int a_index) const { return (m_groups[a_index]); }
+
+    //! Group of each vertex. Vertices which are not allocated are their own group.
+    inline const vector<unsigned int>& getGroups() const { return (m_groups); }
+
+    //! Number of groups of allocated vertices found by the last build.
+    inline unsigned int getNumGroups() const { return (m_numGroups); }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Hash table bucket of a grid cell.
+    inline unsigned int bucket(const int a_x, const int a_y, const int a_z) const
+    {
+        unsigned int h = ((unsigned int)(a_x) * 73856093u) ^
+                         ((unsigned int)(a_y) * 19349663u) ^
+                         ((unsigned int)(a_z) * 83492791u);
+        return (h & m_tableMask);
+    }
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Group of each vertex.
+    vector<unsigned int> m_groups;
+
+    //! First vertex of each bucket, or 0xFFFFFFFF if the bucket is empty.
+    vector<unsigned int> m_bucketHead;
+
+    //! Next vertex in the same bucket, for the first vertex of each group.
+    vector<unsigned int> m_bucketNext;
+
+    //! Grid cell of the first vertex of each group (three coordinates per vertex).
+    vector<int> m_cells;
+
+    //! Number of buckets minus one (number of buckets is a power of two).
+    unsigned int m_tableMask;
+
+    //! Number of groups found by the last build.
+    unsigned int m_numGroups;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,210 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "graphics/CVertexStreams.h"
+//---------------------------------------------------------------------------
+#include "graphics/CVertex.h"
+#include "graphics/CTriangle.h"
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cVertexStreams.
+
+    \fn       cVertexStreams::cVertexStreams()
+*/
+//===========================================================================
+cVertexStreams::cVertexStreams()
+{
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cVertexStreams.
+
+    \fn       cVertexStreams::~cVertexStreams()
+*/
+//===========================================================================
+cVertexStreams::~cVertexStreams()
+{
+}
+
+
+//===========================================================================
+/*!
+    Clear all streams and release their memory.
+
+    \fn       void cVertexStreams::clear()
+*/
+//===========================================================================
+void cVertexStreams::clear()
+{
+    vector<float>().swap(m_positions);
+    vector<float>().swap(m_normals);
+    vector<float>().swap(m_texCoords);
+    vector<float>().swap(m_colors);
+    vector<unsigned int>().swap(m_indices);
+}
+
+
+//===========================================================================
+/*!
+    Convert all vertices to the streams and rebuild the index array.
+
+    \fn       void cVertexStreams::update(const vector<cVertex>& a_vertices,
+                                          const vector<cTriangle>& a_triangles)
+    \param    a_vertices  Vertices of the mesh.
+    \param    a_triangles  Triangles of the mesh.
+*/
+//===========================================================================
+void cVertexStreams::update(const vector<cVertex>& a_vertices,
+                            const vector<cTriangle>& a_triangles)
+{
+    updateVertices(a_vertices);
+    updateIndices(a_triangles);
+}
+
+
+//===========================================================================
+/*!
+    Convert all vertices to the streams, resizing them if the number of
+    vertices changed.
+
+    \fn       void cVertexStreams::updateVertices(const vector<cVertex>& a_vertices)
+    \param    a_vertices  Vertices of the mesh.
+*/
+//===========================================================================
+void cVertexStreams::updateVertices(const vector<cVertex>& a_vertices)
+{
+    unsigned int numVertices = (unsigned int)(a_vertices.size());
+    m_positions.resize(3 * numVertices);
+    m_normals.resize(3 * numVertices);
+    m_texCoords.resize(2 * numVertices);
+    m_colors.resize(4 * numVertices);
+
+    updateVertices(a_vertices, 0, numVertices);
+}
+
+
+//===========================================================================
+/*!
+    Convert a range of vertices to the streams. If the number of vertices
+    has changed since the streams were sized, all vertices are converted.
+
+    \fn       void cVertexStreams::updateVertices(const vector<cVertex>& a_vertices,
+                                          unsigned int a_first, unsigned int a_last)
+    \param    a_vertices  Vertices of the mesh.
+    \param    a_first  First vertex.
+    \param    a_last  Last vertex (excluded).
+*/
+//===========================================================================
+void cVertexStreams::updateVertices(const vector<cVertex>& a_vertices,
+                                    unsigned int a_first, unsigned int a_last)
+{
+    unsigned int numVertices = (unsigned int)(a_vertices.size());
+    if (numVertices != getNumVertices())
+    {
+        updateVertices(a_vertices);
+        return;
+    }
+    if (a_last > numVertices) { a_last = numVertices; }
+
+    for (unsigned int i=a_first; i<a_last; i++)
+    {
+        const cVertex& vertex = a_vertices[i];
+
+        float* position = &m_positions[3*i];
+        position[0] = (float)vertex.m_localPos.x;
+        position[1] = (float)vertex.m_localPos.y;
+        position[2] = (float)vertex.m_localPos.z;
+
+        float* normal = &m_normals[3*i];
+        normal[0] = (float)vertex.m_normal.x;
+        normal[1] = (float)vertex.m_normal.y;
+        normal[2] = (float)vertex.m_normal.z;
+
+        float* texCoord = &m_texCoords[2*i];
+        texCoord[0] = (float)vertex.m_texCoord.x;
+        texCoord[1] = (float)vertex.m_texCoord.y;
+
+        const float* source = vertex.m_color.pColor();
+        float* color = &m_colors[4*i];
+        color[0] = source[0];
+        color[1] = source[1];
+        color[2] = source[2];
+        color[3] = source[3];
+    }
+}
+
+
+//===========================================================================
+/*!
+    Rebuild the index array from the allocated triangles, so that holes
+    left by removed triangles are skipped when drawing.
+
+    \fn       void cVertexStreams::updateIndices(const vector<cTriangle>& a_triangles)
+    \param    a_triangles  Triangles of the mesh.
+*/
+//===========================================================================
+void cVertexStreams::updateIndices(const vector<cTriangle>& a_triangles)
+{
+    unsigned int numTriangles = (unsigned int)(a_triangles.size());
+    m_indices.clear();
+    m_indices.reserve(3 * numTriangles);
+
+    for (unsigned int i=0; i<numTriangles; i++)
+    {
+        const cTriangle& triangle = a_triangles[i];
+        if (!triangle.m_allocated) { continue; }
+
+        m_indices.push_back(triangle.m_indexVertex0);
+        m_indices.push_back(triangle.m_indexVertex1);
+        m_indices.push_back(triangle.m_indexVertex2);
+    }
+}
+
+
+//===========================================================================
+/*!
+    Rebuild the index array from the list of allocated triangles
+    maintained by the mesh, without testing each triangle.
+
+    \fn       void cVertexStreams::updateIndices(const vector<cTriangle>& a_triangles,
+                                    const vector<unsigned int>& a_allocatedTriangles)
+    \param    a_triangles  Triangles of the mesh.
+    \param    a_allocatedTriangles  Indices of the allocated triangles.
+*/
+//===========================================================================
+void cVertexStreams::updateIndices(const vector<cTriangle>& a_triangles,
+                                   const vector<unsigned int>& a_allocatedTriangles)
+{
+    unsigned int numTriangles = (unsigned int)(a_allocatedTriangles.size());
+    m_indices.resize(3 * numTriangles);
+
+    for (unsigned int i=0; i<numTriangles; i++)
+    {
+        const cTriangle& triangle = a_triangles[a_allocatedTriangles[i]];
+        m_indices[3*i+0] = triangle.m_indexVertex0;
+        m_indices[3*i+1] = triangle.m_indexVertex1;
+        m_indices[3*i+2] = triangle.m_indexVertex2;
+    }
+}
@@ -0,0 +1,144 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CVertexStreamsH
+#define CVertexStreamsH
+//---------------------------------------------------------------------------
+#include <vector>
+//---------------------------------------------------------------------------
+using std::vector;
+//---------------------------------------------------------------------------
+class cVertex;
+class cTriangle;
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CVertexStreams.h
+
+    \brief
+    <b> Graphics </b> \n
+    Compact vertex streams for rendering.
+*/
+//===========================================================================
+
+//===========================================================================
+/*!
+    \class      cVertexStreams
+    \ingroup    graphics
+
+    \brief
+    cVertexStreams stores the rendering attributes of an array of vertices
+    as separate contiguous single precision streams (position, normal,
+    texture coordinate and color), together with a packed index array of
+    the allocated triangles. A vertex takes 48 bytes in the streams
+    instead of the size of a cVertex, and each stream can be passed to
+    OpenGL without stride. The streams are a copy: cVertex remains the
+    reference data, in double precision, used by haptic rendering and
+    collision detection.
+*/
+//===========================================================================
+class cVertexStreams
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cVertexStreams.
+    cVertexStreams();
+
+    //! Destructor of cVertexStreams.
+    ~cVertexStreams();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Convert all vertices and rebuild the index array.
+    void update(const vector<cVertex>& a_vertices, const vector<cTriangle>& a_triangles);
+
+    //! Convert all vertices, resizing the streams if the number of vertices changed.
+    void updateVertices(const vector<cVertex>& a_vertices);
+
+    //! Convert the vertices of range [a_first, a_last).
+    void updateVertices(const vector<cVertex>& a_vertices,
+                        unsigned int a_first, unsigned int a_last);
+
+    //! Rebuild the index array from the allocated triangles.
+    void updateIndices(const vector<cTriangle>& a_triangles);
+
+    //! Rebuild the index array from a list of allocated triangles.
+    void updateIndices(const vector<cTriangle>& a_triangles,
+                       const vector<unsigned int>& a_allocatedTriangles);
+
+    //! Clear all streams.
+    void clear();
+
+    //! Number of vertices in the streams.
+    unsigned int getNumVertices() const { return (unsigned int)(m_positions.size() / 3); }
+
+    //! Number of indices (three per allocated triangle).
+    unsigned int getNumIndices() const { return (unsigned int)(m_indices.size()); }
+
+    //! Position stream (3 floats per vertex).
+    const float* getPositions() const { return (m_positions.empty() ? 0 : &m_positions[0]); }
+
+    //! Normal stream (3 floats per vertex).
+    const float* getNormals() const { return (m_normals.empty() ? 0 : &m_normals[0]); }
+
+    //! Texture coordinate stream (2 floats per vertex).
+    const float* getTexCoords() const { return (m_texCoords.empty() ? 0 : &m_texCoords[0]); }
+
+    //! Color stream (4 floats per vertex).
+    const float* getColors() const { return (m_colors.empty() ? 0 : &m_colors[0]); }
+
+    //! Index array of the allocated triangles.
+    const unsigned int* getIndices() const { return (m_indices.empty() ? 0 : &m_indices[0]); }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Vertex positions.
+    vector<float> m_positions;
+
+    //! Vertex normals.
+    vector<float> m_normals;
+
+    //! Vertex texture coordinates.
+    vector<float> m_texCoords;
+
+    //! Vertex colors.
+    vector<float> m_colors;
+
+    //! Vertex indices of the allocated triangles.
+    vector<unsigned int> m_indices;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -60,6 +60,14 @@ cCamera::cCamera(cWorld* a_parentWorld)
     // disable multipass transparency rendering by default
     m_useMultipassTransparency = 0;
 
+    // disable frustum culling by default; boundary boxes must be up to date
+    m_useFrustumCulling = false;
+    m_numFrustumTests = 0;
+    m_numFrustumCulled = 0;
+
+    // draw objects in scene graph order by default
+    m_useRenderQueue = false;
+
     m_performingDisplayReset = 0;
 
     memset(m_projectionMatrix,0,sizeof(m_projectionMatrix));
@@ -424,8 +432,26 @@ void cCamera::renderView(const int a_windowWidth, const int a_windowHeight,
     glDepthMask(GL_TRUE);
     glEnable(GL_DEPTH_TEST);
 
+    // optionally cull objects outside the view frustum
+    if (m_useFrustumCulling)
+    {
+      cGenericObject::beginFrustumCulling(m_projectionMatrix);
+    }
+
+    // optionally collect objects and draw them sorted by render state;
+    // the queue draws transparent objects back-to-front in one pass
+    if (m_useRenderQueue)
+    {
+      m_renderQueue.clear();
+      m_renderQueue.setUseMultipassTransparency(m_useMultipassTransparency);
+      cGenericObject::beginRenderQueue(&m_renderQueue);
+      m_parentWorld->renderSceneGraph(CHAI_RENDER_MODE_RENDER_ALL);
+      cGenericObject::endRenderQueue();
+      m_renderQueue.render();
+    }
+
     // optionally perform multiple rendering passes for transparency
-    if (m_useMultipassTransparency) {
+    else if (m_useMultipassTransparency) {
       m_parentWorld->renderSceneGraph(CHAI_RENDER_MODE_NON_TRANSPARENT_ONLY);
       m_parentWorld->renderSceneGraph(CHAI_RENDER_MODE_TRANSPARENT_BACK_ONLY);
       m_parentWorld->renderSceneGraph(CHAI_RENDER_MODE_TRANSPARENT_FRONT_ONLY);
@@ -435,6 +461,13 @@ void cCamera::renderView(const int a_windowWidth, const int a_windowHeight,
       m_parentWorld->renderSceneGraph(CHAI_RENDER_MODE_RENDER_ALL);
     }        
 
+    if (m_useFrustumCulling)
+    {
+      m_numFrustumTests = cGenericObject::getNumFrustumTests();
+      m_numFrustumCulled = cGenericObject::getNumFrustumCulled();
+      cGenericObject::endFrustumCulling();
+    }
+
     // render the 'front' 2d object layer; it will set up its own
     // projection matrix
     if (m_front_2Dscene.getNumChildren())
@@ -506,6 +539,60 @@ void cCamera::enableMultipassTransparency(bool enable) {
 }
 
 
+//===========================================================================
+/*!
+      Enable or disable frustum culling. When enabled, objects whose
+      boundary box lies outside the view frustum are not rendered, and
+      when the box of an object includes its children, the whole subtree
+      is skipped at once (see cGenericObject::beginFrustumCulling()).
+
+      Boundary boxes are not updated during rendering: call
+      computeBoundaryBox(true) on the world after objects are added,
+      moved or deformed, otherwise visible objects may be culled. This is
+      why culling is disabled by default.
+
+      The number of boxes tested and of objects culled during the last
+      rendering are returned by getNumFrustumTests() and
+      getNumFrustumCulled().
+
+      \fn         void cCamera::setUseFrustumCulling(const bool a_useFrustumCulling)
+      \param      a_useFrustumCulling  If \b true, frustum culling is enabled.
+*/
+//===========================================================================
+void cCamera::setUseFrustumCulling(const bool a_useFrustumCulling)
+{
+    m_useFrustumCulling = a_useFrustumCulling;
+}
+
+
+//===========================================================================
+/*!
+      Enable or disable the render queue. When enabled, the scene graph is
+      traversed once and meshes are collected in a cRenderQueue instead
+      of being drawn, then drawn with their opaque parts sorted by
+      texture and material, and transparent objects sorted back-to-front.
+      OpenGL state is only changed between meshes that differ, instead of
+      being set and reset for each mesh.
+
+      Multipass transparency (see enableMultipassTransparency()) is then
+      performed per object by the queue, which draws back faces then front
+      faces of each transparent object, without traversing the scene graph
+      three times. Opaque objects other than meshes are still drawn during
+      the traversal.
+
+      The numbers of items, texture and material changes of the last
+      rendering are available from getRenderQueue().
+
+      \fn         void cCamera::setUseRenderQueue(const bool a_useRenderQueue)
+      \param      a_useRenderQueue  If \b true, the render queue is enabled.
+*/
+//===========================================================================
+void cCamera::setUseRenderQueue(const bool a_useRenderQueue)
+{
+    m_useRenderQueue = a_useRenderQueue;
+}
+
+
 //===========================================================================
 /*!
     This call automatically adjusts the front and back clipping planes to
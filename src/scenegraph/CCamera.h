@@ -26,6 +26,7 @@
 #include "../scenegraph/CGenericObject.h"
 #include "../math/CMaths.h"
 #include "../files/CImageLoader.h"
+#include "../graphics/CRenderQueue.h"
 //---------------------------------------------------------------------------
 class cWorld;
 //---------------------------------------------------------------------------
@@ -222,6 +223,27 @@ class cCamera : public cGenericObject
     //! Enable or disable additional rendering passes for transparency (see full comment).
     virtual void enableMultipassTransparency(bool enable);
 
+    //! Enable or disable culling of objects outside the view frustum (see full comment).
+    void setUseFrustumCulling(const bool a_useFrustumCulling);
+
+    //! Is culling of objects outside the view frustum enabled?
+    bool getUseFrustumCulling() const { return (m_useFrustumCulling); }
+
+    //! Number of boundary boxes tested against the view frustum during the last rendering.
+    unsigned int getNumFrustumTests() const { return (m_numFrustumTests); }
+
+    //! Number of objects culled during the last rendering (counted once per rendering pass).
+    unsigned int getNumFrustumCulled() const { return (m_numFrustumCulled); }
+
+    //! Enable or disable sorting objects by render state before drawing them (see full comment).
+    void setUseRenderQueue(const bool a_useRenderQueue);
+
+    //! Are objects sorted by render state before being drawn?
+    bool getUseRenderQueue() const { return (m_useRenderQueue); }
+
+    //! Render queue of this camera, with the statistics of the last rendering.
+    cRenderQueue* getRenderQueue() { return (&m_renderQueue); }
+
     //! Resets textures and displays for the world associated with this camera.
     virtual void onDisplayReset(const bool a_affectChildren = true);
 
@@ -281,6 +303,21 @@ class cCamera : public cGenericObject
     //! If true, three rendering passes are performed to approximate back-front sorting (see long comment)
     bool m_useMultipassTransparency;
 
+    //! If true, objects whose boundary box is outside the view frustum are not rendered.
+    bool m_useFrustumCulling;
+
+    //! Number of boundary boxes tested during the last rendering.
+    unsigned int m_numFrustumTests;
+
+    //! Number of objects culled during the last rendering.
+    unsigned int m_numFrustumCulled;
+
+    //! If true, objects are collected in m_renderQueue and drawn sorted by render state.
+    bool m_useRenderQueue;
+
+    //! Render queue used when m_useRenderQueue is enabled.
+    cRenderQueue m_renderQueue;
+
     //! Render a 2d scene within this camera's view.
     void render2dSceneGraph(cGenericObject* a_graph, int a_width, int a_height);
 
@@ -22,11 +22,22 @@
 //---------------------------------------------------------------------------
 #include "scenegraph/CGenericObject.h"
 #include "collisions/CGenericCollision.h"
+#include "graphics/CRenderQueue.h"
 #include <float.h>
+#include <string.h>
 //---------------------------------------------------------------------------
 #include <vector>
 //---------------------------------------------------------------------------
 
+//---------------------------------------------------------------------------
+bool cGenericObject::m_frustumCulling = false;
+double cGenericObject::m_frustumProjection[16];
+bool cGenericObject::m_frustumInside = false;
+unsigned int cGenericObject::m_numFrustumTests = 0;
+unsigned int cGenericObject::m_numFrustumCulled = 0;
+cRenderQueue* cGenericObject::m_renderQueue = NULL;
+//---------------------------------------------------------------------------
+
 //===========================================================================
 /*!
     Constructor of cGenericObject.
@@ -38,6 +49,7 @@ cGenericObject::cGenericObject() : m_parent(NULL),
 m_localPos(0.0, 0.0, 0.0), m_globalPos(0.0, 0.0, 0.0),
 m_show(true), m_showFrame(false), m_frameSize(1.0), m_frameThicknessScale(2.0),
 m_boundaryBoxMin(0.0, 0.0, 0.0), m_boundaryBoxMax(0.0, 0.0, 0.0),
+m_boundaryBoxIncludesChildren(false),
 m_showBox(false), m_boundaryBoxColor(0.5, 0.5, 0.0),
 m_showTree(false), m_treeColor(0.5, 0.0, 0.0),
 m_collisionDetector(NULL), m_showCollisionTree(false),
@@ -1702,6 +1714,7 @@ void cGenericObject::computeBoundaryBox(const bool a_includeChildren)
 
     // compute the bounding box of this object
     updateBoundaryBox();
+    m_boundaryBoxIncludesChildren = a_includeChildren;
 
     if (a_includeChildren == false) return;
 
@@ -1968,6 +1981,30 @@ void cGenericObject::renderSceneGraph(const int a_renderMode)
     m_frameGL.set(m_localPos, m_localRot);
     m_frameGL.glMatrixPushMultiply();
 
+    // test my boundary box against the view frustum. if it includes my
+    // children, the whole subtree is culled, or needs no further test
+    // when entirely inside.
+    bool parentInside = m_frustumInside;
+    bool renderSelf = true;
+    if (m_frustumCulling && !m_frustumInside)
+    {
+        int result = testFrustum();
+        if (result == 0)
+        {
+            m_numFrustumCulled++;
+            if (m_boundaryBoxIncludesChildren)
+            {
+                m_frameGL.glMatrixPop();
+                return;
+            }
+            renderSelf = false;
+        }
+        else if ((result == 2) && m_boundaryBoxIncludesChildren)
+        {
+            m_frustumInside = true;
+        }
+    }
+
     // Handle rendering meta-object components, e.g. collision trees,
     // bounding boxes, scenegraph tree, etc.
     // set up useful rendering state
@@ -1981,8 +2018,9 @@ void cGenericObject::renderSceneGraph(const int a_renderMode)
     // Render non transparent components of cGenericObject
     //-----------------------------------------------------------------------
 
-    if (a_renderMode == CHAI_RENDER_MODE_NON_TRANSPARENT_ONLY ||
-        a_renderMode == CHAI_RENDER_MODE_RENDER_ALL)
+    if (renderSelf &&
+        (a_renderMode == CHAI_RENDER_MODE_NON_TRANSPARENT_ONLY ||
+         a_renderMode == CHAI_RENDER_MODE_RENDER_ALL))
     {
         // disable lighting
         glDisable(GL_LIGHTING);
@@ -2047,7 +2085,14 @@ void cGenericObject::renderSceneGraph(const int a_renderMode)
     //-----------------------------------------------------------------------
     // Render graphical representation of object
     //-----------------------------------------------------------------------
-    if (m_show)
+    bool renderNow = (m_show && renderSelf);
+    if (renderNow && (m_renderQueue != NULL) && (a_renderMode == CHAI_RENDER_MODE_RENDER_ALL))
+    {
+        // the render queue may draw the object later, sorted by state
+        renderNow = !enqueue(m_renderQueue);
+    }
+
+    if (renderNow)
     {
         // set polygon and face mode
         glPolygonMode(GL_FRONT_AND_BACK, m_triangleMode);
@@ -2147,6 +2192,7 @@ void cGenericObject::renderSceneGraph(const int a_renderMode)
     {
         m_children[i]->renderSceneGraph(a_renderMode);
     }
+    m_frustumInside = parentInside;
 
     // pop current matrix
     m_frameGL.glMatrixPop();
@@ -2156,6 +2202,164 @@ void cGenericObject::renderSceneGraph(const int a_renderMode)
 }
 
 
+//===========================================================================
+/*!
+    Start culling objects against the view frustum in renderSceneGraph().
+    An object whose boundary box lies outside the frustum is not
+    rendered; if its box was computed including its children (see
+    computeBoundaryBox()), its children are skipped too, and are not
+    tested if the box lies entirely inside the frustum. Objects without a
+    valid boundary box (lights, cameras, empty groups) are never culled.
+
+    Boundary boxes are not updated during rendering: they must be
+    computed again after objects are moved or deformed, otherwise
+    visible objects may be culled. Culling statistics are reset.
+
+    \fn     void cGenericObject::beginFrustumCulling(const double* a_projectionMatrix)
+    \param  a_projectionMatrix  OpenGL projection matrix (column-major) of the view.
+*/
+//===========================================================================
+void cGenericObject::beginFrustumCulling(const double* a_projectionMatrix)
+{
+    memcpy(m_frustumProjection, a_projectionMatrix, sizeof(m_frustumProjection));
+    m_frustumCulling = true;
+    m_frustumInside = false;
+    m_numFrustumTests = 0;
+    m_numFrustumCulled = 0;
+}
+
+
+//===========================================================================
+/*!
+    Stop culling objects against the view frustum. Statistics of the last
+    culled rendering remain available.
+
+    \fn     void cGenericObject::endFrustumCulling()
+*/
+//===========================================================================
+void cGenericObject::endFrustumCulling()
+{
+    m_frustumCulling = false;
+    m_frustumInside = false;
+}
+
+
+//===========================================================================
+/*!
+    Start collecting objects in a render queue during renderSceneGraph()
+    (see enqueue()). Objects accepted by the queue are not drawn during
+    the traversal; the caller draws them with cRenderQueue::render()
+    after endRenderQueue(). The queue is only used in the
+    CHAI_RENDER_MODE_RENDER_ALL rendering mode.
+
+    \fn     void cGenericObject::beginRenderQueue(cRenderQueue* a_queue)
+    \param  a_queue  Render queue collecting the objects.
+*/
+//===========================================================================
+void cGenericObject::beginRenderQueue(cRenderQueue* a_queue)
+{
+    m_renderQueue = a_queue;
+}
+
+
+//===========================================================================
+/*!
+    Stop collecting objects in a render queue; renderSceneGraph() draws
+    objects again as it traverses them.
+
+    \fn     void cGenericObject::endRenderQueue()
+*/
+//===========================================================================
+void cGenericObject::endRenderQueue()
+{
+    m_renderQueue = NULL;
+}
+
+
+//===========================================================================
+/*!
+    Add this object to a render queue instead of rendering it during the
+    traversal of the scene graph. Opaque objects are rendered at once;
+    transparent objects are added to the queue, which draws them
+    back-to-front with the other transparent objects. Subclasses whose
+    render state can be sorted (see cMesh) override this method.
+
+    \fn     bool cGenericObject::enqueue(cRenderQueue* a_queue)
+    \param  a_queue  Render queue of the current view.
+    \return Return \b true if the queue draws the object.
+*/
+//===========================================================================
+bool cGenericObject::enqueue(cRenderQueue* a_queue)
+{
+    if (!m_useTransparency) { return (false); }
+
+    a_queue->addObject(this);
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Test the boundary box of this object, expressed in the current OpenGL
+    modelview frame, against the six planes of the view frustum, which
+    are extracted from the product of the projection and modelview
+    matrices. A box is outside if its corner furthest along the normal of
+    one plane is behind that plane.
+
+    \fn     int cGenericObject::testFrustum() const
+    \return Return 0 if the box is outside the frustum, 2 if it is inside,
+            and 1 if it intersects the frustum or is not valid.
+*/
+//===========================================================================
+int cGenericObject::testFrustum() const
+{
+    // empty boxes are never culled
+    if (cDistance(m_boundaryBoxMax, m_boundaryBoxMin) <= BOUNDARY_BOX_EPSILON) { return (1); }
+    m_numFrustumTests++;
+
+    // clip matrix: projection * modelview (column-major)
+    double modelview[16];
+    glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
+    double clip[16];
+    int i, j;
+    for (i=0; i<4; i++)
+    {
+        for (j=0; j<4; j++)
+        {
+            clip[4*i+j] = m_frustumProjection[j]    * modelview[4*i]   +
+                          m_frustumProjection[4+j]  * modelview[4*i+1] +
+                          m_frustumProjection[8+j]  * modelview[4*i+2] +
+                          m_frustumProjection[12+j] * modelview[4*i+3];
+        }
+    }
+
+    // planes are the sums and differences of the last row with the others
+    bool inside = true;
+    for (i=0; i<6; i++)
+    {
+        int row = i / 2;
+        double sign = (i % 2 == 0) ? 1.0 : -1.0;
+        double a = clip[3]  + sign * clip[row];
+        double b = clip[7]  + sign * clip[4+row];
+        double c = clip[11] + sign * clip[8+row];
+        double d = clip[15] + sign * clip[12+row];
+
+        // corners furthest and nearest along the plane normal
+        double distanceMax = d + a * ((a > 0.0) ? m_boundaryBoxMax.x : m_boundaryBoxMin.x) +
+                          b * ((b > 0.0) ? m_boundaryBoxMax.y : m_boundaryBoxMin.y) +
+                          c * ((c > 0.0) ? m_boundaryBoxMax.z : m_boundaryBoxMin.z);
+        double distanceMin = d + a * ((a > 0.0) ? m_boundaryBoxMin.x : m_boundaryBoxMax.x) +
+                          b * ((b > 0.0) ? m_boundaryBoxMin.y : m_boundaryBoxMax.y) +
+                          c * ((c > 0.0) ? m_boundaryBoxMin.z : m_boundaryBoxMax.z);
+
+        if (distanceMax < 0.0) { return (0); }
+        if (distanceMin < 0.0) { inside = false; }
+    }
+
+    return (inside ? 2 : 1);
+}
+
+
 //===========================================================================
 /*!
     Render this object.  Subclasses will generally override this method.
@@ -44,6 +44,7 @@ class cTriangle;
 class cGenericCollision;
 class cGenericPointForceAlgo;
 class cMesh;
+class cRenderQueue;
 //---------------------------------------------------------------------------
 // TYPE DEFINITION
 //---------------------------------------------------------------------------
@@ -92,6 +93,7 @@ typedef enum {
 //===========================================================================
 class cGenericObject : public cGenericType
 {
+  friend class cRenderQueue;
 
   public:
     
@@ -275,6 +277,24 @@ class cGenericObject : public cGenericType
     //! Render the entire scene graph, starting from this object.
     virtual void renderSceneGraph(const int a_renderMode=CHAI_RENDER_MODE_RENDER_ALL);
 
+    //! Start culling objects whose boundary box is outside the view frustum (called by cCamera).
+    static void beginFrustumCulling(const double* a_projectionMatrix);
+
+    //! Stop culling objects against the view frustum.
+    static void endFrustumCulling();
+
+    //! Number of boundary boxes tested against the view frustum since beginFrustumCulling().
+    static unsigned int getNumFrustumTests() { return (m_numFrustumTests); }
+
+    //! Number of objects culled since beginFrustumCulling().
+    static unsigned int getNumFrustumCulled() { return (m_numFrustumCulled); }
+
+    //! Start collecting objects in a render queue instead of drawing them (called by cCamera).
+    static void beginRenderQueue(cRenderQueue* a_queue);
+
+    //! Stop collecting objects in a render queue.
+    static void endRenderQueue();
+
 
     //-----------------------------------------------------------------------
     // METHODS - GRAPHIC RENDERING:
@@ -579,6 +599,37 @@ class cGenericObject : public cGenericType
     //! Maximum position of boundary box.
     cVector3d m_boundaryBoxMax;
 
+    //! If \b true, the boundary box was last computed including my children.
+    bool m_boundaryBoxIncludesChildren;
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - FRUSTUM CULLING:
+	//-----------------------------------------------------------------------
+
+    //! If \b true, objects are culled against the view frustum while rendering.
+    static bool m_frustumCulling;
+
+    //! Projection matrix of the view frustum.
+    static double m_frustumProjection[16];
+
+    //! If \b true, the object being rendered lies entirely inside the view frustum.
+    static bool m_frustumInside;
+
+    //! Number of boundary boxes tested.
+    static unsigned int m_numFrustumTests;
+
+    //! Number of objects culled.
+    static unsigned int m_numFrustumCulled;
+
+
+	//-----------------------------------------------------------------------
+    // MEMBERS - RENDER QUEUE:
+	//-----------------------------------------------------------------------
+
+    //! Render queue collecting the objects, or \b NULL if objects are drawn during the traversal.
+    static cRenderQueue* m_renderQueue;
+
 
 	//-----------------------------------------------------------------------
     // MEMBERS - FRAME REPRESENTATION [X,Y,Z]:
@@ -677,12 +728,18 @@ class cGenericObject : public cGenericType
     //! Render this object in OpenGL.
     virtual void render(const int a_renderMode=CHAI_RENDER_MODE_RENDER_ALL);
 
+    //! Add this object to a render queue, and return \b true if the queue draws it.
+    virtual bool enqueue(cRenderQueue* a_queue);
+
     //! Update the m_globalPos and m_globalRot properties of any members of this object (e.g. all triangles).
     virtual void updateGlobalPositions(const bool a_frameOnly) {};
 
     //! Update the bounding box of this object, based on object-specific data (e.g. triangle positions).
     virtual void updateBoundaryBox() {};
 
+    //! Test my boundary box against the view frustum: 0 if outside, 1 if intersecting, 2 if inside.
+    int testFrustum() const;
+
     //! Scale current object with scale factors along x, y and z.
     virtual void scaleObject(const cVector3d& a_scaleFactors) {};
 
@@ -28,8 +28,69 @@
 #include "collisions/CCollisionAABB.h"
 #include "collisions/CCollisionSpheres.h"
 #include "files/CMeshLoader.h"
+#include "graphics/CVertexHash.h"
+#include "graphics/CRenderQueue.h"
 #include <algorithm>
-#include <set>
+//---------------------------------------------------------------------------
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+//! Below this number of items, normals are computed on the calling thread.
+#define CHAI_MESH_MIN_PARALLEL_NORMALS  4096
+
+//! Description of a normal computation shared by the thread pool tasks.
+struct cMeshNormalTask
+{
+    //! Mesh whose normals are computed.
+    cMesh* m_mesh;
+
+    //! Positions of the triangles to process, or NULL for all allocated triangles.
+    const unsigned int* m_triangles;
+
+    //! First vertex to process.
+    unsigned int m_firstVertex;
+};
+
+
+//! Score of a vertex for vertex cache optimization (see cMesh::optimizeVertexCache()).
+static double vertex_cache_score(const int a_cachePosition, const unsigned int a_valence,
+                                 const unsigned int a_cacheSize)
+{
+    // no triangle left to draw with this vertex
+    if (a_valence == 0) { return (-1.0); }
+
+    double score = 0.0;
+    if (a_cachePosition >= 0)
+    {
+        if (a_cachePosition < 3)
+        {
+            // vertices of the last triangle: fixed score, so that the
+            // next triangle is not forced to reuse them
+            score = 0.75;
+        }
+        else
+        {
+            double scale = 1.0 / (double)(a_cacheSize - 3);
+            score = pow(1.0 - (double)(a_cachePosition - 3) * scale, 1.5);
+        }
+    }
+
+    // boost vertices with few triangles left, to finish them off
+    score += 2.0 / sqrt((double)a_valence);
+    return (score);
+}
+
+
+//! Make room for a_size items in a vector. The capacity is at least doubled
+//! when it grows, so that repeated appends copy the vector a constant
+//! number of times per item on average.
+template <class T> static void grow_capacity(std::vector<T>& a_vector, const size_t a_size)
+{
+    if (a_size <= a_vector.capacity()) { return; }
+    a_vector.reserve(cMax(2 * a_vector.capacity(), a_size));
+}
+
+#endif  // DOXYGEN_SHOULD_SKIP_THIS
 //---------------------------------------------------------------------------
 
 //===========================================================================
@@ -75,6 +136,14 @@ cMesh::cMesh(cWorld* a_world)
 
     // Vertex array disabled by default
     m_useVertexArrays = false;
+
+    // Vertex streams and buffer objects disabled by default
+    m_useVertexStreams = false;
+    m_useVertexBufferObjects = false;
+
+    // normal adjacency is built by the first normal computation
+    m_normalCacheValid = false;
+    m_normalStamp = 0;
 }
 
 
@@ -102,6 +171,9 @@ cMesh::~cMesh()
     // Delete any allocated display lists
     if (m_displayList != -1)
       glDeleteLists(m_displayList,1);
+
+    // Delete any allocated buffer objects
+    m_vertexBuffer.release();
 }
 
 
@@ -456,6 +528,106 @@ void cMesh::useVertexArrays(const bool a_useVertexArrays, const bool a_affectChi
 }
 
 
+//===========================================================================
+/*!
+     This enables rendering from compact vertex streams. Positions,
+     normals, texture coordinates and colors are copied to separate single
+     precision arrays, and the allocated triangles to a packed index array,
+     which are drawn with a single call to glDrawElements(). The double
+     precision vertices remain the reference data for haptics.
+
+     Streams are converted again after any mesh operation which modifies
+     vertices or triangles. If you modify vertices directly, call
+     markModifiedVertices() (or invalidateDisplayList()).
+
+     \fn       void cMesh::useVertexStreams(const bool a_useVertexStreams,
+										   const bool a_affectChildren)
+     \param    a_useVertexStreams  If \b true, this mesh will be rendered from vertex streams
+     \param    a_affectChildren  If \b true, then children also modified.
+*/
+//===========================================================================
+void cMesh::useVertexStreams(const bool a_useVertexStreams, const bool a_affectChildren)
+{
+    // update changes to object
+    m_useVertexStreams = a_useVertexStreams;
+
+    // release streams when they are not used
+    if (!m_useVertexStreams)
+    {
+        m_vertexStreams.clear();
+    }
+    m_renderVertices.markAll();
+    m_renderTriangles.markAll();
+
+    // propagate changes to children
+    if (a_affectChildren)
+    {
+        unsigned int i, numItems;
+        numItems = m_children.size();
+        for (i=0; i<numItems; i++)
+        {
+            cGenericObject *nextObject = m_children[i];
+
+            cMesh *nextMesh = dynamic_cast<cMesh*>(nextObject);
+            if (nextMesh)
+            {
+                nextMesh->useVertexStreams(a_useVertexStreams, a_affectChildren);
+            }
+        }
+    }
+}
+
+
+//===========================================================================
+/*!
+     This enables rendering from OpenGL vertex buffer objects. Vertices
+     are kept on the graphics card as interleaved single precision
+     attributes, together with an index buffer of the allocated triangles.
+     After the first upload, vertices are only sent again when they are
+     modified, and indices only when triangles are added or removed.
+
+     If the OpenGL context does not support buffer objects, or if a
+     display list is used, the mesh is rendered by the other methods.
+     If you modify vertices directly, call markModifiedVertices().
+
+     \fn       void cMesh::useVertexBufferObjects(const bool a_useVertexBufferObjects,
+										   const bool a_affectChildren)
+     \param    a_useVertexBufferObjects  If \b true, this mesh will be rendered from buffer objects
+     \param    a_affectChildren  If \b true, then children also modified.
+*/
+//===========================================================================
+void cMesh::useVertexBufferObjects(const bool a_useVertexBufferObjects, const bool a_affectChildren)
+{
+    // update changes to object
+    m_useVertexBufferObjects = a_useVertexBufferObjects;
+
+    // release buffers when they are not used
+    if (!m_useVertexBufferObjects)
+    {
+        m_vertexBuffer.release();
+    }
+    m_renderVertices.markAll();
+    m_renderTriangles.markAll();
+
+    // propagate changes to children
+    if (a_affectChildren)
+    {
+        unsigned int i, numItems;
+        numItems = m_children.size();
+        for (i=0; i<numItems; i++)
+        {
+            cGenericObject *nextObject = m_children[i];
+
+            cMesh *nextMesh = dynamic_cast<cMesh*>(nextObject);
+            if (nextMesh)
+            {
+                nextMesh->useVertexBufferObjects(a_useVertexBufferObjects, a_affectChildren);
+            }
+        }
+    }
+}
+
+
 //===========================================================================
 /*!
      Returns the number of triangles contained in this mesh, optionally
@@ -525,6 +697,8 @@ unsigned int cMesh::newVertex(const double a_x, const double a_y, const double a
         newVertex.m_index = index;
         m_vertices.push_back(newVertex);
     }
+    m_modifiedPositions.mark(index);
+    m_modifiedAttributes.mark(index);
 
     // return the index at which I inserted this vertex in my vertex array
     return index;
@@ -533,7 +707,9 @@ unsigned int cMesh::newVertex(const double a_x, const double a_y, const double a
 
 //===========================================================================
 /*!
-    Create a new vertex for each supplied position and add it to the vertex list.
+    Create a new vertex for each supplied position and add it to the vertex
+    list. The vertices are appended with appendVertices(), so the slots of
+    removed vertices are not reused.
 
     \fn         void cMesh::addVertices(const cVector3d* a_vertexPositions, const unsigned int& a_numVertices);
     \param      a_vertexPositions List of vertex positions to add
@@ -543,12 +719,72 @@ unsigned int cMesh::newVertex(const double a_x, const double a_y, const double a
 void cMesh::addVertices(const cVector3d* a_vertexPositions,
   const unsigned int& a_numVertices)
 {
-    const cVector3d* end = a_vertexPositions + a_numVertices;
-    while(a_vertexPositions != end) 
+    unsigned int first = appendVertices(a_numVertices);
+
+    for (unsigned int i=0; i<a_numVertices; i++)
+    {
+        cVertex& vertex = m_vertices[first + i];
+        vertex.m_localPos = a_vertexPositions[i];
+        vertex.m_globalPos = a_vertexPositions[i];
+    }
+}
+
+
+//===========================================================================
+/*!
+    Append vertices to the end of the vertex list, in a single step. The
+    new vertices are at the origin; their position and attributes are
+    then set with the methods of cVertex. Unlike newVertex(), the slots of
+    removed vertices are not reused, so the new vertices are contiguous.
+
+    \fn         unsigned int cMesh::appendVertices(const unsigned int a_numVertices)
+    \param      a_numVertices  Number of vertices to append.
+    \return     Return the index of the first new vertex.
+*/
+//===========================================================================
+unsigned int cMesh::appendVertices(const unsigned int a_numVertices)
+{
+    unsigned int first = (unsigned int)m_vertices.size();
+
+    m_vertices.resize(first + a_numVertices, cVertex());
+
+    for (unsigned int i=first; i<first + a_numVertices; i++)
+    {
+        m_vertices[i].m_index = i;
+    }
+    markModifiedVertices(first, first + a_numVertices);
+
+    return (first);
+}
+
+
+//===========================================================================
+/*!
+    Append vertices to the end of the vertex list, in a single step, given
+    an array of positions. Like appendVertices(const unsigned int), the
+    slots of removed vertices are not reused.
+
+    \fn         unsigned int cMesh::appendVertices(const double* a_positions,
+                const unsigned int a_numVertices)
+    \param      a_positions  Positions of the vertices (x, y, z per vertex).
+    \param      a_numVertices  Number of vertices to append.
+    \return     Return the index of the first new vertex.
+*/
+//===========================================================================
+unsigned int cMesh::appendVertices(const double* a_positions,
+                                   const unsigned int a_numVertices)
+{
+    unsigned int first = appendVertices(a_numVertices);
+
+    for (unsigned int i=0; i<a_numVertices; i++)
     {
-        newVertex(*a_vertexPositions);
-        a_vertexPositions++;
+        const double* pos = &a_positions[3*i];
+        cVertex& vertex = m_vertices[first + i];
+        vertex.m_localPos.set(pos[0], pos[1], pos[2]);
+        vertex.m_globalPos.set(pos[0], pos[1], pos[2]);
     }
+
+    return (first);
 }
 
 
@@ -574,6 +810,8 @@ bool cMesh::removeVertex(const unsigned int a_index)
 
     // add vertex to free list
     m_freeVertices.push_back(a_index);
+    m_modifiedPositions.mark(a_index);
+    m_modifiedAttributes.mark(a_index);
 
     // return success
     return (true);
@@ -617,8 +855,13 @@ unsigned int cMesh::newTriangle(const unsigned int a_indexVertex0, const unsigne
         newTriangle.m_index = index;
         newTriangle.m_allocated = true;
         m_triangles.push_back(newTriangle);
+        m_allocatedTrianglePositions.push_back(0);
     }
 
+    // add the triangle to the index of allocated triangles
+    m_allocatedTrianglePositions[index] = m_allocatedTriangles.size();
+    m_allocatedTriangles.push_back(index);
+
     vector<cVertex>* vertex_vector = pVertices();
 
     (*vertex_vector)[a_indexVertex0].m_allocated = true;
@@ -627,6 +870,7 @@ unsigned int cMesh::newTriangle(const unsigned int a_indexVertex0, const unsigne
     (*vertex_vector)[a_indexVertex1].m_nTriangles++;
     (*vertex_vector)[a_indexVertex2].m_allocated = true;
     (*vertex_vector)[a_indexVertex2].m_nTriangles++;
+    m_modifiedTriangles.mark(index);
 
     /*
     m_vertices[a_indexVertex0].m_allocated = true;
@@ -670,6 +914,55 @@ unsigned int cMesh::newTriangle(const cVector3d& a_vertex0, const cVector3d& a_v
 }
 
 
+//===========================================================================
+/*!
+     Append triangles to the end of the triangle array, in a single step,
+     given three vertex indices per triangle. Unlike newTriangle(), the
+     slots of removed triangles are not reused, so the new triangles are
+     contiguous.
+
+     \fn       unsigned int cMesh::appendTriangles(const unsigned int* a_indices,
+               const unsigned int a_numTriangles)
+     \param    a_indices  Vertex indices of the triangles (3 per triangle).
+     \param    a_numTriangles  Number of triangles to append.
+     \return   Return the index of the first new triangle.
+*/
+//===========================================================================
+unsigned int cMesh::appendTriangles(const unsigned int* a_indices,
+                                    const unsigned int a_numTriangles)
+{
+    unsigned int first = (unsigned int)m_triangles.size();
+
+    grow_capacity(m_triangles, first + a_numTriangles);
+    grow_capacity(m_allocatedTriangles, m_allocatedTriangles.size() + a_numTriangles);
+    grow_capacity(m_allocatedTrianglePositions, first + a_numTriangles);
+
+    for (unsigned int i=0; i<a_numTriangles; i++)
+    {
+        const unsigned int* indices = &a_indices[3*i];
+
+        cTriangle newTriangle(this, indices[0], indices[1], indices[2]);
+        newTriangle.m_index = first + i;
+        newTriangle.m_allocated = true;
+        m_triangles.push_back(newTriangle);
+
+        // add the triangle to the index of allocated triangles
+        m_allocatedTrianglePositions.push_back((unsigned int)m_allocatedTriangles.size());
+        m_allocatedTriangles.push_back(first + i);
+
+        for (int k=0; k<3; k++)
+        {
+            cVertex& vertex = m_vertices[indices[k]];
+            vertex.m_allocated = true;
+            vertex.m_nTriangles++;
+        }
+    }
+    m_modifiedTriangles.mark(first, first + a_numTriangles);
+
+    return (first);
+}
+
+
 //===========================================================================
 /*!
      Remove a vertex from the vertex array by passing its index number.
@@ -696,6 +989,14 @@ bool cMesh::removeTriangle(const unsigned int a_index)
 
     // add triangle to free list
     m_freeTriangles.push_back(a_index);
+    m_modifiedTriangles.mark(a_index);
+
+    // replace the triangle by the last one in the index of allocated triangles
+    unsigned int position = m_allocatedTrianglePositions[a_index];
+    unsigned int last = m_allocatedTriangles.back();
+    m_allocatedTriangles[position] = last;
+    m_allocatedTrianglePositions[last] = position;
+    m_allocatedTriangles.pop_back();
 
     // return success
     return (true);
@@ -720,95 +1021,86 @@ void cMesh::clear()
     // clear free lists
     m_freeTriangles.clear();
     m_freeVertices.clear();
+    m_allocatedTriangles.clear();
+    m_allocatedTrianglePositions.clear();
+    m_triangleNeighborOffsets.clear();
+    m_triangleNeighbors.clear();
+    m_modifiedPositions.markAll();
+    m_modifiedAttributes.markAll();
+    m_modifiedTriangles.markAll();
 }
 
 
 //===========================================================================
 /*!
-     Load a 3D mesh file.  CHAI currently supports .obj and .3ds files.
+     Reserve memory for a number of vertices and triangles, so that the
+     arrays of the mesh are not reallocated while it is being built.
 
-     \fn       bool cMesh::loadFromFile(const string& a_fileName)
-     \param    a_fileName  Filename of 3d image.
-     \return   Return \b true is file loaded correctly. Otherwise return FALSE.
+     \fn       void cMesh::reserve(const unsigned int a_numVertices,
+               const unsigned int a_numTriangles)
+     \param    a_numVertices  Total number of vertices.
+     \param    a_numTriangles  Total number of triangles.
 */
 //===========================================================================
-bool cMesh::loadFromFile(const string& a_fileName)
+void cMesh::reserve(const unsigned int a_numVertices, const unsigned int a_numTriangles)
 {
-    return ( cLoadMeshFromFile(this, a_fileName) );
+    m_vertices.reserve(a_numVertices);
+    m_triangles.reserve(a_numTriangles);
+    m_allocatedTriangles.reserve(a_numTriangles);
+    m_allocatedTrianglePositions.reserve(a_numTriangles);
 }
 
 
 //===========================================================================
 /*!
-     Compute surface normals for every vertex in the mesh, by averaging
-     the face normals of the triangle that include each vertex.
-
-     \fn       void cMesh::computeAllNormals(const bool a_affectChildren=false)
-     \param    a_affectChildren  If \b true, then children are also updated.
+     Mark a range of vertices as modified. Call this after changing the
+     position, normal, texture coordinate or color of vertices which have
+     already been rendered, either with the methods of cVertex or by
+     writing its members directly.
+
+     \fn       void cMesh::markModifiedVertices(const unsigned int a_first,
+                                 const unsigned int a_last,
+                                 const bool a_positionsModified)
+     \param    a_first  First modified vertex.
+     \param    a_last  Last modified vertex (excluded).
+     \param    a_positionsModified  If \b false, only normals, texture
+               coordinates or colors have been modified.
 */
 //===========================================================================
-void cMesh::computeAllNormals(const bool a_affectChildren)
+void cMesh::markModifiedVertices(const unsigned int a_first, const unsigned int a_last,
+                                 const bool a_positionsModified)
 {
-    unsigned int nvertices = m_vertices.size();
-    unsigned int ntriangles = m_triangles.size();
-
-    // This will point to the array of vertices
-    cVertex* vertex_array = 0;
-
-    // If we have vertices and we have triangles, compute normals
-    // for all triangles
-    if (ntriangles !=0 && ntriangles != 0)
+    if (a_positionsModified)
     {
+        m_modifiedPositions.mark(a_first, a_last);
+    }
+    m_modifiedAttributes.mark(a_first, a_last);
+}
 
-        // used to grab positions of vertices
-        vector<cVertex>* vertex_vector = pVertices();
-        vertex_array = (cVertex*) &((*vertex_vector)[0]);
-
-        cVertex* startv = &(vertex_array[0]);
-        cVertex* endv = startv+nvertices;
-        cVertex* curv = startv;
-
-        // set all normals to zero
-        while(curv != endv)
-        {
-            curv->m_normal.zero();
-            curv->m_nTriangles = 0;
-            curv++;
-        }
-
-        cTriangle* starttri = &(m_triangles[0]);
-        cTriangle* endtri = starttri+ntriangles;
-        cTriangle* curtri = starttri;
-
-        // compute normals for all triangles.
-        while(curtri != endtri)
-        {
-            cVector3d vertex0 = vertex_array[curtri->m_indexVertex0].getPos();
-            cVector3d vertex1 = vertex_array[curtri->m_indexVertex1].getPos();
-            cVector3d vertex2 = vertex_array[curtri->m_indexVertex2].getPos();
 
-            // compute normal vector
-            cVector3d normal, v01, v02;
-            vertex1.subr(vertex0, v01);
-            vertex2.subr(vertex0, v02);
-            v01.crossr(v02, normal);
-            double length = normal.length();
-            if (length > 0.0000001)
-            {
-                normal.div(length);
-                vertex_array[curtri->m_indexVertex0].m_normal.add(normal);
-                vertex_array[curtri->m_indexVertex1].m_normal.add(normal);
-                vertex_array[curtri->m_indexVertex2].m_normal.add(normal);
-                vertex_array[curtri->m_indexVertex0].m_nTriangles++;
-                vertex_array[curtri->m_indexVertex1].m_nTriangles++;
-                vertex_array[curtri->m_indexVertex2].m_nTriangles++;
-            }
+//===========================================================================
+/*!
+     Mark all vertices as modified, optionally including those of my
+     children. Unlike invalidateVertexData(), triangles are not marked,
+     so the vertex indices and the collision tree are not rebuilt.
 
-            curtri++;
-        }
+     \fn       void cMesh::markAllVerticesModified(const bool a_positionsModified,
+                                 const bool a_affectChildren)
+     \param    a_positionsModified  If \b false, only normals, texture
+               coordinates or colors have been modified.
+     \param    a_affectChildren  If \b true all children are updated
+*/
+//===========================================================================
+void cMesh::markAllVerticesModified(const bool a_positionsModified,
+                                    const bool a_affectChildren)
+{
+    if (a_positionsModified)
+    {
+        m_modifiedPositions.markAll();
     }
+    m_modifiedAttributes.markAll();
 
-    // optionally propagate changes to children
+    // Propagate the operation to my children
     if (a_affectChildren)
     {
         unsigned int i, numItems;
@@ -817,122 +1109,839 @@ void cMesh::computeAllNormals(const bool a_affectChildren)
         {
             cGenericObject *nextObject = m_children[i];
 
-            // check if nextobject is a mesh. if yes, apply changes
             cMesh *nextMesh = dynamic_cast<cMesh*>(nextObject);
             if (nextMesh)
             {
-                nextMesh->computeAllNormals(a_affectChildren);
+                nextMesh->markAllVerticesModified(a_positionsModified, a_affectChildren);
             }
         }
     }
-
-    if (nvertices == 0) return;
-
-    cVertex* startv = &(vertex_array[0]);
-    cVertex* endv = startv+nvertices;
-    cVertex* curv = startv;
-
-    // normalize all normals (_after_ doing child-normal computations, in case
-    // I share vertices with my children)
-    while(curv != endv) 
-    {
-        /*
-        if (curv->m_nTriangles)
-        {
-            curv->m_normal /= (double)(curv->m_nTriangles);
-        }
-        */
-        if (curv->m_normal.lengthsq() > CHAI_SMALL)
-        {
-            curv->m_normal.normalize();
-        }
-        curv++;
-    }
 }
 
 
 //===========================================================================
 /*!
-     Compute the global position of all vertices
+     Mark a range of triangles as modified. Call this after changing the
+     vertex indices of triangles directly.
 
-     \fn       void cMesh::updateGlobalPositions(const bool a_frameOnly)
-     \param    a_frameOnly  If \b false, the global position of all vertices
-               is computed, otherwise this function does nothing.
+     \fn       void cMesh::markModifiedTriangles(const unsigned int a_first,
+                                  const unsigned int a_last)
+     \param    a_first  First modified triangle.
+     \param    a_last  Last modified triangle (excluded).
 */
 //===========================================================================
-void cMesh::updateGlobalPositions(const bool a_frameOnly)
+void cMesh::markModifiedTriangles(const unsigned int a_first, const unsigned int a_last)
 {
-    if (a_frameOnly) return;
-
-    register unsigned int i,numVertices;
-    numVertices = m_vertices.size();
-    for (i=0; i<numVertices; i++)
-    {
-        m_vertices[i].computeGlobalPosition(m_globalPos,m_globalRot);
-    }
+    m_modifiedTriangles.mark(a_first, a_last);
 
+    // allocation flags may have changed
+    rebuildAllocatedTriangles();
 }
 
 
 //===========================================================================
 /*!
-     Set the alpha value at each vertex, in all of my material colors,
-     optionally propagating the operation to my children.
-
-     Using the 'apply to textures' option causes the actual texture
-     alpha values to be over-written in my texture, if it exists.
-
-     [Editor's note: the 'apply to textures' option is not currently
-     enabled, since (a) it's a silly way to control transparency
-     and (b) not all textures have an alpha channel.]
-
-     \fn        void cMesh::setTransparencyLevel(const float a_level,
-                const bool a_applyToTextures=false, const bool a_affectChildren=false)
-     \param     a_level  Level of transparency ranging from 0.0 to 1.0.
-     \param     a_applyToTextures  If \b true, then apply changes to texture
-     \param     a_affectChildren  If true, then children also modified.
+     Remove the slots left in the vertex and triangle arrays by
+     removeVertex() and removeTriangle(). Remaining vertices and triangles
+     keep their order and are moved down; triangle vertex indices and
+     neighbor lists are updated, and the collision detector is rebuilt.
+
+     Indices and pointers to vertices or triangles held outside of the
+     mesh become invalid. The optional remap tables give, for each old
+     index, the new index or -1 if the element was removed. A vertex on
+     the free list which is still used by an allocated triangle is kept.
+
+     \fn       void cMesh::compact(vector<int>* a_vertexRemap,
+                                   vector<int>* a_triangleRemap)
+     \param    a_vertexRemap  If not \b NULL, receives the new index of each vertex.
+     \param    a_triangleRemap  If not \b NULL, receives the new index of each triangle.
 */
 //===========================================================================
-void cMesh::setTransparencyLevel(const float a_level, const bool a_applyToTextures,
-                                 const bool a_affectChildren)
+void cMesh::compact(vector<int>* a_vertexRemap, vector<int>* a_triangleRemap)
 {
-    // if the transparency level is equal to 1.0, then do not apply transparency
-    // otherwise enable it.
-    if (a_level < 1.0)
+    unsigned int numVertices = m_vertices.size();
+    unsigned int numTriangles = m_triangles.size();
+    unsigned int i;
+
+    // vertices on the free list are removed, unless a triangle uses them
+    vector<int> vertexRemap(numVertices, 0);
+    list<unsigned int>::iterator it;
+    for (it = m_freeVertices.begin(); it != m_freeVertices.end(); it++)
     {
-        setUseTransparency(true);
-    } else
+        if (*it < numVertices) { vertexRemap[*it] = -1; }
+    }
+
+    vector<int> triangleRemap(numTriangles, -1);
+    unsigned int numAllocatedTriangles = 0;
+    for (i=0; i<numTriangles; i++)
     {
-        setUseTransparency(false);
+        cTriangle* triangle = &m_triangles[i];
+        if (!triangle->m_allocated) { continue; }
+
+        triangleRemap[i] = numAllocatedTriangles++;
+        if (triangle->m_indexVertex0 < numVertices) { vertexRemap[triangle->m_indexVertex0] = 0; }
+        if (triangle->m_indexVertex1 < numVertices) { vertexRemap[triangle->m_indexVertex1] = 0; }
+        if (triangle->m_indexVertex2 < numVertices) { vertexRemap[triangle->m_indexVertex2] = 0; }
     }
 
-    // apply new value to material
-    m_material.setTransparencyLevel(a_level);
+    // move vertices down
+    unsigned int numAllocatedVertices = 0;
+    for (i=0; i<numVertices; i++)
+    {
+        if (vertexRemap[i] < 0) { continue; }
 
-    // convert transparency level to cColorb format
-    GLubyte level = GLubyte(255.0f * a_level);
+        vertexRemap[i] = numAllocatedVertices;
+        if (numAllocatedVertices != i)
+        {
+            m_vertices[numAllocatedVertices] = m_vertices[i];
+        }
+        m_vertices[numAllocatedVertices].m_index = numAllocatedVertices;
+        numAllocatedVertices++;
+    }
+    m_vertices.resize(numAllocatedVertices);
 
-    // apply the new value to all vertex colors
-    unsigned int i, numItems;
-    numItems = m_vertices.size();
-    for(i=0; i<numItems; i++)
+    // move triangles down
+    for (i=0; i<numTriangles; i++)
     {
-        m_vertices[i].m_color.setA(level);
+        int index = triangleRemap[i];
+        if ((index < 0) || (index == (int)i)) { continue; }
+
+        m_triangles[index] = m_triangles[i];
     }
 
-    // apply changes to texture if required
-    if (a_applyToTextures && (m_texture != NULL))
+    // update indices of the remaining triangles
+    for (i=0; i<numAllocatedTriangles; i++)
     {
-       // m_texture->setTransparency(a_level);
+        cTriangle* triangle = &m_triangles[i];
+        triangle->m_index = i;
+        if (triangle->m_indexVertex0 < numVertices) { triangle->m_indexVertex0 = vertexRemap[triangle->m_indexVertex0]; }
+        if (triangle->m_indexVertex1 < numVertices) { triangle->m_indexVertex1 = vertexRemap[triangle->m_indexVertex1]; }
+        if (triangle->m_indexVertex2 < numVertices) { triangle->m_indexVertex2 = vertexRemap[triangle->m_indexVertex2]; }
     }
+    m_triangles.resize(numAllocatedTriangles);
 
-    // propagate the operation to my children
-    if (a_affectChildren)
+    // remaining triangles keep their order, so neighbor lists are
+    // renumbered in place
+    if (m_triangleNeighborOffsets.size() == numTriangles + 1)
     {
-        for (unsigned int i=0; i<m_children.size(); i++)
+        unsigned int numNeighbors = 0;
+        unsigned int offset = 0;
+        for (i=0; i<numTriangles; i++)
         {
-            cGenericObject *nextObject = m_children[i];
-            nextObject->setTransparencyLevel(a_level,
+            unsigned int first = offset;
+            offset = m_triangleNeighborOffsets[i+1];
+            if (triangleRemap[i] < 0) { continue; }
+
+            m_triangleNeighborOffsets[triangleRemap[i]] = numNeighbors;
+            for (unsigned int j=first; j<offset; j++)
+            {
+                int neighbor = triangleRemap[m_triangleNeighbors[j]];
+                if (neighbor >= 0)
+                {
+                    m_triangleNeighbors[numNeighbors++] = neighbor;
+                }
+            }
+        }
+        m_triangleNeighborOffsets[numAllocatedTriangles] = numNeighbors;
+        m_triangleNeighborOffsets.resize(numAllocatedTriangles + 1);
+        m_triangleNeighbors.resize(numNeighbors);
+    }
+
+    // no slots are free anymore
+    m_freeVertices.clear();
+    m_freeTriangles.clear();
+    rebuildAllocatedTriangles();
+
+    m_modifiedPositions.markAll();
+    m_modifiedAttributes.markAll();
+    m_modifiedTriangles.markAll();
+
+    // the collision detector holds pointers to triangles
+    updateCollisionDetector(false);
+
+    // return remap tables
+    if (a_vertexRemap != NULL) { a_vertexRemap->swap(vertexRemap); }
+    if (a_triangleRemap != NULL) { a_triangleRemap->swap(triangleRemap); }
+}
+
+
+//===========================================================================
+/*!
+     Reorder triangles and vertices for the post-transform vertex cache of
+     the graphics card, and for memory locality of every loop over the
+     triangles (rendering, normal computation, collision tree
+     construction and neighbor tests).
+
+     The mesh is first compacted. Triangles are then ordered with Tom
+     Forsyth's linear-speed vertex cache optimization: each vertex is
+     scored from its position in a simulated LRU cache and from the
+     number of triangles still using it, and the next triangle is the one
+     with the highest score among those using a cached vertex. Vertices
+     are finally renumbered in order of first use by the new triangle
+     order; unused vertices are moved to the end.
+
+     As with compact(), indices held outside of the mesh become invalid;
+     the optional remap tables give the new index of each old index, or
+     -1 if the element was removed by compaction.
+
+     \fn       void cMesh::optimizeVertexCache(const unsigned int a_cacheSize,
+                                              vector<int>* a_vertexRemap,
+                                              vector<int>* a_triangleRemap)
+     \param    a_cacheSize  Number of entries of the simulated vertex cache.
+     \param    a_vertexRemap  If not \b NULL, receives the new index of each vertex.
+     \param    a_triangleRemap  If not \b NULL, receives the new index of each triangle.
+*/
+//===========================================================================
+void cMesh::optimizeVertexCache(const unsigned int a_cacheSize,
+                                vector<int>* a_vertexRemap, vector<int>* a_triangleRemap)
+{
+    // remove free slots; all triangles are then allocated
+    vector<int> vertexCompaction, triangleCompaction;
+    compact(&vertexCompaction, &triangleCompaction);
+
+    unsigned int numVertices = m_vertices.size();
+    unsigned int numTriangles = m_triangles.size();
+    unsigned int cacheSize = cMax(a_cacheSize, (unsigned int)4);
+    unsigned int i, j, k;
+
+    // triangles using each vertex
+    vector<unsigned int> offsets(numVertices + 1, 0);
+    for (i=0; i<numTriangles; i++)
+    {
+        offsets[m_triangles[i].m_indexVertex0 + 1]++;
+        offsets[m_triangles[i].m_indexVertex1 + 1]++;
+        offsets[m_triangles[i].m_indexVertex2 + 1]++;
+    }
+    for (i=0; i<numVertices; i++) { offsets[i+1] += offsets[i]; }
+    vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    vector<unsigned int> vertexTriangles(3 * numTriangles);
+    for (i=0; i<numTriangles; i++)
+    {
+        vertexTriangles[fill[m_triangles[i].m_indexVertex0]++] = i;
+        vertexTriangles[fill[m_triangles[i].m_indexVertex1]++] = i;
+        vertexTriangles[fill[m_triangles[i].m_indexVertex2]++] = i;
+    }
+
+    // triangles not yet emitted are kept at the front of each vertex list
+    vector<unsigned int> valence(numVertices);
+    vector<int> cachePosition(numVertices, -1);
+    vector<double> vertexScores(numVertices);
+    for (i=0; i<numVertices; i++)
+    {
+        valence[i] = offsets[i+1] - offsets[i];
+        vertexScores[i] = vertex_cache_score(-1, valence[i], cacheSize);
+    }
+
+    vector<bool> emitted(numTriangles, false);
+
+    vector<unsigned int> order;
+    order.reserve(numTriangles);
+    vector<unsigned int> cache, newCache;
+    cache.reserve(cacheSize + 3);
+    newCache.reserve(cacheSize + 3);
+    unsigned int cursor = 0;
+    int best = -1;
+
+    while (order.size() < numTriangles)
+    {
+        // no candidate among cached vertices: take the next triangle in
+        // the original order
+        if (best < 0)
+        {
+            while (emitted[cursor]) { cursor++; }
+            best = cursor;
+        }
+
+        // emit triangle
+        emitted[best] = true;
+        order.push_back(best);
+        const cTriangle& triangle = m_triangles[best];
+        unsigned int v[3] = { triangle.m_indexVertex0, triangle.m_indexVertex1, triangle.m_indexVertex2 };
+
+        // remove it from the pending lists of its vertices
+        for (k=0; k<3; k++)
+        {
+            unsigned int first = offsets[v[k]];
+            unsigned int last = first + valence[v[k]];
+            for (j=first; j<last; j++)
+            {
+                if (vertexTriangles[j] == (unsigned int)best)
+                {
+                    vertexTriangles[j] = vertexTriangles[last-1];
+                    vertexTriangles[last-1] = best;
+                    valence[v[k]]--;
+                    break;
+                }
+            }
+        }
+
+        // move its vertices to the front of the cache
+        newCache.clear();
+        for (k=0; k<3; k++)
+        {
+            if ((k > 0) && (v[k] == v[0])) { continue; }
+            if ((k > 1) && (v[k] == v[1])) { continue; }
+            newCache.push_back(v[k]);
+        }
+        for (j=0; j<cache.size(); j++)
+        {
+            if ((cache[j] != v[0]) && (cache[j] != v[1]) && (cache[j] != v[2]))
+            {
+                newCache.push_back(cache[j]);
+            }
+        }
+
+        // update scores of vertices in the cache, or which just left it
+        for (j=0; j<newCache.size(); j++)
+        {
+            unsigned int vertex = newCache[j];
+            int position = (j < cacheSize) ? (int)j : -1;
+            cachePosition[vertex] = position;
+            vertexScores[vertex] = vertex_cache_score(position, valence[vertex], cacheSize);
+        }
+        if (newCache.size() > cacheSize) { newCache.resize(cacheSize); }
+        cache.swap(newCache);
+
+        // score pending triangles of cached vertices and pick the best
+        best = -1;
+        double bestScore = -1.0;
+        for (j=0; j<cache.size(); j++)
+        {
+            unsigned int vertex = cache[j];
+            for (k=offsets[vertex]; k<offsets[vertex] + valence[vertex]; k++)
+            {
+                unsigned int index = vertexTriangles[k];
+                const cTriangle& t = m_triangles[index];
+                double score = vertexScores[t.m_indexVertex0] +
+                               vertexScores[t.m_indexVertex1] +
+                               vertexScores[t.m_indexVertex2];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = index;
+                }
+            }
+        }
+    }
+
+    // renumber vertices in order of first use
+    vector<int> vertexOrder(numVertices, -1);
+    unsigned int numUsed = 0;
+    for (i=0; i<numTriangles; i++)
+    {
+        const cTriangle& triangle = m_triangles[order[i]];
+        if (vertexOrder[triangle.m_indexVertex0] < 0) { vertexOrder[triangle.m_indexVertex0] = numUsed++; }
+        if (vertexOrder[triangle.m_indexVertex1] < 0) { vertexOrder[triangle.m_indexVertex1] = numUsed++; }
+        if (vertexOrder[triangle.m_indexVertex2] < 0) { vertexOrder[triangle.m_indexVertex2] = numUsed++; }
+    }
+    for (i=0; i<numVertices; i++)
+    {
+        if (vertexOrder[i] < 0) { vertexOrder[i] = numUsed++; }
+    }
+
+    // rewrite vertex and triangle arrays
+    vector<cVertex> vertices(m_vertices);
+    for (i=0; i<numVertices; i++)
+    {
+        m_vertices[vertexOrder[i]] = vertices[i];
+        m_vertices[vertexOrder[i]].m_index = vertexOrder[i];
+    }
+    vector<cTriangle> triangles(m_triangles);
+    vector<int> triangleOrder(numTriangles);
+    for (i=0; i<numTriangles; i++)
+    {
+        cTriangle& triangle = m_triangles[i];
+        triangle = triangles[order[i]];
+        triangle.m_index = i;
+        triangle.m_indexVertex0 = vertexOrder[triangle.m_indexVertex0];
+        triangle.m_indexVertex1 = vertexOrder[triangle.m_indexVertex1];
+        triangle.m_indexVertex2 = vertexOrder[triangle.m_indexVertex2];
+        triangleOrder[order[i]] = i;
+    }
+    rebuildAllocatedTriangles();
+
+    // renumber neighbor lists
+    if (m_triangleNeighborOffsets.size() == numTriangles + 1)
+    {
+        vector<unsigned int> neighborOffsets(m_triangleNeighborOffsets);
+        vector<unsigned int> neighbors(m_triangleNeighbors);
+        unsigned int numNeighbors = 0;
+        for (i=0; i<numTriangles; i++)
+        {
+            m_triangleNeighborOffsets[i] = numNeighbors;
+            for (j=neighborOffsets[order[i]]; j<neighborOffsets[order[i]+1]; j++)
+            {
+                m_triangleNeighbors[numNeighbors++] = triangleOrder[neighbors[j]];
+            }
+        }
+        m_triangleNeighborOffsets[numTriangles] = numNeighbors;
+    }
+
+    m_modifiedPositions.markAll();
+    m_modifiedAttributes.markAll();
+    m_modifiedTriangles.markAll();
+
+    // the collision detector holds pointers to triangles
+    updateCollisionDetector(false);
+
+    // return remap tables, from indices before compaction
+    if (a_vertexRemap != NULL)
+    {
+        for (i=0; i<vertexCompaction.size(); i++)
+        {
+            if (vertexCompaction[i] >= 0) { vertexCompaction[i] = vertexOrder[vertexCompaction[i]]; }
+        }
+        a_vertexRemap->swap(vertexCompaction);
+    }
+    if (a_triangleRemap != NULL)
+    {
+        for (i=0; i<triangleCompaction.size(); i++)
+        {
+            if (triangleCompaction[i] >= 0) { triangleCompaction[i] = triangleOrder[triangleCompaction[i]]; }
+        }
+        a_triangleRemap->swap(triangleCompaction);
+    }
+}
+
+
+//===========================================================================
+/*!
+     Build the index of allocated triangles from the allocation flag of
+     each triangle. The index is otherwise maintained by newTriangle()
+     and removeTriangle().
+
+     \fn       void cMesh::rebuildAllocatedTriangles()
+*/
+//===========================================================================
+void cMesh::rebuildAllocatedTriangles()
+{
+    unsigned int numTriangles = m_triangles.size();
+    m_allocatedTriangles.clear();
+    m_allocatedTrianglePositions.resize(numTriangles);
+
+    for (unsigned int i=0; i<numTriangles; i++)
+    {
+        if (m_triangles[i].m_allocated)
+        {
+            m_allocatedTrianglePositions[i] = m_allocatedTriangles.size();
+            m_allocatedTriangles.push_back(i);
+        }
+    }
+}
+
+
+//===========================================================================
+/*!
+     Load a 3D mesh file.  CHAI currently supports .obj and .3ds files.
+
+     \fn       bool cMesh::loadFromFile(const string& a_fileName)
+     \param    a_fileName  Filename of 3d image.
+     \return   Return \b true is file loaded correctly. Otherwise return FALSE.
+*/
+//===========================================================================
+bool cMesh::loadFromFile(const string& a_fileName)
+{
+    return ( cLoadMeshFromFile(this, a_fileName) );
+}
+
+
+//===========================================================================
+/*!
+     Compute surface normals for every vertex in the mesh, by averaging
+     the face normals of the triangle that include each vertex.
+
+     \fn       void cMesh::computeAllNormals(const bool a_affectChildren=false)
+     \param    a_affectChildren  If \b true, then children are also updated.
+*/
+//===========================================================================
+void cMesh::computeAllNormals(const bool a_affectChildren)
+{
+    // all normals are computed, pending moves are consumed
+    dispatchModifications();
+    m_normalVertices.clear();
+    m_normalTriangles.clear();
+
+    unsigned int nvertices = pVertices()->size();
+    if ((!m_normalCacheValid) || (m_vertexTriangleOffsets.size() != nvertices + 1))
+    {
+        buildNormalAdjacency();
+    }
+
+    // compute face normals, then gather them at each vertex. normals of
+    // a mesh without triangles are left untouched.
+    if (m_triangles.size() > 0)
+    {
+        cMeshNormalTask task;
+        task.m_mesh = this;
+        task.m_triangles = NULL;
+        task.m_firstVertex = 0;
+        processNormals(triangleNormalsTask, &task, m_allocatedTriangles.size());
+        processNormals(vertexNormalsTask, &task, nvertices);
+    }
+
+    m_normalCacheValid = true;
+    m_modifiedAttributes.markAll();
+
+    // optionally propagate changes to children
+    if (a_affectChildren)
+    {
+        unsigned int i, numItems;
+        numItems = m_children.size();
+        for (i=0; i<numItems; i++)
+        {
+            cGenericObject *nextObject = m_children[i];
+
+            // check if nextobject is a mesh. if yes, apply changes
+            cMesh *nextMesh = dynamic_cast<cMesh*>(nextObject);
+            if (nextMesh)
+            {
+                nextMesh->computeAllNormals(a_affectChildren);
+            }
+        }
+    }
+}
+
+
+//===========================================================================
+/*!
+     Compute the normals of the vertices affected by the vertices moved
+     since the last normal computation: the moved vertices and the
+     vertices sharing a triangle with them. Only the face normals of the
+     triangles using a moved vertex are computed again, so the cost of a
+     local deformation is proportional to its extent. If triangles have
+     been added or removed, all normals are computed.
+
+     \fn       void cMesh::updateNormals(const bool a_affectChildren)
+     \param    a_affectChildren  If \b true, then children are also updated.
+*/
+//===========================================================================
+void cMesh::updateNormals(const bool a_affectChildren)
+{
+    dispatchModifications();
+
+    unsigned int nvertices = pVertices()->size();
+    if ((!m_normalCacheValid) || (!m_normalTriangles.isEmpty()) ||
+        (m_vertexTriangleOffsets.size() != nvertices + 1))
+    {
+        computeAllNormals(false);
+    }
+    else if (!m_normalVertices.isEmpty())
+    {
+        unsigned int first = m_normalVertices.getFirst();
+        unsigned int last = m_normalVertices.getLast(nvertices);
+
+        // start a new stamp, clearing stamps when the counter wraps around
+        m_normalStamp++;
+        if (m_normalStamp == 0)
+        {
+            m_triangleStamps.assign(m_triangleStamps.size(), 0);
+            m_normalStamp = 1;
+        }
+
+        // collect triangles using a moved vertex, and their vertices
+        cDirtyRange affected;
+        m_normalTriangleList.clear();
+        for (unsigned int i=first; i<last; i++)
+        {
+            for (unsigned int j=m_vertexTriangleOffsets[i]; j<m_vertexTriangleOffsets[i+1]; j++)
+            {
+                unsigned int k = m_vertexTriangles[j];
+                if (m_triangleStamps[k] == m_normalStamp) { continue; }
+                m_triangleStamps[k] = m_normalStamp;
+                m_normalTriangleList.push_back(k);
+
+                cTriangle* triangle = &m_triangles[m_allocatedTriangles[k]];
+                affected.mark(triangle->m_indexVertex0);
+                affected.mark(triangle->m_indexVertex1);
+                affected.mark(triangle->m_indexVertex2);
+            }
+        }
+
+        // compute their face normals, then gather the affected vertices
+        if (!affected.isEmpty())
+        {
+            cMeshNormalTask task;
+            task.m_mesh = this;
+            task.m_triangles = &m_normalTriangleList[0];
+            task.m_firstVertex = affected.getFirst();
+            processNormals(triangleNormalsTask, &task, m_normalTriangleList.size());
+            processNormals(vertexNormalsTask, &task,
+                           affected.getLast(nvertices) - affected.getFirst());
+            m_modifiedAttributes.merge(affected);
+        }
+
+        m_normalVertices.clear();
+    }
+
+    // propagate the operation to my children
+    if (a_affectChildren)
+    {
+        unsigned int i, numItems;
+        numItems = m_children.size();
+        for (i=0; i<numItems; i++)
+        {
+            cGenericObject *nextObject = m_children[i];
+
+            cMesh *nextMesh = dynamic_cast<cMesh*>(nextObject);
+            if (nextMesh)
+            {
+                nextMesh->updateNormals(a_affectChildren);
+            }
+        }
+    }
+}
+
+
+//===========================================================================
+/*!
+     Build the list of allocated triangles using each vertex, stored in
+     compressed rows (m_vertexTriangleOffsets, m_vertexTriangles), so that
+     vertex normals can be gathered in parallel without two threads
+     writing to the same vertex.
+
+     \fn       void cMesh::buildNormalAdjacency()
+*/
+//===========================================================================
+void cMesh::buildNormalAdjacency()
+{
+    unsigned int nvertices = pVertices()->size();
+    unsigned int ntriangles = m_allocatedTriangles.size();
+    unsigned int i;
+
+    // count triangles per vertex
+    m_vertexTriangleOffsets.assign(nvertices + 1, 0);
+    for (i=0; i<ntriangles; i++)
+    {
+        cTriangle* triangle = &m_triangles[m_allocatedTriangles[i]];
+        m_vertexTriangleOffsets[triangle->m_indexVertex0 + 1]++;
+        m_vertexTriangleOffsets[triangle->m_indexVertex1 + 1]++;
+        m_vertexTriangleOffsets[triangle->m_indexVertex2 + 1]++;
+    }
+    for (i=0; i<nvertices; i++)
+    {
+        m_vertexTriangleOffsets[i+1] += m_vertexTriangleOffsets[i];
+    }
+
+    // fill rows
+    vector<unsigned int> fill(m_vertexTriangleOffsets.begin(), m_vertexTriangleOffsets.end() - 1);
+    m_vertexTriangles.resize(3 * ntriangles);
+    for (i=0; i<ntriangles; i++)
+    {
+        cTriangle* triangle = &m_triangles[m_allocatedTriangles[i]];
+        m_vertexTriangles[fill[triangle->m_indexVertex0]++] = i;
+        m_vertexTriangles[fill[triangle->m_indexVertex1]++] = i;
+        m_vertexTriangles[fill[triangle->m_indexVertex2]++] = i;
+    }
+
+    m_triangleNormals.assign(ntriangles, cVector3d(0.0, 0.0, 0.0));
+    m_triangleStamps.assign(ntriangles, 0);
+    m_normalStamp = 0;
+}
+
+
+//===========================================================================
+/*!
+     Run a normal computation task over [0, a_count), on the shared thread
+     pool if there are enough items.
+
+     \fn       void cMesh::processNormals(cThreadPoolTask a_task, void* a_data,
+                                   unsigned int a_count)
+     \param    a_task  Task to execute.
+     \param    a_data  Task description.
+     \param    a_count  Number of items.
+*/
+//===========================================================================
+void cMesh::processNormals(cThreadPoolTask a_task, void* a_data, unsigned int a_count)
+{
+    if (a_count == 0) { return; }
+
+    if (a_count >= CHAI_MESH_MIN_PARALLEL_NORMALS)
+    {
+        cThreadPool::getDefaultPool()->parallelFor(a_task, a_data, a_count, 1024);
+    }
+    else
+    {
+        a_task(a_data, 0, a_count);
+    }
+}
+
+
+//===========================================================================
+/*!
+     Thread pool task computing the unit normals of allocated triangles.
+     Items are positions in the list of allocated triangles, or in the
+     list given by the task. Degenerate triangles get a zero normal.
+
+     \fn       void cMesh::triangleNormalsTask(void* a_data, unsigned int a_begin,
+                                        unsigned int a_end)
+*/
+//===========================================================================
+void cMesh::triangleNormalsTask(void* a_data, unsigned int a_begin, unsigned int a_end)
+{
+    cMeshNormalTask* task = (cMeshNormalTask*)a_data;
+    cMesh* mesh = task->m_mesh;
+    const cVertex* vertex_array = &(*mesh->pVertices())[0];
+    const cTriangle* triangle_array = &mesh->m_triangles[0];
+    const unsigned int* allocated = &mesh->m_allocatedTriangles[0];
+    cVector3d* normals = &mesh->m_triangleNormals[0];
+
+    for (unsigned int i=a_begin; i<a_end; i++)
+    {
+        unsigned int k = (task->m_triangles != NULL) ? task->m_triangles[i] : i;
+        const cTriangle* triangle = &triangle_array[allocated[k]];
+        const cVector3d& p0 = vertex_array[triangle->m_indexVertex0].m_localPos;
+        const cVector3d& p1 = vertex_array[triangle->m_indexVertex1].m_localPos;
+        const cVector3d& p2 = vertex_array[triangle->m_indexVertex2].m_localPos;
+
+        // cross product of the two edges from vertex 0
+        double ax = p1.x - p0.x, ay = p1.y - p0.y, az = p1.z - p0.z;
+        double bx = p2.x - p0.x, by = p2.y - p0.y, bz = p2.z - p0.z;
+        double nx = ay * bz - az * by;
+        double ny = az * bx - ax * bz;
+        double nz = ax * by - ay * bx;
+
+        double length = sqrt(nx * nx + ny * ny + nz * nz);
+        if (length > 0.0000001)
+        {
+            double scale = 1.0 / length;
+            normals[k].set(nx * scale, ny * scale, nz * scale);
+        }
+        else
+        {
+            normals[k].zero();
+        }
+    }
+}
+
+
+//===========================================================================
+/*!
+     Thread pool task setting the normal of vertices to the normalized
+     sum of the face normals of their triangles. Items are offsets from
+     the first vertex given by the task.
+
+     \fn       void cMesh::vertexNormalsTask(void* a_data, unsigned int a_begin,
+                                      unsigned int a_end)
+*/
+//===========================================================================
+void cMesh::vertexNormalsTask(void* a_data, unsigned int a_begin, unsigned int a_end)
+{
+    cMeshNormalTask* task = (cMeshNormalTask*)a_data;
+    cMesh* mesh = task->m_mesh;
+    cVertex* vertex_array = &(*mesh->pVertices())[0];
+    const unsigned int* offsets = &mesh->m_vertexTriangleOffsets[0];
+    const unsigned int* triangles = mesh->m_vertexTriangles.empty() ? NULL : &mesh->m_vertexTriangles[0];
+    const cVector3d* normals = mesh->m_triangleNormals.empty() ? NULL : &mesh->m_triangleNormals[0];
+
+    for (unsigned int i=a_begin; i<a_end; i++)
+    {
+        unsigned int index = task->m_firstVertex + i;
+        double nx = 0.0, ny = 0.0, nz = 0.0;
+        int count = 0;
+
+        for (unsigned int j=offsets[index]; j<offsets[index+1]; j++)
+        {
+            const cVector3d& normal = normals[triangles[j]];
+            nx += normal.x;
+            ny += normal.y;
+            nz += normal.z;
+            if ((normal.x != 0.0) || (normal.y != 0.0) || (normal.z != 0.0)) { count++; }
+        }
+
+        cVertex* vertex = &vertex_array[index];
+        vertex->m_normal.set(nx, ny, nz);
+        vertex->m_nTriangles = count;
+        if (vertex->m_normal.lengthsq() > CHAI_SMALL)
+        {
+            vertex->m_normal.normalize();
+        }
+    }
+}
+
+
+//===========================================================================
+/*!
+     Compute the global position of all vertices
+
+     \fn       void cMesh::updateGlobalPositions(const bool a_frameOnly)
+     \param    a_frameOnly  If \b false, the global position of all vertices
+               is computed, otherwise this function does nothing.
+*/
+//===========================================================================
+void cMesh::updateGlobalPositions(const bool a_frameOnly)
+{
+    if (a_frameOnly) return;
+
+    register unsigned int i,numVertices;
+    numVertices = m_vertices.size();
+    for (i=0; i<numVertices; i++)
+    {
+        m_vertices[i].computeGlobalPosition(m_globalPos,m_globalRot);
+    }
+
+}
+
+
+//===========================================================================
+/*!
+     Set the alpha value at each vertex, in all of my material colors,
+     optionally propagating the operation to my children.
+
+     Using the 'apply to textures' option causes the actual texture
+     alpha values to be over-written in my texture, if it exists.
+
+     [Editor's note: the 'apply to textures' option is not currently
+     enabled, since (a) it's a silly way to control transparency
+     and (b) not all textures have an alpha channel.]
+
+     \fn        void cMesh::setTransparencyLevel(const float a_level,
+                const bool a_applyToTextures=false, const bool a_affectChildren=false)
+     \param     a_level  Level of transparency ranging from 0.0 to 1.0.
+     \param     a_applyToTextures  If \b true, then apply changes to texture
+     \param     a_affectChildren  If true, then children also modified.
+*/
+//===========================================================================
+void cMesh::setTransparencyLevel(const float a_level, const bool a_applyToTextures,
+                                 const bool a_affectChildren)
+{
+    // if the transparency level is equal to 1.0, then do not apply transparency
+    // otherwise enable it.
+    if (a_level < 1.0)
+    {
+        setUseTransparency(true);
+    } else
+    {
+        setUseTransparency(false);
+    }
+
+    // apply new value to material
+    m_material.setTransparencyLevel(a_level);
+
+    // convert transparency level to cColorb format
+    GLubyte level = GLubyte(255.0f * a_level);
+
+    // apply the new value to all vertex colors
+    unsigned int i, numItems;
+    numItems = m_vertices.size();
+    for(i=0; i<numItems; i++)
+    {
+        m_vertices[i].m_color.setA(level);
+    }
+    m_modifiedAttributes.markAll();
+
+    // apply changes to texture if required
+    if (a_applyToTextures && (m_texture != NULL))
+    {
+       // m_texture->setTransparency(a_level);
+    }
+
+    // propagate the operation to my children
+    if (a_affectChildren)
+    {
+        for (unsigned int i=0; i<m_children.size(); i++)
+        {
+            cGenericObject *nextObject = m_children[i];
+            nextObject->setTransparencyLevel(a_level,
                                              a_applyToTextures,
                                              a_affectChildren);
         }
@@ -958,6 +1967,7 @@ void cMesh::setVertexColor(const cColorf& a_color, const bool a_affectChildren)
     {
         m_vertices[i].m_color = a_color;
     }
+    m_modifiedAttributes.markAll();
 
     // update changes to children
     if (a_affectChildren)
@@ -1001,6 +2011,7 @@ void cMesh::offsetVertices(const cVector3d& a_offset, const bool a_affectChildre
     {
         m_vertices[i].m_localPos.add(a_offset);
     }
+    m_modifiedPositions.markAll();
 
     m_boundaryBoxMin+=a_offset;
     m_boundaryBoxMax+=a_offset;
@@ -1046,6 +2057,7 @@ void cMesh::extrude(const double a_extrudeDistance, const bool a_affectChildren,
     {
         m_vertices[i].m_localPos.add(cMul(a_extrudeDistance,m_vertices[i].m_normal));
     }
+    m_modifiedPositions.markAll();
 
     // This is an O(N) operation, as is the extrusion, so it seems okay to call
     // this by default...
@@ -1094,6 +2106,7 @@ void cMesh::reverseAllNormals(const bool a_affectChildren)
 			vertex_array[i].m_normal.mul(-1.0);
 		}
 	}
+	m_modifiedAttributes.markAll();
 
 	// propagate changes to my children
 	if (a_affectChildren)
@@ -1134,38 +2147,52 @@ inline void sort_triangle(cTriangle& t)
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 //---------------------------------------------------------------------------
 /*!
-	A comparator for sorting triangles, used for removing redundant
-	triangles.
+	Hash table bucket of a vertex-sorted triangle, used for removing
+	redundant triangles.
 */
 //---------------------------------------------------------------------------
-struct lt_ctriangle
+inline unsigned int triangle_bucket(const cTriangle& t, const unsigned int a_mask)
 {
-	inline bool operator()(const cTriangle& in_t1, const cTriangle& in_t2)
-	{
-		// Sort both triangles so we're comparing them in vertex-sorted order
-		cTriangle t1 = in_t1;
-		sort_triangle(t1);
-
-		cTriangle t2 = in_t2;
-		sort_triangle(t2);
-
-		// Do the comparison
-		if      (t1.m_indexVertex0 < t2.m_indexVertex0) return true;
-		else if (t1.m_indexVertex0 > t2.m_indexVertex0) return false;
-		else if (t1.m_indexVertex1 < t2.m_indexVertex1) return true;
-		else if (t1.m_indexVertex1 > t2.m_indexVertex1) return false;
-		else if (t1.m_indexVertex2 < t2.m_indexVertex2) return true;
-		return false;
-	}
-};
+    unsigned int h = (t.m_indexVertex0 * 73856093u) ^
+                     (t.m_indexVertex1 * 19349663u) ^
+                     (t.m_indexVertex2 * 83492791u);
+    return (h & a_mask);
+}
+
+
+//---------------------------------------------------------------------------
+/*!
+	Return whether two vertices at the same position have the same normal,
+	texture coordinate and color, used for welding vertices.
+*/
+//---------------------------------------------------------------------------
+inline bool same_vertex_attributes(const cVertex& a_vertex0, const cVertex& a_vertex1)
+{
+    const double epsilon = 0.000001;
+    if (!cEqualPoints(a_vertex0.m_normal, a_vertex1.m_normal, epsilon)) return false;
+    if (!cEqualPoints(a_vertex0.m_texCoord, a_vertex1.m_texCoord, epsilon)) return false;
+
+    const float* color0 = a_vertex0.m_color.pColor();
+    const float* color1 = a_vertex1.m_color.pColor();
+    for (int i=0; i<4; i++)
+    {
+        if (fabs(color0[i] - color1[i]) > epsilon) return false;
+    }
+    return true;
+}
 #endif // DOXYGEN_SHOULD_SKIP_THIS
 
 
 //===========================================================================
 /*!
 	Remove redundant triangles from this model.  Does not use vertex positions
-	at all, just removed triangles with redundant indices and obviously-
-	degenerate triangles.
+	at all, just removes triangles with redundant indices (the same three
+	vertices in any order) and obviously-degenerate triangles. Of a set of
+	redundant triangles, the one with the lowest index is kept.
+
+	Triangles are looked up in a hash table of their vertex-sorted indices,
+	so the cost is linear in the number of triangles. Removed triangles
+	leave free slots, like removeTriangle(); call compact() to reclaim them.
 
 	\fn        void cMesh::removeRedundantTriangles(bool a_affectChildren=0);
 	\param     a_affectChildren  If \b true, children are also modified.
@@ -1173,45 +2200,61 @@ struct lt_ctriangle
 //===========================================================================
 void cMesh::removeRedundantTriangles(const bool a_affectChildren)
 {
-    // remove redundant triangles from this mesh
-
-    // move everything from a vector into a set, sorted by triangles,
-    // and remove degenerate triangles.
-    std::set<cTriangle,lt_ctriangle> sorted_tris;
     unsigned int ntris = m_triangles.size();
-        unsigned int i;
-    for(i=0; i<ntris; i++) 
+    unsigned int i;
+
+    // hash table of about twice the number of triangles
+    unsigned int numBuckets = 1;
+    while (numBuckets < 2 * m_allocatedTriangles.size()) { numBuckets <<= 1; }
+    unsigned int mask = numBuckets - 1;
+
+    // each bucket holds the sorted vertex indices of a triangle; an empty
+    // bucket starts with an invalid vertex index
+    vector<unsigned int> keys(3 * numBuckets, 0xFFFFFFFF);
+
+    for (i=0; i<ntris; i++)
     {
+        if (!m_triangles[i].m_allocated) { continue; }
+
         cTriangle t = m_triangles[i];
+        sort_triangle(t);
 
         // Remove degenerate triangles
-        if (
-        t.m_indexVertex0 == t.m_indexVertex1 ||
-        t.m_indexVertex0 == t.m_indexVertex2 ||
-        t.m_indexVertex1 == t.m_indexVertex2)
-        continue;
-
-        // Put this triangle in the sorted list
-        sorted_tris.insert(t);
-    }
-
-    // clear the vector
-    m_triangles.clear();
+        if ((t.m_indexVertex0 == t.m_indexVertex1) ||
+            (t.m_indexVertex1 == t.m_indexVertex2))
+        {
+            removeTriangle(i);
+            continue;
+        }
 
-    // move everything back from the set to the vector
-    ntris = sorted_tris.size();
+        // Look for the same triangle, or insert it into the table
+        unsigned int h = triangle_bucket(t, mask);
+        bool redundant = false;
+        while (keys[3*h] != 0xFFFFFFFF)
+        {
+            const unsigned int* other = &keys[3*h];
+            if ((other[0] == t.m_indexVertex0) &&
+                (other[1] == t.m_indexVertex1) &&
+                (other[2] == t.m_indexVertex2))
+            {
+                redundant = true;
+                break;
+            }
+            h = (h + 1) & mask;
+        }
 
-    std::set<cTriangle,lt_ctriangle>::iterator iter = sorted_tris.begin();
-    std::set<cTriangle,lt_ctriangle>::iterator end = sorted_tris.end();
-    while(iter != end) 
-    {
-        m_triangles.push_back(*iter);
-        iter++;
+        if (redundant)
+        {
+            removeTriangle(i);
+        }
+        else
+        {
+            keys[3*h] = t.m_indexVertex0;
+            keys[3*h+1] = t.m_indexVertex1;
+            keys[3*h+2] = t.m_indexVertex2;
+        }
     }
 
-    // clear the set before recursing
-    sorted_tris.clear();
-
     // propagate changes to my children
     if (a_affectChildren==false) return;
 
@@ -1227,6 +2270,168 @@ void cMesh::removeRedundantTriangles(const bool a_affectChildren)
 }
 
 
+//===========================================================================
+/*!
+	Merge vertices located at the same position (each coordinate within
+	\e a_tolerance), which loaders produce when they generate distinct
+	vertices for each triangle. Triangles are redirected to the first
+	vertex of each position, triangles which become degenerate or
+	redundant are removed, and the mesh is compacted, so indices of
+	vertices and triangles change.
+
+	If \e a_keepSeams is \b true, vertices at the same position but with a
+	different normal, texture coordinate or color are kept apart, so that
+	hard edges and texture seams are preserved; otherwise the attributes
+	of the first vertex are used. Neighbor lists, if any, are renumbered;
+	normals are not recomputed.
+
+	Vertices are grouped with a spatial hash (cVertexHash) in linear time.
+	The memory reduction can be measured by calling getMemorySize() before
+	and after welding.
+
+	\fn        unsigned int cMesh::weldVertices(const double a_tolerance,
+	                                            const bool a_keepSeams,
+	                                            const bool a_affectChildren)
+	\param     a_tolerance  Largest difference between the coordinates of
+	                        two merged vertices.
+	\param     a_keepSeams  If \b true, vertices with different attributes
+	                        are not merged.
+	\param     a_affectChildren  If \b true, children are also welded.
+	\return    Return the number of vertices removed.
+*/
+//===========================================================================
+unsigned int cMesh::weldVertices(const double a_tolerance, const bool a_keepSeams,
+                                 const bool a_affectChildren)
+{
+    unsigned int numVertices = m_vertices.size();
+    unsigned int numRemoved = 0;
+    unsigned int i;
+
+    // group vertices by position
+    cVertexHash hash;
+    hash.build(m_vertices, a_tolerance);
+
+    // vertex kept for each vertex. with seams, the vertices kept at a
+    // position are chained from the first one, and a vertex joins the
+    // first of them with the same attributes.
+    vector<unsigned int> weld(numVertices);
+    vector<unsigned int> seamNext;
+    if (a_keepSeams) { seamNext.assign(numVertices, 0xFFFFFFFF); }
+
+    for (i=0; i<numVertices; i++)
+    {
+        weld[i] = i;
+        unsigned int group = hash.getGroup(i);
+        if (group == i) { continue; }
+
+        if (a_keepSeams)
+        {
+            unsigned int j = group;
+            unsigned int last = group;
+            while ((j != 0xFFFFFFFF) && (!same_vertex_attributes(m_vertices[i], m_vertices[j])))
+            {
+                last = j;
+                j = seamNext[j];
+            }
+            if (j == 0xFFFFFFFF)
+            {
+                seamNext[last] = i;
+                continue;
+            }
+            weld[i] = j;
+        }
+        else
+        {
+            weld[i] = group;
+        }
+        numRemoved++;
+    }
+
+    if (numRemoved > 0)
+    {
+        // redirect triangles to the vertices kept
+        unsigned int numAllocated = m_allocatedTriangles.size();
+        for (i=0; i<numAllocated; i++)
+        {
+            cTriangle* triangle = &m_triangles[m_allocatedTriangles[i]];
+            triangle->m_indexVertex0 = weld[triangle->m_indexVertex0];
+            triangle->m_indexVertex1 = weld[triangle->m_indexVertex1];
+            triangle->m_indexVertex2 = weld[triangle->m_indexVertex2];
+        }
+
+        // update triangle counts, then release merged vertices
+        for (i=0; i<numVertices; i++)
+        {
+            if (weld[i] == i) { continue; }
+            m_vertices[weld[i]].m_nTriangles += m_vertices[i].m_nTriangles;
+            m_vertices[i].m_nTriangles = 0;
+            m_vertices[i].m_allocated = false;
+            m_freeVertices.push_back(i);
+        }
+
+        // merged vertices may have made triangles degenerate or redundant
+        removeRedundantTriangles(false);
+        compact();
+
+        // release the memory of the removed elements
+        vector<cVertex>(m_vertices).swap(m_vertices);
+        vector<cTriangle>(m_triangles).swap(m_triangles);
+    }
+
+    // propagate changes to my children
+    if (a_affectChildren)
+    {
+        for (i=0; i<m_children.size(); i++)
+        {
+            cGenericObject *nextObject = m_children[i];
+            cMesh *nextMesh = dynamic_cast<cMesh*>(nextObject);
+            if (nextMesh)
+            {
+                numRemoved += nextMesh->weldVertices(a_tolerance, a_keepSeams, true);
+            }
+        }
+    }
+
+    return (numRemoved);
+}
+
+
+//===========================================================================
+/*!
+	Compute the memory allocated for the vertices and triangles of this
+	mesh, including the index of allocated triangles and the neighbor
+	lists, optionally adding the memory of my children.
+
+	\fn        size_t cMesh::getMemorySize(const bool a_includeChildren) const
+	\param     a_includeChildren  If \b true, children are included.
+	\return    Return the number of bytes allocated.
+*/
+//===========================================================================
+size_t cMesh::getMemorySize(const bool a_includeChildren) const
+{
+    size_t size = m_vertices.capacity() * sizeof(cVertex) +
+                  m_triangles.capacity() * sizeof(cTriangle) +
+                  m_allocatedTriangles.capacity() * sizeof(unsigned int) +
+                  m_allocatedTrianglePositions.capacity() * sizeof(unsigned int) +
+                  m_triangleNeighborOffsets.capacity() * sizeof(unsigned int) +
+                  m_triangleNeighbors.capacity() * sizeof(unsigned int);
+
+    if (a_includeChildren)
+    {
+        for (unsigned int i=0; i<m_children.size(); i++)
+        {
+            const cMesh *nextMesh = dynamic_cast<const cMesh*>(m_children[i]);
+            if (nextMesh)
+            {
+                size += nextMesh->getMemorySize(true);
+            }
+        }
+    }
+
+    return (size);
+}
+
+
 //===========================================================================
 /*!
      Define the way normals are graphically rendered, optionally propagating
@@ -1307,7 +2512,7 @@ void cMesh::setShowNormals(const bool& a_showNormals, const bool a_affectChildre
 //===========================================================================
 void cMesh::updateBoundaryBox()
 {
-    if (m_triangles.size() == 0)
+    if (m_allocatedTriangles.size() == 0)
     {
         m_boundaryBoxMin.zero();
         m_boundaryBoxMax.zero();
@@ -1326,42 +2531,39 @@ void cMesh::updateBoundaryBox()
     if (vertex_vector == 0) return;
     cVertex* vertex_array = (cVertex*) &((*vertex_vector)[0]);
 
-    // loop over all my triangles
-    for(unsigned int i=0; i<m_triangles.size(); i++)
+    // loop over all my allocated triangles
+    for(unsigned int i=0; i<m_allocatedTriangles.size(); i++)
     {
         // get next triangle
-        cTriangle* nextTriangle = &m_triangles[i];
+        cTriangle* nextTriangle = &m_triangles[m_allocatedTriangles[i]];
 
-        if (nextTriangle->m_allocated)
-        {
-            cVector3d tVertex0 = vertex_array[nextTriangle->m_indexVertex0].m_localPos;
-            xMin = cMin(tVertex0.x, xMin);
-            yMin = cMin(tVertex0.y, yMin);
-            zMin = cMin(tVertex0.z, zMin);
-            xMax = cMax(tVertex0.x, xMax);
-            yMax = cMax(tVertex0.y, yMax);
-            zMax = cMax(tVertex0.z, zMax);
+        cVector3d tVertex0 = vertex_array[nextTriangle->m_indexVertex0].m_localPos;
+        xMin = cMin(tVertex0.x, xMin);
+        yMin = cMin(tVertex0.y, yMin);
+        zMin = cMin(tVertex0.z, zMin);
+        xMax = cMax(tVertex0.x, xMax);
+        yMax = cMax(tVertex0.y, yMax);
+        zMax = cMax(tVertex0.z, zMax);
 
-            cVector3d tVertex1 = vertex_array[nextTriangle->m_indexVertex1].m_localPos;
-            xMin = cMin(tVertex1.x, xMin);
-            yMin = cMin(tVertex1.y, yMin);
-            zMin = cMin(tVertex1.z, zMin);
-            xMax = cMax(tVertex1.x, xMax);
-            yMax = cMax(tVertex1.y, yMax);
-            zMax = cMax(tVertex1.z, zMax);
+        cVector3d tVertex1 = vertex_array[nextTriangle->m_indexVertex1].m_localPos;
+        xMin = cMin(tVertex1.x, xMin);
+        yMin = cMin(tVertex1.y, yMin);
+        zMin = cMin(tVertex1.z, zMin);
+        xMax = cMax(tVertex1.x, xMax);
+        yMax = cMax(tVertex1.y, yMax);
+        zMax = cMax(tVertex1.z, zMax);
 
-            cVector3d tVertex2 = vertex_array[nextTriangle->m_indexVertex2].m_localPos;
-            xMin = cMin(tVertex2.x, xMin);
-            yMin = cMin(tVertex2.y, yMin);
-            zMin = cMin(tVertex2.z, zMin);
-            xMax = cMax(tVertex2.x, xMax);
-            yMax = cMax(tVertex2.y, yMax);
-            zMax = cMax(tVertex2.z, zMax);
-        }
+        cVector3d tVertex2 = vertex_array[nextTriangle->m_indexVertex2].m_localPos;
+        xMin = cMin(tVertex2.x, xMin);
+        yMin = cMin(tVertex2.y, yMin);
+        zMin = cMin(tVertex2.z, zMin);
+        xMax = cMax(tVertex2.x, xMax);
+        yMax = cMax(tVertex2.y, yMax);
+        zMax = cMax(tVertex2.z, zMax);
     }
 
 
-    if (m_triangles.size() > 0)
+    if (m_allocatedTriangles.size() > 0)
     {
         m_boundaryBoxMin.set(xMin, yMin, zMin);
         m_boundaryBoxMax.set(xMax, yMax, zMax);
@@ -1374,6 +2576,36 @@ void cMesh::updateBoundaryBox()
 }
 
 
+//===========================================================================
+/*!
+     Add the modifications recorded by the mesh operations and the calls
+     to markModifiedVertices() since the last call to the ranges of each
+     stage which consumes them: rendering (all modifications), collision
+     detection and normal computation (positions and triangles only).
+     Each stage clears its own ranges once it has processed them.
+
+     \fn       void cMesh::dispatchModifications()
+*/
+//===========================================================================
+void cMesh::dispatchModifications()
+{
+    m_renderVertices.merge(m_modifiedPositions);
+    m_renderVertices.merge(m_modifiedAttributes);
+    m_renderTriangles.merge(m_modifiedTriangles);
+
+    m_collisionVertices.merge(m_modifiedPositions);
+    m_collisionTriangles.merge(m_modifiedTriangles);
+
+    m_normalVertices.merge(m_modifiedPositions);
+    m_normalTriangles.merge(m_modifiedTriangles);
+    if (!m_modifiedTriangles.isEmpty()) { m_normalCacheValid = false; }
+
+    m_modifiedPositions.clear();
+    m_modifiedAttributes.clear();
+    m_modifiedTriangles.clear();
+}
+
+
 //===========================================================================
 /*!
      Resize the current mesh by scaling all my vertex positions.  If you want
@@ -1394,169 +2626,14 @@ void cMesh::scaleObject(const cVector3d& a_scaleFactors)
         m_vertices[i].m_normal.elementMul(a_scaleFactors);
         m_vertices[i].m_normal.normalize();
     }
+    m_modifiedPositions.markAll();
+    m_modifiedAttributes.markAll();
 
     m_boundaryBoxMax.elementMul(a_scaleFactors);
     m_boundaryBoxMin.elementMul(a_scaleFactors);
 }
 
 
-//===========================================================================
-/*!
-     Sorting functions to help in the findNeighbors method
-
-     \fn       bool TriangleSort0(const cTriangle* t1, const cTriangle* t2)
-     \param    t1  First triangle.
-     \param    t2  Second triangle.
-     \return   Return whether the x-coordinate of vertex X of the
-                   first triangle is less than that of the second triangle.
-*/
-//===========================================================================
-bool TriangleSort0(const cTriangle* t1, const cTriangle* t2)
-{
-    return (t1->getVertex0()->getPos().x < t2->getVertex0()->getPos().x);
-}
-
-
-//===========================================================================
-/*!
-    Sorting functions to help in the findNeighbors method
-
-    \fn       bool TriangleSort1(const cTriangle* t1, const cTriangle* t2)
-    \param    t1  First triangle.
-    \param    t2  Second triangle.
-    \return   Return whether the x-coordinate of vertex X of the
-    first triangle is less than that of the second triangle.
-*/
-//===========================================================================
-bool TriangleSort1(const cTriangle* t1, const cTriangle* t2)
-{
-    return (t1->getVertex1()->getPos().x < t2->getVertex1()->getPos().x);
-}
-
-
-//===========================================================================
-/*!
-    Sorting functions to help in the findNeighbors method
-
-    \fn       bool TriangleSort2(const cTriangle* t1, const cTriangle* t2)
-    \param    t1  First triangle.
-    \param    t2  Second triangle.
-    \return   Return whether the x-coordinate of vertex X of the
-    first triangle is less than that of the second triangle.
-*/
-//===========================================================================
-bool TriangleSort2(const cTriangle* t1, const cTriangle* t2)
-{
-    return (t1->getVertex2()->getPos().x < t2->getVertex2()->getPos().x);
-}
-
-
-//===========================================================================
-/*!
-    Find pairs of neighboring triangles that share specific vertices,
-    given vectors of those triangles sorted by the x-coordinates of those vertices
-    (first, second, or third), using a merge join.  We define two triangles to
-    be neighbors if and only if they have a common vertex (within some distance
-    tolerance).  In this function, we are only concerned about matching triangles
-    whose vertex v1 in search1 is shared (within tolerance) with vertex v2 in
-    search2; this function should be called once for each possible combination
-    (order doesn't matter) of v1=0..2 and v2=0..2 to find all neighbors.  Two
-    shared vertices must have equal x-coordinates (within tolerance), which allows
-    us to check for matches using a merge join on lists sorted by x-coordinate.
-    (Using y-coordinates or z-coordinates would have been equally valid.)
-
-     \fn       void cMesh::findNeighbors(std::vector<cTriangle*>* search1,
-                            std::vector<cTriangle*>* search2, const int& v1, const int& v2)
-     \param    search1   First vector of triangles, sorted by x-coords of some vertex.
-     \param    search2   Second vector of triangles, sorted by x-coords of some vertex.
-     \param    v1        Which vertex the first vector is sorted by (0, 1, or 2).
-     \param    v2        Which vertex the second vector is sorted by (0, 1, or 2).
-*/
-//===========================================================================
-void cMesh::findNeighbors(std::vector<cTriangle*>* search1,
-                             std::vector<cTriangle*>* search2, const int& v1, const int& v2)
-{
-    unsigned int i = 0;
-    unsigned int j = 0;
-
-        // In this loop, we want to find triangles from search1 that have vertex #v1
-        // (v1 = 0, 1, or 2) equal to vertex #v2 (v2 = 0, 1, or 2) of a triangle from
-        // search2.  Since both lists are sorted, we use a merge join.
-    while ((i < search1->size()) && (j < search2->size()))
-    {
-      // If the x coordinate of vertex #v1 of triangle #i in search1 is the same as
-            // the x-coordinate of vertex #v2 of triangle #j in search2 (matching x-
-            // coordinates is a necessary but not sufficient condition that the vertices
-            // are shared)...
-      if (fabs( (*search1)[i]->getVertex(v1)->getPos().x -
-                (*search2)[j]->getVertex(v2)->getPos().x) < 0.0000001)
-      {
-                // Keep matching triangles from search1 with triangle #j in search2 as
-                // long as the specified vertices' x-coordinates are shared.
-        while ((i<search1->size()) &&
-               (fabs( (*search1)[i]->getVertex(v1)->getPos().x -
-                      (*search2)[j]->getVertex(v2)->getPos().x) < 0.0000001))
-        {
-          unsigned int jj = j;
-
-                    // Keep matching triangles from search2 with triangle #i in search1 as
-                    // long as the specified vertices' x-coordinates are shared.
-          while ((jj<search2->size()) &&
-                 (fabs( (*search1)[i]->getVertex(v1)->getPos().x -
-                        (*search2)[jj]->getVertex(v2)->getPos().x) < 0.0000001))
-          {
-                        // If vertex #v1 of triangle #i in search1 is in fact equal (in x, y, and
-                        // z coordinates) to vertex #v2 of triangle #jj in search2, we have
-                        // found a pair of neighbors.
-            if (((*search1)[i] != (*search2)[jj]) &&
-                (cEqualPoints((*search1)[i]->getVertex(v1)->getPos(),
-                             (*search2)[jj]->getVertex(v2)->getPos())))
-            {
-              bool found = false;
-              unsigned int ii;
-
-                            // Check if triangle #jj from search2 has already been inserted into
-                            // the neighbors list for triangle #i from search1.
-              for (ii=0; (!found) && (ii<(*search1)[i]->m_neighbors->size()); ii++)
-                if ((*((*search1)[i]->m_neighbors))[ii] == (*search2)[jj])
-                  found = true;
-
-                            // If not, add it now.
-              if (!found)
-                (*search1)[i]->m_neighbors->push_back((*search2)[jj]);
-
-                            // Check if triangle #i from search1 has already been inserted into
-                            // the neighbors list for triangle #jj from search2.
-              found = false;
-              for (ii=0; (!found) && (ii<(*search2)[jj]->m_neighbors->size()); ii++)
-                if ((*((*search2)[jj]->m_neighbors))[ii] == (*search1)[i])
-                  found = true;
-
-                          // If not, add it now.
-              if (!found)
-                (*search2)[jj]->m_neighbors->push_back((*search1)[i]);
-            }
-            jj++;
-          }
-          i++;
-        }
-      }
-
-            // Since this is a merge join, we increment the counter for the search2 to
-            // "catch up to" search1 if the x-coordiante of vertex #v2 of triangle #j
-            // from search2 is smaller than that of vertex #v1 of triangle #i from search1...
-      else if ( (*search1)[i]->getVertex(v1)->getPos().x >
-                (*search2)[j]->getVertex(v2)->getPos().x )
-        j++;
-
-            // And vice versa.
-      else if ( (*search1)[i]->getVertex(v1)->getPos().x <
-                (*search2)[j]->getVertex(v2)->getPos().x )
-        i++;
-    }
-}
-
-
 //===========================================================================
 /*!
      Set up a Brute Force collision detector for this mesh and (optionally) its children
@@ -1583,6 +2660,11 @@ void cMesh::createBruteForceCollisionDetector(bool a_affectChildren,
     collisionDetector->initialize();
     m_collisionDetector = collisionDetector;
 
+    // the new detector includes all modifications made so far
+    dispatchModifications();
+    m_collisionVertices.clear();
+    m_collisionTriangles.clear();
+
     // create neighbor lists
     if (a_useNeighbors)
     {
@@ -1610,7 +2692,19 @@ void cMesh::createBruteForceCollisionDetector(bool a_affectChildren,
 
 //===========================================================================
 /*!
-     Set up for each triangle a list of neighbor triangles
+     Set up for each triangle a list of neighbor triangles: the triangles
+     which share a vertex with it, itself included. Vertices at the same
+     position (within CHAI_SMALL) are considered shared, so the lists also
+     connect triangles which use duplicated vertices.
+
+     Vertices are grouped by position with a spatial hash (cVertexHash),
+     then the triangles using each group are listed, and the list of a
+     triangle is the union of the lists of its three groups. All steps are
+     linear in the number of triangles for meshes of bounded valence. The
+     lists are stored one after the other in a single array; they are
+     accessed with getNumTriangleNeighbors() and getTriangleNeighbors(),
+     or cTriangle::getNeighbor(). Slots of removed triangles have no
+     neighbors, and no triangle lists them.
 
      \fn       void cMesh::createTriangleNeighborList(bool a_affectChildren)
      \param    a_affectChildren   Create neighborlists for children?
@@ -1618,61 +2712,110 @@ void cMesh::createBruteForceCollisionDetector(bool a_affectChildren,
 //===========================================================================
 void cMesh::createTriangleNeighborList(bool a_affectChildren)
 {
-    std::vector<cTriangle*>* sort0 = new std::vector<cTriangle*>;
-    unsigned int i;
-    for (i=0; i<m_triangles.size(); i++)
-      sort0->push_back(&(m_triangles[i]));
-
-    std::vector<cTriangle*>* sort1 = new std::vector<cTriangle*>(*sort0);
-    std::vector<cTriangle*>* sort2 = new std::vector<cTriangle*>(*sort1);
-
-    // Sort each list by the appropriate vertex index
-    std::sort(sort0->begin(), sort0->end(), TriangleSort0);
-    std::sort(sort1->begin(), sort1->end(), TriangleSort1);
-    std::sort(sort2->begin(), sort2->end(), TriangleSort2);
-
-    // Create neighbors for each triangle
-    for (i=0; i<m_triangles.size(); i++)
+    unsigned int numTriangles = m_triangles.size();
+    unsigned int numAllocated = m_allocatedTriangles.size();
+    unsigned int i, j, k;
+
+    // group vertices located at the same position
+    cVertexHash hash;
+    hash.build(*pVertices(), CHAI_SMALL);
+    const vector<unsigned int>& groups = hash.getGroups();
+    unsigned int numVertices = groups.size();
+
+    // list the allocated triangles using each group (a triangle whose
+    // vertices share a group is listed once)
+    vector<unsigned int> groupOffsets(numVertices + 1, 0);
+    vector<unsigned int> triangleGroups(3 * numAllocated);
+    for (i=0; i<numAllocated; i++)
+    {
+        const cTriangle& triangle = m_triangles[m_allocatedTriangles[i]];
+        unsigned int* g = &triangleGroups[3*i];
+        g[0] = groups[triangle.m_indexVertex0];
+        g[1] = groups[triangle.m_indexVertex1];
+        g[2] = groups[triangle.m_indexVertex2];
+        if (g[1] == g[0]) { g[1] = 0xFFFFFFFF; }
+        if ((g[2] == g[0]) || (g[2] == g[1])) { g[2] = 0xFFFFFFFF; }
+
+        for (k=0; k<3; k++)
+        {
+            if (g[k] != 0xFFFFFFFF) { groupOffsets[g[k] + 1]++; }
+        }
+    }
+    for (i=0; i<numVertices; i++)
     {
-      // Create the neighbor array
-      if (m_triangles[i].m_neighbors) {
-          m_triangles[i].m_neighbors->clear();
-      } else {
-          m_triangles[i].m_neighbors = new std::vector<cTriangle*>;
-      }
-      // Include each triangle as its own neighbor
-      m_triangles[i].m_neighbors->push_back(&(m_triangles[i]));
+        groupOffsets[i+1] += groupOffsets[i];
+    }
+    vector<unsigned int> fill(groupOffsets.begin(), groupOffsets.end() - 1);
+    vector<unsigned int> groupTriangles(groupOffsets[numVertices]);
+    for (i=0; i<numAllocated; i++)
+    {
+        for (k=0; k<3; k++)
+        {
+            unsigned int g = triangleGroups[3*i+k];
+            if (g != 0xFFFFFFFF) { groupTriangles[fill[g]++] = m_allocatedTriangles[i]; }
+        }
     }
 
+    // neighbors of each triangle, in triangle order; stamps avoid
+    // listing a triangle twice when it shares several vertices
+    vector<unsigned int> stamps(numTriangles, 0);
+    m_triangleNeighborOffsets.assign(numTriangles + 1, 0);
+    m_triangleNeighbors.clear();
+    m_triangleNeighbors.reserve(groupOffsets[numVertices] * 4);
+    for (i=0; i<numTriangles; i++)
+    {
+        m_triangleNeighborOffsets[i] = m_triangleNeighbors.size();
+        if (!m_triangles[i].m_allocated) { continue; }
+        const unsigned int* g = &triangleGroups[3 * m_allocatedTrianglePositions[i]];
 
-    // Find pairs of triangles for which vertex #0 of one is shared with
-    // vertex #0 of the other...
-    findNeighbors(sort0, sort0, 0, 0);
+        // include each triangle as its own neighbor
+        m_triangleNeighbors.push_back(i);
+        stamps[i] = i + 1;
 
-    // Find pairs of triangles for which vertex #0 of one is shared with
-    // vertex #1 of the other...
-    findNeighbors(sort0, sort1, 0, 1);
+        for (k=0; k<3; k++)
+        {
+            if (g[k] == 0xFFFFFFFF) { continue; }
+            for (j=groupOffsets[g[k]]; j<groupOffsets[g[k]+1]; j++)
+            {
+                unsigned int neighbor = groupTriangles[j];
+                if (stamps[neighbor] == i + 1) { continue; }
+                stamps[neighbor] = i + 1;
+                m_triangleNeighbors.push_back(neighbor);
+            }
+        }
+    }
+    m_triangleNeighborOffsets[numTriangles] = m_triangleNeighbors.size();
 
-    // Find pairs of triangles for which vertex #0 of one is shared with
-    // vertex #2 of the other...
-    findNeighbors(sort0, sort2, 0, 2);
+    // update children if required
+    if (a_affectChildren)
+    {
+        unsigned int i;
+        for (i=0; i<m_children.size(); i++)
+        {
+            cGenericObject *nextObject = m_children[i];
 
-    // Find pairs of triangles for which vertex #1 of one is shared with
-    // vertex #1 of the other...
-    findNeighbors(sort1, sort1, 1, 1);
+            cMesh *nextMesh = dynamic_cast<cMesh*>(nextObject);
+            if (nextMesh)
+            {
+                nextMesh->createTriangleNeighborList(a_affectChildren);
+            }
+        }
+    }
+}
 
-    // Find pairs of triangles for which vertex #1 of one is shared with
-    // vertex #2 of the other...
-    findNeighbors(sort1, sort2, 1, 2);
 
-    // Find pairs of triangles for which vertex #2 of one is shared with
-    // vertex #2 of the other...
-    findNeighbors(sort2, sort2, 2, 2);
+//===========================================================================
+/*!
+     Delete the neighbor lists of the triangles.
 
-    // Clean up
-    delete sort0;
-    delete sort1;
-    delete sort2;
+     \fn       void cMesh::clearTriangleNeighborList(bool a_affectChildren)
+     \param    a_affectChildren   Delete neighbor lists of children?
+*/
+//===========================================================================
+void cMesh::clearTriangleNeighborList(bool a_affectChildren)
+{
+    vector<unsigned int>().swap(m_triangleNeighborOffsets);
+    vector<unsigned int>().swap(m_triangleNeighbors);
 
     // update children if required
     if (a_affectChildren)
@@ -1685,7 +2828,7 @@ void cMesh::createTriangleNeighborList(bool a_affectChildren)
             cMesh *nextMesh = dynamic_cast<cMesh*>(nextObject);
             if (nextMesh)
             {
-                nextMesh->createTriangleNeighborList(a_affectChildren);
+                nextMesh->clearTriangleNeighborList(a_affectChildren);
             }
         }
     }
@@ -1721,6 +2864,11 @@ void cMesh::createAABBCollisionDetector(double a_radius,
     collisionDetectorAABB->initialize(a_radius);
     m_collisionDetector = collisionDetectorAABB;
 
+    // the new detector includes all modifications made so far
+    dispatchModifications();
+    m_collisionVertices.clear();
+    m_collisionTriangles.clear();
+
     // create neighbor lists
     if (a_useNeighbors)
     {
@@ -1776,6 +2924,11 @@ void cMesh::createSphereTreeCollisionDetector(double a_radius,
     collisionDetectorSphereTree->initialize(a_radius);
     m_collisionDetector = collisionDetectorSphereTree;
 
+    // the new detector includes all modifications made so far
+    dispatchModifications();
+    m_collisionVertices.clear();
+    m_collisionTriangles.clear();
+
     // create list of neighbors
     if (a_useNeighbors)
     {
@@ -1794,13 +2947,180 @@ void cMesh::createSphereTreeCollisionDetector(double a_radius,
           nextMesh->createSphereTreeCollisionDetector(a_radius,
                                                       a_affectChildren,
                                                       a_useNeighbors);
-          nextMesh->m_collisionDetector->initialize(a_radius);
         }
       }
     }
 }
 
 
+//===========================================================================
+/*!
+     Set up an AABB collision detector for this mesh, loading its tree from
+     a file written by saveCollisionDetector() instead of building it. The
+     file is only used if it was saved for the same radius, and for the
+     same triangles and vertex positions. Otherwise the current collision
+     detector is kept, and the tree can be built with
+     createAABBCollisionDetector() and saved for the next time.
+
+     \fn       bool cMesh::loadAABBCollisionDetector(const string& a_fileName,
+                                                     double a_radius,
+                                                     bool a_useNeighbors)
+     \param    a_fileName  Name of the file.
+     \param    a_radius  Bounding radius.
+     \param    a_useNeighbors  Create neighbor lists?
+     \return   Return \b true if the collision detector was loaded.
+*/
+//===========================================================================
+bool cMesh::loadAABBCollisionDetector(const string& a_fileName,
+                                      double a_radius,
+                                      bool a_useNeighbors)
+{
+    // load the AABB tree
+    cCollisionAABB* collisionDetectorAABB =
+                         new cCollisionAABB(pTriangles(), a_useNeighbors);
+    if (!collisionDetectorAABB->loadTree(a_fileName, a_radius))
+    {
+        delete collisionDetectorAABB;
+        return (false);
+    }
+
+    // replace previous collision detector
+    if (m_collisionDetector != NULL)
+    {
+        delete m_collisionDetector;
+    }
+    m_collisionDetector = collisionDetectorAABB;
+
+    // the new detector includes all modifications made so far
+    dispatchModifications();
+    m_collisionVertices.clear();
+    m_collisionTriangles.clear();
+
+    // create neighbor lists
+    if (a_useNeighbors)
+    {
+        createTriangleNeighborList(false);
+    }
+
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+     Set up a sphere tree collision detector for this mesh, loading its tree
+     from a file written by saveCollisionDetector() instead of building it.
+     The file is only used if it was saved for the same radius, and for the
+     same triangles and vertex positions. Otherwise the current collision
+     detector is kept, and the tree can be built with
+     createSphereTreeCollisionDetector() and saved for the next time.
+
+     \fn       bool cMesh::loadSphereTreeCollisionDetector(const string& a_fileName,
+                                                           double a_radius,
+                                                           bool a_useNeighbors)
+     \param    a_fileName  Name of the file.
+     \param    a_radius  Bounding radius.
+     \param    a_useNeighbors  Create neighbor lists?
+     \return   Return \b true if the collision detector was loaded.
+*/
+//===========================================================================
+bool cMesh::loadSphereTreeCollisionDetector(const string& a_fileName,
+                                            double a_radius,
+                                            bool a_useNeighbors)
+{
+    // load the sphere tree
+    cCollisionSpheres* collisionDetectorSphereTree =
+                           new cCollisionSpheres(pTriangles(), a_useNeighbors);
+    if (!collisionDetectorSphereTree->loadTree(a_fileName, a_radius))
+    {
+        delete collisionDetectorSphereTree;
+        return (false);
+    }
+
+    // replace previous collision detector
+    if (m_collisionDetector != NULL)
+    {
+        delete m_collisionDetector;
+    }
+    m_collisionDetector = collisionDetectorSphereTree;
+
+    // the new detector includes all modifications made so far
+    dispatchModifications();
+    m_collisionVertices.clear();
+    m_collisionTriangles.clear();
+
+    // create list of neighbors
+    if (a_useNeighbors)
+    {
+        createTriangleNeighborList(false);
+    }
+
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+     Save the tree of the collision detector of this mesh to a file, so
+     that it can be loaded with loadAABBCollisionDetector() or
+     loadSphereTreeCollisionDetector() the next time the mesh is used.
+     Pending modifications are applied to the tree first.
+
+     \fn       bool cMesh::saveCollisionDetector(const string& a_fileName)
+     \param    a_fileName  Name of the file.
+     \return   Return \b true if the file was written.
+*/
+//===========================================================================
+bool cMesh::saveCollisionDetector(const string& a_fileName)
+{
+    if (m_collisionDetector == NULL) { return (false); }
+
+    updateCollisionDetector(false);
+    return (m_collisionDetector->saveTree(a_fileName));
+}
+
+
+//===========================================================================
+/*!
+     Update the collision detector for the vertices and triangles modified
+     since its last update. Tree based detectors refit the bounding volumes
+     of the moved triangles instead of building a new tree, unless
+     triangles have been added or removed.
+
+     \fn       void cMesh::updateCollisionDetector(const bool a_affectChildren)
+     \param    a_affectChildren  If \b true, then children are also updated.
+*/
+//===========================================================================
+void cMesh::updateCollisionDetector(const bool a_affectChildren)
+{
+    dispatchModifications();
+
+    if (m_collisionDetector != NULL)
+    {
+        m_collisionDetector->update(m_collisionVertices, m_collisionTriangles);
+    }
+    m_collisionVertices.clear();
+    m_collisionTriangles.clear();
+
+    // propagate the operation to my children
+    if (a_affectChildren)
+    {
+        unsigned int i, numItems;
+        numItems = m_children.size();
+        for (i=0; i<numItems; i++)
+        {
+            cGenericObject *nextObject = m_children[i];
+
+            cMesh *nextMesh = dynamic_cast<cMesh*>(nextObject);
+            if (nextMesh)
+            {
+                nextMesh->updateCollisionDetector(a_affectChildren);
+            }
+        }
+    }
+}
+
+
 //===========================================================================
 /*!
      Render this mesh in OpenGL.  This method actually just prepares some
@@ -1842,6 +3162,32 @@ void cMesh::render(const int a_renderMode)
 }
 
 
+//===========================================================================
+/*!
+    Add this mesh to a render queue, which draws it later sorted by render
+    state. Normals are drawn at once.
+
+    \fn       bool cMesh::enqueue(cRenderQueue* a_queue)
+    \param    a_queue  Render queue of the current view.
+    \return   Return \b true, the mesh is drawn by the queue.
+*/
+//===========================================================================
+bool cMesh::enqueue(cRenderQueue* a_queue)
+{
+    // render normals
+    if (m_showNormals) renderNormals(m_showNormalsForTriangleVerticesOnly);
+
+    // empty meshes are not drawn
+    if ((m_vertices.size() == 0) || (m_triangles.size() == 0))
+    {
+        return (true);
+    }
+
+    a_queue->addMesh(this);
+    return (true);
+}
+
+
 //===========================================================================
 /*!
      Invalidate any existing display lists.  You should call this on if you're using
@@ -1860,6 +3206,10 @@ void cMesh::invalidateDisplayList(const bool a_affectChildren)
         m_displayList = -1;
     }
 
+    // vertices may have changed too
+    m_renderVertices.markAll();
+    m_renderTriangles.markAll();
+
     // Propagate the operation to my children
     if (a_affectChildren)
     {
@@ -1879,6 +3229,42 @@ void cMesh::invalidateDisplayList(const bool a_affectChildren)
 }
 
 
+//===========================================================================
+/*!
+     Mark vertices and triangles as modified, so that vertex streams and
+     vertex buffer objects are updated before the next rendering pass.
+     Call this if you modify vertices directly while rendering from vertex
+     streams or buffer objects.
+
+     \fn       void cMesh::invalidateVertexData(const bool a_affectChildren)
+     \param    a_affectChildren  If \b true all children are updated
+*/
+//===========================================================================
+void cMesh::invalidateVertexData(const bool a_affectChildren)
+{
+    m_modifiedPositions.markAll();
+    m_modifiedAttributes.markAll();
+    m_modifiedTriangles.markAll();
+
+    // Propagate the operation to my children
+    if (a_affectChildren)
+    {
+        unsigned int i, numItems;
+        numItems = m_children.size();
+        for (i=0; i<numItems; i++)
+        {
+            cGenericObject *nextObject = m_children[i];
+
+            cMesh *nextMesh = dynamic_cast<cMesh*>(nextObject);
+            if (nextMesh)
+            {
+                nextMesh->invalidateVertexData(a_affectChildren);
+            }
+        }
+    }
+}
+
+
 //===========================================================================
 /*!
      Render a graphic representation of each normal of the mesh.
@@ -2040,7 +3426,9 @@ void cMesh::renderMesh(const int a_renderMode)
     glDisableClientState(GL_INDEX_ARRAY);
     glDisableClientState(GL_EDGE_FLAG_ARRAY);
 
-    if (m_useVertexArrays)
+    bool useArrays = (m_useVertexArrays || m_useVertexStreams || isRenderedWithBufferObjects());
+
+    if (useArrays)
     {
         glEnableClientState(GL_NORMAL_ARRAY);
         glEnableClientState(GL_VERTEX_ARRAY);
@@ -2071,7 +3459,7 @@ void cMesh::renderMesh(const int a_renderMode)
         // enable vertex colors
         glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
         glEnable(GL_COLOR_MATERIAL);
-        if (m_useVertexArrays)
+        if (useArrays)
         {
             glEnableClientState(GL_COLOR_ARRAY);
         }
@@ -2100,7 +3488,7 @@ void cMesh::renderMesh(const int a_renderMode)
     if ((m_texture != NULL) && (m_useTextureMapping))
     {
         glEnable(GL_TEXTURE_2D);
-        if (m_useVertexArrays)
+        if (useArrays)
         {
             glEnableClientState(GL_TEXTURE_COORD_ARRAY);
         }
@@ -2108,10 +3496,134 @@ void cMesh::renderMesh(const int a_renderMode)
     }
 
 
+    /////////////////////////////////////////////////////////////////////////
+    // RENDER TRIANGLES
+    /////////////////////////////////////////////////////////////////////////
+    renderTriangles();
+
+    //-----------------------------------------------------------------------
+    // FINALIZE
+    //-----------------------------------------------------------------------
+
+    // restore OpenGL settings to reasonable defaults
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_COLOR_MATERIAL);
+    glColorMaterial(GL_FRONT_AND_BACK,GL_AMBIENT_AND_DIFFUSE);
+    glDisable(GL_TEXTURE_2D);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+    // Turn off any array variables I might have turned on...
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    // If we've gotten this far and we're using a display list for rendering,
+    // we must be capturing it right now...
+    if ((m_useDisplayList) && (m_displayList != -1) && (creating_display_list))
+    {
+        // finalize list
+        glEndList();
+
+        // Recursively make a call to actually render this object if
+        // we didn't use compile_and_execute
+        renderMesh(a_renderMode);
+    }
+}
+
+
+//===========================================================================
+/*!
+    Return \b true if the mesh is drawn from vertex buffer objects: they
+    are enabled, supported by the current OpenGL context, and the mesh is
+    not compiled in a display list.
+
+    \fn       bool cMesh::isRenderedWithBufferObjects() const
+    \return   Return \b true if vertex buffer objects are used for rendering.
+*/
+//===========================================================================
+bool cMesh::isRenderedWithBufferObjects() const
+{
+    // buffer objects are not compiled in display lists
+    return (m_useVertexBufferObjects && (!m_useDisplayList) &&
+            cVertexBuffer::isSupported());
+}
+
+
+//===========================================================================
+/*!
+    Draw the allocated triangles with the current OpenGL state. Material,
+    texture and client arrays must already be set, by renderMesh() or by
+    a cRenderQueue; modified vertices and triangles are uploaded first
+    when rendering from vertex streams or buffer objects.
+
+    \fn       void cMesh::renderTriangles()
+*/
+//===========================================================================
+void cMesh::renderTriangles()
+{
+    /////////////////////////////////////////////////////////////////////////
+    // RENDER TRIANGLES WITH VERTEX BUFFER OBJECTS
+    /////////////////////////////////////////////////////////////////////////
+    if (isRenderedWithBufferObjects())
+    {
+        // upload the modified part of the mesh
+        dispatchModifications();
+        if (!m_renderVertices.isEmpty())
+        {
+            vector<cVertex>* vertices = pVertices();
+            m_vertexBuffer.updateVertices(*vertices, m_renderVertices.getFirst(),
+                                          m_renderVertices.getLast(vertices->size()));
+            m_renderVertices.clear();
+        }
+        if (!m_renderTriangles.isEmpty())
+        {
+            m_vertexBuffer.updateTriangles(m_triangles, m_allocatedTriangles);
+            m_renderTriangles.clear();
+        }
+
+        // render all allocated triangles
+        m_vertexBuffer.render(true,
+                              ((m_texture != NULL) && (m_useTextureMapping)),
+                              m_useVertexColors);
+    }
+
+    /////////////////////////////////////////////////////////////////////////
+    // RENDER TRIANGLES WITH VERTEX STREAMS
+    /////////////////////////////////////////////////////////////////////////
+    else if (m_useVertexStreams)
+    {
+        // convert the modified part of the mesh
+        dispatchModifications();
+        if (!m_renderVertices.isEmpty())
+        {
+            vector<cVertex>* vertices = pVertices();
+            m_vertexStreams.updateVertices(*vertices, m_renderVertices.getFirst(),
+                                           m_renderVertices.getLast(vertices->size()));
+            m_renderVertices.clear();
+        }
+        if (!m_renderTriangles.isEmpty())
+        {
+            m_vertexStreams.updateIndices(m_triangles, m_allocatedTriangles);
+            m_renderTriangles.clear();
+        }
+
+        // specify pointers to the streams
+        glVertexPointer(3, GL_FLOAT, 0, m_vertexStreams.getPositions());
+        glNormalPointer(GL_FLOAT, 0, m_vertexStreams.getNormals());
+        glColorPointer(4, GL_FLOAT, 0, m_vertexStreams.getColors());
+        glTexCoordPointer(2, GL_FLOAT, 0, m_vertexStreams.getTexCoords());
+
+        // render all allocated triangles
+        glDrawElements(GL_TRIANGLES, m_vertexStreams.getNumIndices(),
+                       GL_UNSIGNED_INT, m_vertexStreams.getIndices());
+    }
+
     /////////////////////////////////////////////////////////////////////////
     // RENDER TRIANGLES WITH VERTEX ARRAYS
     /////////////////////////////////////////////////////////////////////////
-    if (m_useVertexArrays)
+    else if (m_useVertexArrays)
     {
         // Where does our vertex array live?
         vector<cVertex>* vertex_vector = pVertices();
@@ -2125,24 +3637,18 @@ void cMesh::renderMesh(const int a_renderMode)
 
         // variables
         unsigned int i;
-        unsigned int numItems = m_triangles.size();
+        unsigned int numItems = m_allocatedTriangles.size();
 
         // begin rendering triangles
         glBegin(GL_TRIANGLES);
 
-        // render all active triangles
+        // render all allocated triangles
         for(i=0; i<numItems; i++)
         {
-            bool allocated = m_triangles[i].m_allocated;
-            if (allocated)
-            {
-                unsigned int index0 = m_triangles[i].m_indexVertex0;
-                unsigned int index1 = m_triangles[i].m_indexVertex1;
-                unsigned int index2 = m_triangles[i].m_indexVertex2;
-                glArrayElement(index0);
-                glArrayElement(index1);
-                glArrayElement(index2);
-            }
+            const cTriangle* triangle = &m_triangles[m_allocatedTriangles[i]];
+            glArrayElement(triangle->m_indexVertex0);
+            glArrayElement(triangle->m_indexVertex1);
+            glArrayElement(triangle->m_indexVertex2);
         }
 
         // finalize rendering list of triangles
@@ -2156,20 +3662,20 @@ void cMesh::renderMesh(const int a_renderMode)
     {
         // variables
         unsigned int i;
-        unsigned int numItems = m_triangles.size();
+        unsigned int numItems = m_allocatedTriangles.size();
 
         // begin rendering triangles
         glBegin(GL_TRIANGLES);
 
-        // render all active triangles
+        // render all allocated triangles
         if ((!m_useTextureMapping) && (!m_useVertexColors))
         {
             for(i=0; i<numItems; i++)
             {
                 // get pointers to vertices
-                cVertex* v0 = m_triangles[i].getVertex(0);
-                cVertex* v1 = m_triangles[i].getVertex(1);
-                cVertex* v2 = m_triangles[i].getVertex(2);
+                cVertex* v0 = m_triangles[m_allocatedTriangles[i]].getVertex(0);
+                cVertex* v1 = m_triangles[m_allocatedTriangles[i]].getVertex(1);
+                cVertex* v2 = m_triangles[m_allocatedTriangles[i]].getVertex(2);
 
                 // render vertex 0
                 glNormal3dv(&v0->m_normal.x);
@@ -2189,9 +3695,9 @@ void cMesh::renderMesh(const int a_renderMode)
             for(i=0; i<numItems; i++)
             {
                 // get pointers to vertices
-                cVertex* v0 = m_triangles[i].getVertex(0);
-                cVertex* v1 = m_triangles[i].getVertex(1);
-                cVertex* v2 = m_triangles[i].getVertex(2);
+                cVertex* v0 = m_triangles[m_allocatedTriangles[i]].getVertex(0);
+                cVertex* v1 = m_triangles[m_allocatedTriangles[i]].getVertex(1);
+                cVertex* v2 = m_triangles[m_allocatedTriangles[i]].getVertex(2);
 
                 // render vertex 0
                 glNormal3dv(&v0->m_normal.x);
@@ -2214,9 +3720,9 @@ void cMesh::renderMesh(const int a_renderMode)
             for(i=0; i<numItems; i++)
             {
                 // get pointers to vertices
-                cVertex* v0 = m_triangles[i].getVertex(0);
-                cVertex* v1 = m_triangles[i].getVertex(1);
-                cVertex* v2 = m_triangles[i].getVertex(2);
+                cVertex* v0 = m_triangles[m_allocatedTriangles[i]].getVertex(0);
+                cVertex* v1 = m_triangles[m_allocatedTriangles[i]].getVertex(1);
+                cVertex* v2 = m_triangles[m_allocatedTriangles[i]].getVertex(2);
 
                 // render vertex 0
                 glNormal3dv(&v0->m_normal.x);
@@ -2239,9 +3745,9 @@ void cMesh::renderMesh(const int a_renderMode)
             for(i=0; i<numItems; i++)
             {
                 // get pointers to vertices
-                cVertex* v0 = m_triangles[i].getVertex(0);
-                cVertex* v1 = m_triangles[i].getVertex(1);
-                cVertex* v2 = m_triangles[i].getVertex(2);
+                cVertex* v0 = m_triangles[m_allocatedTriangles[i]].getVertex(0);
+                cVertex* v1 = m_triangles[m_allocatedTriangles[i]].getVertex(1);
+                cVertex* v2 = m_triangles[m_allocatedTriangles[i]].getVertex(2);
 
                 // render vertex 0
                 glNormal3dv(&v0->m_normal.x);
@@ -2266,36 +3772,6 @@ void cMesh::renderMesh(const int a_renderMode)
         // finalize rendering list of triangles
         glEnd();
     }
-
-    //-----------------------------------------------------------------------
-    // FINALIZE
-    //-----------------------------------------------------------------------
-
-    // restore OpenGL settings to reasonable defaults
-    glDisable(GL_BLEND);
-    glDepthMask(GL_TRUE);
-    glDisable(GL_COLOR_MATERIAL);
-    glColorMaterial(GL_FRONT_AND_BACK,GL_AMBIENT_AND_DIFFUSE);
-    glDisable(GL_TEXTURE_2D);
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-    // Turn off any array variables I might have turned on...
-    glDisableClientState(GL_NORMAL_ARRAY);
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_COLOR_ARRAY);
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-
-    // If we've gotten this far and we're using a display list for rendering,
-    // we must be capturing it right now...
-    if ((m_useDisplayList) && (m_displayList != -1) && (creating_display_list))
-    {
-        // finalize list
-        glEndList();
-
-        // Recursively make a call to actually render this object if
-        // we didn't use compile_and_execute
-        renderMesh(a_renderMode);
-    }
 }
 
 
@@ -2314,6 +3790,11 @@ void cMesh::onDisplayReset(const bool a_affectChildren)
     invalidateDisplayList();
     if (m_texture != NULL) m_texture->markForUpdate();
 
+    // buffer objects belonged to the previous context
+    m_vertexBuffer.reset();
+    m_renderVertices.markAll();
+    m_renderTriangles.markAll();
+
     // Use the superclass method to call the same function on the rest of the
     // scene graph...
     cGenericObject::onDisplayReset(a_affectChildren);
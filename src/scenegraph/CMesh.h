@@ -32,6 +32,10 @@
 #include "../graphics/CMaterial.h"
 #include "../graphics/CTexture2D.h"
 #include "../graphics/CColor.h"
+#include "../graphics/CVertexStreams.h"
+#include "../graphics/CVertexBuffer.h"
+#include "../graphics/CDirtyRange.h"
+#include "../timers/CThreadPool.h"
 #include <vector>
 #include <list>
 //---------------------------------------------------------------------------
@@ -65,6 +69,7 @@ class cVertex;
 //===========================================================================
 class cMesh : public cGenericObject
 {
+  friend class cRenderQueue;
 
   public:
 
@@ -106,6 +111,12 @@ class cMesh : public cGenericObject
     //! Add an array of vertices to the vertex list given an array of vertex positions.
     void addVertices(const cVector3d* a_vertexPositions, const unsigned int& a_numVertices);
 
+    //! Append vertices at the origin to the end of the vertex list, and return the index of the first one.
+    unsigned int appendVertices(const unsigned int a_numVertices);
+
+    //! Append vertices given an array of positions (x, y, z per vertex), and return the index of the first one.
+    unsigned int appendVertices(const double* a_positions, const unsigned int a_numVertices);
+
     //! Remove the vertex at the specified position in my vertex array.
     bool removeVertex(const unsigned int a_index);
 
@@ -130,6 +141,14 @@ class cMesh : public cGenericObject
     //! Access the first non-empty vertex list in any of my children (use carefully).
     virtual vector<cVertex>* pVerticesNonEmpty();
 
+    //! Mark vertices [a_first, a_last) as modified, after changing their position or attributes.
+    void markModifiedVertices(const unsigned int a_first, const unsigned int a_last,
+                              const bool a_positionsModified=true);
+
+    //! Mark all vertices as modified, optionally including those of my children.
+    void markAllVerticesModified(const bool a_positionsModified=true,
+                                 const bool a_affectChildren=true);
+
 
     //-----------------------------------------------------------------------
     // METHODS - TRIANGLES
@@ -143,6 +162,9 @@ class cMesh : public cGenericObject
     unsigned int newTriangle(const cVector3d& a_vertex0, const cVector3d& a_vertex1,
                              const cVector3d& a_vertex2);
 
+    //! Append triangles given an array of vertex index triples, and return the index of the first one.
+    unsigned int appendTriangles(const unsigned int* a_indices, const unsigned int a_numTriangles);
+
     //! Remove a triangle from my triangle array.
     bool removeTriangle(const unsigned int a_index);
 
@@ -152,12 +174,31 @@ class cMesh : public cGenericObject
     //! Read the number of stored triangles, optionally including those of my children.
     unsigned int getNumTriangles(bool a_includeChildren = false) const;
 
+    //! Read the number of allocated triangles, which excludes the slots of removed triangles.
+    unsigned int getNumAllocatedTriangles() const { return (unsigned int)(m_allocatedTriangles.size()); }
+
+    //! Access the indices of all allocated triangles, in no particular order.
+    inline const vector<unsigned int>& getAllocatedTriangles() const { return (m_allocatedTriangles); }
+
     //! Clear all triangles and vertices of mesh.
     void clear();
 
+    //! Reserve memory for a total number of vertices and triangles, before building the mesh.
+    void reserve(const unsigned int a_numVertices, const unsigned int a_numTriangles);
+
+    //! Remove the slots of removed vertices and triangles, optionally returning the new index of each old index.
+    void compact(vector<int>* a_vertexRemap=NULL, vector<int>* a_triangleRemap=NULL);
+
+    //! Reorder triangles for the vertex cache and vertices by first use, optionally returning the new index of each old index.
+    void optimizeVertexCache(const unsigned int a_cacheSize=32,
+                             vector<int>* a_vertexRemap=NULL, vector<int>* a_triangleRemap=NULL);
+
     //! Access my triangle array directly (use carefully).
     inline vector<cTriangle>* pTriangles() { return (&m_triangles); }
 
+    //! Mark triangles [a_first, a_last) as modified, after writing their members directly.
+    void markModifiedTriangles(const unsigned int a_first, const unsigned int a_last);
+
 
     //-----------------------------------------------------------------------
     // METHODS - GRAPHIC RENDERING
@@ -177,12 +218,27 @@ class cMesh : public cGenericObject
     //! Enable or disable the use vertex arrays for rendering, optionally propagating the operation to my children.
     void useVertexArrays(const bool a_useVertexArrays, const bool a_affectChildren=true);
 
+    //! Enable or disable rendering from compact float vertex streams, optionally propagating the operation to my children.
+    void useVertexStreams(const bool a_useVertexStreams, const bool a_affectChildren=true);
+
+    //! Ask whether I'm currently rendering from vertex streams.
+    bool getVertexStreamsEnabled() const { return m_useVertexStreams; }
+
+    //! Enable or disable rendering from OpenGL vertex buffer objects, optionally propagating the operation to my children.
+    void useVertexBufferObjects(const bool a_useVertexBufferObjects, const bool a_affectChildren=true);
+
+    //! Ask whether I'm currently rendering from vertex buffer objects.
+    bool getVertexBufferObjectsEnabled() const { return m_useVertexBufferObjects; }
+
     //! Ask whether I'm currently rendering with a display list.
     bool getDisplayListEnabled() const { return m_useDisplayList; }
 
     //! Invalidate any existing display lists.
     void invalidateDisplayList(const bool a_affectChildren=true);
 
+    //! Mark vertices and triangles as modified, so that vertex streams and buffer objects are updated.
+    void invalidateVertexData(const bool a_affectChildren=true);
+
     //! Enable or disable the rendering of vertex normals, optionally propagating the operation to my children.
     void setShowNormals(const bool& a_showNormals, const bool a_affectChildren=true, const bool a_trianglesOnly = false);
 
@@ -212,12 +268,39 @@ class cMesh : public cGenericObject
     //! Set up a sphere tree collision detector for this mesh and (optionally) its children.
     virtual void createSphereTreeCollisionDetector(double a_radius, bool a_affectChildren, bool a_useNeighbors);
 
+    //! Set up an AABB collision detector for this mesh from a tree saved with saveCollisionDetector().
+    bool loadAABBCollisionDetector(const string& a_fileName, double a_radius, bool a_useNeighbors);
+
+    //! Set up a sphere tree collision detector for this mesh from a tree saved with saveCollisionDetector().
+    bool loadSphereTreeCollisionDetector(const string& a_fileName, double a_radius, bool a_useNeighbors);
+
+    //! Save the tree of the collision detector of this mesh to a file.
+    bool saveCollisionDetector(const string& a_fileName);
+
+    //! Update the collision detector for the vertices and triangles modified since its last update.
+    void updateCollisionDetector(const bool a_affectChildren=true);
+
     //! Create a lists for neighbor triangles for each triangle of the mesh.
     void createTriangleNeighborList(bool a_affectChildren);
 
-    //! Search for triangle neighbors.
-    void findNeighbors(std::vector<cTriangle*>* search1,
-                             std::vector<cTriangle*>* search2, const int& v1, const int& v2);
+    //! Delete the neighbor lists of the triangles.
+    void clearTriangleNeighborList(bool a_affectChildren);
+
+    //! Return \b true if the neighbor lists match the current triangle array.
+    inline bool getTriangleNeighborListValid() const { return (m_triangleNeighborOffsets.size() == m_triangles.size() + 1); }
+
+    //! Read the number of neighbors of a triangle, itself included (0 if there is no neighbor list).
+    inline unsigned int getNumTriangleNeighbors(const unsigned int a_index) const
+    {
+        if (a_index + 1 >= m_triangleNeighborOffsets.size()) { return (0); }
+        return (m_triangleNeighborOffsets[a_index+1] - m_triangleNeighborOffsets[a_index]);
+    }
+
+    //! Access the indices of the neighbors of a triangle.
+    inline const unsigned int* getTriangleNeighbors(const unsigned int a_index) const
+    {
+        return (&m_triangleNeighbors[m_triangleNeighborOffsets[a_index]]);
+    }
 
 
     //-----------------------------------------------------------------------
@@ -227,6 +310,9 @@ class cMesh : public cGenericObject
     //! Compute all triangle normals, optionally propagating the operation to my children.
     void computeAllNormals(const bool a_affectChildren=false);
 
+    //! Compute the normals of the vertices around the vertices moved since the last normal computation.
+    void updateNormals(const bool a_affectChildren=false);
+
     //! Extrude each vertex of the mesh by some amount along its normal.
     void extrude(const double a_extrudeDistance, const bool a_affectChildren=false,
       const bool a_updateCollisionDetector=false);
@@ -257,6 +343,13 @@ class cMesh : public cGenericObject
     //! Remove redundant triangles from this model.
     virtual void removeRedundantTriangles(const bool a_affectChildren=0);
 
+    //! Merge vertices located at the same position, and return the number of vertices removed.
+    unsigned int weldVertices(const double a_tolerance=CHAI_SMALL, const bool a_keepSeams=true,
+                              const bool a_affectChildren=false);
+
+    //! Read the number of bytes allocated for vertices and triangles, optionally including my children.
+    size_t getMemorySize(const bool a_includeChildren=false) const;
+
 
   protected:
 
@@ -267,6 +360,15 @@ class cMesh : public cGenericObject
     //! Render the mesh itself.
     virtual void render(const int a_renderMode=0);
 
+    //! Add the mesh to a render queue instead of rendering it.
+    virtual bool enqueue(cRenderQueue* a_queue);
+
+    //! Return \b true if the mesh is drawn from vertex buffer objects.
+    bool isRenderedWithBufferObjects() const;
+
+    //! Draw the allocated triangles with the current material, texture and client arrays.
+    void renderTriangles();
+
     //! Draw a small line for each vertex normal.
     virtual void renderNormals(const bool a_trianglesOnly=true);
 
@@ -276,6 +378,24 @@ class cMesh : public cGenericObject
     //! Update my boundary box dimensions based on my vertices.
     virtual void updateBoundaryBox();
 
+    //! Add the modifications recorded since the last call to the ranges of each stage.
+    void dispatchModifications();
+
+    //! Build the index of allocated triangles from the allocation flags.
+    void rebuildAllocatedTriangles();
+
+    //! Build the list of triangles using each vertex, for normal computation.
+    void buildNormalAdjacency();
+
+    //! Run a normal computation task, on the thread pool for large meshes.
+    void processNormals(cThreadPoolTask a_task, void* a_data, unsigned int a_count);
+
+    //! Thread pool task computing face normals.
+    static void triangleNormalsTask(void* a_data, unsigned int a_begin, unsigned int a_end);
+
+    //! Thread pool task gathering vertex normals from face normals.
+    static void vertexNormalsTask(void* a_data, unsigned int a_begin, unsigned int a_end);
+
 
     //-----------------------------------------------------------------------
     // MEMBERS - DISPLAY PROPERTIES:
@@ -305,6 +425,51 @@ class cMesh : public cGenericObject
     //! The openGL display list used to draw this mesh, if display lists are enabled.
     int m_displayList;
 
+    //! Should we render this mesh from compact vertex streams?
+    bool m_useVertexStreams;
+
+    //! Float copy of the vertices and packed triangle indices, if vertex streams are enabled.
+    cVertexStreams m_vertexStreams;
+
+    //! Should we render this mesh from OpenGL vertex buffer objects?
+    bool m_useVertexBufferObjects;
+
+    //! Vertex and index buffer objects, if vertex buffer objects are enabled.
+    cVertexBuffer m_vertexBuffer;
+
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS - MODIFICATIONS:
+    //-----------------------------------------------------------------------
+
+    //! Vertices whose position changed since the last dispatch (marked by cMesh methods and markModifiedVertices()).
+    cDirtyRange m_modifiedPositions;
+
+    //! Vertices whose normal, texture coordinate or color changed since the last dispatch (marked by cMesh methods and markModifiedVertices()).
+    cDirtyRange m_modifiedAttributes;
+
+    //! Triangles added or removed since the last dispatch.
+    cDirtyRange m_modifiedTriangles;
+
+    //! Vertices to be sent again to the vertex streams or buffer objects.
+    cDirtyRange m_renderVertices;
+
+    //! Triangles to be sent again to the vertex streams or buffer objects.
+    cDirtyRange m_renderTriangles;
+
+    //! Vertices moved since the last update of the collision detector.
+    cDirtyRange m_collisionVertices;
+
+    //! Triangles modified since the last update of the collision detector.
+    cDirtyRange m_collisionTriangles;
+
+    //! Vertices moved since the last normal computation.
+    cDirtyRange m_normalVertices;
+
+    //! Triangles modified since the last normal computation.
+    cDirtyRange m_normalTriangles;
+
 
     //-----------------------------------------------------------------------
     // MEMBERS - ARRAYS:
@@ -321,6 +486,49 @@ class cMesh : public cGenericObject
 
     //! List of free slots in the triangle array.
     list<unsigned int> m_freeTriangles;
+
+    //! Indices of the allocated triangles.
+    vector<unsigned int> m_allocatedTriangles;
+
+    //! Position of each allocated triangle in m_allocatedTriangles.
+    vector<unsigned int> m_allocatedTrianglePositions;
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS - NORMALS:
+    //-----------------------------------------------------------------------
+
+    //! If \b true, the adjacency below matches the allocated triangles.
+    bool m_normalCacheValid;
+
+    //! For each vertex, offset of its first triangle in m_vertexTriangles (one more entry than vertices).
+    vector<unsigned int> m_vertexTriangleOffsets;
+
+    //! Positions in m_allocatedTriangles of the triangles using each vertex.
+    vector<unsigned int> m_vertexTriangles;
+
+    //! Unit normal of each allocated triangle, zero if degenerate.
+    vector<cVector3d> m_triangleNormals;
+
+    //! Last stamp at which each allocated triangle was collected by updateNormals().
+    vector<unsigned int> m_triangleStamps;
+
+    //! Current stamp of updateNormals().
+    unsigned int m_normalStamp;
+
+    //! Triangles collected by updateNormals().
+    vector<unsigned int> m_normalTriangleList;
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS - NEIGHBORS:
+    //-----------------------------------------------------------------------
+
+    //! For each triangle, offset of its first neighbor in m_triangleNeighbors (one more entry than triangles).
+    vector<unsigned int> m_triangleNeighborOffsets;
+
+    //! Indices of the neighbors of each triangle, stored one triangle after the other.
+    vector<unsigned int> m_triangleNeighbors;
 };
 
 //---------------------------------------------------------------------------
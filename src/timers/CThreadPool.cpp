@@ -0,0 +1,470 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CThreadPool.h"
+//---------------------------------------------------------------------------
+#if defined(_LINUX) || defined(_MACOSX)
+#include <unistd.h>
+#endif
+//---------------------------------------------------------------------------
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+/*!
+    Arguments passed to a worker thread at creation.
+*/
+//---------------------------------------------------------------------------
+struct cThreadPoolWorker
+{
+    cThreadPool* m_pool;
+    unsigned int m_index;
+};
+#endif // DOXYGEN_SHOULD_SKIP_THIS
+
+
+//===========================================================================
+/*!
+    Constructor of cThreadPool. The worker threads are created immediately
+    and sleep until a loop is submitted.
+
+    \fn		cThreadPool::cThreadPool(const unsigned int a_numThreads)
+    \param  a_numThreads  Number of worker threads. If 0, one worker is
+                          created for each processor besides the one
+                          running the calling thread.
+*/
+//===========================================================================
+cThreadPool::cThreadPool(const unsigned int a_numThreads)
+{
+    m_numThreads = a_numThreads;
+    if (m_numThreads == 0)
+    {
+        m_numThreads = getNumProcessors() - 1;
+    }
+
+    m_task       = NULL;
+    m_data       = NULL;
+    m_count      = 0;
+    m_blockSize  = 1;
+    m_next       = 0;
+    m_numBusy    = 0;
+    m_generation = 0;
+    m_exit       = false;
+    m_workers    = new cThreadPoolWorker[m_numThreads + 1];
+
+    unsigned int i;
+
+#if defined(_WIN32)
+    InitializeCriticalSection(&m_mutex);
+    m_busy       = 0;
+    m_doneEvent  = CreateEvent(0, FALSE, FALSE, 0);
+    m_threads    = new HANDLE[m_numThreads + 1];
+    m_wakeEvents = new HANDLE[m_numThreads + 1];
+
+    for (i=0; i<m_numThreads; i++)
+    {
+        m_workers[i].m_pool  = this;
+        m_workers[i].m_index = i;
+        m_wakeEvents[i] = CreateEvent(0, FALSE, FALSE, 0);
+        m_threads[i] = CreateThread(0, 0, workerEntry, &m_workers[i], 0, 0);
+    }
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_mutex_init(&m_mutex, 0);
+    pthread_mutex_init(&m_callMutex, 0);
+    pthread_cond_init(&m_wakeCondition, 0);
+    pthread_cond_init(&m_doneCondition, 0);
+    m_threads = new pthread_t[m_numThreads + 1];
+
+    for (i=0; i<m_numThreads; i++)
+    {
+        m_workers[i].m_pool  = this;
+        m_workers[i].m_index = i;
+        pthread_create(&m_threads[i], 0, workerEntry, &m_workers[i]);
+    }
+#endif
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cThreadPool. Waits for all worker threads to terminate.
+
+    \fn		cThreadPool::~cThreadPool()
+*/
+//===========================================================================
+cThreadPool::~cThreadPool()
+{
+    unsigned int i;
+
+#if defined(_WIN32)
+    EnterCriticalSection(&m_mutex);
+    m_exit = true;
+    LeaveCriticalSection(&m_mutex);
+
+    for (i=0; i<m_numThreads; i++)
+    {
+        SetEvent(m_wakeEvents[i]);
+    }
+    for (i=0; i<m_numThreads; i++)
+    {
+        WaitForSingleObject(m_threads[i], INFINITE);
+        CloseHandle(m_threads[i]);
+        CloseHandle(m_wakeEvents[i]);
+    }
+
+    CloseHandle(m_doneEvent);
+    DeleteCriticalSection(&m_mutex);
+    delete [] m_wakeEvents;
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_mutex_lock(&m_mutex);
+    m_exit = true;
+    pthread_cond_broadcast(&m_wakeCondition);
+    pthread_mutex_unlock(&m_mutex);
+
+    for (i=0; i<m_numThreads; i++)
+    {
+        pthread_join(m_threads[i], 0);
+    }
+
+    pthread_cond_destroy(&m_wakeCondition);
+    pthread_cond_destroy(&m_doneCondition);
+    pthread_mutex_destroy(&m_mutex);
+    pthread_mutex_destroy(&m_callMutex);
+#endif
+
+    delete [] m_threads;
+    delete [] m_workers;
+}
+
+
+//===========================================================================
+/*!
+    Execute a task over the range [0, a_count). The range is cut into
+    blocks which are handed out to the worker threads and to the calling
+    thread. The method returns once every block has been processed.
+
+    Tasks of the same loop run concurrently and must therefore not write
+    to shared data without synchronization.
+
+    \fn		void cThreadPool::parallelFor(cThreadPoolTask a_task, void* a_data,
+                                  const unsigned int a_count,
+                                  const unsigned int a_minBlockSize)
+    \param  a_task  Function processing a block of iterations.
+    \param  a_data  User pointer passed to \e a_task.
+    \param  a_count  Number of iterations.
+    \param  a_minBlockSize  Minimum number of iterations per block.
+*/
+//===========================================================================
+void cThreadPool::parallelFor(cThreadPoolTask a_task, void* a_data,
+                              const unsigned int a_count,
+                              const unsigned int a_minBlockSize)
+{
+    if (a_count == 0) { return; }
+
+    // small loops, single processor machines and nested calls are
+    // processed serially on the calling thread
+    if ((m_numThreads == 0) || (a_count <= a_minBlockSize))
+    {
+        a_task(a_data, 0, a_count);
+        return;
+    }
+
+#if defined(_WIN32)
+    if (InterlockedCompareExchange(&m_busy, 1, 0) != 0)
+    {
+        a_task(a_data, 0, a_count);
+        return;
+    }
+    EnterCriticalSection(&m_mutex);
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    if (pthread_mutex_trylock(&m_callMutex) != 0)
+    {
+        a_task(a_data, 0, a_count);
+        return;
+    }
+    pthread_mutex_lock(&m_mutex);
+#endif
+
+    // hand out about four blocks per thread to balance the load
+    unsigned int numBlocks = 4 * (m_numThreads + 1);
+    m_blockSize = (a_count + numBlocks - 1) / numBlocks;
+    if (m_blockSize < a_minBlockSize) { m_blockSize = a_minBlockSize; }
+    if (m_blockSize < 1) { m_blockSize = 1; }
+
+    m_task    = a_task;
+    m_data    = a_data;
+    m_count   = a_count;
+    m_next    = 0;
+    m_numBusy = m_numThreads;
+    m_generation++;
+
+#if defined(_WIN32)
+    LeaveCriticalSection(&m_mutex);
+    for (unsigned int i=0; i<m_numThreads; i++)
+    {
+        SetEvent(m_wakeEvents[i]);
+    }
+
+    processBlocks();
+
+    WaitForSingleObject(m_doneEvent, INFINITE);
+    InterlockedExchange(&m_busy, 0);
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_cond_broadcast(&m_wakeCondition);
+    pthread_mutex_unlock(&m_mutex);
+
+    processBlocks();
+
+    pthread_mutex_lock(&m_mutex);
+    while (m_numBusy > 0)
+    {
+        pthread_cond_wait(&m_doneCondition, &m_mutex);
+    }
+    pthread_mutex_unlock(&m_mutex);
+    pthread_mutex_unlock(&m_callMutex);
+#endif
+}
+
+
+//===========================================================================
+/*!
+    Grab the next block of iterations of the current loop.
+
+    \fn		bool cThreadPool::nextBlock(unsigned int& a_begin, unsigned int& a_end)
+    \param  a_begin  Returns the first iteration of the block.
+    \param  a_end  Returns the iteration following the last one of the block.
+    \return Return \b false if the whole loop has been handed out.
+*/
+//===========================================================================
+bool cThreadPool::nextBlock(unsigned int& a_begin, unsigned int& a_end)
+{
+    bool result = false;
+
+#if defined(_WIN32)
+    EnterCriticalSection(&m_mutex);
+#endif
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_mutex_lock(&m_mutex);
+#endif
+
+    if (m_next < m_count)
+    {
+        a_begin = m_next;
+        a_end = m_next + m_blockSize;
+        if (a_end > m_count) { a_end = m_count; }
+        m_next = a_end;
+        result = true;
+    }
+
+#if defined(_WIN32)
+    LeaveCriticalSection(&m_mutex);
+#endif
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_mutex_unlock(&m_mutex);
+#endif
+
+    return (result);
+}
+
+
+//===========================================================================
+/*!
+    Process blocks of the current loop until none is left.
+
+    \fn		void cThreadPool::processBlocks()
+*/
+//===========================================================================
+void cThreadPool::processBlocks()
+{
+    unsigned int begin, end;
+    while (nextBlock(begin, end))
+    {
+        m_task(m_data, begin, end);
+    }
+}
+
+
+//===========================================================================
+/*!
+    Main loop of a worker thread: sleep until a loop is submitted, take
+    part in it, and report completion.
+
+    \fn		void cThreadPool::workerLoop(unsigned int a_workerIndex)
+    \param  a_workerIndex  Index of the worker.
+*/
+//===========================================================================
+void cThreadPool::workerLoop(unsigned int a_workerIndex)
+{
+#if defined(_WIN32)
+    while (true)
+    {
+        WaitForSingleObject(m_wakeEvents[a_workerIndex], INFINITE);
+        if (m_exit) { break; }
+
+        processBlocks();
+
+        EnterCriticalSection(&m_mutex);
+        m_numBusy--;
+        bool last = (m_numBusy == 0);
+        LeaveCriticalSection(&m_mutex);
+
+        if (last) { SetEvent(m_doneEvent); }
+    }
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    unsigned int generation = 0;
+
+    pthread_mutex_lock(&m_mutex);
+    while (true)
+    {
+        while ((!m_exit) && (m_generation == generation))
+        {
+            pthread_cond_wait(&m_wakeCondition, &m_mutex);
+        }
+        if (m_exit) { break; }
+        generation = m_generation;
+        pthread_mutex_unlock(&m_mutex);
+
+        processBlocks();
+
+        pthread_mutex_lock(&m_mutex);
+        m_numBusy--;
+        if (m_numBusy == 0)
+        {
+            pthread_cond_signal(&m_doneCondition);
+        }
+    }
+    pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+
+#if defined(_WIN32)
+//===========================================================================
+/*!
+    Entry point of a worker thread.
+
+    \fn		DWORD WINAPI cThreadPool::workerEntry(LPVOID a_arg)
+    \param  a_arg  Pointer to the cThreadPoolWorker of the thread.
+*/
+//===========================================================================
+DWORD WINAPI cThreadPool::workerEntry(LPVOID a_arg)
+{
+    cThreadPoolWorker* worker = (cThreadPoolWorker*)a_arg;
+    worker->m_pool->workerLoop(worker->m_index);
+    return (0);
+}
+#endif
+
+
+#if defined(_LINUX) || defined(_MACOSX)
+//===========================================================================
+/*!
+    Entry point of a worker thread.
+
+    \fn		void* cThreadPool::workerEntry(void* a_arg)
+    \param  a_arg  Pointer to the cThreadPoolWorker of the thread.
+*/
+//===========================================================================
+void* cThreadPool::workerEntry(void* a_arg)
+{
+    cThreadPoolWorker* worker = (cThreadPoolWorker*)a_arg;
+    worker->m_pool->workerLoop(worker->m_index);
+    return (0);
+}
+#endif
+
+
+//===========================================================================
+/*!
+    Return the number of processors available on the machine.
+
+    \fn		unsigned int cThreadPool::getNumProcessors()
+    \return Return the number of processors (at least 1).
+*/
+//===========================================================================
+unsigned int cThreadPool::getNumProcessors()
+{
+    long numProcessors = 1;
+
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    numProcessors = (long)info.dwNumberOfProcessors;
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    if (numProcessors < 1) { numProcessors = 1; }
+    return ((unsigned int)numProcessors);
+}
+
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+static cThreadPool* s_defaultPool = NULL;
+
+#if defined(_LINUX) || defined(_MACOSX)
+static pthread_once_t s_defaultPoolOnce = PTHREAD_ONCE_INIT;
+static void createDefaultPool() { s_defaultPool = new cThreadPool(); }
+#endif
+//---------------------------------------------------------------------------
+#endif // DOXYGEN_SHOULD_SKIP_THIS
+
+
+//===========================================================================
+/*!
+    Return the pool shared by the library. It is created the first time
+    it is requested, with one worker per additional processor.
+
+    \fn		cThreadPool* cThreadPool::getDefaultPool()
+    \return Return a pointer to the shared pool.
+*/
+//===========================================================================
+cThreadPool* cThreadPool::getDefaultPool()
+{
+#if defined(_WIN32)
+    if (s_defaultPool == NULL)
+    {
+        cThreadPool* pool = new cThreadPool();
+        if (InterlockedCompareExchangePointer((PVOID*)&s_defaultPool, pool, NULL) != NULL)
+        {
+            delete pool;
+        }
+    }
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_once(&s_defaultPoolOnce, createDefaultPool);
+#endif
+
+    return (s_defaultPool);
+}
@@ -0,0 +1,196 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CThreadPoolH
+#define CThreadPoolH
+//---------------------------------------------------------------------------
+#include "../extras/CGlobals.h"
+//---------------------------------------------------------------------------
+struct cThreadPoolWorker;
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CThreadPool.h
+
+    \brief
+    <b> Timers </b> \n
+    Pool of worker threads for data parallel loops.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+/*!
+    Function executed by the worker threads of a cThreadPool. Each call
+    processes the items [a_begin, a_end) of the loop; \e a_data is the
+    user pointer passed to cThreadPool::parallelFor().
+*/
+//---------------------------------------------------------------------------
+typedef void (*cThreadPoolTask)(void* a_data, unsigned int a_begin, unsigned int a_end);
+
+
+//===========================================================================
+/*!
+    \class	    cThreadPool
+    \ingroup    timers
+
+    \brief
+    cThreadPool keeps a set of worker threads alive and distributes
+    the iterations of a loop among them. The calling thread takes part
+    in the computation and returns once every iteration has completed.
+
+    Only one loop runs on a pool at a time. If parallelFor() is called
+    while the pool is busy (from another thread, or from inside a task),
+    the loop simply executes serially on the calling thread.
+*/
+//===========================================================================
+class cThreadPool
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cThreadPool. If \e a_numThreads is 0, one worker per extra processor is created.
+    cThreadPool(const unsigned int a_numThreads = 0);
+
+    //! Destructor of cThreadPool.
+    ~cThreadPool();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Execute \e a_task over the range [0, a_count), split in blocks of at least \e a_minBlockSize items.
+    void parallelFor(cThreadPoolTask a_task, void* a_data,
+                     const unsigned int a_count,
+                     const unsigned int a_minBlockSize = 1);
+
+    //! Number of worker threads (the calling thread is not included).
+    unsigned int getNumThreads() const { return (m_numThreads); }
+
+    //! Shared pool used by the library.
+    static cThreadPool* getDefaultPool();
+
+    //! Number of processors available on the machine.
+    static unsigned int getNumProcessors();
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Grab the next block of the current loop. Returns \b false when none is left.
+    bool nextBlock(unsigned int& a_begin, unsigned int& a_end);
+
+    //! Process blocks of the current loop until none is left.
+    void processBlocks();
+
+    //! Main loop of a worker thread.
+    void workerLoop(unsigned int a_workerIndex);
+
+#if defined(_WIN32)
+    //! Entry point of a worker thread.
+    static DWORD WINAPI workerEntry(LPVOID a_arg);
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    //! Entry point of a worker thread.
+    static void* workerEntry(void* a_arg);
+#endif
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Number of worker threads.
+    unsigned int m_numThreads;
+
+    //! Task of the current loop.
+    cThreadPoolTask m_task;
+
+    //! User data of the current loop.
+    void* m_data;
+
+    //! Number of iterations of the current loop.
+    unsigned int m_count;
+
+    //! Number of iterations handed out per block.
+    unsigned int m_blockSize;
+
+    //! Next iteration to be handed out.
+    unsigned int m_next;
+
+    //! Number of workers which have not yet finished the current loop.
+    unsigned int m_numBusy;
+
+    //! Incremented each time a new loop is started.
+    unsigned int m_generation;
+
+    //! If \b true, the workers leave their main loop.
+    bool m_exit;
+
+    //! Arguments passed to each worker thread.
+    cThreadPoolWorker* m_workers;
+
+#if defined(_WIN32)
+    //! Worker thread handles.
+    HANDLE* m_threads;
+
+    //! One auto-reset event per worker, signaled when a loop starts.
+    HANDLE* m_wakeEvents;
+
+    //! Signaled by the last worker to finish a loop.
+    HANDLE m_doneEvent;
+
+    //! Protects the loop state.
+    CRITICAL_SECTION m_mutex;
+
+    //! Non zero while a loop is running; unlike a critical section, it cannot be re-entered by its owner.
+    volatile LONG m_busy;
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    //! Worker thread handles.
+    pthread_t* m_threads;
+
+    //! Protects the loop state.
+    pthread_mutex_t m_mutex;
+
+    //! Held by the thread currently running a loop.
+    pthread_mutex_t m_callMutex;
+
+    //! Signaled when a loop starts.
+    pthread_cond_t m_wakeCondition;
+
+    //! Signaled by the last worker to finish a loop.
+    pthread_cond_t m_doneCondition;
+#endif
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
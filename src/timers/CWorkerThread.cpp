@@ -0,0 +1,275 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CWorkerThread.h"
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cWorkerThread. The thread is created immediately and
+    sleeps until a task is posted.
+
+    \fn		cWorkerThread::cWorkerThread()
+*/
+//===========================================================================
+cWorkerThread::cWorkerThread()
+{
+    m_numPending = 0;
+    m_exit = false;
+
+#if defined(_WIN32)
+    InitializeCriticalSection(&m_mutex);
+    m_wakeEvent = CreateEvent(0, FALSE, FALSE, 0);
+    m_idleEvent = CreateEvent(0, TRUE, TRUE, 0);
+    m_thread = CreateThread(0, 0, workerEntry, this, 0, 0);
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_mutex_init(&m_mutex, 0);
+    pthread_cond_init(&m_wakeCondition, 0);
+    pthread_cond_init(&m_idleCondition, 0);
+    pthread_create(&m_thread, 0, workerEntry, this);
+#endif
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cWorkerThread. Tasks still in the queue are executed
+    before the thread terminates.
+
+    \fn		cWorkerThread::~cWorkerThread()
+*/
+//===========================================================================
+cWorkerThread::~cWorkerThread()
+{
+#if defined(_WIN32)
+    EnterCriticalSection(&m_mutex);
+    m_exit = true;
+    LeaveCriticalSection(&m_mutex);
+    SetEvent(m_wakeEvent);
+
+    WaitForSingleObject(m_thread, INFINITE);
+    CloseHandle(m_thread);
+    CloseHandle(m_wakeEvent);
+    CloseHandle(m_idleEvent);
+    DeleteCriticalSection(&m_mutex);
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_mutex_lock(&m_mutex);
+    m_exit = true;
+    pthread_cond_signal(&m_wakeCondition);
+    pthread_mutex_unlock(&m_mutex);
+
+    pthread_join(m_thread, 0);
+    pthread_cond_destroy(&m_wakeCondition);
+    pthread_cond_destroy(&m_idleCondition);
+    pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+
+//===========================================================================
+/*!
+    Queue a task. The call returns immediately; the task is executed on
+    the worker thread after all previously posted tasks.
+
+    \fn		void cWorkerThread::post(cWorkerThreadTask a_task, void* a_data)
+    \param  a_task  Function to execute.
+    \param  a_data  User pointer passed to \e a_task.
+*/
+//===========================================================================
+void cWorkerThread::post(cWorkerThreadTask a_task, void* a_data)
+{
+    cWorkerThreadJob job;
+    job.m_task = a_task;
+    job.m_data = a_data;
+
+#if defined(_WIN32)
+    EnterCriticalSection(&m_mutex);
+    m_jobs.push_back(job);
+    m_numPending++;
+    ResetEvent(m_idleEvent);
+    LeaveCriticalSection(&m_mutex);
+    SetEvent(m_wakeEvent);
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_mutex_lock(&m_mutex);
+    m_jobs.push_back(job);
+    m_numPending++;
+    pthread_cond_signal(&m_wakeCondition);
+    pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+
+//===========================================================================
+/*!
+    Return the number of tasks which are queued or running. Once it
+    returns 0, results written by earlier tasks are visible to the caller.
+
+    \fn		unsigned int cWorkerThread::getNumPendingTasks()
+    \return Return the number of pending tasks.
+*/
+//===========================================================================
+unsigned int cWorkerThread::getNumPendingTasks()
+{
+    unsigned int result = 0;
+
+#if defined(_WIN32)
+    EnterCriticalSection(&m_mutex);
+    result = m_numPending;
+    LeaveCriticalSection(&m_mutex);
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_mutex_lock(&m_mutex);
+    result = m_numPending;
+    pthread_mutex_unlock(&m_mutex);
+#endif
+
+    return (result);
+}
+
+
+//===========================================================================
+/*!
+    Block until every posted task has completed.
+
+    \fn		void cWorkerThread::waitAll()
+*/
+//===========================================================================
+void cWorkerThread::waitAll()
+{
+#if defined(_WIN32)
+    WaitForSingleObject(m_idleEvent, INFINITE);
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_mutex_lock(&m_mutex);
+    while (m_numPending > 0)
+    {
+        pthread_cond_wait(&m_idleCondition, &m_mutex);
+    }
+    pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+
+//===========================================================================
+/*!
+    Main loop of the worker thread: execute queued tasks, and sleep while
+    the queue is empty.
+
+    \fn		void cWorkerThread::workerLoop()
+*/
+//===========================================================================
+void cWorkerThread::workerLoop()
+{
+    cWorkerThreadJob job;
+
+#if defined(_WIN32)
+    while (true)
+    {
+        EnterCriticalSection(&m_mutex);
+        if (m_jobs.empty())
+        {
+            bool exit = m_exit;
+            LeaveCriticalSection(&m_mutex);
+            if (exit) { break; }
+            WaitForSingleObject(m_wakeEvent, INFINITE);
+            continue;
+        }
+        job = m_jobs.front();
+        m_jobs.pop_front();
+        LeaveCriticalSection(&m_mutex);
+
+        job.m_task(job.m_data);
+
+        EnterCriticalSection(&m_mutex);
+        m_numPending--;
+        if (m_numPending == 0) { SetEvent(m_idleEvent); }
+        LeaveCriticalSection(&m_mutex);
+    }
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    pthread_mutex_lock(&m_mutex);
+    while (true)
+    {
+        while ((m_jobs.empty()) && (!m_exit))
+        {
+            pthread_cond_wait(&m_wakeCondition, &m_mutex);
+        }
+        if (m_jobs.empty()) { break; }
+
+        job = m_jobs.front();
+        m_jobs.pop_front();
+        pthread_mutex_unlock(&m_mutex);
+
+        job.m_task(job.m_data);
+
+        pthread_mutex_lock(&m_mutex);
+        m_numPending--;
+        if (m_numPending == 0)
+        {
+            pthread_cond_broadcast(&m_idleCondition);
+        }
+    }
+    pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+
+#if defined(_WIN32)
+//===========================================================================
+/*!
+    Entry point of the worker thread.
+
+    \fn		DWORD WINAPI cWorkerThread::workerEntry(LPVOID a_arg)
+    \param  a_arg  Pointer to the cWorkerThread.
+*/
+//===========================================================================
+DWORD WINAPI cWorkerThread::workerEntry(LPVOID a_arg)
+{
+    ((cWorkerThread*)a_arg)->workerLoop();
+    return (0);
+}
+#endif
+
+
+#if defined(_LINUX) || defined(_MACOSX)
+//===========================================================================
+/*!
+    Entry point of the worker thread.
+
+    \fn		void* cWorkerThread::workerEntry(void* a_arg)
+    \param  a_arg  Pointer to the cWorkerThread.
+*/
+//===========================================================================
+void* cWorkerThread::workerEntry(void* a_arg)
+{
+    ((cWorkerThread*)a_arg)->workerLoop();
+    return (0);
+}
+#endif
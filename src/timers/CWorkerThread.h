@@ -0,0 +1,167 @@
+//===========================================================================
+/*
+    This file is part of the CHAI 3D visualization and haptics libraries.
+    Copyright (C) 2003-2009 by CHAI 3D. All rights reserved.
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.
+
+    For using the CHAI 3D libraries with software that can not be combined
+    with the GNU GPL, and for taking advantage of the additional benefits
+    of our support services, please contact CHAI 3D about acquiring a
+    Professional Edition License.
+
+    \author    <http://www.chai3d.org>
+    \author    Francois Conti
+    \version   2.0.0 $Rev: 251 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CWorkerThreadH
+#define CWorkerThreadH
+//---------------------------------------------------------------------------
+#include "../extras/CGlobals.h"
+#include <list>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \file       CWorkerThread.h
+
+    \brief
+    <b> Timers </b> \n
+    Background thread executing queued tasks.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+/*!
+    Function executed by a cWorkerThread; \e a_data is the user pointer
+    passed to cWorkerThread::post().
+*/
+//---------------------------------------------------------------------------
+typedef void (*cWorkerThreadTask)(void* a_data);
+
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+//---------------------------------------------------------------------------
+/*!
+    Task waiting in the queue of a cWorkerThread.
+*/
+//---------------------------------------------------------------------------
+struct cWorkerThreadJob
+{
+    cWorkerThreadTask m_task;
+    void* m_data;
+};
+#endif // DOXYGEN_SHOULD_SKIP_THIS
+
+
+//===========================================================================
+/*!
+    \class	    cWorkerThread
+    \ingroup    timers
+
+    \brief
+    cWorkerThread owns a background thread which executes tasks one after
+    the other, in the order in which they were posted. Posting a task
+    never blocks, which allows time critical loops such as the haptic
+    loop to delegate expensive work and pick up the result later.
+*/
+//===========================================================================
+class cWorkerThread
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cWorkerThread.
+    cWorkerThread();
+
+    //! Destructor of cWorkerThread. Pending tasks are completed first.
+    ~cWorkerThread();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Queue a task for execution on the worker thread.
+    void post(cWorkerThreadTask a_task, void* a_data);
+
+    //! Number of tasks queued or running.
+    unsigned int getNumPendingTasks();
+
+    //! Wait until all posted tasks have completed.
+    void waitAll();
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Main loop of the worker thread.
+    void workerLoop();
+
+#if defined(_WIN32)
+    //! Entry point of the worker thread.
+    static DWORD WINAPI workerEntry(LPVOID a_arg);
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    //! Entry point of the worker thread.
+    static void* workerEntry(void* a_arg);
+#endif
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Tasks waiting for execution.
+    std::list<cWorkerThreadJob> m_jobs;
+
+    //! Number of tasks queued or running.
+    unsigned int m_numPending;
+
+    //! If \b true, the worker leaves its main loop once the queue is empty.
+    bool m_exit;
+
+#if defined(_WIN32)
+    //! Worker thread handle.
+    HANDLE m_thread;
+
+    //! Auto-reset event signaled when a task is posted.
+    HANDLE m_wakeEvent;
+
+    //! Manual-reset event signaled while no task is pending.
+    HANDLE m_idleEvent;
+
+    //! Protects the queue.
+    CRITICAL_SECTION m_mutex;
+#endif
+
+#if defined(_LINUX) || defined(_MACOSX)
+    //! Worker thread handle.
+    pthread_t m_thread;
+
+    //! Protects the queue.
+    pthread_mutex_t m_mutex;
+
+    //! Signaled when a task is posted.
+    pthread_cond_t m_wakeCondition;
+
+    //! Signaled when the last pending task completes.
+    pthread_cond_t m_idleCondition;
+#endif
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------